@@ -62,6 +62,9 @@
 
 #include <stdarg.h>
 #include <stdio.h>
+#ifdef HAVE_ZLIB
+# include <zlib.h>
+#endif
 
 #include "windef.h"
 #include "winbase.h"
@@ -73,7 +76,9 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(cabinet);
 
+#ifndef HAVE_ZLIB
 THOSE_ZIP_CONSTS;
+#endif
 
 struct fdi_file {
   struct fdi_file *next;               /* next file in sequence          */
@@ -154,6 +159,11 @@ typedef struct fdi_cds_fwd {
   cab_ULONG q_position_base[42];
   cab_ULONG lzx_position_base[51];
   cab_UBYTE extra_bits[51];
+#ifdef HAVE_ZLIB
+  z_stream zstream;                /* zlib state for MSZIP blocks           */
+  BOOL     zstream_init;
+  struct fdi_pipeline *pipeline;   /* decode thread for MSZIP folders       */
+#endif
   USHORT  setID;                   /* Cabinet set ID */
   USHORT  iCabinet;                /* Cabinet number in set (0 based) */
   struct fdi_cds_fwd *decomp_cab;
@@ -857,6 +867,8 @@ static int NONEfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
   return DECR_OK;
 }
 
+#ifndef HAVE_ZLIB
+
 /********************************************************
  * Ziphuft_free (internal)
  */
@@ -1400,11 +1412,211 @@ static cab_LONG fdi_Zipinflate_block(cab_LONG *e, fdi_decomp_state *decomp_state
   return 2;
 }
 
+#endif  /* HAVE_ZLIB */
+
+#ifdef HAVE_ZLIB
+
+/* number of blocks in flight between the reader and the decode thread */
+#define FDI_PIPELINE_DEPTH 4
+
+struct fdi_block {
+  cab_UBYTE inbuf[CAB_INPUTMAX+2];
+  cab_UBYTE outbuf[CAB_BLOCKMAX];
+  cab_UWORD inlen, outlen;
+  int err;
+};
+
+/*
+ * MSZIP folders that lie entirely in one cabinet are decoded on a separate
+ * thread.  The caller's thread reads blocks ahead with the FDI callbacks and
+ * writes out the decoded data; the decode thread inflates them in order.
+ * Blocks are numbered from the start of the folder: "read" have been read in,
+ * "decoded" have been inflated and "used" have been handed to fdi_decomp.
+ */
+struct fdi_pipeline {
+  CRITICAL_SECTION cs;
+  CONDITION_VARIABLE cv;
+  HANDLE thread;
+  BOOL quit;
+  z_stream zstream;
+  BOOL zstream_init;
+  cab_ULONG total, read, decoded, used;
+  struct fdi_block blocks[FDI_PIPELINE_DEPTH];
+};
+
+static voidpf fdi_zalloc( voidpf opaque, uInt items, uInt size )
+{
+    FDI_Int *fdi = opaque;
+    return fdi->alloc( items * size );
+}
+
+static void fdi_zfree( voidpf opaque, voidpf address )
+{
+    FDI_Int *fdi = opaque;
+    fdi->free( address );
+}
+
+/* the decode thread must not call into the FDI callbacks */
+static voidpf fdi_zalloc_heap( voidpf opaque, uInt items, uInt size )
+{
+    return HeapAlloc( GetProcessHeap(), 0, items * size );
+}
+
+static void fdi_zfree_heap( voidpf opaque, voidpf address )
+{
+    HeapFree( GetProcessHeap(), 0, address );
+}
+
+/****************************************************
+ * fdi_zlib_inflate(internal)
+ *
+ * Inflates an MSZIP block with zlib. Back references may reach into the
+ * previous block, so its whole output buffer is handed to zlib as the
+ * dictionary; this matches the window wrap-around of fdi_Zipinflate_codes.
+ */
+static int fdi_zlib_inflate(z_stream *stream, const cab_UBYTE *in, int inlen,
+  const cab_UBYTE *dict, cab_UBYTE *out, int outlen)
+{
+  int ret;
+
+  if (outlen > ZIPWSIZE)
+    return DECR_DATAFORMAT;
+
+  /* CK = Chris Kirmse, official Microsoft purloiner */
+  if (inlen < 2 || in[0] != 0x43 || in[1] != 0x4B)
+    return DECR_ILLEGALDATA;
+
+  if (inflateReset(stream) != Z_OK)
+    return DECR_ILLEGALDATA;
+
+  if (dict && inflateSetDictionary(stream, dict, CAB_BLOCKMAX) != Z_OK)
+    return DECR_ILLEGALDATA;
+
+  stream->next_in = (Bytef *)in + 2;
+  stream->avail_in = inlen - 2;
+  stream->next_out = out;
+  stream->avail_out = CAB_BLOCKMAX;
+
+  ret = inflate(stream, Z_FINISH);
+  if (ret == Z_MEM_ERROR) return DECR_NOMEMORY;
+  if (ret != Z_STREAM_END) return DECR_ILLEGALDATA;
+  if (CAB_BLOCKMAX - stream->avail_out != outlen) return DECR_ILLEGALDATA;
+  return DECR_OK;
+}
+
+static int ZIPfdi_zlib_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
+{
+  z_stream *stream = &CAB(zstream);
+
+  if (!CAB(zstream_init)) {
+    stream->zalloc = fdi_zalloc;
+    stream->zfree = fdi_zfree;
+    stream->opaque = CAB(fdi);
+    stream->next_in = NULL;
+    stream->avail_in = 0;
+    if (inflateInit2(stream, -MAX_WBITS) != Z_OK)
+      return DECR_NOMEMORY;
+    CAB(zstream_init) = TRUE;
+  }
+
+  return fdi_zlib_inflate(stream, CAB(inbuf), inlen, CAB(outbuf), CAB(outbuf), outlen);
+}
+
+static DWORD CALLBACK fdi_pipeline_thread( void *arg )
+{
+  struct fdi_pipeline *pipe = arg;
+  struct fdi_block *block;
+  cab_ULONG index;
+
+  EnterCriticalSection( &pipe->cs );
+  for (;;)
+  {
+    while (!pipe->quit && pipe->decoded == pipe->read)
+      SleepConditionVariableCS( &pipe->cv, &pipe->cs, INFINITE );
+    if (pipe->quit) break;
+    index = pipe->decoded;
+    LeaveCriticalSection( &pipe->cs );
+
+    block = &pipe->blocks[index % FDI_PIPELINE_DEPTH];
+    if (!block->err)
+      block->err = fdi_zlib_inflate( &pipe->zstream, block->inbuf, block->inlen,
+                                     index ? pipe->blocks[(index - 1) % FDI_PIPELINE_DEPTH].outbuf : NULL,
+                                     block->outbuf, block->outlen );
+
+    EnterCriticalSection( &pipe->cs );
+    pipe->decoded++;
+    WakeAllConditionVariable( &pipe->cv );
+  }
+  LeaveCriticalSection( &pipe->cs );
+  return 0;
+}
+
+/* start decoding a folder on the decode thread; the cabinet is positioned at its first block */
+static BOOL fdi_pipeline_start(fdi_decomp_state *decomp_state, const struct fdi_folder *fol)
+{
+  struct fdi_pipeline *pipe = CAB(pipeline);
+
+  if (!pipe) {
+    if (!(pipe = CAB(fdi)->alloc(sizeof(*pipe)))) return FALSE;
+    ZeroMemory(pipe, sizeof(*pipe));
+    pipe->zstream.zalloc = fdi_zalloc_heap;
+    pipe->zstream.zfree = fdi_zfree_heap;
+    if (inflateInit2(&pipe->zstream, -MAX_WBITS) != Z_OK) {
+      CAB(fdi)->free(pipe);
+      return FALSE;
+    }
+    InitializeCriticalSection(&pipe->cs);
+    InitializeConditionVariable(&pipe->cv);
+    if (!(pipe->thread = CreateThread(NULL, 0, fdi_pipeline_thread, pipe, 0, NULL))) {
+      inflateEnd(&pipe->zstream);
+      DeleteCriticalSection(&pipe->cs);
+      CAB(fdi)->free(pipe);
+      return FALSE;
+    }
+    CAB(pipeline) = pipe;
+  }
+
+  EnterCriticalSection(&pipe->cs);
+  pipe->total = fol->num_blocks;
+  LeaveCriticalSection(&pipe->cs);
+  return TRUE;
+}
+
+/* wait for the decode thread to go idle and drop the blocks of the current folder */
+static void fdi_pipeline_reset(struct fdi_pipeline *pipe)
+{
+  EnterCriticalSection(&pipe->cs);
+  while (pipe->decoded != pipe->read)
+    SleepConditionVariableCS(&pipe->cv, &pipe->cs, INFINITE);
+  pipe->total = pipe->read = pipe->decoded = pipe->used = 0;
+  LeaveCriticalSection(&pipe->cs);
+}
+
+static void fdi_pipeline_free(FDI_Int *fdi, struct fdi_pipeline *pipe)
+{
+  EnterCriticalSection(&pipe->cs);
+  pipe->quit = TRUE;
+  WakeAllConditionVariable(&pipe->cv);
+  LeaveCriticalSection(&pipe->cs);
+  WaitForSingleObject(pipe->thread, INFINITE);
+  CloseHandle(pipe->thread);
+  inflateEnd(&pipe->zstream);
+  DeleteCriticalSection(&pipe->cs);
+  fdi->free(pipe);
+}
+
+#endif  /* HAVE_ZLIB */
+
 /****************************************************
  * ZIPfdi_decomp(internal)
  */
 static int ZIPfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
 {
+#ifdef HAVE_ZLIB
+  TRACE("(inlen == %d, outlen == %d)\n", inlen, outlen);
+
+  return ZIPfdi_zlib_decomp(inlen, outlen, decomp_state);
+#else
   cab_LONG e;               /* last block flag */
 
   TRACE("(inlen == %d, outlen == %d)\n", inlen, outlen);
@@ -1426,6 +1638,7 @@ static int ZIPfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
 
   /* return success */
   return DECR_OK;
+#endif
 }
 
 /*******************************************************************
@@ -1923,6 +2136,94 @@ static int LZXfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
   return DECR_OK;
 }
 
+/**********************************************************
+ * fdi_read_block (internal)
+ *
+ * Reads the next data block of cab into data, which has room for maxlen
+ * bytes plus two bytes of padding, and verifies its checksum.
+ */
+static int fdi_read_block(FDI_Int *fdi, fdi_decomp_state *cab, cab_UBYTE *data, cab_UWORD maxlen,
+  cab_UWORD *len, cab_UWORD *outlen)
+{
+  cab_UBYTE buf[cfdata_SIZEOF];
+  cab_ULONG cksum;
+
+  /* read the block header, skip the reserved part */
+  if (fdi->read(cab->cabhf, buf, cfdata_SIZEOF) != cfdata_SIZEOF)
+    return DECR_INPUT;
+
+  if (fdi->seek(cab->cabhf, cab->mii.block_resv, SEEK_CUR) == -1)
+    return DECR_INPUT;
+
+  /* we shouldn't get blocks over CAB_INPUTMAX in size */
+  *len = EndGetI16(buf+cfdata_CompressedSize);
+  if (*len > maxlen) return DECR_INPUT;
+  if (fdi->read(cab->cabhf, data, *len) != *len)
+    return DECR_INPUT;
+
+  /* clear two bytes after read-in data */
+  data[*len+1] = data[*len+2] = 0;
+
+  /* perform checksum test on the block (if one is stored) */
+  cksum = EndGetI32(buf+cfdata_CheckSum);
+  if (cksum && cksum != checksum(buf+4, 4, checksum(data, *len, 0)))
+    return DECR_CHECKSUM; /* checksum is wrong */
+
+  *outlen = EndGetI16(buf+cfdata_UncompressedSize);
+  return DECR_OK;
+}
+
+#ifdef HAVE_ZLIB
+
+/**********************************************************
+ * fdi_pipeline_next (internal)
+ *
+ * Hands the next decoded block of the folder to fdi_decomp.  Before
+ * waiting for it, reads in as many blocks as the decode thread has
+ * room for.
+ */
+static int fdi_pipeline_next(fdi_decomp_state *decomp_state)
+{
+  struct fdi_pipeline *pipe = CAB(pipeline);
+  struct fdi_block *block;
+  int err;
+
+  EnterCriticalSection(&pipe->cs);
+
+  /* a slot can be refilled once the block in it has been written out */
+  while (pipe->read < pipe->total && pipe->read < pipe->used + FDI_PIPELINE_DEPTH) {
+    block = &pipe->blocks[pipe->read % FDI_PIPELINE_DEPTH];
+    LeaveCriticalSection(&pipe->cs);
+
+    block->err = fdi_read_block(CAB(fdi), decomp_state, block->inbuf, CAB_INPUTMAX,
+                                &block->inlen, &block->outlen);
+    /* a split block means the folder continues in the next cabinet */
+    if (!block->err && !block->outlen) block->err = DECR_INPUT;
+
+    EnterCriticalSection(&pipe->cs);
+    if (block->err) pipe->total = pipe->read + 1;
+    pipe->read++;
+    WakeAllConditionVariable(&pipe->cv);
+  }
+
+  if (pipe->used == pipe->read) {
+    LeaveCriticalSection(&pipe->cs);
+    return DECR_INPUT;
+  }
+
+  while (pipe->decoded == pipe->used)
+    SleepConditionVariableCS(&pipe->cv, &pipe->cs, INFINITE);
+  block = &pipe->blocks[pipe->used++ % FDI_PIPELINE_DEPTH];
+  LeaveCriticalSection(&pipe->cs);
+
+  if ((err = block->err)) return err;
+  CAB(outlen) = block->outlen;
+  CAB(outpos) = block->outbuf;
+  return DECR_OK;
+}
+
+#endif  /* HAVE_ZLIB */
+
 /**********************************************************
  * fdi_decomp (internal)
  *
@@ -1939,9 +2240,7 @@ static int fdi_decomp(const struct fdi_file *fi, int savemode, fdi_decomp_state
   char *pszCabPath, PFNFDINOTIFY pfnfdin, void *pvUser)
 {
   cab_ULONG bytes = savemode ? fi->length : fi->offset - CAB(offset);
-  cab_UBYTE buf[cfdata_SIZEOF], *data;
   cab_UWORD inlen, len, outlen, cando;
-  cab_ULONG cksum;
   cab_LONG err;
   fdi_decomp_state *cab = (savemode && CAB(decomp_cab)) ? CAB(decomp_cab) : decomp_state;
 
@@ -1962,33 +2261,20 @@ static int fdi_decomp(const struct fdi_file *fi, int savemode, fdi_decomp_state
 
     /* we only get here if we emptied the output buffer */
 
+#ifdef HAVE_ZLIB
+    if (CAB(pipeline) && CAB(pipeline)->total) {
+      if ((err = fdi_pipeline_next(decomp_state)))
+        return err;
+      continue;
+    }
+#endif
+
     /* read data header + data */
     inlen = outlen = 0;
     while (outlen == 0) {
-      /* read the block header, skip the reserved part */
-      if (CAB(fdi)->read(cab->cabhf, buf, cfdata_SIZEOF) != cfdata_SIZEOF)
-        return DECR_INPUT;
-
-      if (CAB(fdi)->seek(cab->cabhf, cab->mii.block_resv, SEEK_CUR) == -1)
-        return DECR_INPUT;
-
-      /* we shouldn't get blocks over CAB_INPUTMAX in size */
-      data = CAB(inbuf) + inlen;
-      len = EndGetI16(buf+cfdata_CompressedSize);
+      if ((err = fdi_read_block(CAB(fdi), cab, CAB(inbuf) + inlen, CAB_INPUTMAX - inlen, &len, &outlen)))
+        return err;
       inlen += len;
-      if (inlen > CAB_INPUTMAX) return DECR_INPUT;
-      if (CAB(fdi)->read(cab->cabhf, data, len) != len)
-        return DECR_INPUT;
-
-      /* clear two bytes after read-in data */
-      data[len+1] = data[len+2] = 0;
-
-      /* perform checksum test on the block (if one is stored) */
-      cksum = EndGetI32(buf+cfdata_CheckSum);
-      if (cksum && cksum != checksum(buf+4, 4, checksum(data, len, 0)))
-        return DECR_CHECKSUM; /* checksum is wrong */
-
-      outlen = EndGetI16(buf+cfdata_UncompressedSize);
 
       /* outlen=0 means this block was the last contiguous part
          of a split block, continued in the next cabinet */
@@ -2228,6 +2514,11 @@ static void free_decompression_mem(FDI_Int *fdi, fdi_decomp_state *decomp_state)
 
     fdi->close(CAB(cabhf));
 
+#ifdef HAVE_ZLIB
+    if (CAB(pipeline)) fdi_pipeline_free(fdi, CAB(pipeline));
+    if (CAB(zstream_init)) inflateEnd(&CAB(zstream));
+#endif
+
     /* free the storage remembered by mii */
     if (CAB(mii).nextname) fdi->free(CAB(mii).nextname);
     if (CAB(mii).nextinfo) fdi->free(CAB(mii).nextinfo);
@@ -2695,6 +2986,10 @@ BOOL __cdecl FDICopy(
           break;
         }
 
+#ifdef HAVE_ZLIB
+        if (CAB(pipeline)) fdi_pipeline_reset(CAB(pipeline));
+#endif
+
         CAB(decomp_cab) = NULL;
         CAB(fdi)->seek(CAB(cabhf), fol->offset, SEEK_SET);
         CAB(offset) = 0;
@@ -2707,6 +3002,12 @@ BOOL __cdecl FDICopy(
           break;
         case cffoldCOMPTYPE_MSZIP:
           CAB(decompress) = ZIPfdi_decomp;
+#ifdef HAVE_ZLIB
+          /* split folders are decoded in place, they need the NEXT_CABINET handling */
+          if (fol->num_blocks > 1 && !(fol == CAB(firstfol) && fdici.hasprev) &&
+              !(!fol->next && CAB(mii).hasnext))
+            fdi_pipeline_start(decomp_state, fol);
+#endif
           break;
         case cffoldCOMPTYPE_QUANTUM:
           CAB(decompress) = QTMfdi_decomp;
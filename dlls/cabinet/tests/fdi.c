@@ -948,6 +948,135 @@ static void test_FDICopy(void)
     FDIDestroy(hfdi);
 }
 
+/* Files large enough to span several MSZIP blocks, checked as they are written */
+static struct mszip_file
+{
+    char name[16];
+    char *data;
+    ULONG size, pos;
+    BOOL extract, closed;
+} mszip_files[2];
+
+static UINT CDECL fdi_mszip_write(INT_PTR hf, void *pv, UINT cb)
+{
+    struct mszip_file *file = (struct mszip_file *)hf;
+
+    ok(file->pos + cb <= file->size, "%s: wrote past the end, pos %u, cb %u\n", file->name, file->pos, cb);
+    if (file->pos + cb <= file->size)
+        ok(!memcmp(file->data + file->pos, pv, cb), "%s: data mismatch at %u\n", file->name, file->pos);
+    file->pos += cb;
+    return cb;
+}
+
+static INT_PTR CDECL fdi_mszip_notify(FDINOTIFICATIONTYPE fdint, FDINOTIFICATION *info)
+{
+    unsigned int i;
+
+    for (i = 0; i < 2; i++)
+        if (info->psz1 && !strcmp(info->psz1, mszip_files[i].name)) break;
+
+    switch (fdint)
+    {
+    case fdintCOPY_FILE:
+        ok(i < 2, "unexpected file %s\n", info->psz1);
+        if (i == 2 || !mszip_files[i].extract) return 0;
+        ok(info->cb == mszip_files[i].size, "%s: expected %u, got %u\n", info->psz1, mszip_files[i].size, info->cb);
+        mszip_files[i].pos = 0;
+        return (INT_PTR)&mszip_files[i];
+
+    case fdintCLOSE_FILE_INFO:
+        ok(i < 2, "unexpected file %s\n", info->psz1);
+        if (i == 2) return 1;
+        ok(info->hf == (INT_PTR)&mszip_files[i], "%s: got handle %#lx\n", info->psz1, info->hf);
+        ok(mszip_files[i].pos == mszip_files[i].size, "%s: expected %u bytes, got %u\n",
+           info->psz1, mszip_files[i].size, mszip_files[i].pos);
+        mszip_files[i].closed = TRUE;
+        return 1;
+
+    default:
+        return 0;
+    }
+}
+
+static void test_FDICopy_mszip(void)
+{
+    static const char chars[] = "abcdefghijklmnopqrstuvwxyz0123456789 \n";
+    static const ULONG sizes[2] = { 150000, 70001 };
+    char name[] = "mszip.cab";
+    char path[MAX_PATH + 1];
+    CCAB cabParams;
+    HFCI hfci;
+    HFDI hfdi;
+    ERF erf;
+    HANDLE handle;
+    DWORD written;
+    ULONG i, j;
+    BOOL ret;
+
+    for (i = 0; i < 2; i++)
+    {
+        sprintf(mszip_files[i].name, "mszip%u.dat", i);
+        mszip_files[i].size = sizes[i];
+        mszip_files[i].data = HeapAlloc(GetProcessHeap(), 0, sizes[i]);
+        /* repeats with a period that doesn't line up with the 32k blocks */
+        for (j = 0; j < sizes[i]; j++)
+            mszip_files[i].data[j] = chars[(j * 7 + j / 1000 + i) % (sizeof(chars) - 1)];
+
+        handle = CreateFileA(mszip_files[i].name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+        ok(handle != INVALID_HANDLE_VALUE, "failed to create %s\n", mszip_files[i].name);
+        WriteFile(handle, mszip_files[i].data, sizes[i], &written, NULL);
+        CloseHandle(handle);
+    }
+
+    set_cab_parameters(&cabParams);
+    lstrcpyA(cabParams.szCab, name);
+
+    hfci = FCICreate(&erf, file_placed, mem_alloc, mem_free, fci_open,
+                     fci_read, fci_write, fci_close, fci_seek,
+                     fci_delete, get_temp_file, &cabParams, NULL);
+    ok(hfci != NULL, "Failed to create an FCI context\n");
+
+    add_file(hfci, mszip_files[0].name);
+    add_file(hfci, mszip_files[1].name);
+
+    ret = FCIFlushCabinet(hfci, FALSE, get_next_cabinet, progress);
+    ok(ret, "Failed to flush the cabinet\n");
+    FCIDestroy(hfci);
+
+    lstrcpyA(path, CURR_DIR);
+    lstrcatA(path, "\\");
+
+    hfdi = FDICreate(fdi_alloc, fdi_free, fdi_open, fdi_read,
+                     fdi_mszip_write, fdi_close, fdi_seek, cpuUNKNOWN, &erf);
+    ok(hfdi != NULL, "FDICreate error %d\n", erf.erfOper);
+
+    /* extract everything */
+    for (i = 0; i < 2; i++)
+    {
+        mszip_files[i].extract = TRUE;
+        mszip_files[i].closed = FALSE;
+    }
+    ret = FDICopy(hfdi, name, path, 0, fdi_mszip_notify, NULL, 0);
+    ok(ret, "FDICopy error %d\n", erf.erfOper);
+    ok(mszip_files[0].closed && mszip_files[1].closed, "not all files were extracted\n");
+
+    /* skip the first file, the second one starts in the middle of a block */
+    mszip_files[0].extract = FALSE;
+    mszip_files[1].closed = FALSE;
+    ret = FDICopy(hfdi, name, path, 0, fdi_mszip_notify, NULL, 0);
+    ok(ret, "FDICopy error %d\n", erf.erfOper);
+    ok(mszip_files[1].closed, "second file wasn't extracted\n");
+
+    FDIDestroy(hfdi);
+
+    for (i = 0; i < 2; i++)
+    {
+        DeleteFileA(mszip_files[i].name);
+        HeapFree(GetProcessHeap(), 0, mszip_files[i].data);
+    }
+    DeleteFileA(name);
+}
+
 
 START_TEST(fdi)
 {
@@ -955,4 +1084,5 @@ START_TEST(fdi)
     test_FDIDestroy();
     test_FDIIsCabinet();
     test_FDICopy();
+    test_FDICopy_mszip();
 }
@@ -22068,11 +22068,78 @@ static void test_evict_bound_resources(void)
     DestroyWindow(window);
 }
 
+static void run_csmt_tests(void)
+{
+    test_sanity();
+    lighting_test();
+    clear_test();
+    color_fill_test();
+    fog_test();
+    offscreen_test();
+    stretchrect_test();
+    release_buffer_test();
+    test_blend();
+    pixelshader_blending_test();
+    update_surface_test();
+    add_dirty_rect_test();
+}
+
+/* Run a subset of the tests in a child process, with wined3d executing the
+ * command stream on a separate thread. The setting is read when wined3d is
+ * loaded, so it can't be changed in this process. */
+static void test_csmt(void)
+{
+    static const char key_name[] = "Software\\Wine\\Direct3D";
+    char cmdline[MAX_PATH + 16], old_value[32], **argv;
+    DWORD size = sizeof(old_value), type;
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+    BOOL had_value, ret;
+    HKEY key;
+    LONG res;
+
+    if (strcmp(winetest_platform, "wine"))
+    {
+        skip("The multithreaded command stream is specific to Wine.\n");
+        return;
+    }
+
+    res = RegCreateKeyExA(HKEY_CURRENT_USER, key_name, 0, NULL, 0,
+            KEY_QUERY_VALUE | KEY_SET_VALUE, NULL, &key, NULL);
+    ok(!res, "Failed to open the Direct3D key, error %d.\n", res);
+    if (res)
+        return;
+    had_value = !RegQueryValueExA(key, "CSMT", NULL, &type, (BYTE *)old_value, &size);
+    res = RegSetValueExA(key, "CSMT", 0, REG_SZ, (const BYTE *)"enabled", sizeof("enabled"));
+    ok(!res, "Failed to set the CSMT value, error %d.\n", res);
+
+    winetest_get_mainargs(&argv);
+    sprintf(cmdline, "\"%s\" visual csmt", argv[0]);
+    memset(&startup, 0, sizeof(startup));
+    startup.cb = sizeof(startup);
+    ret = CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info);
+    ok(ret, "Failed to create the child process, error %u.\n", GetLastError());
+    if (ret)
+    {
+        winetest_wait_child_process(info.hProcess);
+        CloseHandle(info.hProcess);
+        CloseHandle(info.hThread);
+    }
+
+    if (had_value)
+        RegSetValueExA(key, "CSMT", 0, type, (const BYTE *)old_value, size);
+    else
+        RegDeleteValueA(key, "CSMT");
+    RegCloseKey(key);
+}
+
 START_TEST(visual)
 {
     D3DADAPTER_IDENTIFIER9 identifier;
     IDirect3D9 *d3d;
+    char **argv;
     HRESULT hr;
+    int argc;
 
     if (!(d3d = Direct3DCreate9(D3D_SDK_VERSION)))
     {
@@ -22080,6 +22147,14 @@ START_TEST(visual)
         return;
     }
 
+    argc = winetest_get_mainargs(&argv);
+    if (argc >= 3 && !strcmp(argv[2], "csmt"))
+    {
+        IDirect3D9_Release(d3d);
+        run_csmt_tests();
+        return;
+    }
+
     memset(&identifier, 0, sizeof(identifier));
     hr = IDirect3D9_GetAdapterIdentifier(d3d, 0, 0, &identifier);
     ok(SUCCEEDED(hr), "Failed to get adapter identifier, hr %#x.\n", hr);
@@ -22194,4 +22269,5 @@ START_TEST(visual)
     test_line_antialiasing_blending();
     test_dsy();
     test_evict_bound_resources();
+    test_csmt();
 }
@@ -26,9 +26,133 @@
 #include "wine/port.h"
 
 #include "d3dx9_private.h"
+#include "wine/simd.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3dx);
 
+#ifdef HAVE_SSE2_INTRINSICS
+
+static BOOL use_sse;
+
+/* The SSE versions add the products in the same order as the scalar code,
+ * so they give the same results as long as the latter doesn't use x87. */
+
+static inline void SSE_FUNC load_matrix_sse(__m128 *rows, const D3DXMATRIX *m)
+{
+    rows[0] = _mm_loadu_ps(m->u.m[0]);
+    rows[1] = _mm_loadu_ps(m->u.m[1]);
+    rows[2] = _mm_loadu_ps(m->u.m[2]);
+    rows[3] = _mm_loadu_ps(m->u.m[3]);
+}
+
+static inline __m128 SSE_FUNC transform_sse(const __m128 *rows, float x, float y, float z)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(rows[0], _mm_set1_ps(x)), _mm_mul_ps(rows[1], _mm_set1_ps(y))),
+            _mm_mul_ps(rows[2], _mm_set1_ps(z)));
+}
+
+static inline __m128 SSE_FUNC divide_by_w_sse(__m128 v)
+{
+    return _mm_div_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)));
+}
+
+static inline void SSE_FUNC store_vec2_sse(D3DXVECTOR2 *out, __m128 v)
+{
+    _mm_storel_pi((__m64 *)out, v);
+}
+
+static inline void SSE_FUNC store_vec3_sse(D3DXVECTOR3 *out, __m128 v)
+{
+    _mm_storel_pi((__m64 *)out, v);
+    _mm_store_ss(&out->z, _mm_movehl_ps(v, v));
+}
+
+static void SSE_FUNC matrix_multiply_sse(D3DXMATRIX *out, const D3DXMATRIX *m1, const D3DXMATRIX *m2, BOOL transpose)
+{
+    __m128 rows[4], res[4];
+    int i;
+
+    load_matrix_sse(rows, m2);
+    for (i = 0; i < 4; ++i)
+        res[i] = _mm_add_ps(transform_sse(rows, m1->u.m[i][0], m1->u.m[i][1], m1->u.m[i][2]),
+                _mm_mul_ps(rows[3], _mm_set1_ps(m1->u.m[i][3])));
+    if (transpose) _MM_TRANSPOSE4_PS(res[0], res[1], res[2], res[3]);
+    _mm_storeu_ps(out->u.m[0], res[0]);
+    _mm_storeu_ps(out->u.m[1], res[1]);
+    _mm_storeu_ps(out->u.m[2], res[2]);
+    _mm_storeu_ps(out->u.m[3], res[3]);
+}
+
+static void SSE_FUNC vec2_transform_array_sse(void *out, UINT outstride, const D3DXVECTOR2 *in, UINT instride,
+        const D3DXMATRIX *matrix, UINT elements, BOOL coord, BOOL normal)
+{
+    __m128 rows[4];
+    UINT i;
+
+    load_matrix_sse(rows, matrix);
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXVECTOR2 *v = (const D3DXVECTOR2 *)((const char *)in + instride * i);
+        __m128 res = _mm_add_ps(_mm_mul_ps(rows[0], _mm_set1_ps(v->x)), _mm_mul_ps(rows[1], _mm_set1_ps(v->y)));
+
+        if (!normal) res = _mm_add_ps(res, rows[3]);
+        if (coord) res = divide_by_w_sse(res);
+        if (coord || normal) store_vec2_sse((D3DXVECTOR2 *)((char *)out + outstride * i), res);
+        else _mm_storeu_ps((float *)((char *)out + outstride * i), res);
+    }
+}
+
+static void SSE_FUNC vec3_transform_array_sse(void *out, UINT outstride, const D3DXVECTOR3 *in, UINT instride,
+        const D3DXMATRIX *matrix, UINT elements, BOOL coord, BOOL normal)
+{
+    __m128 rows[4];
+    UINT i;
+
+    load_matrix_sse(rows, matrix);
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXVECTOR3 *v = (const D3DXVECTOR3 *)((const char *)in + instride * i);
+        __m128 res = transform_sse(rows, v->x, v->y, v->z);
+
+        if (!normal) res = _mm_add_ps(res, rows[3]);
+        if (coord) res = divide_by_w_sse(res);
+        if (coord || normal) store_vec3_sse((D3DXVECTOR3 *)((char *)out + outstride * i), res);
+        else _mm_storeu_ps((float *)((char *)out + outstride * i), res);
+    }
+}
+
+/* D3DXVECTOR4 and D3DXPLANE have the same layout */
+static void SSE_FUNC vec4_transform_array_sse(void *out, UINT outstride, const void *in, UINT instride,
+        const D3DXMATRIX *matrix, UINT elements)
+{
+    __m128 rows[4];
+    UINT i;
+
+    load_matrix_sse(rows, matrix);
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXVECTOR4 *v = (const D3DXVECTOR4 *)((const char *)in + instride * i);
+        __m128 res = _mm_add_ps(transform_sse(rows, v->x, v->y, v->z), _mm_mul_ps(rows[3], _mm_set1_ps(v->w)));
+
+        _mm_storeu_ps((float *)((char *)out + outstride * i), res);
+    }
+}
+
+#endif /* HAVE_SSE2_INTRINSICS */
+
+/***********************************************************************
+ *           init_math_functions
+ *
+ * Select the SIMD versions of the math functions supported by the CPU.
+ */
+void init_math_functions(void)
+{
+#ifdef HAVE_SSE2_INTRINSICS
+    use_sse = wine_sse_present();
+    TRACE("SSE math functions %s\n", use_sse ? "enabled" : "disabled");
+#endif
+}
+
 struct ID3DXMatrixStackImpl
 {
   ID3DXMatrixStack ID3DXMatrixStack_iface;
@@ -397,6 +521,14 @@ D3DXMATRIX* WINAPI D3DXMatrixMultiply(D3DXMATRIX *pout, const D3DXMATRIX *pm1, c
 
     TRACE("pout %p, pm1 %p, pm2 %p\n", pout, pm1, pm2);
 
+#ifdef HAVE_SSE2_INTRINSICS
+    if (use_sse)
+    {
+        matrix_multiply_sse(pout, pm1, pm2, FALSE);
+        return pout;
+    }
+#endif
+
     for (i=0; i<4; i++)
     {
         for (j=0; j<4; j++)
@@ -416,6 +548,14 @@ D3DXMATRIX* WINAPI D3DXMatrixMultiplyTranspose(D3DXMATRIX *pout, const D3DXMATRI
 
     TRACE("pout %p, pm1 %p, pm2 %p\n", pout, pm1, pm2);
 
+#ifdef HAVE_SSE2_INTRINSICS
+    if (use_sse)
+    {
+        matrix_multiply_sse(pout, pm1, pm2, TRUE);
+        return pout;
+    }
+#endif
+
     for (i = 0; i < 4; i++)
         for (j = 0; j < 4; j++)
             temp.u.m[j][i] = pm1->u.m[i][0] * pm2->u.m[0][j] + pm1->u.m[i][1] * pm2->u.m[1][j] + pm1->u.m[i][2] * pm2->u.m[2][j] + pm1->u.m[i][3] * pm2->u.m[3][j];
@@ -1328,6 +1468,14 @@ D3DXPLANE* WINAPI D3DXPlaneTransformArray(D3DXPLANE* out, UINT outstride, const
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+#ifdef HAVE_SSE2_INTRINSICS
+    if (use_sse)
+    {
+        vec4_transform_array_sse(out, outstride, in, instride, matrix, elements);
+        return out;
+    }
+#endif
+
     for (i = 0; i < elements; ++i) {
         D3DXPlaneTransform(
             (D3DXPLANE*)((char*)out + outstride * i),
@@ -1731,6 +1879,14 @@ D3DXVECTOR4* WINAPI D3DXVec2TransformArray(D3DXVECTOR4* out, UINT outstride, con
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+#ifdef HAVE_SSE2_INTRINSICS
+    if (use_sse)
+    {
+        vec2_transform_array_sse(out, outstride, in, instride, matrix, elements, FALSE, FALSE);
+        return out;
+    }
+#endif
+
     for (i = 0; i < elements; ++i) {
         D3DXVec2Transform(
             (D3DXVECTOR4*)((char*)out + outstride * i),
@@ -1762,6 +1918,14 @@ D3DXVECTOR2* WINAPI D3DXVec2TransformCoordArray(D3DXVECTOR2* out, UINT outstride
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+#ifdef HAVE_SSE2_INTRINSICS
+    if (use_sse)
+    {
+        vec2_transform_array_sse(out, outstride, in, instride, matrix, elements, TRUE, FALSE);
+        return out;
+    }
+#endif
+
     for (i = 0; i < elements; ++i) {
         D3DXVec2TransformCoord(
             (D3DXVECTOR2*)((char*)out + outstride * i),
@@ -1788,6 +1952,14 @@ D3DXVECTOR2* WINAPI D3DXVec2TransformNormalArray(D3DXVECTOR2* out, UINT outstrid
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+#ifdef HAVE_SSE2_INTRINSICS
+    if (use_sse)
+    {
+        vec2_transform_array_sse(out, outstride, in, instride, matrix, elements, FALSE, TRUE);
+        return out;
+    }
+#endif
+
     for (i = 0; i < elements; ++i) {
         D3DXVec2TransformNormal(
             (D3DXVECTOR2*)((char*)out + outstride * i),
@@ -1917,6 +2089,14 @@ D3DXVECTOR4* WINAPI D3DXVec3TransformArray(D3DXVECTOR4* out, UINT outstride, con
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+#ifdef HAVE_SSE2_INTRINSICS
+    if (use_sse)
+    {
+        vec3_transform_array_sse(out, outstride, in, instride, matrix, elements, FALSE, FALSE);
+        return out;
+    }
+#endif
+
     for (i = 0; i < elements; ++i) {
         D3DXVec3Transform(
             (D3DXVECTOR4*)((char*)out + outstride * i),
@@ -1950,6 +2130,14 @@ D3DXVECTOR3* WINAPI D3DXVec3TransformCoordArray(D3DXVECTOR3* out, UINT outstride
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+#ifdef HAVE_SSE2_INTRINSICS
+    if (use_sse)
+    {
+        vec3_transform_array_sse(out, outstride, in, instride, matrix, elements, TRUE, FALSE);
+        return out;
+    }
+#endif
+
     for (i = 0; i < elements; ++i) {
         D3DXVec3TransformCoord(
             (D3DXVECTOR3*)((char*)out + outstride * i),
@@ -1978,6 +2166,14 @@ D3DXVECTOR3* WINAPI D3DXVec3TransformNormalArray(D3DXVECTOR3* out, UINT outstrid
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+#ifdef HAVE_SSE2_INTRINSICS
+    if (use_sse)
+    {
+        vec3_transform_array_sse(out, outstride, in, instride, matrix, elements, FALSE, TRUE);
+        return out;
+    }
+#endif
+
     for (i = 0; i < elements; ++i) {
         D3DXVec3TransformNormal(
             (D3DXVECTOR3*)((char*)out + outstride * i),
@@ -2118,6 +2314,14 @@ D3DXVECTOR4* WINAPI D3DXVec4TransformArray(D3DXVECTOR4* out, UINT outstride, con
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+#ifdef HAVE_SSE2_INTRINSICS
+    if (use_sse)
+    {
+        vec4_transform_array_sse(out, outstride, in, instride, matrix, elements);
+        return out;
+    }
+#endif
+
     for (i = 0; i < elements; ++i) {
         D3DXVec4Transform(
             (D3DXVECTOR4*)((char*)out + outstride * i),
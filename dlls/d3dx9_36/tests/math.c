@@ -2366,6 +2366,99 @@ static void test_D3DXVec_Array(void)
     compare_planes(exp_plane, out_plane);
 }
 
+static void test_D3DXVec_Array_consistency(void)
+{
+    /* Strides that are not a multiple of 16, and a count large enough to
+     * exercise any vectorized path, compared against the single versions. */
+    static const UINT count = 101, stride = 20;
+    D3DXVECTOR4 expected, got;
+    D3DXMATRIX mat, mat2, res, res2;
+    BYTE in[101 * 20], out[101 * 20];
+    BOOL equal;
+    UINT i, j;
+
+    for (i = 0; i < 4; ++i)
+    {
+        for (j = 0; j < 4; ++j)
+        {
+            U(mat).m[i][j] = (i * 4 + j) * 0.25f - 1.5f;
+            U(mat2).m[i][j] = (j * 4 + i) * 0.5f + 1.0f;
+        }
+    }
+    /* keep the w component well away from zero for the coord variants */
+    U(mat).m[0][3] = 0.125f;
+    U(mat).m[1][3] = 0.25f;
+    U(mat).m[2][3] = 0.375f;
+    U(mat).m[3][3] = 7.0f;
+
+    for (i = 0; i < count; ++i)
+    {
+        D3DXVECTOR4 *v = (D3DXVECTOR4 *)(in + i * stride);
+        v->x = i * 0.5f - 20.0f;
+        v->y = 10.0f - i * 0.25f;
+        v->z = (i % 7) * 3.0f;
+        v->w = 1.0f + (i % 3);
+    }
+
+#define check_array(func, single, intype, outtype, fields) \
+    memset(out, 0, sizeof(out)); \
+    func((outtype *)out, stride, (const intype *)in, stride, &mat, count); \
+    for (i = 0, equal = TRUE; i < count && equal; ++i) \
+    { \
+        memset(&expected, 0, sizeof(expected)); \
+        memset(&got, 0, sizeof(got)); \
+        single((outtype *)&expected, (const intype *)(in + i * stride), &mat); \
+        memcpy(&got, out + i * stride, sizeof(outtype)); \
+        equal = relative_error(expected.x, got.x) < admitted_error && \
+                relative_error(expected.y, got.y) < admitted_error && \
+                (fields < 3 || relative_error(expected.z, got.z) < admitted_error) && \
+                (fields < 4 || relative_error(expected.w, got.w) < admitted_error); \
+    } \
+    ok(equal, #func ": got (%f, %f, %f, %f), expected (%f, %f, %f, %f) for index %u.\n", \
+            got.x, got.y, got.z, got.w, expected.x, expected.y, expected.z, expected.w, i - 1);
+
+    check_array(D3DXVec2TransformArray, D3DXVec2Transform, D3DXVECTOR2, D3DXVECTOR4, 4);
+    check_array(D3DXVec2TransformCoordArray, D3DXVec2TransformCoord, D3DXVECTOR2, D3DXVECTOR2, 2);
+    check_array(D3DXVec2TransformNormalArray, D3DXVec2TransformNormal, D3DXVECTOR2, D3DXVECTOR2, 2);
+    check_array(D3DXVec3TransformArray, D3DXVec3Transform, D3DXVECTOR3, D3DXVECTOR4, 4);
+    check_array(D3DXVec3TransformCoordArray, D3DXVec3TransformCoord, D3DXVECTOR3, D3DXVECTOR3, 3);
+    check_array(D3DXVec3TransformNormalArray, D3DXVec3TransformNormal, D3DXVECTOR3, D3DXVECTOR3, 3);
+    check_array(D3DXVec4TransformArray, D3DXVec4Transform, D3DXVECTOR4, D3DXVECTOR4, 4);
+    check_array(D3DXPlaneTransformArray, D3DXPlaneTransform, D3DXPLANE, D3DXPLANE, 4);
+
+#undef check_array
+
+    /* In place. */
+    memcpy(out, in, sizeof(out));
+    D3DXVec4TransformArray((D3DXVECTOR4 *)out, stride, (const D3DXVECTOR4 *)out, stride, &mat, count);
+    for (i = 0, equal = TRUE; i < count && equal; ++i)
+    {
+        D3DXVec4Transform(&expected, (const D3DXVECTOR4 *)(in + i * stride), &mat);
+        memcpy(&got, out + i * stride, sizeof(got));
+        equal = relative_error(expected.x, got.x) < admitted_error &&
+                relative_error(expected.y, got.y) < admitted_error &&
+                relative_error(expected.z, got.z) < admitted_error &&
+                relative_error(expected.w, got.w) < admitted_error;
+    }
+    ok(equal, "Got (%f, %f, %f, %f), expected (%f, %f, %f, %f) for index %u.\n",
+            got.x, got.y, got.z, got.w, expected.x, expected.y, expected.z, expected.w, i - 1);
+
+    /* Matrix products, including the output aliasing an input. */
+    for (i = 0; i < 4; ++i)
+        for (j = 0; j < 4; ++j)
+            U(res2).m[i][j] = U(mat).m[i][0] * U(mat2).m[0][j] + U(mat).m[i][1] * U(mat2).m[1][j]
+                    + U(mat).m[i][2] * U(mat2).m[2][j] + U(mat).m[i][3] * U(mat2).m[3][j];
+    D3DXMatrixMultiply(&res, &mat, &mat2);
+    expect_mat(&res2, &res);
+    res = mat;
+    D3DXMatrixMultiply(&res, &res, &mat2);
+    expect_mat(&res2, &res);
+    D3DXMatrixTranspose(&res2, &res2);
+    res = mat2;
+    D3DXMatrixMultiplyTranspose(&res, &mat, &res);
+    expect_mat(&res2, &res);
+}
+
 static void test_D3DXFloat_Array(void)
 {
     static const float z = 0.0f;
@@ -3435,6 +3528,7 @@ START_TEST(math)
     test_Matrix_Decompose();
     test_Matrix_Transformation2D();
     test_D3DXVec_Array();
+    test_D3DXVec_Array_consistency();
     test_D3DXFloat_Array();
     test_D3DXSHAdd();
     test_D3DXSHDot();
@@ -37,6 +37,7 @@
 #include "config.h"
 
 #include <stdarg.h>
+#include <string.h>
 #include <math.h>
 
 #include "windef.h"
@@ -44,6 +45,7 @@
 #include "mmsystem.h"
 #include "winternl.h"
 #include "wine/debug.h"
+#include "wine/simd.h"
 #include "dsound.h"
 #include "dsound_private.h"
 
@@ -102,6 +104,40 @@ static float getieee32(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD chann
 
 const bitsgetfunc getbpp[5] = {get8, get16, get24, get32, getieee32};
 
+/* Bulk versions of the getters above, used when a whole run of interleaved
+ * samples can be converted without resampling or channel remapping. */
+static void conv8_c(const void *src, float *dst, unsigned samples)
+{
+    const BYTE *buf = src;
+    unsigned i;
+
+    for (i = 0; i < samples; i++)
+        dst[i] = (buf[i] - 0x80) / (float)0x80;
+}
+
+static void conv16_c(const void *src, float *dst, unsigned samples)
+{
+    const SHORT *buf = src;
+    unsigned i;
+
+    for (i = 0; i < samples; i++)
+        dst[i] = (SHORT)le16(buf[i]) / (float)0x8000;
+}
+
+static void conv32_c(const void *src, float *dst, unsigned samples)
+{
+    const LONG *buf = src;
+    unsigned i;
+
+    for (i = 0; i < samples; i++)
+        dst[i] = (LONG)le32(buf[i]) / (float)0x80000000U;
+}
+
+static void convieee32_c(const void *src, float *dst, unsigned samples)
+{
+    memcpy(dst, src, samples * sizeof(float));
+}
+
 float get_mono(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel)
 {
     DWORD channels = dsb->pwfx->nChannels;
@@ -279,13 +315,32 @@ void put_quad2stereo(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel
     }
 }
 
-void mixieee32(float *src, float *dst, unsigned samples)
+static void mix_c(const float *src, float *dst, unsigned samples)
 {
     TRACE("%p - %p %d\n", src, dst, samples);
     while (samples--)
         *(dst++) += *(src++);
 }
 
+static void volume_c(float *buf, const float *vols, unsigned channels, unsigned frames)
+{
+    unsigned i, chan;
+
+    for (i = 0; i < frames; i++)
+        for (chan = 0; chan < channels; chan++)
+            *(buf++) *= vols[chan];
+}
+
+static float fir_c(const float *fir, const float *input, unsigned len)
+{
+    float sum = 0.0;
+    unsigned i;
+
+    for (i = 0; i < len; i++)
+        sum += fir[i] * input[i];
+    return sum;
+}
+
 static void norm8(float *src, unsigned char *dst, unsigned len)
 {
     TRACE("%p - %p %d\n", src, dst, len);
@@ -336,9 +391,253 @@ static void norm32(float *src, INT *dst, unsigned len)
     }
 }
 
-const normfunc normfunctions[4] = {
+#ifdef HAVE_SSE2_INTRINSICS
+
+static void SSE2_FUNC mix_sse2(const float *src, float *dst, unsigned samples)
+{
+    unsigned i;
+
+    TRACE("%p - %p %d\n", src, dst, samples);
+    for (i = 0; i + 4 <= samples; i += 4)
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+    for (; i < samples; i++)
+        dst[i] += src[i];
+}
+
+/* 4 * channels samples always hold a whole number of frames, so each of the
+ * channels vectors below sees the same volume pattern on every iteration. */
+static void SSE2_FUNC volume_sse2(float *buf, const float *vols, unsigned channels, unsigned frames)
+{
+    float pattern[4 * DS_MAX_CHANNELS];
+    __m128 v[DS_MAX_CHANNELS];
+    unsigned i, j, samples = frames * channels, block = 4 * channels;
+
+    for (i = 0; i < block; i++)
+        pattern[i] = vols[i % channels];
+    for (j = 0; j < channels; j++)
+        v[j] = _mm_loadu_ps(pattern + 4 * j);
+
+    for (i = 0; i + block <= samples; i += block)
+        for (j = 0; j < channels; j++)
+            _mm_storeu_ps(buf + i + 4 * j, _mm_mul_ps(_mm_loadu_ps(buf + i + 4 * j), v[j]));
+    for (; i < samples; i++)
+        buf[i] *= vols[i % channels];
+}
+
+static float SSE2_FUNC fir_sse2(const float *fir, const float *input, unsigned len)
+{
+    __m128 acc = _mm_setzero_ps();
+    float part[4], sum;
+    unsigned i;
+
+    for (i = 0; i + 4 <= len; i += 4)
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(fir + i), _mm_loadu_ps(input + i)));
+    _mm_storeu_ps(part, acc);
+    sum = part[0] + part[1] + part[2] + part[3];
+    for (; i < len; i++)
+        sum += fir[i] * input[i];
+    return sum;
+}
+
+/* Same results as f_to_16(); clamping before the conversion keeps
+ * cvtps2dq from returning the "integer indefinite" value. */
+static void SSE2_FUNC norm16_sse2(float *src, SHORT *dst, unsigned len)
+{
+    const __m128 min = _mm_set1_ps(-1.f), max = _mm_set1_ps(1.f), scale = _mm_set1_ps(0x8000);
+    unsigned i;
+
+    TRACE("%p - %p %d\n", src, dst, len);
+    len /= 2;
+    for (i = 0; i + 8 <= len; i += 8)
+    {
+        __m128 lo = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), min), max);
+        __m128 hi = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), min), max);
+        __m128i out = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(lo, scale)),
+                                      _mm_cvtps_epi32(_mm_mul_ps(hi, scale)));
+        _mm_storeu_si128((__m128i *)(dst + i), out);
+    }
+    for (; i < len; i++)
+        dst[i] = f_to_16(src[i]);
+}
+
+/* The scale factors are powers of two, so these match the C versions bit
+ * for bit. */
+static void SSE2_FUNC conv8_sse2(const void *src, float *dst, unsigned samples)
+{
+    const BYTE *buf = src;
+    const __m128i bias = _mm_set1_epi8(0x80);
+    const __m128 scale = _mm_set1_ps(1.f / 0x80);
+    unsigned i;
+
+    for (i = 0; i + 16 <= samples; i += 16)
+    {
+        __m128i in = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(buf + i)), bias);
+        __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(in, in), 8);
+        __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(in, in), 8);
+        _mm_storeu_ps(dst + i,      _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16)), scale));
+        _mm_storeu_ps(dst + i + 4,  _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16)), scale));
+        _mm_storeu_ps(dst + i + 8,  _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16)), scale));
+        _mm_storeu_ps(dst + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16)), scale));
+    }
+    for (; i < samples; i++)
+        dst[i] = (buf[i] - 0x80) / (float)0x80;
+}
+
+static void SSE2_FUNC conv16_sse2(const void *src, float *dst, unsigned samples)
+{
+    const SHORT *buf = src;
+    const __m128 scale = _mm_set1_ps(1.f / 0x8000);
+    unsigned i;
+
+    for (i = 0; i + 8 <= samples; i += 8)
+    {
+        __m128i in = _mm_loadu_si128((const __m128i *)(buf + i));
+        _mm_storeu_ps(dst + i,     _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(in, in), 16)), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(in, in), 16)), scale));
+    }
+    for (; i < samples; i++)
+        dst[i] = buf[i] / (float)0x8000;
+}
+
+static void SSE2_FUNC conv32_sse2(const void *src, float *dst, unsigned samples)
+{
+    const LONG *buf = src;
+    const __m128 scale = _mm_set1_ps(1.f / 0x80000000U);
+    unsigned i;
+
+    for (i = 0; i + 4 <= samples; i += 4)
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(buf + i))), scale));
+    for (; i < samples; i++)
+        dst[i] = buf[i] / (float)0x80000000U;
+}
+
+static void SSE2_FUNC norm32_sse2(float *src, INT *dst, unsigned len)
+{
+    const __m128 min = _mm_set1_ps(-1.f), max = _mm_set1_ps(1.f), scale = _mm_set1_ps(0x80000000U);
+    const __m128i top = _mm_set1_epi32(0x7FFFFFFF);
+    unsigned i;
+
+    TRACE("%p - %p %d\n", src, dst, len);
+    len /= 4;
+    for (i = 0; i + 4 <= len; i += 4)
+    {
+        __m128 v = _mm_loadu_ps(src + i);
+        __m128i clip = _mm_castps_si128(_mm_cmpge_ps(v, max));
+        __m128i out = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(v, min), max), scale));
+        out = _mm_or_si128(_mm_and_si128(clip, top), _mm_andnot_si128(clip, out));
+        _mm_storeu_si128((__m128i *)(dst + i), out);
+    }
+    for (; i < len; i++)
+        dst[i] = f_to_32(src[i]);
+}
+
+#endif /* HAVE_SSE2_INTRINSICS */
+
+convfunc convfunctions[5] = {conv8_c, conv16_c, NULL, conv32_c, convieee32_c};
+mixfunc mixieee32 = mix_c;
+volfunc volieee32 = volume_c;
+firfunc firieee32 = fir_c;
+
+normfunc normfunctions[4] = {
     (normfunc)norm8,
     (normfunc)norm16,
     (normfunc)norm24,
     (normfunc)norm32,
 };
+
+#ifdef HAVE_SSE2_INTRINSICS
+
+#define CHECK_SAMPLES 133
+
+static float check_value(unsigned *seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return ((*seed >> 8) & 0xffff) / 16384.f - 2.f;
+}
+
+/* Runs the C and SSE2 versions of every routine over the same odd-sized
+ * block, which includes out of range values, and checks that they agree.
+ * Everything but the FIR has to match exactly; the FIR adds up its
+ * products in a different order. */
+static BOOL check_sse2_functions(void)
+{
+    static const unsigned channels[] = {1, 2, 6};
+    float src[CHECK_SAMPLES], ref[CHECK_SAMPLES], out[CHECK_SAMPLES], vols[DS_MAX_CHANNELS];
+    union { BYTE b[4 * CHECK_SAMPLES]; SHORT s[CHECK_SAMPLES]; INT i[CHECK_SAMPLES]; } iref, iout;
+    float fir_ref, fir_out;
+    unsigned i, j, seed = 0x5eed;
+
+    for (i = 0; i < CHECK_SAMPLES; i++)
+        src[i] = check_value(&seed);
+    for (i = 0; i < DS_MAX_CHANNELS; i++)
+        vols[i] = (check_value(&seed) + 2.f) / 4.f;
+
+    for (i = 0; i < CHECK_SAMPLES; i++)
+        ref[i] = out[i] = check_value(&seed);
+    mix_c(src, ref, CHECK_SAMPLES);
+    mix_sse2(src, out, CHECK_SAMPLES);
+    if (memcmp(ref, out, sizeof(ref))) return FALSE;
+
+    for (j = 0; j < sizeof(channels) / sizeof(channels[0]); j++)
+    {
+        memcpy(ref, src, sizeof(ref));
+        memcpy(out, src, sizeof(out));
+        volume_c(ref, vols, channels[j], CHECK_SAMPLES / channels[j]);
+        volume_sse2(out, vols, channels[j], CHECK_SAMPLES / channels[j]);
+        if (memcmp(ref, out, sizeof(ref))) return FALSE;
+    }
+
+    for (i = 0; i < CHECK_SAMPLES; i++)
+        ref[i] = check_value(&seed);
+    fir_ref = fir_c(src, ref, CHECK_SAMPLES);
+    fir_out = fir_sse2(src, ref, CHECK_SAMPLES);
+    if (fabsf(fir_ref - fir_out) > 1e-4f * (fabsf(fir_ref) + 1.f)) return FALSE;
+
+    norm16(src, iref.s, CHECK_SAMPLES * 2);
+    norm16_sse2(src, iout.s, CHECK_SAMPLES * 2);
+    if (memcmp(iref.s, iout.s, CHECK_SAMPLES * 2)) return FALSE;
+
+    norm32(src, iref.i, CHECK_SAMPLES * 4);
+    norm32_sse2(src, iout.i, CHECK_SAMPLES * 4);
+    if (memcmp(iref.i, iout.i, CHECK_SAMPLES * 4)) return FALSE;
+
+    for (i = 0; i < sizeof(iref.b); i++)
+        iref.b[i] = (int)(check_value(&seed) * 64);
+    conv8_c(iref.b, ref, CHECK_SAMPLES);
+    conv8_sse2(iref.b, out, CHECK_SAMPLES);
+    if (memcmp(ref, out, sizeof(ref))) return FALSE;
+    conv16_c(iref.b, ref, CHECK_SAMPLES);
+    conv16_sse2(iref.b, out, CHECK_SAMPLES);
+    if (memcmp(ref, out, sizeof(ref))) return FALSE;
+    conv32_c(iref.b, ref, CHECK_SAMPLES);
+    conv32_sse2(iref.b, out, CHECK_SAMPLES);
+    if (memcmp(ref, out, sizeof(ref))) return FALSE;
+
+    return TRUE;
+}
+
+#endif /* HAVE_SSE2_INTRINSICS */
+
+/* Called once on process attach, before any device picks its functions. */
+void DSOUND_InitMixFunctions(void)
+{
+#ifdef HAVE_SSE2_INTRINSICS
+    if (wine_sse2_present())
+    {
+        if (!check_sse2_functions())
+        {
+            ERR("SSE2 mixing functions disagree with the C ones, not using them\n");
+            return;
+        }
+        TRACE("using SSE2 mixing functions\n");
+        convfunctions[0] = conv8_sse2;
+        convfunctions[1] = conv16_sse2;
+        convfunctions[3] = conv32_sse2;
+        mixieee32 = mix_sse2;
+        volieee32 = volume_sse2;
+        firieee32 = fir_sse2;
+        normfunctions[1] = (normfunc)norm16_sse2;
+        normfunctions[3] = (normfunc)norm32_sse2;
+    }
+#endif
+}
@@ -48,9 +48,17 @@ typedef void (*bitsputfunc)(const IDirectSoundBufferImpl *, DWORD, DWORD, float)
 extern const bitsgetfunc getbpp[5] DECLSPEC_HIDDEN;
 void putieee32(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value) DECLSPEC_HIDDEN;
 void putieee32_sum(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value) DECLSPEC_HIDDEN;
-void mixieee32(float *src, float *dst, unsigned samples) DECLSPEC_HIDDEN;
+typedef void (*convfunc)(const void *src, float *dst, unsigned samples);
+extern convfunc convfunctions[5] DECLSPEC_HIDDEN;
+typedef void (*mixfunc)(const float *src, float *dst, unsigned samples);
+typedef void (*volfunc)(float *buf, const float *vols, unsigned channels, unsigned frames);
+typedef float (*firfunc)(const float *fir, const float *input, unsigned len);
+extern mixfunc mixieee32 DECLSPEC_HIDDEN;
+extern volfunc volieee32 DECLSPEC_HIDDEN;
+extern firfunc firieee32 DECLSPEC_HIDDEN;
 typedef void (*normfunc)(const void *, void *, unsigned);
-extern const normfunc normfunctions[4] DECLSPEC_HIDDEN;
+extern normfunc normfunctions[4] DECLSPEC_HIDDEN;
+void DSOUND_InitMixFunctions(void) DECLSPEC_HIDDEN;
 
 typedef struct _DSVOLUMEPAN
 {
@@ -166,6 +174,7 @@ struct IDirectSoundBufferImpl
     int                         mix_channels;
     bitsgetfunc get, get_aux;
     bitsputfunc put, put_aux;
+    convfunc                    convert;
     int                         num_filters;
     DSFilter*                   filters;
 
@@ -24,6 +24,7 @@
 
 #include <assert.h>
 #include <stdarg.h>
+#include <string.h>
 #include <math.h>	/* Insomnia - pow() function */
 
 #define COBJMACROS
@@ -138,6 +139,7 @@ void DSOUND_RecalcFormat(IDirectSoundBufferImpl *dsb)
 
 	dsb->get = dsb->get_aux;
 	dsb->put = dsb->put_aux;
+	dsb->convert = NULL;
 
 	if (ichannels == ochannels)
 	{
@@ -146,6 +148,8 @@ void DSOUND_RecalcFormat(IDirectSoundBufferImpl *dsb)
 			FIXME("Copying %u channels is unsupported, limiting to first 32\n", ichannels);
 			dsb->mix_channels = 32;
 		}
+		else
+			dsb->convert = ieee ? convfunctions[4] : convfunctions[dsb->pwfx->wBitsPerSample/8 - 1];
 	}
 	else if (ichannels == 1)
 	{
@@ -283,6 +287,32 @@ static UINT cp_fields_noresample(IDirectSoundBufferImpl *dsb, UINT count)
     UINT istride = dsb->pwfx->nBlockAlign;
     UINT ostride = dsb->device->pwfx->nChannels * sizeof(float);
     DWORD channel, i;
+
+    /* Same layout on both sides, so whole runs up to the end of the buffer
+     * can be converted at once. */
+    if (dsb->convert)
+    {
+        const BYTE *buf = dsb->buffer->memory;
+        float *out = dsb->device->tmp_buffer;
+        DWORD pos = dsb->sec_mixpos, frames;
+
+        for (i = 0; i < count; i += frames, pos += frames * istride)
+        {
+            if (pos >= dsb->buflen)
+            {
+                if (!(dsb->playflags & DSBPLAY_LOOPING))
+                {
+                    memset(out + i * dsb->mix_channels, 0, (count - i) * ostride);
+                    break;
+                }
+                pos %= dsb->buflen;
+            }
+            frames = min(count - i, (dsb->buflen - pos) / istride);
+            dsb->convert(buf + pos, out + i * dsb->mix_channels, frames * dsb->mix_channels);
+        }
+        return count;
+    }
+
     for (i = 0; i < count; i++)
         for (channel = 0; channel < dsb->mix_channels; channel++)
             dsb->put(dsb, i * ostride, channel, get_current_sample(dsb,
@@ -350,11 +380,8 @@ static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *
         assert(ipos + fir_used <= required_input);
 
         for (channel = 0; channel < dsb->mix_channels; channel++) {
-            int j;
-            float sum = 0.0;
             float* cache = &intermediate[channel * required_input + ipos];
-            for (j = 0; j < fir_used; j++)
-                sum += fir_copy[j] * cache[j];
+            float sum = firieee32(fir_copy, cache, fir_used);
             dsb->put(dsb, i * ostride, channel, sum * dsb->firgain);
         }
     }
@@ -448,7 +475,7 @@ static void DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, INT frames)
 {
 	INT	i;
 	float vols[DS_MAX_CHANNELS];
-	UINT channels = dsb->device->pwfx->nChannels, chan;
+	UINT channels = dsb->device->pwfx->nChannels;
 
 	TRACE("(%p,%d)\n",dsb,frames);
 	TRACE("left = %x, right = %x\n", dsb->volpan.dwTotalAmpFactor[0],
@@ -468,11 +495,7 @@ static void DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, INT frames)
 	for (i = 0; i < channels; ++i)
 		vols[i] = dsb->volpan.dwTotalAmpFactor[i] / ((float)0xFFFF);
 
-	for(i = 0; i < frames; ++i){
-		for(chan = 0; chan < channels; ++chan){
-			dsb->device->tmp_buffer[i * channels + chan] *= vols[chan];
-		}
-	}
+	volieee32(dsb->device->tmp_buffer, vols, channels, frames);
 }
 
 /**
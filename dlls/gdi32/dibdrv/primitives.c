@@ -24,6 +24,7 @@
 #include "dibdrv.h"
 
 #include "wine/debug.h"
+#include "wine/simd.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(dib);
 
@@ -261,6 +262,77 @@ static inline void memset_16( WORD *start, WORD val, DWORD size )
 #endif
 }
 
+#ifdef HAVE_SSE2_INTRINSICS
+
+static BOOL use_sse2;
+
+/* apply (dst & and) ^ xor to a row of len bytes, the masks being replicated to every dword */
+static void SSE2_FUNC solid_row_sse2( BYTE *ptr, int len, DWORD and, DWORD xor )
+{
+    __m128i and_mask = _mm_set1_epi32( and ), xor_mask = _mm_set1_epi32( xor );
+
+    for (; len >= 16; len -= 16, ptr += 16)
+    {
+        __m128i val = _mm_loadu_si128( (const __m128i *)ptr );
+        _mm_storeu_si128( (__m128i *)ptr, _mm_xor_si128( _mm_and_si128( val, and_mask ), xor_mask ));
+    }
+    for (; len >= 4; len -= 4, ptr += 4) do_rop_32( (DWORD *)ptr, and, xor );
+    for (; len > 0; len--, ptr++, and >>= 8, xor >>= 8) do_rop_8( ptr, and, xor );
+}
+
+static inline __m128i SSE2_FUNC rop_codes_sse2( __m128i dst, __m128i src, const __m128i *codes )
+{
+    __m128i and = _mm_xor_si128( _mm_and_si128( src, codes[0] ), codes[1] );
+    __m128i xor = _mm_xor_si128( _mm_and_si128( src, codes[2] ), codes[3] );
+    return _mm_xor_si128( _mm_and_si128( dst, and ), xor );
+}
+
+/* the rop codes are either 0 or ~0, so the rop can be applied bytewise whatever the depth */
+static void SSE2_FUNC copy_rect_bits_sse2( BYTE *dst_start, const BYTE *src_start, int len, int height,
+                                           int dst_stride, int src_stride, int rop2, BOOL reverse )
+{
+    struct rop_codes codes;
+    __m128i vcodes[4];
+    const BYTE *src;
+    BYTE *dst;
+    int x, y;
+
+    get_rop_codes( rop2, &codes );
+    vcodes[0] = _mm_set1_epi32( codes.a1 );
+    vcodes[1] = _mm_set1_epi32( codes.a2 );
+    vcodes[2] = _mm_set1_epi32( codes.x1 );
+    vcodes[3] = _mm_set1_epi32( codes.x2 );
+
+    for (y = 0; y < height; y++, dst_start += dst_stride, src_start += src_stride)
+    {
+        if (reverse)
+        {
+            for (x = len, src = src_start + len, dst = dst_start + len; x >= 16; x -= 16)
+            {
+                __m128i s, d;
+                src -= 16;
+                dst -= 16;
+                s = _mm_loadu_si128( (const __m128i *)src );
+                d = _mm_loadu_si128( (const __m128i *)dst );
+                _mm_storeu_si128( (__m128i *)dst, rop_codes_sse2( d, s, vcodes ));
+            }
+            do_rop_codes_line_rev_8( dst_start, src_start, &codes, x );
+        }
+        else
+        {
+            for (x = len, src = src_start, dst = dst_start; x >= 16; x -= 16, src += 16, dst += 16)
+            {
+                __m128i s = _mm_loadu_si128( (const __m128i *)src );
+                __m128i d = _mm_loadu_si128( (const __m128i *)dst );
+                _mm_storeu_si128( (__m128i *)dst, rop_codes_sse2( d, s, vcodes ));
+            }
+            do_rop_codes_line_8( dst, src, &codes, x );
+        }
+    }
+}
+
+#endif /* HAVE_SSE2_INTRINSICS */
+
 static void solid_rects_32(const dib_info *dib, int num, const RECT *rc, DWORD and, DWORD xor)
 {
     DWORD *ptr, *start;
@@ -271,6 +343,12 @@ static void solid_rects_32(const dib_info *dib, int num, const RECT *rc, DWORD a
         assert( !is_rect_empty( rc ));
 
         start = get_pixel_ptr_32(dib, rc->left, rc->top);
+#ifdef HAVE_SSE2_INTRINSICS
+        if (and && use_sse2)
+            for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 4)
+                solid_row_sse2( (BYTE *)start, (rc->right - rc->left) * 4, and, xor );
+        else
+#endif
         if (and)
             for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 4)
                 for(x = rc->left, ptr = start; x < rc->right; x++)
@@ -422,6 +500,13 @@ static void solid_rects_16(const dib_info *dib, int num, const RECT *rc, DWORD a
         assert( !is_rect_empty( rc ));
 
         start = get_pixel_ptr_16(dib, rc->left, rc->top);
+#ifdef HAVE_SSE2_INTRINSICS
+        if (and && use_sse2)
+            for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 2)
+                solid_row_sse2( (BYTE *)start, (rc->right - rc->left) * 2,
+                                (and & 0xffff) * 0x10001, (xor & 0xffff) * 0x10001 );
+        else
+#endif
         if (and)
             for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 2)
                 for(x = rc->left, ptr = start; x < rc->right; x++)
@@ -1404,6 +1489,15 @@ static void copy_rect_32(const dib_info *dst, const RECT *rc,
     size.cx = rc->right - rc->left;
     size.cy = rc->bottom - rc->top;
 
+#ifdef HAVE_SSE2_INTRINSICS
+    if (use_sse2)
+    {
+        copy_rect_bits_sse2( (BYTE *)dst_start, (const BYTE *)src_start, size.cx * 4, size.cy,
+                             dst_stride * 4, src_stride * 4, rop2, overlap & OVERLAP_RIGHT );
+        return;
+    }
+#endif
+
     if (overlap & OVERLAP_RIGHT)
         copy_rect_bits_rev_32( dst_start, src_start, &size, dst_stride, src_stride, rop2 );
     else
@@ -1478,6 +1572,16 @@ static void copy_rect_16(const dib_info *dst, const RECT *rc,
         return;
     }
 
+#ifdef HAVE_SSE2_INTRINSICS
+    if (use_sse2)
+    {
+        copy_rect_bits_sse2( (BYTE *)dst_start, (const BYTE *)src_start, (rc->right - rc->left) * 2,
+                             rc->bottom - rc->top, dst_stride * 2, src_stride * 2, rop2,
+                             overlap & OVERLAP_RIGHT );
+        return;
+    }
+#endif
+
     get_rop_codes( rop2, &codes );
     for (y = rc->top; y < rc->bottom; y++, dst_start += dst_stride, src_start += src_stride)
     {
@@ -4690,6 +4794,71 @@ static inline DWORD blend_rgb( BYTE dst_r, BYTE dst_g, BYTE dst_b, DWORD src, BL
             blend_color( dst_r, src >> 16, blend.SourceConstantAlpha ) << 16);
 }
 
+#ifdef HAVE_SSE2_INTRINSICS
+
+/* (x + 127) / 255 on 16-bit lanes, exact for x <= 255 * 255 */
+static inline __m128i SSE2_FUNC div255_sse2( __m128i x )
+{
+    x = _mm_add_epi16( x, _mm_set1_epi16( 128 ));
+    return _mm_srli_epi16( _mm_add_epi16( x, _mm_srli_epi16( x, 8 )), 8 );
+}
+
+/* pack 16-bit channels back to pixels; like the C code, a channel overflowing
+ * to 9 bits is or'ed into the next one */
+static inline __m128i SSE2_FUNC pack_channels_sse2( __m128i lo, __m128i hi )
+{
+    __m128i mask = _mm_set1_epi16( 0xff );
+    __m128i val = _mm_packus_epi16( _mm_and_si128( lo, mask ), _mm_and_si128( hi, mask ));
+    __m128i carry = _mm_packus_epi16( _mm_srli_epi16( lo, 8 ), _mm_srli_epi16( hi, 8 ));
+    return _mm_or_si128( val, _mm_slli_epi32( carry, 8 ));
+}
+
+/* blend two pixels unpacked to 16-bit channels */
+static inline __m128i SSE2_FUNC blend_pixels_sse2( __m128i dst, __m128i src, BLENDFUNCTION blend )
+{
+    __m128i ff = _mm_set1_epi16( 0xff ), alpha = _mm_set1_epi16( blend.SourceConstantAlpha );
+
+    if (blend.AlphaFormat & AC_SRC_ALPHA)
+    {
+        if (blend.SourceConstantAlpha != 255) src = div255_sse2( _mm_mullo_epi16( src, alpha ));
+        alpha = _mm_shufflehi_epi16( _mm_shufflelo_epi16( src, 0xff ), 0xff );
+        return _mm_add_epi16( src, div255_sse2( _mm_mullo_epi16( dst, _mm_sub_epi16( ff, alpha ))));
+    }
+    return div255_sse2( _mm_add_epi16( _mm_mullo_epi16( src, alpha ),
+                                       _mm_mullo_epi16( dst, _mm_sub_epi16( ff, alpha ))));
+}
+
+static void SSE2_FUNC blend_row_8888_sse2( DWORD *dst, const DWORD *src, int len, BLENDFUNCTION blend,
+                                           BOOL no_src_alpha )
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i src_or = _mm_set1_epi32( no_src_alpha ? 0xff000000 : 0 );
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        __m128i s = _mm_or_si128( _mm_loadu_si128( (const __m128i *)(src + x) ), src_or );
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        __m128i lo = blend_pixels_sse2( _mm_unpacklo_epi8( d, zero ), _mm_unpacklo_epi8( s, zero ), blend );
+        __m128i hi = blend_pixels_sse2( _mm_unpackhi_epi8( d, zero ), _mm_unpackhi_epi8( s, zero ), blend );
+        _mm_storeu_si128( (__m128i *)(dst + x), pack_channels_sse2( lo, hi ));
+    }
+    for (; x < len; x++)
+    {
+        if (blend.AlphaFormat & AC_SRC_ALPHA)
+        {
+            if (blend.SourceConstantAlpha == 255) dst[x] = blend_argb( dst[x], src[x] );
+            else dst[x] = blend_argb_alpha( dst[x], src[x], blend.SourceConstantAlpha );
+        }
+        else if (no_src_alpha)
+            dst[x] = blend_argb_no_src_alpha( dst[x], src[x], blend.SourceConstantAlpha );
+        else
+            dst[x] = blend_argb_constant_alpha( dst[x], src[x], blend.SourceConstantAlpha );
+    }
+}
+
+#endif /* HAVE_SSE2_INTRINSICS */
+
 static void blend_rect_8888(const dib_info *dst, const RECT *rc,
                             const dib_info *src, const POINT *origin, BLENDFUNCTION blend)
 {
@@ -4697,6 +4866,17 @@ static void blend_rect_8888(const dib_info *dst, const RECT *rc,
     DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
     int x, y;
 
+#ifdef HAVE_SSE2_INTRINSICS
+    if (use_sse2)
+    {
+        BOOL no_src_alpha = !(blend.AlphaFormat & AC_SRC_ALPHA) && src->compression != BI_RGB;
+
+        for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
+            blend_row_8888_sse2( dst_ptr, src_ptr, rc->right - rc->left, blend, no_src_alpha );
+        return;
+    }
+#endif
+
     if (blend.AlphaFormat & AC_SRC_ALPHA)
     {
 	if (blend.SourceConstantAlpha == 255)
@@ -6118,6 +6298,90 @@ static inline DWORD aa_rgb( BYTE r_dst, BYTE g_dst, BYTE b_dst, DWORD text, cons
             aa_color( r_dst, text >> 16, range->r_min, range->r_max ) << 16);
 }
 
+#ifdef HAVE_SSE2_INTRINSICS
+
+/* find how the next 16 glyph pixels can be drawn: returns 0 if they are all transparent,
+ * 1 if they are all opaque (level 16 and above), -1 if they need antialiasing */
+static inline int SSE2_FUNC get_glyph_span_sse2( const BYTE *glyph )
+{
+    __m128i val = _mm_loadu_si128( (const __m128i *)glyph );
+    __m128i zero = _mm_setzero_si128();
+
+    if (_mm_movemask_epi8( _mm_cmpeq_epi8( _mm_subs_epu8( val, _mm_set1_epi8( 1 )), zero )) == 0xffff)
+        return 0;
+    if (_mm_movemask_epi8( _mm_cmpeq_epi8( _mm_subs_epu8( _mm_set1_epi8( 16 ), val ), zero )) == 0xffff)
+        return 1;
+    return -1;
+}
+
+/* returns the number of pixels drawn, the remaining ones are left to the caller */
+static int SSE2_FUNC draw_glyph_row_8888_sse2( DWORD *dst, const BYTE *glyph, int len, DWORD text_pixel,
+                                               const struct intensity_range *ranges )
+{
+    __m128i text = _mm_set1_epi32( text_pixel );
+    int x, i;
+
+    for (x = 0; x + 16 <= len; x += 16)
+    {
+        switch (get_glyph_span_sse2( glyph + x ))
+        {
+        case 0:
+            break;
+        case 1:
+            for (i = 0; i < 16; i += 4) _mm_storeu_si128( (__m128i *)(dst + x + i), text );
+            break;
+        default:
+            for (i = x; i < x + 16; i++)
+            {
+                if (glyph[i] <= 1) continue;
+                if (glyph[i] >= 16) { dst[i] = text_pixel; continue; }
+                dst[i] = aa_rgb( dst[i] >> 16, dst[i] >> 8, dst[i], text_pixel, ranges + glyph[i] );
+            }
+            break;
+        }
+    }
+    return x;
+}
+
+static int SSE2_FUNC draw_glyph_row_16_sse2( const dib_info *dib, WORD *dst, const BYTE *glyph, int len,
+                                             DWORD text_pixel, DWORD text,
+                                             const struct intensity_range *ranges )
+{
+    __m128i text16 = _mm_set1_epi16( text_pixel );
+    DWORD val;
+    int x, i;
+
+    for (x = 0; x + 16 <= len; x += 16)
+    {
+        switch (get_glyph_span_sse2( glyph + x ))
+        {
+        case 0:
+            break;
+        case 1:
+            _mm_storeu_si128( (__m128i *)(dst + x), text16 );
+            _mm_storeu_si128( (__m128i *)(dst + x + 8), text16 );
+            break;
+        default:
+            for (i = x; i < x + 16; i++)
+            {
+                if (glyph[i] <= 1) continue;
+                if (glyph[i] >= 16) { dst[i] = text_pixel; continue; }
+                val = aa_rgb( get_field(dst[i], dib->red_shift,   dib->red_len),
+                              get_field(dst[i], dib->green_shift, dib->green_len),
+                              get_field(dst[i], dib->blue_shift,  dib->blue_len),
+                              text, ranges + glyph[i] );
+                dst[i] = (put_field( val >> 16, dib->red_shift,   dib->red_len )   |
+                          put_field( val >> 8,  dib->green_shift, dib->green_len ) |
+                          put_field( val,       dib->blue_shift,  dib->blue_len ));
+            }
+            break;
+        }
+    }
+    return x;
+}
+
+#endif /* HAVE_SSE2_INTRINSICS */
+
 static void draw_glyph_8888( const dib_info *dib, const RECT *rect, const dib_info *glyph,
                              const POINT *origin, DWORD text_pixel, const struct intensity_range *ranges )
 {
@@ -6127,7 +6391,12 @@ static void draw_glyph_8888( const dib_info *dib, const RECT *rect, const dib_in
 
     for (y = rect->top; y < rect->bottom; y++)
     {
-        for (x = 0; x < rect->right - rect->left; x++)
+        x = 0;
+#ifdef HAVE_SSE2_INTRINSICS
+        if (use_sse2)
+            x = draw_glyph_row_8888_sse2( dst_ptr, glyph_ptr, rect->right - rect->left, text_pixel, ranges );
+#endif
+        for (; x < rect->right - rect->left; x++)
         {
             if (glyph_ptr[x] <= 1) continue;
             if (glyph_ptr[x] >= 16) { dst_ptr[x] = text_pixel; continue; }
@@ -6239,7 +6508,13 @@ static void draw_glyph_16( const dib_info *dib, const RECT *rect, const dib_info
 
     for (y = rect->top; y < rect->bottom; y++)
     {
-        for (x = 0; x < rect->right - rect->left; x++)
+        x = 0;
+#ifdef HAVE_SSE2_INTRINSICS
+        if (use_sse2)
+            x = draw_glyph_row_16_sse2( dib, dst_ptr, glyph_ptr, rect->right - rect->left,
+                                        text_pixel, text, ranges );
+#endif
+        for (; x < rect->right - rect->left; x++)
         {
             if (glyph_ptr[x] <= 1) continue;
             if (glyph_ptr[x] >= 16) { dst_ptr[x] = text_pixel; continue; }
@@ -7402,6 +7677,138 @@ static void shrink_row_null(const dib_info *dst_dib, const POINT *dst_start,
     return;
 }
 
+#ifdef HAVE_SSE2_INTRINSICS
+
+#define CHECK_GLYPH_WIDTH  (8 * 16 + 5)
+#define CHECK_GLYPH_HEIGHT 18
+
+static inline BYTE check_random( unsigned int *seed )
+{
+    *seed = *seed * 1103515245 + 12345;
+    return *seed >> 16;
+}
+
+/* build a glyph with a row for every antialiasing level, plus a row of spans
+ * mixing transparent, blended and opaque pixels (notably levels 15 and 16) */
+static void init_check_glyph( BYTE bits[CHECK_GLYPH_HEIGHT][CHECK_GLYPH_WIDTH], unsigned int *seed )
+{
+    BYTE *row = bits[CHECK_GLYPH_HEIGHT - 1];
+    int x, y;
+
+    for (y = 0; y <= 16; y++) memset( bits[y], y, CHECK_GLYPH_WIDTH );
+    for (x = 0; x < 16; x++)
+    {
+        row[x]           = x & 1;                /* transparent */
+        row[x + 16]      = 16;                   /* opaque */
+        row[x + 2 * 16]  = 15;                   /* blended */
+        row[x + 3 * 16]  = 15 + (x & 1);         /* blended and opaque */
+        row[x + 4 * 16]  = (x == 7) ? 15 : 16;
+        row[x + 5 * 16]  = x;
+        row[x + 6 * 16]  = x + 1;
+        row[x + 7 * 16]  = check_random( seed ) % 17;
+    }
+    for (x = 8 * 16; x < CHECK_GLYPH_WIDTH; x++) row[x] = check_random( seed ) % 17;
+}
+
+/* run the SSE2 glyph primitives next to the C ones, they must produce the same pixels */
+static BOOL check_sse2_glyphs(void)
+{
+    BYTE glyph_bits[CHECK_GLYPH_HEIGHT][CHECK_GLYPH_WIDTH];
+    DWORD ref32[CHECK_GLYPH_HEIGHT][CHECK_GLYPH_WIDTH], out32[CHECK_GLYPH_HEIGHT][CHECK_GLYPH_WIDTH];
+    WORD ref16[CHECK_GLYPH_HEIGHT][CHECK_GLYPH_WIDTH], out16[CHECK_GLYPH_HEIGHT][CHECK_GLYPH_WIDTH];
+    struct intensity_range ranges[17];
+    static const DWORD text_pixel = 0x00c06020;
+    static const POINT origin;
+    RECT rect = { 0, 0, CHECK_GLYPH_WIDTH, CHECK_GLYPH_HEIGHT };
+    dib_info glyph, dib;
+    unsigned int seed = 0x5eed;
+    BOOL ret;
+    int i, x, y;
+
+    init_check_glyph( glyph_bits, &seed );
+    for (i = 0; i <= 16; i++)
+    {
+        ranges[i].r_min = 0xc0 * i / 16;
+        ranges[i].r_max = 0xc0 + (0xff - 0xc0) * (16 - i) / 16;
+        ranges[i].g_min = 0x60 * i / 16;
+        ranges[i].g_max = 0x60 + (0xff - 0x60) * (16 - i) / 16;
+        ranges[i].b_min = 0x20 * i / 16;
+        ranges[i].b_max = 0x20 + (0xff - 0x20) * (16 - i) / 16;
+    }
+    for (y = 0; y < CHECK_GLYPH_HEIGHT; y++)
+        for (x = 0; x < CHECK_GLYPH_WIDTH; x++)
+        {
+            ref32[y][x] = check_random( &seed ) << 16 | check_random( &seed ) << 8 | check_random( &seed );
+            ref16[y][x] = check_random( &seed ) << 8 | check_random( &seed );
+        }
+    memcpy( out32, ref32, sizeof(out32) );
+    memcpy( out16, ref16, sizeof(out16) );
+
+    memset( &glyph, 0, sizeof(glyph) );
+    glyph.bit_count = 8;
+    glyph.width = CHECK_GLYPH_WIDTH;
+    glyph.height = CHECK_GLYPH_HEIGHT;
+    glyph.rect = rect;
+    glyph.stride = CHECK_GLYPH_WIDTH;
+    glyph.bits.ptr = glyph_bits;
+
+    memset( &dib, 0, sizeof(dib) );
+    dib.width = CHECK_GLYPH_WIDTH;
+    dib.height = CHECK_GLYPH_HEIGHT;
+    dib.rect = rect;
+
+    dib.bit_count = 32;
+    dib.stride = CHECK_GLYPH_WIDTH * 4;
+    use_sse2 = FALSE;
+    dib.bits.ptr = ref32;
+    draw_glyph_8888( &dib, &rect, &glyph, &origin, text_pixel, ranges );
+    use_sse2 = TRUE;
+    dib.bits.ptr = out32;
+    draw_glyph_8888( &dib, &rect, &glyph, &origin, text_pixel, ranges );
+    ret = !memcmp( ref32, out32, sizeof(ref32) );
+
+    dib.bit_count = 16;
+    dib.stride = CHECK_GLYPH_WIDTH * 2;
+    dib.red_mask   = 0xf800;
+    dib.green_mask = 0x07e0;
+    dib.blue_mask  = 0x001f;
+    dib.red_shift   = 11;
+    dib.green_shift = 5;
+    dib.blue_shift  = 0;
+    dib.red_len   = 5;
+    dib.green_len = 6;
+    dib.blue_len  = 5;
+    use_sse2 = FALSE;
+    dib.bits.ptr = ref16;
+    draw_glyph_16( &dib, &rect, &glyph, &origin, 0xc32c, ranges );
+    use_sse2 = TRUE;
+    dib.bits.ptr = out16;
+    draw_glyph_16( &dib, &rect, &glyph, &origin, 0xc32c, ranges );
+    ret = ret && !memcmp( ref16, out16, sizeof(ref16) );
+
+    use_sse2 = FALSE;
+    return ret;
+}
+
+#endif /* HAVE_SSE2_INTRINSICS */
+
+/***********************************************************************
+ *           init_dib_primitives
+ *
+ * Select the SIMD versions of the primitives supported by the CPU.
+ */
+void init_dib_primitives(void)
+{
+#ifdef HAVE_SSE2_INTRINSICS
+    if (wine_sse2_present())
+    {
+        if (check_sse2_glyphs()) use_sse2 = TRUE;
+        else ERR( "SSE2 glyph primitives disagree with the C ones, not using them\n" );
+    }
+    TRACE( "SSE2 primitives %s\n", use_sse2 ? "enabled" : "disabled" );
+#endif
+}
+
 const primitive_funcs funcs_8888 =
 {
     solid_rects_32,
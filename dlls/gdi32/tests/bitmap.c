@@ -3074,6 +3074,101 @@ static void test_BitBlt(void)
     DeleteDC(hdcScreen);
 }
 
+static void test_BitBlt_rows(void)
+{
+    static const DWORD rops[] = { SRCINVERT, SRCAND, SRCPAINT, NOTSRCCOPY };
+    BITMAPINFO info;
+    HBITMAP bmp_dst, bmp_src, old_dst, old_src;
+    HDC hdc_dst, hdc_src;
+    BYTE *dst_bits, *src_bits, orig[64 * 4], expect[64 * 4];
+    DWORD white;
+    int bpp, i, j, x, width, pixel_size;
+
+    memset( &info, 0, sizeof(info) );
+    info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    info.bmiHeader.biWidth = 64;
+    info.bmiHeader.biHeight = -1;
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biCompression = BI_RGB;
+
+    hdc_dst = CreateCompatibleDC( 0 );
+    hdc_src = CreateCompatibleDC( 0 );
+
+    for (bpp = 16; bpp <= 32; bpp += 16)
+    {
+        pixel_size = bpp / 8;
+        white = (bpp == 32) ? 0x00ffffff : 0x7fff;
+        info.bmiHeader.biBitCount = bpp;
+        bmp_dst = CreateDIBSection( 0, &info, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0 );
+        bmp_src = CreateDIBSection( 0, &info, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0 );
+        old_dst = SelectObject( hdc_dst, bmp_dst );
+        old_src = SelectObject( hdc_src, bmp_src );
+        SelectObject( hdc_dst, GetStockObject( WHITE_BRUSH ) );
+
+        for (i = 0; i < 64 * pixel_size; i++) src_bits[i] = i * 37 + 11;
+        if (bpp == 16) for (i = 1; i < 64 * 2; i += 2) src_bits[i] &= 0x7f;
+
+        for (width = 1; width <= 40; width++)
+        {
+            for (x = 0; x < 4; x++)
+            {
+                for (j = 0; j <= sizeof(rops) / sizeof(rops[0]); j++)
+                {
+                    for (i = 0; i < 64 * pixel_size; i++) orig[i] = i * 13 + width;
+                    if (bpp == 16) for (i = 1; i < 64 * 2; i += 2) orig[i] &= 0x7f;
+                    memcpy( dst_bits, orig, 64 * pixel_size );
+                    memcpy( expect, orig, 64 * pixel_size );
+
+                    if (j < sizeof(rops) / sizeof(rops[0]))
+                    {
+                        BitBlt( hdc_dst, x, 0, width, 1, hdc_src, 3 - x, 0, rops[j] );
+                        for (i = x * pixel_size; i < (x + width) * pixel_size; i++)
+                        {
+                            BYTE src = src_bits[i + (3 - 2 * x) * pixel_size];
+                            switch (rops[j])
+                            {
+                            case SRCINVERT:  expect[i] ^= src; break;
+                            case SRCAND:     expect[i] &= src; break;
+                            case SRCPAINT:   expect[i] |= src; break;
+                            case NOTSRCCOPY: expect[i] = ~src; break;
+                            }
+                        }
+                    }
+                    else
+                    {
+                        PatBlt( hdc_dst, x, 0, width, 1, PATINVERT );
+                        for (i = x; i < x + width; i++)
+                        {
+                            expect[i * pixel_size] ^= white;
+                            expect[i * pixel_size + 1] ^= white >> 8;
+                            if (bpp == 32) expect[i * pixel_size + 2] ^= white >> 16;
+                        }
+                    }
+                    ok( !memcmp( dst_bits, expect, 64 * pixel_size ),
+                        "%u bpp: rop %u width %u x %u: wrong bits\n", bpp, j, width, x );
+                }
+
+                /* overlapping blit to the right */
+                memcpy( dst_bits, orig, 64 * pixel_size );
+                memcpy( expect, orig, 64 * pixel_size );
+                BitBlt( hdc_dst, x + 1, 0, width, 1, hdc_dst, x, 0, SRCINVERT );
+                for (i = (x + 1) * pixel_size; i < (x + 1 + width) * pixel_size; i++)
+                    expect[i] ^= orig[i - pixel_size];
+                ok( !memcmp( dst_bits, expect, 64 * pixel_size ),
+                    "%u bpp: overlapping width %u x %u: wrong bits\n", bpp, width, x );
+            }
+        }
+
+        SelectObject( hdc_src, old_src );
+        SelectObject( hdc_dst, old_dst );
+        DeleteObject( bmp_src );
+        DeleteObject( bmp_dst );
+    }
+
+    DeleteDC( hdc_src );
+    DeleteDC( hdc_dst );
+}
+
 static void check_StretchBlt_pixel(HDC hdcDst, HDC hdcSrc, UINT32 *dstBuffer, UINT32 *srcBuffer,
                                    DWORD dwRop, UINT32 expected, int line)
 {
@@ -5921,6 +6016,7 @@ START_TEST(bitmap)
     test_select_object();
     test_CreateBitmap();
     test_BitBlt();
+    test_BitBlt_rows();
     test_StretchBlt();
     test_StretchDIBits();
     test_GdiAlphaBlend();
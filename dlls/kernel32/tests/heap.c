@@ -39,6 +39,7 @@
 #define HEAP_VALIDATE_PARAMS  0x40000000
 
 static BOOL (WINAPI *pHeapQueryInformation)(HANDLE, HEAP_INFORMATION_CLASS, PVOID, SIZE_T, PSIZE_T);
+static BOOL (WINAPI *pHeapSetInformation)(HANDLE, HEAP_INFORMATION_CLASS, PVOID, SIZE_T);
 static BOOL (WINAPI *pGetPhysicallyInstalledSystemMemory)(ULONGLONG *);
 static ULONG (WINAPI *pRtlGetNtGlobalFlags)(void);
 
@@ -867,6 +868,101 @@ static void test_HeapQueryInformation(void)
     ok(info == 0 || info == 1 || info == 2, "expected 0, 1 or 2, got %u\n", info);
 }
 
+static void test_HeapSetInformation(void)
+{
+    PROCESS_HEAP_ENTRY entry;
+    BYTE *ptrs[256], *p;
+    HANDLE heap;
+    ULONG info;
+    SIZE_T size;
+    BOOL ret;
+    int i, busy, found;
+
+    pHeapSetInformation = (void *)GetProcAddress(GetModuleHandleA("kernel32.dll"), "HeapSetInformation");
+    if (!pHeapSetInformation || !pHeapQueryInformation)
+    {
+        win_skip("HeapSetInformation is not available\n");
+        return;
+    }
+
+    heap = HeapCreate( HEAP_NO_SERIALIZE, 0, 0 );
+    ok( heap != NULL, "HeapCreate failed\n" );
+    info = 2;
+    ret = pHeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    ok( !ret, "HeapSetInformation succeeded\n" );
+    HeapDestroy( heap );
+
+    heap = HeapCreate( 0, 0, 0 );
+    ok( heap != NULL, "HeapCreate failed\n" );
+
+    info = 2;
+    ret = pHeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) - 1 );
+    ok( !ret, "HeapSetInformation succeeded\n" );
+
+    ret = pHeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    ok( ret, "HeapSetInformation error %u\n", GetLastError() );
+
+    info = 0xdeadbeef;
+    ret = pHeapQueryInformation( heap, HeapCompatibilityInformation, &info, sizeof(info), NULL );
+    ok( ret, "HeapQueryInformation error %u\n", GetLastError() );
+    ok( info == 2, "expected 2, got %u\n", info );
+
+    for (i = 0; i < sizeof(ptrs) / sizeof(ptrs[0]); i++)
+    {
+        ptrs[i] = HeapAlloc( heap, HEAP_ZERO_MEMORY, i * 3 + 1 );
+        ok( ptrs[i] != NULL, "%u: HeapAlloc failed\n", i );
+        ok( !ptrs[i][i * 3], "%u: memory not zeroed\n", i );
+        memset( ptrs[i], 0xcc, i * 3 + 1 );
+        size = HeapSize( heap, 0, ptrs[i] );
+        ok( size == i * 3 + 1, "%u: wrong size %lu\n", i, size );
+        ok( HeapValidate( heap, 0, ptrs[i] ), "%u: HeapValidate failed\n", i );
+    }
+    ok( HeapValidate( heap, 0, NULL ), "HeapValidate failed\n" );
+
+    p = HeapReAlloc( heap, 0, ptrs[10], 2000 );
+    ok( p != NULL, "HeapReAlloc failed\n" );
+    for (i = 0; i < 31; i++) if (p[i] != 0xcc) break;
+    ok( i == 31, "wrong data at %u\n", i );
+    size = HeapSize( heap, 0, p );
+    ok( size == 2000, "wrong size %lu\n", size );
+    ptrs[10] = p;
+
+    p = HeapReAlloc( heap, HEAP_ZERO_MEMORY, ptrs[20], 62 );
+    ok( p != NULL, "HeapReAlloc failed\n" );
+    ok( p[60] == 0xcc && !p[61], "wrong data %x/%x\n", p[60], p[61] );
+    ptrs[20] = p;
+
+    busy = found = 0;
+    memset( &entry, 0, sizeof(entry) );
+    while (HeapWalk( heap, &entry ))
+    {
+        if (!(entry.wFlags & PROCESS_HEAP_ENTRY_BUSY)) continue;
+        busy++;
+        for (i = 0; i < sizeof(ptrs) / sizeof(ptrs[0]); i++)
+            if (entry.lpData == ptrs[i]) found++;
+    }
+    ok( GetLastError() == ERROR_NO_MORE_ITEMS, "wrong error %u\n", GetLastError() );
+    ok( busy > 0, "no busy entries\n" );
+    if (!strcmp( winetest_platform, "wine" ))  /* the Windows front end layout differs */
+        ok( found == sizeof(ptrs) / sizeof(ptrs[0]), "found %d blocks\n", found );
+
+    for (i = 0; i < sizeof(ptrs) / sizeof(ptrs[0]); i++)
+    {
+        ret = HeapFree( heap, 0, ptrs[i] );
+        ok( ret, "%u: HeapFree failed\n", i );
+    }
+    ok( HeapValidate( heap, 0, NULL ), "HeapValidate failed\n" );
+    HeapCompact( heap, 0 );
+    ok( HeapValidate( heap, 0, NULL ), "HeapValidate failed\n" );
+
+    p = HeapAlloc( heap, 0, 40 );
+    ok( p != NULL, "HeapAlloc failed\n" );
+    ret = HeapFree( heap, 0, p );
+    ok( ret, "HeapFree failed\n" );
+
+    HeapDestroy( heap );
+}
+
 static void test_heap_checks( DWORD flags )
 {
     BYTE old, *p, *p2;
@@ -1220,6 +1316,7 @@ START_TEST(heap)
     test_sized_HeapReAlloc((1 << 20), 1);
 
     test_HeapQueryInformation();
+    test_HeapSetInformation();
     test_GetPhysicallyInstalledSystemMemory();
 
     if (pRtlGetNtGlobalFlags)
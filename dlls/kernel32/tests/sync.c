@@ -22,6 +22,8 @@
 #include <stdarg.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <ntstatus.h>
+#define WIN32_NO_STATUS
 #include <windef.h>
 #include <winbase.h>
 #include <winternl.h>
@@ -59,6 +61,9 @@ static VOID   (WINAPI *pReleaseSRWLockExclusive)(PSRWLOCK);
 static VOID   (WINAPI *pReleaseSRWLockShared)(PSRWLOCK);
 static BOOLEAN (WINAPI *pTryAcquireSRWLockExclusive)(PSRWLOCK);
 static BOOLEAN (WINAPI *pTryAcquireSRWLockShared)(PSRWLOCK);
+static NTSTATUS (WINAPI *pRtlWaitOnAddress)(const void *, const void *, SIZE_T, const LARGE_INTEGER *);
+static void (WINAPI *pRtlWakeAddressAll)(const void *);
+static void (WINAPI *pRtlWakeAddressSingle)(const void *);
 
 static NTSTATUS (WINAPI *pNtAllocateVirtualMemory)(HANDLE, PVOID *, ULONG, SIZE_T *, ULONG, ULONG);
 static NTSTATUS (WINAPI *pNtFreeVirtualMemory)(HANDLE, PVOID *, SIZE_T *, ULONG);
@@ -2648,6 +2653,80 @@ static void test_apc_deadlock(void)
     CloseHandle(pi.hProcess);
 }
 
+static LONG address_var;
+
+static DWORD WINAPI address_wait_thread(LPVOID arg)
+{
+    LONG compare = 0;
+    NTSTATUS status;
+
+    while (address_var == compare)
+    {
+        status = pRtlWaitOnAddress(&address_var, &compare, sizeof(compare), NULL);
+        ok(!status, "got status %#x\n", status);
+    }
+    InterlockedIncrement((LONG *)arg);
+    return 0;
+}
+
+static void test_WaitOnAddress(void)
+{
+    LARGE_INTEGER timeout;
+    HANDLE threads[4];
+    LONG compare, woken = 0;
+    NTSTATUS status;
+    USHORT value16 = 1, compare16;
+    int i;
+
+    if (!pRtlWaitOnAddress)
+    {
+        win_skip("RtlWaitOnAddress not supported, skipping test\n");
+        return;
+    }
+
+    /* invalid size */
+    compare = 0;
+    timeout.QuadPart = -10000;
+    status = pRtlWaitOnAddress(&address_var, &compare, 3, &timeout);
+    ok(status == STATUS_INVALID_PARAMETER, "got status %#x\n", status);
+
+    /* value differs, returns immediately */
+    compare16 = 0;
+    status = pRtlWaitOnAddress(&value16, &compare16, sizeof(compare16), NULL);
+    ok(!status, "got status %#x\n", status);
+
+    /* value matches, times out */
+    compare16 = 1;
+    status = pRtlWaitOnAddress(&value16, &compare16, sizeof(compare16), &timeout);
+    ok(status == STATUS_TIMEOUT, "got status %#x\n", status);
+
+    /* waking without waiters is a no-op */
+    pRtlWakeAddressSingle(&address_var);
+    pRtlWakeAddressAll(&address_var);
+
+    address_var = 0;
+    for (i = 0; i < sizeof(threads) / sizeof(threads[0]); i++)
+        threads[i] = CreateThread(NULL, 0, address_wait_thread, &woken, 0, NULL);
+
+    Sleep(50);
+    ok(!woken, "%d threads woken\n", woken);
+    pRtlWakeAddressAll(&address_var);
+    Sleep(50);
+    ok(!woken, "%d threads woken without a value change\n", woken);
+
+    InterlockedExchange(&address_var, 1);
+    pRtlWakeAddressSingle(&address_var);
+    pRtlWakeAddressAll(&address_var);
+
+    for (i = 0; i < sizeof(threads) / sizeof(threads[0]); i++)
+    {
+        DWORD ret = WaitForSingleObject(threads[i], 1000);
+        ok(ret == WAIT_OBJECT_0, "thread %d didn't exit, ret %u\n", i, ret);
+        CloseHandle(threads[i]);
+    }
+    ok(woken == sizeof(threads) / sizeof(threads[0]), "%d threads woken\n", woken);
+}
+
 START_TEST(sync)
 {
     char **argv;
@@ -2686,6 +2765,9 @@ START_TEST(sync)
     pNtWaitForMultipleObjects = (void *)GetProcAddress(hntdll, "NtWaitForMultipleObjects");
     pRtlInterlockedPushListSList = (void *)GetProcAddress(hntdll, "RtlInterlockedPushListSList");
     pRtlInterlockedPushListSListEx = (void *)GetProcAddress(hntdll, "RtlInterlockedPushListSListEx");
+    pRtlWaitOnAddress = (void *)GetProcAddress(hntdll, "RtlWaitOnAddress");
+    pRtlWakeAddressAll = (void *)GetProcAddress(hntdll, "RtlWakeAddressAll");
+    pRtlWakeAddressSingle = (void *)GetProcAddress(hntdll, "RtlWakeAddressSingle");
 
     argc = winetest_get_mainargs( &argv );
     if (argc >= 3)
@@ -2713,6 +2795,7 @@ START_TEST(sync)
     test_condvars_consumer_producer();
     test_srwlock_base();
     test_srwlock_example();
+    test_WaitOnAddress();
     test_alertable_wait();
     test_apc_deadlock();
 }
@@ -403,6 +403,76 @@ static void test_VirtualAlloc(void)
     ok(VirtualFree(addr1, 0, MEM_RELEASE), "VirtualFree failed\n");
 }
 
+static void test_many_views(void)
+{
+    static const unsigned int count = 256, view_size = 0x10000;
+    MEMORY_BASIC_INFORMATION info;
+    char *base, *addr;
+    unsigned int i;
+    SIZE_T ret;
+    BOOL res;
+
+    /* find a free range large enough for all the views */
+    base = VirtualAlloc( NULL, count * view_size, MEM_RESERVE, PAGE_NOACCESS );
+    ok( base != NULL, "VirtualAlloc failed %u\n", GetLastError() );
+    res = VirtualFree( base, 0, MEM_RELEASE );
+    ok( res, "VirtualFree failed %u\n", GetLastError() );
+
+    for (i = 0; i < count; i++)
+    {
+        addr = VirtualAlloc( base + i * view_size, view_size, MEM_RESERVE, PAGE_NOACCESS );
+        ok( addr == base + i * view_size, "%u: got %p, expected %p\n", i, addr, base + i * view_size );
+        if (i % 3) continue;
+        addr = VirtualAlloc( base + i * view_size, 0x1000, MEM_COMMIT, PAGE_READWRITE );
+        ok( addr == base + i * view_size, "%u: commit failed %u\n", i, GetLastError() );
+    }
+    for (i = 1; i < count; i += 2)
+    {
+        res = VirtualFree( base + i * view_size, 0, MEM_RELEASE );
+        ok( res, "%u: VirtualFree failed %u\n", i, GetLastError() );
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        addr = base + i * view_size + 0x2000;
+        ret = VirtualQuery( addr, &info, sizeof(info) );
+        ok( ret == sizeof(info), "%u: VirtualQuery failed %u\n", i, GetLastError() );
+        ok( info.BaseAddress == addr, "%u: wrong base %p / %p\n", i, info.BaseAddress, addr );
+        if (i % 2)
+        {
+            ok( info.State == MEM_FREE, "%u: wrong state %x\n", i, info.State );
+            if (i < count - 1)
+                ok( info.RegionSize == view_size - 0x2000, "%u: wrong size %lx\n", i, info.RegionSize );
+        }
+        else
+        {
+            ok( info.AllocationBase == base + i * view_size, "%u: wrong alloc base %p / %p\n",
+                i, info.AllocationBase, base + i * view_size );
+            ok( info.State == MEM_RESERVE, "%u: wrong state %x\n", i, info.State );
+            ok( info.RegionSize == view_size - 0x2000, "%u: wrong size %lx\n", i, info.RegionSize );
+        }
+
+        if (i % 6) continue;
+        ret = VirtualQuery( base + i * view_size, &info, sizeof(info) );
+        ok( ret == sizeof(info), "%u: VirtualQuery failed %u\n", i, GetLastError() );
+        ok( info.State == MEM_COMMIT, "%u: wrong state %x\n", i, info.State );
+        ok( info.Protect == PAGE_READWRITE, "%u: wrong protect %x\n", i, info.Protect );
+        ok( info.RegionSize == 0x1000, "%u: wrong size %lx\n", i, info.RegionSize );
+    }
+
+    /* the freed slots can be reused */
+    for (i = 1; i < count; i += 2)
+    {
+        addr = VirtualAlloc( base + i * view_size, view_size, MEM_RESERVE, PAGE_NOACCESS );
+        ok( addr == base + i * view_size, "%u: got %p, expected %p\n", i, addr, base + i * view_size );
+    }
+    for (i = 0; i < count; i++)
+    {
+        res = VirtualFree( base + i * view_size, 0, MEM_RELEASE );
+        ok( res, "%u: VirtualFree failed %u\n", i, GetLastError() );
+    }
+}
+
 static void test_MapViewOfFile(void)
 {
     static const char testfile[] = "testfile.xxx";
@@ -3910,6 +3980,7 @@ START_TEST(virtual)
     test_VirtualProtect();
     test_VirtualAllocEx();
     test_VirtualAlloc();
+    test_many_views();
     test_MapViewOfFile();
     test_NtMapViewOfSection();
     test_NtAreMappedFilesTheSame();
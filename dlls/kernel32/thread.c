@@ -982,6 +982,39 @@ PTP_CLEANUP_GROUP WINAPI CreateThreadpoolCleanupGroup( void )
     return group;
 }
 
+/* translates the ntdll I/O completion callback into the win32 one, which
+ * is stored in the first pointer of the object by CreateThreadpoolIo */
+static void CALLBACK tp_io_callback( TP_CALLBACK_INSTANCE *instance, void *userdata,
+                                     void *cvalue, IO_STATUS_BLOCK *iosb, TP_IO *io )
+{
+    PTP_WIN32_IO_CALLBACK callback = *(void **)io;
+
+    callback( instance, userdata, cvalue, RtlNtStatusToDosError( iosb->Status ),
+              iosb->Information, io );
+}
+
+/***********************************************************************
+ *              CreateThreadpoolIo (KERNEL32.@)
+ */
+PTP_IO WINAPI CreateThreadpoolIo( HANDLE file, PTP_WIN32_IO_CALLBACK callback, PVOID userdata,
+                                  TP_CALLBACK_ENVIRON *environment )
+{
+    TP_IO *io;
+    NTSTATUS status;
+
+    TRACE( "%p, %p, %p, %p\n", file, callback, userdata, environment );
+
+    status = TpAllocIoCompletion( &io, file, tp_io_callback, userdata, environment );
+    if (status)
+    {
+        SetLastError( RtlNtStatusToDosError(status) );
+        return NULL;
+    }
+
+    *(void **)io = callback;
+    return io;
+}
+
 /***********************************************************************
  *              CreateThreadpoolTimer (KERNEL32.@)
  */
@@ -4076,6 +4076,109 @@ static void test_join(void)
     DeleteFileA(msifile);
 }
 
+static void test_join_large(void)
+{
+    MSIHANDLE hdb, hview, hrec;
+    char query[MAX_PATH], buf[MAX_PATH];
+    UINT r, i, count, key, id;
+    DWORD size;
+
+    hdb = create_db();
+    ok( hdb, "failed to create db\n");
+
+    r = run_query( hdb, 0, "CREATE TABLE `Outer` (`Key` SHORT NOT NULL, `Name` CHAR(32) PRIMARY KEY `Key`)" );
+    ok( r == ERROR_SUCCESS, "failed to create table: %u\n", r );
+
+    r = run_query( hdb, 0, "CREATE TABLE `Inner` (`Id` SHORT NOT NULL, `Ref` SHORT, `Name` CHAR(32) PRIMARY KEY `Id`)" );
+    ok( r == ERROR_SUCCESS, "failed to create table: %u\n", r );
+
+    for (i = 0; i < 100; i++)
+    {
+        sprintf( query, "INSERT INTO `Outer` (`Key`, `Name`) VALUES (%u, 'name%u')", i, i );
+        r = run_query( hdb, 0, query );
+        ok( r == ERROR_SUCCESS, "failed to insert row %u: %u\n", i, r );
+    }
+
+    for (i = 0; i < 300; i++)
+    {
+        sprintf( query, "INSERT INTO `Inner` (`Id`, `Ref`, `Name`) VALUES (%u, %u, 'name%u')",
+                 i, (i % 50) * 2, i % 25 );
+        r = run_query( hdb, 0, query );
+        ok( r == ERROR_SUCCESS, "failed to insert row %u: %u\n", i, r );
+    }
+
+    /* integer join */
+    r = MsiDatabaseOpenViewA( hdb, "SELECT `Outer`.`Key`, `Inner`.`Id` FROM `Outer`, `Inner` "
+                              "WHERE `Outer`.`Key` = `Inner`.`Ref`", &hview );
+    ok( r == ERROR_SUCCESS, "failed to open view: %u\n", r );
+    r = MsiViewExecute( hview, 0 );
+    ok( r == ERROR_SUCCESS, "failed to execute view: %u\n", r );
+
+    count = 0;
+    while (MsiViewFetch( hview, &hrec ) == ERROR_SUCCESS)
+    {
+        key = MsiRecordGetInteger( hrec, 1 );
+        id = MsiRecordGetInteger( hrec, 2 );
+        ok( key == (id % 50) * 2, "got key %u for id %u\n", key, id );
+        MsiCloseHandle( hrec );
+        count++;
+    }
+    ok( count == 300, "expected 300 rows, got %u\n", count );
+
+    MsiViewClose( hview );
+    MsiCloseHandle( hview );
+
+    /* string join, with the tables in the other order */
+    r = MsiDatabaseOpenViewA( hdb, "SELECT `Outer`.`Key`, `Inner`.`Id` FROM `Inner`, `Outer` "
+                              "WHERE `Inner`.`Name` = `Outer`.`Name`", &hview );
+    ok( r == ERROR_SUCCESS, "failed to open view: %u\n", r );
+    r = MsiViewExecute( hview, 0 );
+    ok( r == ERROR_SUCCESS, "failed to execute view: %u\n", r );
+
+    count = 0;
+    while (MsiViewFetch( hview, &hrec ) == ERROR_SUCCESS)
+    {
+        key = MsiRecordGetInteger( hrec, 1 );
+        id = MsiRecordGetInteger( hrec, 2 );
+        ok( key == id % 25, "got key %u for id %u\n", key, id );
+        MsiCloseHandle( hrec );
+        count++;
+    }
+    ok( count == 300, "expected 300 rows, got %u\n", count );
+
+    MsiViewClose( hview );
+    MsiCloseHandle( hview );
+
+    /* join combined with a constant condition */
+    r = MsiDatabaseOpenViewA( hdb, "SELECT `Outer`.`Name`, `Inner`.`Id` FROM `Outer`, `Inner` "
+                              "WHERE `Outer`.`Key` = `Inner`.`Ref` AND `Inner`.`Name` = 'name3' "
+                              "ORDER BY `Inner`.`Id`", &hview );
+    ok( r == ERROR_SUCCESS, "failed to open view: %u\n", r );
+    r = MsiViewExecute( hview, 0 );
+    ok( r == ERROR_SUCCESS, "failed to execute view: %u\n", r );
+
+    count = 0;
+    while (MsiViewFetch( hview, &hrec ) == ERROR_SUCCESS)
+    {
+        id = MsiRecordGetInteger( hrec, 2 );
+        ok( id == count * 25 + 3, "expected id %u, got %u\n", count * 25 + 3, id );
+        size = sizeof(buf);
+        r = MsiRecordGetStringA( hrec, 1, buf, &size );
+        ok( r == ERROR_SUCCESS, "failed to get record string: %u\n", r );
+        sprintf( query, "name%u", (id % 50) * 2 );
+        ok( !lstrcmpA( buf, query ), "expected %s, got %s\n", query, buf );
+        MsiCloseHandle( hrec );
+        count++;
+    }
+    ok( count == 12, "expected 12 rows, got %u\n", count );
+
+    MsiViewClose( hview );
+    MsiCloseHandle( hview );
+
+    MsiCloseHandle( hdb );
+    DeleteFileA( msifile );
+}
+
 static void test_temporary_table(void)
 {
     MSICONDITION cond;
@@ -9747,6 +9850,7 @@ START_TEST(db)
     test_handle_limit();
     test_try_transform();
     test_join();
+    test_join_large();
     test_temporary_table();
     test_alter();
     test_integers();
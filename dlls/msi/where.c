@@ -52,8 +52,22 @@ typedef struct tagJOINTABLE
     UINT col_count;
     UINT row_count;
     UINT table_index;
+    struct tagJOININDEX *index;
 } JOINTABLE;
 
+/* hash of the rows of a table on a column that the condition requires to be
+ * equal to a column of a table that precedes it in the join order */
+typedef struct tagJOININDEX
+{
+    const union ext_column *inner; /* column of the indexed table */
+    const union ext_column *outer; /* column of the preceding table */
+    BOOL string;
+    UINT shift;
+    UINT *buckets; /* 1-based row numbers, 0 ends a chain */
+    UINT *next;
+    UINT keys[1];
+} JOININDEX;
+
 typedef struct tagMSIORDERINFO
 {
     UINT col_count;
@@ -599,15 +613,69 @@ static UINT WHERE_evaluate( MSIWHEREVIEW *wv, const UINT rows[],
     return ERROR_SUCCESS;
 }
 
+/* strings are keyed on a hash of their contents, so that rows that compare
+ * equal with STRCMP_Evaluate share a key */
+static UINT join_key( MSIWHEREVIEW *wv, const union ext_column *column, BOOL string,
+                      UINT row, UINT *key )
+{
+    JOINTABLE *table = column->parsed.table;
+    const WCHAR *str;
+    UINT r, val;
+
+    r = table->view->ops->fetch_int( table->view, row, column->parsed.column, &val );
+    if (r != ERROR_SUCCESS)
+        return r;
+
+    if (string)
+    {
+        str = msi_string_lookup( wv->db->strings, val, NULL );
+        val = 0;
+        if (str) while (*str) val = val * 31 + *str++;
+    }
+
+    *key = val;
+    return ERROR_SUCCESS;
+}
+
+static inline UINT join_bucket( const JOININDEX *index, UINT key )
+{
+    return (key * 0x9e3779b1) >> index->shift;
+}
+
+/* returns the 1-based number of the next row after pos matching key, or 0 */
+static UINT next_join_row( const JOININDEX *index, UINT key, UINT pos )
+{
+    pos = pos ? index->next[pos - 1] : index->buckets[join_bucket( index, key )];
+    while (pos && index->keys[pos - 1] != key)
+        pos = index->next[pos - 1];
+    return pos;
+}
+
 static UINT check_condition( MSIWHEREVIEW *wv, MSIRECORD *record, JOINTABLE **tables,
                              UINT table_rows[] )
 {
+    JOINTABLE *table = *tables;
+    JOININDEX *index = table->index;
+    UINT *row = &table_rows[table->table_index];
     UINT r = ERROR_FUNCTION_FAILED;
+    UINT key = 0, pos = 0;
     INT val;
 
-    for (table_rows[(*tables)->table_index] = 0;
-         table_rows[(*tables)->table_index] < (*tables)->row_count;
-         table_rows[(*tables)->table_index]++)
+    /* only the rows whose key matches the outer row can satisfy the condition */
+    if (index && join_key( wv, index->outer, index->string,
+                           table_rows[index->outer->parsed.table->table_index], &key ) != ERROR_SUCCESS)
+        index = NULL;
+
+    if (index)
+    {
+        r = ERROR_SUCCESS;
+        pos = next_join_row( index, key, 0 );
+        *row = pos ? pos - 1 : table->row_count;
+    }
+    else
+        *row = 0;
+
+    while (*row < table->row_count)
     {
         val = 0;
         wv->rec_index = 0;
@@ -629,8 +697,16 @@ static UINT check_condition( MSIWHEREVIEW *wv, MSIRECORD *record, JOINTABLE **ta
                 add_row (wv, table_rows);
             }
         }
+
+        if (index)
+        {
+            pos = next_join_row( index, key, pos );
+            *row = pos ? pos - 1 : table->row_count;
+        }
+        else
+            (*row)++;
     }
-    table_rows[(*tables)->table_index] = INVALID_ROW_INDEX;
+    *row = INVALID_ROW_INDEX;
     return r;
 }
 
@@ -763,6 +839,106 @@ static JOINTABLE **ordertables( MSIWHEREVIEW *wv )
     return tables;
 }
 
+static BOOL is_bound( JOINTABLE **tables, UINT count, const JOINTABLE *table )
+{
+    UINT i;
+
+    for (i = 0; i < count; i++)
+        if (tables[i] == table) return TRUE;
+    return FALSE;
+}
+
+/* looks for an equality between a column of table and a column of one of the
+ * bound tables among the conjuncts of the condition */
+static BOOL find_join_columns( const struct expr *expr, const JOINTABLE *table,
+                               JOINTABLE **bound, UINT bound_count, JOININDEX *index )
+{
+    const union ext_column *left, *right;
+
+    if (expr->type != EXPR_COMPLEX && expr->type != EXPR_STRCMP)
+        return FALSE;
+
+    if (expr->type == EXPR_COMPLEX && expr->u.expr.op == OP_AND)
+        return find_join_columns( expr->u.expr.left, table, bound, bound_count, index ) ||
+               find_join_columns( expr->u.expr.right, table, bound, bound_count, index );
+
+    if (expr->u.expr.op != OP_EQ || expr->u.expr.left->type != expr->u.expr.right->type)
+        return FALSE;
+
+    switch (expr->u.expr.left->type)
+    {
+    case EXPR_COL_NUMBER:
+    case EXPR_COL_NUMBER32:
+        if (expr->type != EXPR_COMPLEX) return FALSE;
+        index->string = FALSE;
+        break;
+    case EXPR_COL_NUMBER_STRING:
+        index->string = TRUE;
+        break;
+    default:
+        return FALSE;
+    }
+
+    left = &expr->u.expr.left->u.column;
+    right = &expr->u.expr.right->u.column;
+
+    if (left->parsed.table == table && is_bound( bound, bound_count, right->parsed.table ))
+    {
+        index->inner = left;
+        index->outer = right;
+        return TRUE;
+    }
+    if (right->parsed.table == table && is_bound( bound, bound_count, left->parsed.table ))
+    {
+        index->inner = right;
+        index->outer = left;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/* builds a hash join index for a table that is joined on equality to the
+ * tables bound before it, instead of scanning it for every outer row */
+static JOININDEX *create_join_index( MSIWHEREVIEW *wv, JOINTABLE *table,
+                                     JOINTABLE **bound, UINT bound_count )
+{
+    JOININDEX key_info, *index;
+    UINT bits = 1, i, key, *bucket;
+
+    if (!wv->cond || !find_join_columns( wv->cond, table, bound, bound_count, &key_info ))
+        return NULL;
+
+    while (bits < 24 && (1u << bits) < table->row_count)
+        bits++;
+
+    index = msi_alloc( FIELD_OFFSET( JOININDEX, keys[2 * table->row_count + (1u << bits)] ) );
+    if (!index)
+        return NULL;
+
+    *index = key_info;
+    index->shift = 32 - bits;
+    index->next = index->keys + table->row_count;
+    index->buckets = index->next + table->row_count;
+    memset( index->buckets, 0, (1u << bits) * sizeof(UINT) );
+
+    /* insert in reverse so that the chains list the rows in ascending order */
+    for (i = table->row_count; i > 0; i--)
+    {
+        if (join_key( wv, index->inner, index->string, i - 1, &key ) != ERROR_SUCCESS)
+        {
+            msi_free( index );
+            return NULL;
+        }
+        bucket = &index->buckets[join_bucket( index, key )];
+        index->keys[i - 1] = key;
+        index->next[i - 1] = *bucket;
+        *bucket = i;
+    }
+
+    TRACE("joining table %u on column %u\n", table->table_index, index->inner->parsed.column);
+    return index;
+}
+
 static UINT WHERE_execute( struct tagMSIVIEW *view, MSIRECORD *record )
 {
     MSIWHEREVIEW *wv = (MSIWHEREVIEW*)view;
@@ -800,12 +976,21 @@ static UINT WHERE_execute( struct tagMSIVIEW *view, MSIRECORD *record )
 
     ordered_tables = ordertables( wv );
 
+    for (i = 1; i < wv->table_count; i++)
+        ordered_tables[i]->index = create_join_index( wv, ordered_tables[i], ordered_tables, i );
+
     rows = msi_alloc( wv->table_count * sizeof(*rows) );
     for (i = 0; i < wv->table_count; i++)
         rows[i] = INVALID_ROW_INDEX;
 
     r =  check_condition(wv, record, ordered_tables, rows);
 
+    for (i = 0; i < wv->table_count; i++)
+    {
+        msi_free( ordered_tables[i]->index );
+        ordered_tables[i]->index = NULL;
+    }
+
     if (wv->order_info)
         wv->order_info->error = ERROR_SUCCESS;
 
@@ -1260,6 +1445,7 @@ UINT WHERE_CreateView( MSIDATABASE *db, MSIVIEW **view, LPWSTR tables,
 
         wv->col_count += table->col_count;
         table->table_index = wv->table_count++;
+        table->index = NULL;
 
         table->next = wv->tables;
         wv->tables = table;
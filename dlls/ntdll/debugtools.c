@@ -29,6 +29,10 @@
 # include <unistd.h>
 #endif
 #include <ctype.h>
+#include <fcntl.h>
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
 
 #include "wine/debug.h"
 #include "wine/exception.h"
@@ -44,6 +48,55 @@ WINE_DECLARE_DEBUG_CHANNEL(timestamp);
 
 static struct __wine_debug_functions default_funcs;
 
+/* Binary trace log, enabled by setting WINEDEBUGLOG to a file name prefix.
+ * Each process maps its own <prefix>.<unix pid> file; threads append
+ * records to chunks they own, so logging a line needs no lock and no
+ * system call. The file is a ring: once all chunks are used the oldest
+ * ones get recycled. Use winedump to convert it back to text. */
+
+#define DEBUG_LOG_MAGIC        0x474c4457  /* "WDLG" */
+#define DEBUG_LOG_VERSION      1
+#define DEBUG_LOG_CHUNK_SIZE   0x10000
+#define DEBUG_LOG_CHUNK_COUNT  256
+#define DEBUG_LOG_MAX_CHANNELS 255
+#define DEBUG_LOG_NO_CHANNEL   0xff
+#define DEBUG_LOG_NO_CLASS     0xff
+#define DEBUG_LOG_SEQ_BUSY     0x80000000  /* set in the chunk seq while a record is written */
+
+struct debug_log_header
+{
+    unsigned int magic;         /* DEBUG_LOG_MAGIC */
+    unsigned int version;       /* DEBUG_LOG_VERSION */
+    unsigned int chunk_size;    /* size of a chunk, including its header */
+    unsigned int chunk_count;   /* number of chunks, the first one starts at offset chunk_size */
+    unsigned int unix_pid;      /* Unix process that wrote the log */
+    int          next_seq;      /* sequence number of the next chunk to hand out */
+    int          channel_count; /* number of entries allocated in the channel table */
+    unsigned int pad;
+    char         channels[DEBUG_LOG_MAX_CHANNELS + 1][16];  /* channel names by id */
+};
+
+struct debug_log_chunk
+{
+    unsigned int seq;           /* chunk sequence number plus one, 0 if unused */
+    unsigned int pid;           /* process id of the owning thread */
+    unsigned int tid;           /* owning thread id */
+    unsigned int used;          /* size of the records following the header */
+};
+
+struct debug_log_record
+{
+    ULONGLONG      time;        /* performance counter, in 100ns units */
+    unsigned short size;        /* record size, including header and padding */
+    unsigned short text_len;    /* length of the text following the function name */
+    unsigned char  cls;         /* debug class, DEBUG_LOG_NO_CLASS for plain output */
+    unsigned char  channel;     /* channel id, DEBUG_LOG_NO_CHANNEL for plain output */
+    unsigned char  func_len;    /* length of the function name following the header */
+    unsigned char  pad;
+};
+
+static struct debug_log_header *debug_log;
+
 /* ---------------------------------------------------------------------- */
 
 /* get the debug info pointer for the current thread */
@@ -116,6 +169,126 @@ static const char *NTDLL_dbgstr_wn( const WCHAR *src, int n )
      return res;
 }
 
+/* release a chunk claimed by get_log_chunk */
+static inline void release_log_chunk( struct debug_info *info, struct debug_log_chunk *chunk )
+{
+    interlocked_xchg( (int *)&chunk->seq, info->log_seq );
+}
+
+/* claim a chunk of the binary log with room for size more bytes */
+static struct debug_log_chunk *get_log_chunk( struct debug_info *info, unsigned int size )
+{
+    struct debug_log_chunk *chunk = info->log_chunk;
+    unsigned int next, seq, old;
+
+    /* once the ring wraps around another thread may recycle our chunk, so the
+     * owner check and the busy flag that keeps it from being recycled while we
+     * write have to be set in one step */
+    if (chunk && interlocked_cmpxchg( (int *)&chunk->seq, info->log_seq | DEBUG_LOG_SEQ_BUSY,
+                                      info->log_seq ) == info->log_seq)
+    {
+        if (chunk->used + size <= debug_log->chunk_size - sizeof(*chunk)) return chunk;
+        release_log_chunk( info, chunk );
+    }
+
+    for (;;)
+    {
+        next = interlocked_xchg_add( &debug_log->next_seq, 1 );
+        if (!(seq = (next + 1) & ~DEBUG_LOG_SEQ_BUSY)) continue;
+        chunk = (struct debug_log_chunk *)((char *)debug_log +
+                                           (next % debug_log->chunk_count + 1) * debug_log->chunk_size);
+        /* don't wait for a thread that is still writing to the oldest chunk, take the next one */
+        if ((old = chunk->seq) & DEBUG_LOG_SEQ_BUSY) continue;
+        if (interlocked_cmpxchg( (int *)&chunk->seq, seq | DEBUG_LOG_SEQ_BUSY, old ) == old) break;
+    }
+    chunk->used = 0;
+    chunk->pid  = GetCurrentProcessId();
+    chunk->tid  = GetCurrentThreadId();
+    info->log_seq = seq;
+    info->log_chunk = chunk;
+    return chunk;
+}
+
+/* map a channel to its id in the binary log channel table */
+static unsigned char get_log_channel( struct debug_info *info, const struct __wine_debug_channel *channel )
+{
+    int i, count;
+
+    if (channel == info->log_last_channel) return info->log_last_id;
+
+    count = min( debug_log->channel_count, DEBUG_LOG_MAX_CHANNELS );
+    for (i = 0; i < count; i++)
+        if (!strncmp( debug_log->channels[i], channel->name, sizeof(channel->name) )) break;
+
+    if (i == count)
+    {
+        /* two threads racing here may both add the channel, which is harmless */
+        if ((i = interlocked_xchg_add( &debug_log->channel_count, 1 )) >= DEBUG_LOG_MAX_CHANNELS)
+            return DEBUG_LOG_NO_CHANNEL;
+        memcpy( debug_log->channels[i], channel->name, sizeof(channel->name) );
+    }
+    info->log_last_channel = channel;
+    info->log_last_id = i;
+    return i;
+}
+
+/* append a line of output to the binary log */
+static void write_log_record( struct debug_info *info, const char *text, unsigned int len )
+{
+    struct debug_log_chunk *chunk;
+    struct debug_log_record *rec;
+    LARGE_INTEGER counter;
+    unsigned int func_len = 0, size;
+
+    if (info->log_function) func_len = min( strlen( info->log_function ), 255 );
+    size = (sizeof(*rec) + func_len + len + 7) & ~7;
+
+    chunk = get_log_chunk( info, size );
+    rec = (struct debug_log_record *)((char *)(chunk + 1) + chunk->used);
+
+    NtQueryPerformanceCounter( &counter, NULL );
+    rec->time     = counter.QuadPart;
+    rec->size     = size;
+    rec->text_len = len;
+    rec->func_len = func_len;
+    rec->pad      = 0;
+    if (info->log_function)
+    {
+        rec->cls     = info->log_class;
+        rec->channel = get_log_channel( info, info->log_channel );
+    }
+    else
+    {
+        rec->cls     = DEBUG_LOG_NO_CLASS;
+        rec->channel = DEBUG_LOG_NO_CHANNEL;
+    }
+    memcpy( rec + 1, info->log_function, func_len );
+    memcpy( (char *)(rec + 1) + func_len, text, len );
+    chunk->used += size;
+    release_log_chunk( info, chunk );
+
+    /* further lines of the same message don't get a header */
+    info->log_function = NULL;
+}
+
+/* write complete lines from the output buffer */
+static void flush_output( struct debug_info *info, const char *pos, unsigned int len )
+{
+    const char *end;
+
+    if (!debug_log)
+    {
+        write( 2, pos, len );
+        return;
+    }
+    while (len && (end = memchr( pos, '\n', len )))
+    {
+        write_log_record( info, pos, end - pos );
+        len -= end + 1 - pos;
+        pos = end + 1;
+    }
+}
+
 /***********************************************************************
  *		NTDLL_dbg_vprintf
  */
@@ -145,7 +318,7 @@ static int NTDLL_dbg_vprintf( const char *format, va_list args )
     else
     {
         char *pos = info->output;
-        write( 2, pos, info->out_pos + end - pos );
+        flush_output( info, pos, info->out_pos + end - pos );
         /* move beginning of next line to start of buffer */
         memmove( pos, info->out_pos + end, ret - end );
         info->out_pos = pos + ret - end;
@@ -166,6 +339,18 @@ static int NTDLL_dbg_vlog( enum __wine_debug_class cls, struct __wine_debug_chan
     /* only print header if we are at the beginning of the line */
     if (info->out_pos == info->output || info->out_pos[-1] == '\n')
     {
+        if (debug_log)
+        {
+            /* the header is stored in binary form when the line is complete */
+            if (cls < sizeof(classes)/sizeof(classes[0]))
+            {
+                info->log_class    = cls;
+                info->log_channel  = channel;
+                info->log_function = function ? function : "";
+            }
+            else info->log_function = NULL;
+            return format ? NTDLL_dbg_vprintf( format, args ) : 0;
+        }
         if (TRACE_ON(timestamp))
         {
             ULONG ticks = NtGetTickCount();
@@ -194,10 +379,53 @@ static const struct __wine_debug_functions funcs =
     NTDLL_dbg_vlog
 };
 
+/***********************************************************************
+ *		debug_log_init
+ *
+ * Create the binary log file if requested through WINEDEBUGLOG.
+ */
+static void debug_log_init(void)
+{
+#ifdef HAVE_MMAP
+    const char *prefix = getenv( "WINEDEBUGLOG" );
+    size_t size = (DEBUG_LOG_CHUNK_COUNT + 1) * DEBUG_LOG_CHUNK_SIZE;
+    char name[1024];
+    void *ptr;
+    int fd;
+
+    if (!prefix || !*prefix) return;
+    if (snprintf( name, sizeof(name), "%s.%u", prefix, (unsigned int)getpid() ) >= sizeof(name)) return;
+
+    /* the name is predictable, so never open a file or link that someone else put there */
+    unlink( name );
+    if ((fd = open( name, O_RDWR | O_CREAT | O_EXCL, 0600 )) == -1)
+    {
+        fprintf( stderr, "wine: cannot create debug log %s\n", name );
+        return;
+    }
+    if (ftruncate( fd, size ) == -1 ||
+        (ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 )) == (void *)-1)
+    {
+        fprintf( stderr, "wine: cannot map debug log %s\n", name );
+        close( fd );
+        return;
+    }
+    close( fd );
+
+    debug_log = ptr;
+    debug_log->version     = DEBUG_LOG_VERSION;
+    debug_log->chunk_size  = DEBUG_LOG_CHUNK_SIZE;
+    debug_log->chunk_count = DEBUG_LOG_CHUNK_COUNT;
+    debug_log->unix_pid    = getpid();
+    debug_log->magic       = DEBUG_LOG_MAGIC;
+#endif
+}
+
 /***********************************************************************
  *		debug_init
  */
 void debug_init(void)
 {
+    debug_log_init();
     __wine_dbg_set_functions( &funcs, &default_funcs, sizeof(funcs) );
 }
@@ -218,6 +218,55 @@ static RTL_CRITICAL_SECTION_DEBUG critsect_debug =
 };
 static RTL_CRITICAL_SECTION dir_section = { &critsect_debug, -1, 0, 0, 0, 0 };
 
+/* case-insensitive index of the entries of a directory */
+struct dir_cache_entry
+{
+    unsigned int hash;       /* hash of the upper-case Unicode name */
+    unsigned int next;       /* next entry in the hash chain */
+    unsigned int name;       /* offset of the Unicode name in the names pool */
+    unsigned int unix_name;  /* offset of the Unix name in the unix_names pool */
+    unsigned int len;        /* length of the Unicode name */
+};
+
+struct dir_cache_short
+{
+    unsigned int next;       /* next entry in the hash chain */
+    unsigned int len;        /* length of the short name, 0 if the entry has none */
+    WCHAR        name[12];   /* hashed 8.3 name */
+};
+
+struct dir_cache
+{
+    struct list             entry;
+    dev_t                   dev;
+    ino_t                   ino;
+    time_t                  mtime;
+    time_t                  ctime;
+    unsigned int            count;
+    unsigned int            size;         /* number of hash buckets */
+    unsigned int           *buckets;
+    struct dir_cache_entry *entries;
+    WCHAR                  *names;
+    char                   *unix_names;
+    unsigned int           *short_buckets;  /* short names are only hashed on first use */
+    struct dir_cache_short *short_names;
+};
+
+#define DIR_CACHE_MAX_DIRS 32
+#define DIR_CACHE_END      (~0u)
+
+static struct list dir_cache_list = LIST_INIT( dir_cache_list );
+static unsigned int dir_cache_count;
+
+static RTL_CRITICAL_SECTION dir_cache_section;
+static RTL_CRITICAL_SECTION_DEBUG dir_cache_critsect_debug =
+{
+    0, 0, &dir_cache_section,
+    { &dir_cache_critsect_debug.ProcessLocksList, &dir_cache_critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": dir_cache_section") }
+};
+static RTL_CRITICAL_SECTION dir_cache_section = { &dir_cache_critsect_debug, -1, 0, 0, 0, 0 };
+
 
 /* check if a given Unicode char is OK in a DOS short name */
 static inline BOOL is_invalid_dos_char( WCHAR ch )
@@ -2073,6 +2122,264 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event,
 }
 
 
+static unsigned int dir_cache_hash( const WCHAR *name, unsigned int len )
+{
+    unsigned int hash = 0;
+    while (len--) hash = hash * 33 + toupperW( *name++ );
+    return hash;
+}
+
+static void free_dir_cache( struct dir_cache *cache )
+{
+    RtlFreeHeap( GetProcessHeap(), 0, cache->buckets );
+    RtlFreeHeap( GetProcessHeap(), 0, cache->entries );
+    RtlFreeHeap( GetProcessHeap(), 0, cache->names );
+    RtlFreeHeap( GetProcessHeap(), 0, cache->unix_names );
+    RtlFreeHeap( GetProcessHeap(), 0, cache->short_buckets );
+    RtlFreeHeap( GetProcessHeap(), 0, cache->short_names );
+    RtlFreeHeap( GetProcessHeap(), 0, cache );
+}
+
+/* grow a pool so that it can hold 'needed' more elements */
+static BOOL grow_dir_cache_pool( void **pool, unsigned int *alloc, unsigned int used,
+                                 unsigned int needed, unsigned int elem_size )
+{
+    unsigned int new_alloc = *alloc;
+    void *new_pool;
+
+    if (*pool && used + needed <= *alloc) return TRUE;
+    while (used + needed > new_alloc) new_alloc *= 2;
+    if (*pool) new_pool = RtlReAllocateHeap( GetProcessHeap(), 0, *pool, new_alloc * elem_size );
+    else new_pool = RtlAllocateHeap( GetProcessHeap(), 0, new_alloc * elem_size );
+    if (!new_pool) return FALSE;
+    *pool = new_pool;
+    *alloc = new_alloc;
+    return TRUE;
+}
+
+/***********************************************************************
+ *           build_dir_cache
+ *
+ * Read a whole directory into a case-insensitive index. 'st' must have been
+ * retrieved before reading the directory, so that any concurrent change
+ * invalidates the index.
+ */
+static struct dir_cache *build_dir_cache( const char *unix_name, const struct stat *st, NTSTATUS *status )
+{
+    unsigned int alloc_entries = 64, alloc_names = 1024, alloc_unix = 1024;
+    unsigned int names_used = 0, unix_used = 0, i;
+    WCHAR buffer[MAX_DIR_ENTRY_LEN];
+    struct dir_cache *cache;
+    struct dirent *de;
+    DIR *dir;
+    int ret;
+
+    if (!(dir = opendir( unix_name )))
+    {
+        if (errno == ENOENT) *status = STATUS_OBJECT_PATH_NOT_FOUND;
+        else *status = FILE_GetNtStatus();
+        return NULL;
+    }
+
+    *status = STATUS_NO_MEMORY;
+    if (!(cache = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*cache) ))) goto failed;
+    cache->dev   = st->st_dev;
+    cache->ino   = st->st_ino;
+    cache->mtime = st->st_mtime;
+    cache->ctime = st->st_ctime;
+
+    while ((de = readdir( dir )))
+    {
+        unsigned int unix_len = strlen( de->d_name ) + 1;
+
+        ret = ntdll_umbstowcs( 0, de->d_name, unix_len - 1, buffer, MAX_DIR_ENTRY_LEN );
+        if (ret < 0) continue;
+
+        if (!grow_dir_cache_pool( (void **)&cache->entries, &alloc_entries, cache->count, 1,
+                                  sizeof(*cache->entries) ) ||
+            !grow_dir_cache_pool( (void **)&cache->names, &alloc_names, names_used, ret,
+                                  sizeof(*cache->names) ) ||
+            !grow_dir_cache_pool( (void **)&cache->unix_names, &alloc_unix, unix_used, unix_len,
+                                  sizeof(*cache->unix_names) ))
+            goto failed;
+
+        cache->entries[cache->count].hash      = dir_cache_hash( buffer, ret );
+        cache->entries[cache->count].name      = names_used;
+        cache->entries[cache->count].unix_name = unix_used;
+        cache->entries[cache->count].len       = ret;
+        memcpy( cache->names + names_used, buffer, ret * sizeof(WCHAR) );
+        memcpy( cache->unix_names + unix_used, de->d_name, unix_len );
+        names_used += ret;
+        unix_used += unix_len;
+        cache->count++;
+    }
+    closedir( dir );
+    dir = NULL;
+
+    cache->size = cache->count | 1;
+    if (!(cache->buckets = RtlAllocateHeap( GetProcessHeap(), 0, cache->size * sizeof(*cache->buckets) )))
+        goto failed;
+    for (i = 0; i < cache->size; i++) cache->buckets[i] = DIR_CACHE_END;
+    /* insert in reverse order so that chains are in readdir order */
+    for (i = cache->count; i > 0; i--)
+    {
+        unsigned int *bucket = &cache->buckets[cache->entries[i - 1].hash % cache->size];
+        cache->entries[i - 1].next = *bucket;
+        *bucket = i - 1;
+    }
+    *status = STATUS_SUCCESS;
+    return cache;
+
+failed:
+    if (dir) closedir( dir );
+    if (cache) free_dir_cache( cache );
+    return NULL;
+}
+
+/* hash the DOS short names of the entries that need one; cache must be private or locked */
+static BOOL build_dir_cache_short_names( struct dir_cache *cache )
+{
+    UNICODE_STRING str;
+    BOOLEAN spaces;
+    unsigned int i;
+
+    if (!(cache->short_names = RtlAllocateHeap( GetProcessHeap(), 0,
+                                                cache->count * sizeof(*cache->short_names) )))
+        return FALSE;
+    if (!(cache->short_buckets = RtlAllocateHeap( GetProcessHeap(), 0,
+                                                  cache->size * sizeof(*cache->short_buckets) )))
+    {
+        RtlFreeHeap( GetProcessHeap(), 0, cache->short_names );
+        cache->short_names = NULL;
+        return FALSE;
+    }
+
+    for (i = 0; i < cache->size; i++) cache->short_buckets[i] = DIR_CACHE_END;
+    for (i = cache->count; i > 0; i--)
+    {
+        struct dir_cache_short *short_name = &cache->short_names[i - 1];
+        unsigned int *bucket;
+
+        short_name->len = 0;
+        str.Buffer = cache->names + cache->entries[i - 1].name;
+        str.Length = str.MaximumLength = cache->entries[i - 1].len * sizeof(WCHAR);
+        if (RtlIsNameLegalDOS8Dot3( &str, NULL, &spaces ) && !spaces) continue;
+
+        short_name->len = hash_short_file_name( &str, short_name->name );
+        bucket = &cache->short_buckets[dir_cache_hash( short_name->name, short_name->len ) % cache->size];
+        short_name->next = *bucket;
+        *bucket = i - 1;
+    }
+    return TRUE;
+}
+
+/* look up a name in the index; cache must be private or locked */
+static NTSTATUS find_in_dir_cache( struct dir_cache *cache, const WCHAR *name, unsigned int length,
+                                   BOOLEAN check_short, char *unix_name )
+{
+    unsigned int hash = dir_cache_hash( name, length ) % cache->size;
+    unsigned int i;
+
+    for (i = cache->buckets[hash]; i != DIR_CACHE_END; i = cache->entries[i].next)
+    {
+        const struct dir_cache_entry *entry = &cache->entries[i];
+
+        if (entry->len == length && !memicmpW( cache->names + entry->name, name, length ))
+        {
+            strcpy( unix_name, cache->unix_names + entry->unix_name );
+            return STATUS_SUCCESS;
+        }
+    }
+
+    if (!check_short) return STATUS_OBJECT_PATH_NOT_FOUND;
+    if (!cache->short_names && !build_dir_cache_short_names( cache )) return STATUS_NO_MEMORY;
+
+    for (i = cache->short_buckets[hash]; i != DIR_CACHE_END; i = cache->short_names[i].next)
+    {
+        const struct dir_cache_short *short_name = &cache->short_names[i];
+
+        if (short_name->len == length && !memicmpW( short_name->name, name, length ))
+        {
+            strcpy( unix_name, cache->unix_names + cache->entries[i].unix_name );
+            return STATUS_SUCCESS;
+        }
+    }
+    return STATUS_OBJECT_PATH_NOT_FOUND;
+}
+
+/***********************************************************************
+ *           lookup_dir_cache
+ *
+ * Case-insensitive lookup of a file name in a directory, using a cached index
+ * of the directory contents that is validated against the directory change
+ * times. The matching Unix name is copied to 'result'.
+ */
+static NTSTATUS lookup_dir_cache( const char *dir_name, const WCHAR *name, int length,
+                                  BOOLEAN check_short, char *result )
+{
+    struct dir_cache *cache, *old, *next;
+    struct stat st;
+    NTSTATUS status;
+
+    if (stat( dir_name, &st ) == -1)
+    {
+        if (errno == ENOENT) return STATUS_OBJECT_PATH_NOT_FOUND;
+        return FILE_GetNtStatus();
+    }
+
+    RtlEnterCriticalSection( &dir_cache_section );
+    LIST_FOR_EACH_ENTRY( cache, &dir_cache_list, struct dir_cache, entry )
+    {
+        if (cache->dev != st.st_dev || cache->ino != st.st_ino) continue;
+
+        list_remove( &cache->entry );
+        if (cache->mtime == st.st_mtime && cache->ctime == st.st_ctime)
+        {
+            list_add_head( &dir_cache_list, &cache->entry );
+            status = find_in_dir_cache( cache, name, length, check_short, result );
+            RtlLeaveCriticalSection( &dir_cache_section );
+            return status;
+        }
+        free_dir_cache( cache );
+        dir_cache_count--;
+        break;
+    }
+    RtlLeaveCriticalSection( &dir_cache_section );
+
+    if (!(cache = build_dir_cache( dir_name, &st, &status ))) return status;
+    status = find_in_dir_cache( cache, name, length, check_short, result );
+
+    /* a change within the timestamp granularity would go unnoticed, so
+     * don't keep the index of a directory that was modified very recently */
+    if (st.st_mtime >= time( NULL ) - 1 || st.st_ctime >= time( NULL ) - 1)
+    {
+        free_dir_cache( cache );
+        return status;
+    }
+
+    /* drop the index that another thread may have added meanwhile */
+    RtlEnterCriticalSection( &dir_cache_section );
+    LIST_FOR_EACH_ENTRY_SAFE( old, next, &dir_cache_list, struct dir_cache, entry )
+    {
+        if (old->dev != st.st_dev || old->ino != st.st_ino) continue;
+        list_remove( &old->entry );
+        free_dir_cache( old );
+        dir_cache_count--;
+    }
+    if (dir_cache_count == DIR_CACHE_MAX_DIRS)
+    {
+        old = LIST_ENTRY( list_tail( &dir_cache_list ), struct dir_cache, entry );
+        list_remove( &old->entry );
+        free_dir_cache( old );
+        dir_cache_count--;
+    }
+    list_add_head( &dir_cache_list, &cache->entry );
+    dir_cache_count++;
+    RtlLeaveCriticalSection( &dir_cache_section );
+    return status;
+}
+
+
 /***********************************************************************
  *           find_file_in_dir
  *
@@ -2083,11 +2390,9 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event,
 static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, int length,
                                   BOOLEAN check_case, BOOLEAN *is_win_dir )
 {
-    WCHAR buffer[MAX_DIR_ENTRY_LEN];
     UNICODE_STRING str;
     BOOLEAN spaces, is_name_8_dot_3;
-    DIR *dir;
-    struct dirent *de;
+    NTSTATUS status;
     struct stat st;
     int ret, used_default;
 
@@ -2132,6 +2437,7 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
         int fd = open( unix_name, O_RDONLY | O_DIRECTORY );
         if (fd != -1)
         {
+            WCHAR buffer[MAX_DIR_ENTRY_LEN];
             KERNEL_DIRENT *kde;
 
             RtlEnterCriticalSection( &dir_section );
@@ -2183,40 +2489,13 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
     }
 #endif /* VFAT_IOCTL_READDIR_BOTH */
 
-    if (!(dir = opendir( unix_name )))
+    status = lookup_dir_cache( unix_name, name, length, is_name_8_dot_3, unix_name + pos );
+    if (status == STATUS_SUCCESS)
     {
-        if (errno == ENOENT) return STATUS_OBJECT_PATH_NOT_FOUND;
-        else return FILE_GetNtStatus();
+        unix_name[pos - 1] = '/';
+        goto success;
     }
-    unix_name[pos - 1] = '/';
-    str.Buffer = buffer;
-    str.MaximumLength = sizeof(buffer);
-    while ((de = readdir( dir )))
-    {
-        ret = ntdll_umbstowcs( 0, de->d_name, strlen(de->d_name), buffer, MAX_DIR_ENTRY_LEN );
-        if (ret == length && !memicmpW( buffer, name, length ))
-        {
-            strcpy( unix_name + pos, de->d_name );
-            closedir( dir );
-            goto success;
-        }
-
-        if (!is_name_8_dot_3) continue;
-
-        str.Length = ret * sizeof(WCHAR);
-        if (!RtlIsNameLegalDOS8Dot3( &str, NULL, &spaces ) || spaces)
-        {
-            WCHAR short_nameW[12];
-            ret = hash_short_file_name( &str, short_nameW );
-            if (ret == length && !memicmpW( short_nameW, name, length ))
-            {
-                strcpy( unix_name + pos, de->d_name );
-                closedir( dir );
-                goto success;
-            }
-        }
-    }
-    closedir( dir );
+    if (status != STATUS_OBJECT_PATH_NOT_FOUND) return status;
 
 not_found:
     unix_name[pos - 1] = 0;
@@ -42,6 +42,7 @@
 #include "ntdll_misc.h"
 #include "wine/list.h"
 #include "wine/debug.h"
+#include "wine/exception.h"
 #include "wine/server.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(heap);
@@ -85,6 +86,8 @@ typedef struct
 #define ARENA_PENDING_MAGIC    0xbedead
 #define ARENA_FREE_MAGIC       0x45455246
 #define ARENA_LARGE_MAGIC      0x6752614c
+#define ARENA_LFH_MAGIC        0x48464c
+#define ARENA_LFH_FREE_MAGIC   0x46464c
 
 #define ARENA_INUSE_FILLER     0x55
 #define ARENA_TAIL_FILLER      0xab
@@ -158,10 +161,46 @@ typedef struct tagHEAP
     ARENA_INUSE    **pending_free;  /* Ring buffer for pending free requests */
     RTL_CRITICAL_SECTION critSection; /* Critical section for serialization */
     FREE_LIST_ENTRY *freeList;      /* Free lists */
+    struct tagLFH_BIN *lfh_bins;    /* Front end bins, or NULL if the front end is disabled */
+    struct list      lfh_list;      /* Front end sub-segments list */
 } HEAP;
 
 #define HEAP_MAGIC       ((DWORD)('H' | ('E'<<8) | ('A'<<16) | ('P'<<24)))
 
+/* Low-fragmentation front end: small blocks of a given size are carved out of
+ * sub-segments allocated from the back end heap, and recycled through lock-free
+ * per-size bins without entering the heap critical section.
+ * The arena of a front end block stores the offset to its sub-segment in the
+ * 'size' field, so that the back end never sees these blocks. */
+
+typedef struct
+{
+    struct list         entry;      /* Entry in heap sub-segment list */
+    struct tagHEAP     *heap;       /* Heap owning this sub-segment */
+    SIZE_T              block_size; /* Size of the blocks, including the arena */
+    DWORD               count;      /* Number of blocks */
+    DWORD               free;       /* Number of free blocks, only valid while compacting */
+    DWORD               unused;
+    DWORD               magic;      /* Magic number */
+} LFH_SUBSEGMENT;
+
+#define LFH_SUBSEGMENT_MAGIC  ((DWORD)('L' | ('F'<<8) | ('H'<<16) | ('S'<<24)))
+
+typedef struct tagLFH_BIN
+{
+    SLIST_HEADER        list;       /* Free blocks of this size */
+    LONG                poppers;    /* Number of threads popping from the list */
+} LFH_BIN;
+
+#define HEAP_LFH_MAX_SIZE      0x400   /* max block size handled by the front end */
+#define HEAP_LFH_NB_BINS       (HEAP_LFH_MAX_SIZE / ALIGNMENT + 1)
+#define HEAP_LFH_SEGMENT_SIZE  0x4000  /* size of the sub-segments allocated from the back end */
+#define HEAP_LFH_FIRST_BLOCK   ROUND_SIZE(sizeof(LFH_SUBSEGMENT))
+
+/* FrontEndHeapDebugOptions values */
+#define HEAP_FRONTEND_DISABLE_LFH  0x04
+#define HEAP_FRONTEND_ENABLE_LFH   0x08
+
 #define HEAP_DEF_SIZE        0x110000   /* Default heap size = 1Mb + 64Kb */
 #define COMMIT_MASK          0xffff  /* bitmask for commit/decommit granularity */
 #define MAX_FREE_PENDING     1024    /* max number of free requests to delay */
@@ -173,6 +212,7 @@ typedef struct tagHEAP
 #define HEAP_VALIDATE_PARAMS  0x40000000
 
 static HEAP *processHeap;  /* main process heap */
+static ULONG frontend_options;  /* FrontEndHeapDebugOptions for the process */
 
 static BOOL HEAP_IsRealArena( HEAP *heapPtr, DWORD flags, LPCVOID block, BOOL quiet );
 
@@ -860,6 +900,311 @@ static BOOL validate_large_arena( HEAP *heap, const ARENA_LARGE *arena, BOOL qui
 }
 
 
+/***********************************************************************
+ *           get_lfh_subsegment
+ *
+ * Retrieve the front end sub-segment of a block, making sure that it belongs to the heap.
+ */
+static LFH_SUBSEGMENT *get_lfh_subsegment( const HEAP *heap, const ARENA_INUSE *arena )
+{
+    const LFH_SUBSEGMENT *subseg;
+    LFH_SUBSEGMENT *ret = NULL;
+    DWORD offset;
+
+    if ((ULONG_PTR)arena % ALIGNMENT != ARENA_OFFSET) return NULL;
+
+    /* this runs without the heap lock, before the pointer has been validated
+     * against the subheaps, so it may not even point to mapped memory */
+    __TRY
+    {
+        if (arena->magic == ARENA_LFH_MAGIC)
+        {
+            offset = arena->size;
+            subseg = (const LFH_SUBSEGMENT *)((const char *)arena - offset);
+            if (offset >= HEAP_LFH_FIRST_BLOCK && offset < HEAP_LFH_SEGMENT_SIZE &&
+                subseg->magic == LFH_SUBSEGMENT_MAGIC && subseg->heap == heap &&
+                !((offset - HEAP_LFH_FIRST_BLOCK) % subseg->block_size))
+                ret = (LFH_SUBSEGMENT *)subseg;
+        }
+    }
+    __EXCEPT_PAGE_FAULT
+    {
+        ret = NULL;
+    }
+    __ENDTRY
+    return ret;
+}
+
+
+/***********************************************************************
+ *           get_lfh_bin
+ */
+static inline LFH_BIN *get_lfh_bin( const HEAP *heap, SIZE_T block_size )
+{
+    return &heap->lfh_bins[(block_size - sizeof(ARENA_INUSE)) / ALIGNMENT];
+}
+
+
+/***********************************************************************
+ *           allocate_lfh_block
+ *
+ * Get a free block from the front end, refilling the bin from the back end if needed.
+ * 'size' is the rounded size of the user data.
+ */
+static ARENA_INUSE *allocate_lfh_block( HEAP *heap, SIZE_T size )
+{
+    SIZE_T block_size = sizeof(ARENA_INUSE) + size;
+    LFH_BIN *bin = get_lfh_bin( heap, block_size );
+    LFH_SUBSEGMENT *subseg;
+    ARENA_INUSE *arena, *first;
+    SLIST_ENTRY *entry;
+    DWORD i;
+
+    /* popping reads the first entry, which compact_lfh() must not free under us */
+    interlocked_xchg_add( &bin->poppers, 1 );
+    entry = RtlInterlockedPopEntrySList( &bin->list );
+    interlocked_xchg_add( &bin->poppers, -1 );
+    if (entry) return (ARENA_INUSE *)entry - 1;
+
+    /* the bin is empty, allocate a new sub-segment from the back end */
+
+    if (!(subseg = RtlAllocateHeap( heap, 0, HEAP_LFH_SEGMENT_SIZE ))) return NULL;
+    subseg->heap       = heap;
+    subseg->block_size = block_size;
+    subseg->count      = (HEAP_LFH_SEGMENT_SIZE - HEAP_LFH_FIRST_BLOCK) / block_size;
+    subseg->free       = 0;
+    subseg->magic      = LFH_SUBSEGMENT_MAGIC;
+
+    first = (ARENA_INUSE *)((char *)subseg + HEAP_LFH_FIRST_BLOCK);
+    for (i = 0, arena = first; i < subseg->count; i++)
+    {
+        arena->size = (char *)arena - (char *)subseg;
+        arena->magic = ARENA_LFH_FREE_MAGIC;
+        arena->unused_bytes = 0;
+        if (i < subseg->count - 1)
+            ((SLIST_ENTRY *)(arena + 1))->Next = (SLIST_ENTRY *)((char *)(arena + 1) + block_size);
+        arena = (ARENA_INUSE *)((char *)arena + block_size);
+    }
+
+    RtlEnterCriticalSection( &heap->critSection );
+    list_add_head( &heap->lfh_list, &subseg->entry );
+    RtlLeaveCriticalSection( &heap->critSection );
+
+    /* keep the first block for ourselves, the other ones go to the bin */
+    arena = (ARENA_INUSE *)((char *)first + block_size);
+    if (subseg->count > 1)
+        RtlInterlockedPushListSListEx( &bin->list, (SLIST_ENTRY *)(arena + 1),
+                                       (SLIST_ENTRY *)((char *)(first + 1) + (subseg->count - 1) * block_size),
+                                       subseg->count - 1 );
+    TRACE( "heap %p: new sub-segment %p for %lu blocks of %08lx bytes\n",
+           heap, subseg, (SIZE_T)subseg->count, size );
+    return first;
+}
+
+
+/***********************************************************************
+ *           free_lfh_block
+ */
+static void free_lfh_block( HEAP *heap, LFH_SUBSEGMENT *subseg, ARENA_INUSE *arena )
+{
+    arena->magic = ARENA_LFH_FREE_MAGIC;
+    mark_block_free( arena + 1, subseg->block_size - sizeof(*arena), heap->flags );
+    mark_block_initialized( arena + 1, sizeof(SLIST_ENTRY) );
+    RtlInterlockedPushEntrySList( &get_lfh_bin( heap, subseg->block_size )->list, (SLIST_ENTRY *)(arena + 1) );
+}
+
+
+/***********************************************************************
+ *           realloc_lfh_block
+ */
+static void *realloc_lfh_block( HEAP *heap, DWORD flags, LFH_SUBSEGMENT *subseg,
+                                ARENA_INUSE *arena, SIZE_T size )
+{
+    SIZE_T block_size = subseg->block_size - sizeof(*arena);
+    SIZE_T old_size = block_size - arena->unused_bytes;
+    SIZE_T rounded_size = ROUND_SIZE(size);
+    void *new_ptr;
+
+    if (rounded_size < size) return NULL;  /* overflow */
+    if (rounded_size < HEAP_MIN_DATA_SIZE) rounded_size = HEAP_MIN_DATA_SIZE;
+
+    /* same rule as HEAP_ShrinkBlock: only keep the block if there is nothing worth splitting */
+    if (rounded_size <= block_size && block_size - rounded_size < HEAP_MIN_SHRINK_SIZE)
+    {
+        notify_realloc( arena + 1, old_size, size );
+        arena->unused_bytes = block_size - size;
+        if (size > old_size)
+            initialize_block( (char *)(arena + 1) + old_size, size - old_size, arena->unused_bytes, flags );
+        else
+            mark_block_tail( (char *)(arena + 1) + size, arena->unused_bytes, flags );
+        return arena + 1;
+    }
+    if (flags & HEAP_REALLOC_IN_PLACE_ONLY) return NULL;
+    if (!(new_ptr = RtlAllocateHeap( heap, flags & ~HEAP_GENERATE_EXCEPTIONS, size ))) return NULL;
+    memcpy( new_ptr, arena + 1, min( old_size, size ));
+    notify_free( arena + 1 );
+    free_lfh_block( heap, subseg, arena );
+    return new_ptr;
+}
+
+
+/***********************************************************************
+ *           validate_lfh_subsegment
+ */
+static BOOL validate_lfh_subsegment( HEAP *heap, const LFH_SUBSEGMENT *subseg )
+{
+    const ARENA_INUSE *arena = (const ARENA_INUSE *)((const char *)subseg + HEAP_LFH_FIRST_BLOCK);
+    DWORD i;
+
+    if (subseg->magic != LFH_SUBSEGMENT_MAGIC || subseg->heap != heap ||
+        HEAP_LFH_FIRST_BLOCK + subseg->count * subseg->block_size > HEAP_LFH_SEGMENT_SIZE)
+    {
+        ERR( "Heap %p: invalid front end sub-segment %p\n", heap, subseg );
+        return FALSE;
+    }
+    for (i = 0; i < subseg->count; i++)
+    {
+        if ((arena->magic != ARENA_LFH_MAGIC && arena->magic != ARENA_LFH_FREE_MAGIC) ||
+            arena->size != (const char *)arena - (const char *)subseg ||
+            arena->unused_bytes > subseg->block_size - sizeof(*arena))
+        {
+            ERR( "Heap %p: invalid front end arena %p values %x/%x\n",
+                 heap, arena, arena->size, arena->magic );
+            return FALSE;
+        }
+        arena = (const ARENA_INUSE *)((const char *)arena + subseg->block_size);
+    }
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           get_walk_lfh_subsegment
+ *
+ * Check whether a back end block walked by RtlWalkHeap is a front end sub-segment.
+ */
+static const LFH_SUBSEGMENT *get_walk_lfh_subsegment( const HEAP *heap, const ARENA_INUSE *arena )
+{
+    const LFH_SUBSEGMENT *subseg = (const LFH_SUBSEGMENT *)(arena + 1);
+
+    if (!heap->lfh_bins || arena->magic != ARENA_INUSE_MAGIC) return NULL;
+    if ((arena->size & ARENA_SIZE_MASK) < HEAP_LFH_SEGMENT_SIZE) return NULL;
+    if (subseg->magic != LFH_SUBSEGMENT_MAGIC || subseg->heap != heap) return NULL;
+    return subseg;
+}
+
+
+/***********************************************************************
+ *           compact_lfh
+ *
+ * Give back to the back end the sub-segments that don't contain any used block.
+ * Return the number of bytes released. The heap must be locked.
+ */
+static SIZE_T compact_lfh( HEAP *heap )
+{
+    LFH_SUBSEGMENT *subseg, *next;
+    SLIST_ENTRY *entry, *next_entry;
+    SLIST_ENTRY *lists[HEAP_LFH_NB_BINS];
+    SIZE_T released = 0;
+    BOOL unused = FALSE;
+    unsigned int i;
+
+    for (i = 0; i < HEAP_LFH_NB_BINS; i++)
+    {
+        lists[i] = RtlInterlockedFlushSList( &heap->lfh_bins[i].list );
+        for (entry = lists[i]; entry; entry = entry->Next)
+        {
+            ARENA_INUSE *arena = (ARENA_INUSE *)entry - 1;
+            subseg = (LFH_SUBSEGMENT *)((char *)arena - arena->size);
+            if (++subseg->free == subseg->count) unused = TRUE;
+        }
+    }
+
+    /* put back the blocks of the sub-segments that are still in use */
+
+    for (i = 0; i < HEAP_LFH_NB_BINS; i++)
+    {
+        for (entry = lists[i]; entry; entry = next_entry)
+        {
+            ARENA_INUSE *arena = (ARENA_INUSE *)entry - 1;
+            next_entry = entry->Next;
+            subseg = (LFH_SUBSEGMENT *)((char *)arena - arena->size);
+            if (subseg->free < subseg->count) RtlInterlockedPushEntrySList( &heap->lfh_bins[i].list, entry );
+        }
+    }
+
+    /* a thread that started popping before the flush may still be reading the
+     * link of a block that we are about to free, wait until all of them are done;
+     * later pops can only see the blocks that were put back */
+    if (unused)
+    {
+        for (i = 0; i < HEAP_LFH_NB_BINS; i++)
+            while (*(volatile LONG *)&heap->lfh_bins[i].poppers) NtYieldExecution();
+    }
+
+    LIST_FOR_EACH_ENTRY_SAFE( subseg, next, &heap->lfh_list, LFH_SUBSEGMENT, entry )
+    {
+        ARENA_INUSE *arena = (ARENA_INUSE *)subseg - 1;
+
+        if (subseg->free < subseg->count)
+        {
+            subseg->free = 0;
+            continue;
+        }
+        TRACE( "heap %p: freeing sub-segment %p\n", heap, subseg );
+        list_remove( &subseg->entry );
+        subseg->magic = 0;
+        released += arena->size & ARENA_SIZE_MASK;
+        notify_free( subseg );
+        HEAP_MakeInUseBlockFree( HEAP_FindSubHeap( heap, arena ), arena );
+    }
+    return released;
+}
+
+
+/***********************************************************************
+ *           enable_lfh
+ */
+static NTSTATUS enable_lfh( HEAP *heap )
+{
+    SIZE_T size = HEAP_LFH_NB_BINS * sizeof(LFH_BIN);
+    void *ptr = NULL;
+    unsigned int i;
+
+    if (heap->lfh_bins) return STATUS_SUCCESS;
+
+    /* the front end is not compatible with heap debugging */
+    if (!(heap->flags & HEAP_GROWABLE) ||
+        (heap->flags & (HEAP_NO_SERIALIZE | HEAP_SHARED | HEAP_VALIDATE |
+                        HEAP_TAIL_CHECKING_ENABLED | HEAP_FREE_CHECKING_ENABLED)) ||
+        RUNNING_ON_VALGRIND)
+    {
+        WARN( "heap %p: flags %08x don't allow a front end\n", heap, heap->flags );
+        return STATUS_UNSUCCESSFUL;
+    }
+
+    if (NtAllocateVirtualMemory( NtCurrentProcess(), &ptr, 4, &size, MEM_COMMIT, PAGE_READWRITE ))
+        return STATUS_NO_MEMORY;
+    for (i = 0; i < HEAP_LFH_NB_BINS; i++) RtlInitializeSListHead( &((LFH_BIN *)ptr)[i].list );
+
+    RtlEnterCriticalSection( &heap->critSection );
+    if (!heap->lfh_bins)
+    {
+        heap->lfh_bins = ptr;
+        ptr = NULL;
+    }
+    RtlLeaveCriticalSection( &heap->critSection );
+
+    if (ptr)  /* another thread was faster */
+    {
+        size = 0;
+        NtFreeVirtualMemory( NtCurrentProcess(), &ptr, &size, MEM_RELEASE );
+    }
+    TRACE( "heap %p: front end enabled\n", heap );
+    return STATUS_SUCCESS;
+}
+
+
 /***********************************************************************
  *           HEAP_CreateSubHeap
  */
@@ -915,8 +1260,10 @@ static SUBHEAP *HEAP_CreateSubHeap( HEAP *heap, LPVOID address, DWORD flags,
         heap->flags         = flags;
         heap->magic         = HEAP_MAGIC;
         heap->grow_size     = max( HEAP_DEF_SIZE, totalSize );
+        heap->lfh_bins      = NULL;
         list_init( &heap->subheap_list );
         list_init( &heap->large_list );
+        list_init( &heap->lfh_list );
 
         subheap = &heap->subheap;
         subheap->base       = address;
@@ -1348,7 +1695,29 @@ static BOOL HEAP_IsRealArena( HEAP *heapPtr,   /* [in] ptr to the heap */
             }
             else
                 ret = validate_large_arena( heapPtr, large_arena, quiet );
-        } else
+        }
+        else if (heapPtr->lfh_bins && arena->magic == ARENA_LFH_MAGIC)
+        {
+            /* front end blocks are carved out of back end blocks, so the
+             * subheap check above ensures the arena can be read */
+            const LFH_SUBSEGMENT *subseg = get_lfh_subsegment( heapPtr, arena );
+
+            if (!subseg)
+            {
+                if (quiet == NOISY)
+                    ERR("Heap %p: block %p is not a valid front end block\n", heapPtr, block );
+                else if (WARN_ON(heap))
+                    WARN("Heap %p: block %p is not a valid front end block\n", heapPtr, block );
+                ret = FALSE;
+            }
+            else if (arena->unused_bytes > subseg->block_size - sizeof(*arena))
+            {
+                ERR("Heap %p: invalid unused size %08x for front end block %p\n",
+                    heapPtr, arena->unused_bytes, block );
+                ret = FALSE;
+            }
+        }
+        else
             ret = HEAP_ValidateInUseArena( subheap, arena, quiet );
 
         if (!(flags & HEAP_NO_SERIALIZE))
@@ -1381,6 +1750,14 @@ static BOOL HEAP_IsRealArena( HEAP *heapPtr,   /* [in] ptr to the heap */
         if (!ret) break;
     }
 
+    if (ret)
+    {
+        const LFH_SUBSEGMENT *subseg;
+
+        LIST_FOR_EACH_ENTRY( subseg, &heapPtr->lfh_list, LFH_SUBSEGMENT, entry )
+            if (!(ret = validate_lfh_subsegment( heapPtr, subseg ))) break;
+    }
+
     LIST_FOR_EACH_ENTRY( large_arena, &heapPtr->large_list, ARENA_LARGE, entry )
         if (!(ret = validate_large_arena( heapPtr, large_arena, quiet ))) break;
 
@@ -1419,7 +1796,7 @@ static BOOL validate_block_pointer( HEAP *heap, SUBHEAP **ret_subheap, const ARE
         ret = HEAP_ValidateInUseArena( subheap, arena, QUIET );
     else if ((ULONG_PTR)arena % ALIGNMENT != ARENA_OFFSET)
         WARN( "Heap %p: unaligned arena pointer %p\n", subheap->heap, arena );
-    else if (arena->magic == ARENA_PENDING_MAGIC)
+    else if (arena->magic == ARENA_PENDING_MAGIC || arena->magic == ARENA_LFH_FREE_MAGIC)
         WARN( "Heap %p: block %p used after free\n", subheap->heap, arena + 1 );
     else if (arena->magic != ARENA_INUSE_MAGIC)
         WARN( "Heap %p: invalid in-use arena magic %08x for %p\n", subheap->heap, arena->magic, arena );
@@ -1553,6 +1930,7 @@ HANDLE WINAPI RtlCreateHeap( ULONG flags, PVOID addr, SIZE_T totalSize, SIZE_T c
     if (!(subheap = HEAP_CreateSubHeap( NULL, addr, flags, commitSize, totalSize ))) return 0;
 
     heap_set_debug_flags( subheap->heap );
+    if (frontend_options & HEAP_FRONTEND_ENABLE_LFH) enable_lfh( subheap->heap );
 
     /* link it into the per-process heap list */
     if (processHeap)
@@ -1628,6 +2006,12 @@ HANDLE WINAPI RtlDestroyHeap( HANDLE heap )
         addr = heapPtr->pending_free;
         NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
     }
+    if (heapPtr->lfh_bins)
+    {
+        size = 0;
+        addr = heapPtr->lfh_bins;
+        NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+    }
     size = 0;
     addr = heapPtr->subheap.base;
     NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
@@ -1673,6 +2057,17 @@ PVOID WINAPI RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_T size )
     }
     if (rounded_size < HEAP_MIN_DATA_SIZE) rounded_size = HEAP_MIN_DATA_SIZE;
 
+    if (heapPtr->lfh_bins && rounded_size <= HEAP_LFH_MAX_SIZE &&
+        (pInUse = allocate_lfh_block( heapPtr, rounded_size )))
+    {
+        pInUse->magic = ARENA_LFH_MAGIC;
+        pInUse->unused_bytes = rounded_size - size;
+        notify_alloc( pInUse + 1, size, flags & HEAP_ZERO_MEMORY );
+        initialize_block( pInUse + 1, size, pInUse->unused_bytes, flags );
+        TRACE("(%p,%08x,%08lx): returning %p\n", heap, flags, size, pInUse + 1 );
+        return pInUse + 1;
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     if (rounded_size >= HEAP_MIN_LARGE_BLOCK_SIZE && (flags & HEAP_GROWABLE))
@@ -1741,6 +2136,7 @@ BOOLEAN WINAPI RtlFreeHeap( HANDLE heap, ULONG flags, PVOID ptr )
 {
     ARENA_INUSE *pInUse;
     SUBHEAP *subheap;
+    LFH_SUBSEGMENT *subseg;
     HEAP *heapPtr;
 
     /* Validate the parameters */
@@ -1756,13 +2152,22 @@ BOOLEAN WINAPI RtlFreeHeap( HANDLE heap, ULONG flags, PVOID ptr )
 
     flags &= HEAP_NO_SERIALIZE;
     flags |= heapPtr->flags;
+    pInUse  = (ARENA_INUSE *)ptr - 1;
+
+    if (heapPtr->lfh_bins && (subseg = get_lfh_subsegment( heapPtr, pInUse )))
+    {
+        notify_free( ptr );
+        free_lfh_block( heapPtr, subseg, pInUse );
+        TRACE("(%p,%08x,%p): returning TRUE\n", heap, flags, ptr );
+        return TRUE;
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     /* Inform valgrind we are trying to free memory, so it can throw up an error message */
     notify_free( ptr );
 
     /* Some sanity checks */
-    pInUse  = (ARENA_INUSE *)ptr - 1;
     if (!validate_block_pointer( heapPtr, &subheap, pInUse )) goto error;
 
     if (!subheap)
@@ -1802,6 +2207,7 @@ PVOID WINAPI RtlReAllocateHeap( HANDLE heap, ULONG flags, PVOID ptr, SIZE_T size
     ARENA_INUSE *pArena;
     HEAP *heapPtr;
     SUBHEAP *subheap;
+    LFH_SUBSEGMENT *subseg;
     SIZE_T oldBlockSize, oldActualSize, rounded_size;
     void *ret;
 
@@ -1817,13 +2223,25 @@ PVOID WINAPI RtlReAllocateHeap( HANDLE heap, ULONG flags, PVOID ptr, SIZE_T size
     flags &= HEAP_GENERATE_EXCEPTIONS | HEAP_NO_SERIALIZE | HEAP_ZERO_MEMORY |
              HEAP_REALLOC_IN_PLACE_ONLY;
     flags |= heapPtr->flags;
+
+    pArena = (ARENA_INUSE *)ptr - 1;
+    if (heapPtr->lfh_bins && (subseg = get_lfh_subsegment( heapPtr, pArena )))
+    {
+        if (!(ret = realloc_lfh_block( heapPtr, flags, subseg, pArena, size )))
+        {
+            if (flags & HEAP_GENERATE_EXCEPTIONS) RtlRaiseStatus( STATUS_NO_MEMORY );
+            RtlSetLastWin32ErrorAndNtStatusFromNtStatus( STATUS_NO_MEMORY );
+        }
+        TRACE("(%p,%08x,%p,%08lx): returning %p\n", heap, flags, ptr, size, ret );
+        return ret;
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     rounded_size = ROUND_SIZE(size) + HEAP_TAIL_EXTRA_SIZE(flags);
     if (rounded_size < size) goto oom;  /* overflow */
     if (rounded_size < HEAP_MIN_DATA_SIZE) rounded_size = HEAP_MIN_DATA_SIZE;
 
-    pArena = (ARENA_INUSE *)ptr - 1;
     if (!validate_block_pointer( heapPtr, &subheap, pArena )) goto error;
     if (!subheap)
     {
@@ -1940,16 +2358,25 @@ error:
  *  flags [I] HEAP_ flags from "winnt.h"
  *
  * RETURNS
- *  The number of bytes compacted.
+ *  The number of bytes released.
  *
  * NOTES
- *  This function is a harmless stub.
+ *  The back end coalesces free blocks as soon as they are freed, so only
+ *  the unused front end sub-segments can be released here. Without a front
+ *  end there is nothing to do and 0 is returned.
  */
 ULONG WINAPI RtlCompactHeap( HANDLE heap, ULONG flags )
 {
-    static BOOL reported;
-    if (!reported++) FIXME( "(%p, 0x%x) stub\n", heap, flags );
-    return 0;
+    HEAP *heapPtr = HEAP_GetPtr( heap );
+    SIZE_T released;
+
+    TRACE( "(%p, 0x%x)\n", heap, flags );
+    if (!heapPtr || !heapPtr->lfh_bins) return 0;
+
+    RtlEnterCriticalSection( &heapPtr->critSection );
+    released = compact_lfh( heapPtr );
+    RtlLeaveCriticalSection( &heapPtr->critSection );
+    return released;
 }
 
 
@@ -2016,6 +2443,7 @@ SIZE_T WINAPI RtlSizeHeap( HANDLE heap, ULONG flags, const void *ptr )
 {
     SIZE_T ret;
     const ARENA_INUSE *pArena;
+    const LFH_SUBSEGMENT *subseg;
     SUBHEAP *subheap;
     HEAP *heapPtr = HEAP_GetPtr( heap );
 
@@ -2026,9 +2454,17 @@ SIZE_T WINAPI RtlSizeHeap( HANDLE heap, ULONG flags, const void *ptr )
     }
     flags &= HEAP_NO_SERIALIZE;
     flags |= heapPtr->flags;
-    if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     pArena = (const ARENA_INUSE *)ptr - 1;
+    if (heapPtr->lfh_bins && (subseg = get_lfh_subsegment( heapPtr, pArena )))
+    {
+        ret = subseg->block_size - sizeof(*pArena) - pArena->unused_bytes;
+        TRACE("(%p,%08x,%p): returning %08lx\n", heap, flags, ptr, ret );
+        return ret;
+    }
+
+    if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
+
     if (!validate_block_pointer( heapPtr, &subheap, pArena ))
     {
         RtlSetLastWin32ErrorAndNtStatusFromNtStatus( STATUS_INVALID_PARAMETER );
@@ -2084,6 +2520,8 @@ NTSTATUS WINAPI RtlWalkHeap( HANDLE heap, PVOID entry_ptr )
     LPPROCESS_HEAP_ENTRY entry = entry_ptr; /* FIXME */
     HEAP *heapPtr = HEAP_GetPtr(heap);
     SUBHEAP *sub, *currentheap = NULL;
+    const LFH_SUBSEGMENT *subseg;
+    ARENA_INUSE *lfh_arena = NULL;
     NTSTATUS ret;
     char *ptr;
     int region_index = 0;
@@ -2122,8 +2560,21 @@ NTSTATUS WINAPI RtlWalkHeap( HANDLE heap, PVOID entry_ptr )
             goto HW_end;
         }
 
-        if (((ARENA_INUSE *)ptr - 1)->magic == ARENA_INUSE_MAGIC ||
-            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_PENDING_MAGIC)
+        if (heapPtr->lfh_bins && (((ARENA_INUSE *)ptr - 1)->magic == ARENA_LFH_MAGIC ||
+                                  ((ARENA_INUSE *)ptr - 1)->magic == ARENA_LFH_FREE_MAGIC))
+        {
+            /* front end blocks are walked one by one, then we move on to
+             * the back end block that follows their sub-segment */
+            ARENA_INUSE *pArena = (ARENA_INUSE *)ptr - 1;
+
+            subseg = (const LFH_SUBSEGMENT *)((char *)pArena - pArena->size);
+            if (pArena->size + subseg->block_size < HEAP_LFH_FIRST_BLOCK + subseg->count * subseg->block_size)
+                lfh_arena = (ARENA_INUSE *)((char *)pArena + subseg->block_size);
+            ptr = (char *)subseg - sizeof(ARENA_INUSE);
+            if (!lfh_arena) ptr += sizeof(ARENA_INUSE) + (((ARENA_INUSE *)ptr)->size & ARENA_SIZE_MASK);
+        }
+        else if (((ARENA_INUSE *)ptr - 1)->magic == ARENA_INUSE_MAGIC ||
+                 ((ARENA_INUSE *)ptr - 1)->magic == ARENA_PENDING_MAGIC)
         {
             ARENA_INUSE *pArena = (ARENA_INUSE *)ptr - 1;
             ptr += pArena->size & ARENA_SIZE_MASK;
@@ -2136,7 +2587,7 @@ NTSTATUS WINAPI RtlWalkHeap( HANDLE heap, PVOID entry_ptr )
         else
             ptr += entry->cbData; /* point to next arena */
 
-        if (ptr > (char *)currentheap->base + currentheap->size - 1)
+        if (!lfh_arena && ptr > (char *)currentheap->base + currentheap->size - 1)
         {   /* proceed with next subheap */
             struct list *next = list_next( &heapPtr->subheap_list, &currentheap->entry );
             if (!next)
@@ -2151,7 +2602,20 @@ NTSTATUS WINAPI RtlWalkHeap( HANDLE heap, PVOID entry_ptr )
     }
 
     entry->wFlags = 0;
-    if (*(DWORD *)ptr & ARENA_FLAG_FREE)
+    if (!lfh_arena && !(*(DWORD *)ptr & ARENA_FLAG_FREE) &&
+        (subseg = get_walk_lfh_subsegment( heapPtr, (ARENA_INUSE *)ptr )))
+        lfh_arena = (ARENA_INUSE *)((char *)subseg + HEAP_LFH_FIRST_BLOCK);
+
+    if (lfh_arena)
+    {
+        subseg = (const LFH_SUBSEGMENT *)((char *)lfh_arena - lfh_arena->size);
+        entry->lpData = lfh_arena + 1;
+        entry->cbData = subseg->block_size - sizeof(ARENA_INUSE);
+        entry->cbOverhead = sizeof(ARENA_INUSE);
+        entry->wFlags = (lfh_arena->magic == ARENA_LFH_FREE_MAGIC) ?
+                        PROCESS_HEAP_UNCOMMITTED_RANGE : PROCESS_HEAP_ENTRY_BUSY;
+    }
+    else if (*(DWORD *)ptr & ARENA_FLAG_FREE)
     {
         ARENA_FREE *pArena = (ARENA_FREE *)ptr;
 
@@ -2180,7 +2644,8 @@ NTSTATUS WINAPI RtlWalkHeap( HANDLE heap, PVOID entry_ptr )
     entry->iRegionIndex = region_index;
 
     /* first element of heap ? */
-    if (ptr == (char *)currentheap->base + currentheap->headerSize)
+    if (ptr == (char *)currentheap->base + currentheap->headerSize &&
+        (!lfh_arena || lfh_arena->size == HEAP_LFH_FIRST_BLOCK))
     {
         entry->wFlags |= PROCESS_HEAP_REGION;
         entry->u.Region.dwCommittedSize = currentheap->commitSize;
@@ -2236,6 +2701,8 @@ ULONG WINAPI RtlGetProcessHeaps( ULONG count, HANDLE *heaps )
 NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class,
                                          PVOID info, SIZE_T size_in, PSIZE_T size_out)
 {
+    HEAP *heapPtr;
+
     switch (info_class)
     {
     case HeapCompatibilityInformation:
@@ -2244,7 +2711,11 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
         if (size_in < sizeof(ULONG))
             return STATUS_BUFFER_TOO_SMALL;
 
-        *(ULONG *)info = 0; /* standard heap */
+        heapPtr = HEAP_GetPtr( heap );
+        if (heapPtr && heapPtr->lfh_bins)
+            *(ULONG *)info = 2; /* low-fragmentation heap */
+        else
+            *(ULONG *)info = 0; /* standard heap */
         return STATUS_SUCCESS;
 
     default:
@@ -2258,6 +2729,44 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
  */
 NTSTATUS WINAPI RtlSetHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class, PVOID info, SIZE_T size)
 {
-    FIXME("%p %d %p %ld stub\n", heap, info_class, info, size);
-    return STATUS_SUCCESS;
+    HEAP *heapPtr;
+
+    TRACE("%p %d %p %ld\n", heap, info_class, info, size);
+
+    switch (info_class)
+    {
+    case HeapCompatibilityInformation:
+        if (size < sizeof(ULONG)) return STATUS_BUFFER_TOO_SMALL;
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_HANDLE;
+
+        switch (*(ULONG *)info)
+        {
+        case 0:  /* the front end cannot be disabled once enabled */
+            return heapPtr->lfh_bins ? STATUS_UNSUCCESSFUL : STATUS_SUCCESS;
+        case 2:
+            if (frontend_options & HEAP_FRONTEND_DISABLE_LFH) return STATUS_UNSUCCESSFUL;
+            return enable_lfh( heapPtr );
+        default:
+            FIXME("unsupported heap compatibility mode %u\n", *(ULONG *)info);
+            return STATUS_UNSUCCESSFUL;
+        }
+
+    default:
+        FIXME("%p %d %p %ld stub\n", heap, info_class, info, size);
+        return STATUS_SUCCESS;
+    }
+}
+
+
+/***********************************************************************
+ *           heap_set_frontend_options
+ *
+ * Apply the FrontEndHeapDebugOptions setting to the process heap and to the heaps created later.
+ */
+void heap_set_frontend_options( ULONG options )
+{
+    TRACE( "options %08x\n", options );
+    if (options & HEAP_FRONTEND_DISABLE_LFH) options &= ~HEAP_FRONTEND_ENABLE_LFH;
+    frontend_options = options;
+    if (options & HEAP_FRONTEND_ENABLE_LFH) enable_lfh( processHeap );
 }
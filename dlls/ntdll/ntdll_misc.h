@@ -28,6 +28,7 @@
 #include "winnt.h"
 #include "winternl.h"
 #include "wine/server.h"
+#include "wine/list.h"
 
 #define MAX_NT_PATH_LENGTH 277
 
@@ -76,8 +77,15 @@ extern void virtual_init(void) DECLSPEC_HIDDEN;
 extern void virtual_init_threading(void) DECLSPEC_HIDDEN;
 extern void fill_cpu_info(void) DECLSPEC_HIDDEN;
 extern void heap_set_debug_flags( HANDLE handle ) DECLSPEC_HIDDEN;
+extern void heap_set_frontend_options( ULONG options ) DECLSPEC_HIDDEN;
 
 /* server support */
+struct closing_handle
+{
+    struct list entry;
+    HANDLE      handle;
+};
+
 extern timeout_t server_start_time DECLSPEC_HIDDEN;
 extern unsigned int server_cpus DECLSPEC_HIDDEN;
 extern BOOL is_wow64 DECLSPEC_HIDDEN;
@@ -94,6 +102,13 @@ extern unsigned int server_select( const select_op_t *select_op, data_size_t siz
                                    UINT flags, const LARGE_INTEGER *timeout ) DECLSPEC_HIDDEN;
 extern unsigned int server_queue_process_apc( HANDLE process, const apc_call_t *call, apc_result_t *result ) DECLSPEC_HIDDEN;
 extern int server_remove_fd_from_cache( HANDLE handle ) DECLSPEC_HIDDEN;
+extern void server_set_fd_completion_flags( HANDLE handle, unsigned int flags ) DECLSPEC_HIDDEN;
+extern BOOL server_skip_fd_completion( HANDLE handle, NTSTATUS status ) DECLSPEC_HIDDEN;
+extern BOOL server_get_object_type( HANDLE handle, UNICODE_STRING *name, NTSTATUS *status ) DECLSPEC_HIDDEN;
+extern int server_begin_close_handle( HANDLE handle, struct closing_handle *closing ) DECLSPEC_HIDDEN;
+extern void server_end_close_handle( struct closing_handle *closing ) DECLSPEC_HIDDEN;
+extern NTSTATUS server_close_handle( HANDLE handle ) DECLSPEC_HIDDEN;
+extern void server_close_handles( const HANDLE *handles, unsigned int count ) DECLSPEC_HIDDEN;
 extern int server_get_unix_fd( HANDLE handle, unsigned int access, int *unix_fd,
                                int *needs_close, enum server_fd_type *type, unsigned int *options ) DECLSPEC_HIDDEN;
 extern int server_pipe( int fd[2] ) DECLSPEC_HIDDEN;
@@ -109,6 +124,9 @@ extern FARPROC RELAY_GetProcAddress( HMODULE module, const IMAGE_EXPORT_DIRECTOR
 extern FARPROC SNOOP_GetProcAddress( HMODULE hmod, const IMAGE_EXPORT_DIRECTORY *exports, DWORD exp_size,
                                      FARPROC origfun, DWORD ordinal, const WCHAR *user ) DECLSPEC_HIDDEN;
 extern void RELAY_SetupDLL( HMODULE hmod ) DECLSPEC_HIDDEN;
+extern void RELAY_InitProfile(void) DECLSPEC_HIDDEN;
+extern void RELAY_DumpProfile(void) DECLSPEC_HIDDEN;
+extern BOOL relay_profile DECLSPEC_HIDDEN;
 extern void SNOOP_SetupDLL( HMODULE hmod ) DECLSPEC_HIDDEN;
 extern UNICODE_STRING system_dir DECLSPEC_HIDDEN;
 
@@ -179,7 +197,7 @@ extern struct _KUSER_SHARED_DATA *user_shared_data DECLSPEC_HIDDEN;
 
 /* completion */
 extern NTSTATUS NTDLL_AddCompletion( HANDLE hFile, ULONG_PTR CompletionValue,
-                                     NTSTATUS CompletionStatus, ULONG Information ) DECLSPEC_HIDDEN;
+                                     NTSTATUS CompletionStatus, ULONG Information, BOOL async ) DECLSPEC_HIDDEN;
 
 /* code pages */
 extern int ntdll_umbstowcs(DWORD flags, const char* src, int srclen, WCHAR* dst, int dstlen) DECLSPEC_HIDDEN;
@@ -210,6 +228,14 @@ struct debug_info
     char *out_pos;       /* current position in output buffer */
     char  strings[1024]; /* buffer for temporary strings */
     char  output[1024];  /* current output line */
+    struct debug_log_chunk *log_chunk;                   /* current chunk of the binary log */
+    unsigned int            log_seq;                     /* sequence number of that chunk */
+    const struct __wine_debug_channel *log_channel;      /* channel of the pending line */
+    const char             *log_function;                /* function of the pending line, NULL if none */
+    int                     log_class;                   /* class of the pending line */
+    const struct __wine_debug_channel *log_last_channel; /* last channel looked up in the log */
+    int                     log_last_id;                 /* log id of that channel */
+    struct relay_profile_thread *relay_profile;          /* relay profile table of the thread */
 };
 
 /* thread private data, stored in NtCurrentTeb()->SpareBytes1 */
@@ -153,6 +153,32 @@ NTSTATUS WINAPI NtQueryObject(IN HANDLE handle,
     case ObjectTypeInformation:
         {
             OBJECT_TYPE_INFORMATION *p = ptr;
+            UNICODE_STRING type;
+
+            if (server_get_object_type( handle, &type, &status ))
+            {
+                if (status) break;
+                if (!type.Length)  /* no name */
+                {
+                    if (sizeof(*p) > len) status = STATUS_INFO_LENGTH_MISMATCH;
+                    else memset( p, 0, sizeof(*p) );
+                    if (used_len) *used_len = sizeof(*p);
+                }
+                else if (sizeof(*p) + type.MaximumLength > len)
+                {
+                    if (used_len) *used_len = sizeof(*p) + type.MaximumLength;
+                    status = STATUS_INFO_LENGTH_MISMATCH;
+                }
+                else
+                {
+                    p->TypeName.Buffer = (WCHAR *)(p + 1);
+                    p->TypeName.Length = type.Length;
+                    p->TypeName.MaximumLength = type.MaximumLength;
+                    memcpy( p->TypeName.Buffer, type.Buffer, type.MaximumLength );
+                    if (used_len) *used_len = sizeof(*p) + p->TypeName.MaximumLength;
+                }
+                break;
+            }
 
             SERVER_START_REQ( get_object_type )
             {
@@ -353,7 +379,16 @@ NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source,
                                    HANDLE dest_process, PHANDLE dest,
                                    ACCESS_MASK access, ULONG attributes, ULONG options )
 {
+    struct closing_handle closing;
+    BOOL close_here = (options & DUPLICATE_CLOSE_SOURCE) && source_process == NtCurrentProcess();
+    BOOL self = FALSE;
     NTSTATUS ret;
+    int fd = -1;
+
+    /* when the source is ours, let the server close it, so that it can reuse the handle
+     * in place, but keep it out of the caches until the server is done with it */
+    if (close_here) fd = server_begin_close_handle( source, &closing );
+
     SERVER_START_REQ( dup_handle )
     {
         req->src_process = wine_server_obj_handle( source_process );
@@ -361,36 +396,46 @@ NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source,
         req->dst_process = wine_server_obj_handle( dest_process );
         req->access      = access;
         req->attributes  = attributes;
-        req->options     = options;
+        req->options     = close_here ? options : options & ~DUPLICATE_CLOSE_SOURCE;
 
-        if (!(ret = wine_server_call( req )))
+        ret = wine_server_call( req );
+        if (!ret && dest) *dest = wine_server_ptr_handle( reply->handle );
+        self = reply->self;
+    }
+    SERVER_END_REQ;
+
+    if (close_here)
+    {
+        server_end_close_handle( &closing );
+        if (fd != -1) close( fd );
+    }
+    else if (options & DUPLICATE_CLOSE_SOURCE)
+    {
+        /* the source handle is closed no matter what happened, by the source process itself
+         * so that it can update its handle caches before the handle value gets reused */
+        NTSTATUS status;
+
+        if (self) status = close_handle( source );
+        else
         {
-            if (dest) *dest = wine_server_ptr_handle( reply->handle );
-            if (reply->closed && reply->self)
-            {
-                int fd = server_remove_fd_from_cache( source );
-                if (fd != -1) close( fd );
-            }
+            apc_call_t call;
+            apc_result_t result;
+
+            memset( &call, 0, sizeof(call) );
+            call.close_handle.type   = APC_CLOSE_HANDLE;
+            call.close_handle.handle = wine_server_obj_handle( source );
+            if (!(status = server_queue_process_apc( source_process, &call, &result )))
+                status = result.close_handle.status;
         }
+        if (!ret) ret = status;
     }
-    SERVER_END_REQ;
     return ret;
 }
 
 /* Everquest 2 / Pirates of the Burning Sea hooks NtClose, so we need a wrapper */
 NTSTATUS close_handle( HANDLE handle )
 {
-    NTSTATUS ret;
-    int fd = server_remove_fd_from_cache( handle );
-
-    SERVER_START_REQ( close_handle )
-    {
-        req->handle = wine_server_obj_handle( handle );
-        ret = wine_server_call( req );
-    }
-    SERVER_END_REQ;
-    if (fd != -1) close( fd );
-    return ret;
+    return server_close_handle( handle );
 }
 
 /**************************************************************************
@@ -26,6 +26,10 @@
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -34,10 +38,13 @@
 #include "wine/exception.h"
 #include "ntdll_misc.h"
 #include "wine/unicode.h"
+#include "wine/list.h"
 #include "wine/debug.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(relay);
 
+BOOL relay_profile = FALSE;
+
 #if defined(__i386__) || defined(__x86_64__) || defined(__arm__)
 
 WINE_DECLARE_DEBUG_CHANNEL(timestamp);
@@ -70,9 +77,55 @@ struct relay_private_data
     HMODULE                  module;            /* module handle of this dll */
     unsigned int             base;              /* ordinal base */
     char                     dllname[40];       /* dll name (without .dll extension) */
+    struct list              profile_entry;     /* entry in the list of profiled dlls */
+    unsigned int             profile_id;        /* profile id of the first entry point, -1 if none */
+    unsigned int             nb_entry_points;   /* number of entry points */
     struct relay_entry_point entry_points[1];   /* list of dll entry points */
 };
 
+/* profiling data, enabled by setting WINERELAYPROFILE */
+
+#define PROFILE_BUCKETS    24    /* histogram buckets, bucket n counts durations < 2^n ticks, the last one the rest */
+#define PROFILE_PAGE_SIZE  256   /* counters per page of a thread table */
+#define PROFILE_MAX_PAGES  1024  /* max pages, i.e. max number of profiled entry points / 256 */
+#define PROFILE_MAX_DEPTH  128   /* max nesting of timed calls in a thread */
+
+struct relay_profile_counter
+{
+    ULONGLONG    calls;                          /* number of calls */
+    ULONGLONG    time;                           /* total inclusive time, in 100ns ticks */
+    unsigned int histogram[PROFILE_BUCKETS];     /* log2 histogram of call durations */
+};
+
+struct relay_profile_frame
+{
+    const INT_PTR *stack;                        /* stack of the relay thunk */
+    ULONGLONG      start;                        /* time of the call */
+};
+
+/* per-thread table, only ever written by its owner thread */
+struct relay_profile_thread
+{
+    struct list                   entry;         /* entry in the list of thread tables */
+    unsigned int                  depth;         /* number of pending timed calls */
+    struct relay_profile_frame    frames[PROFILE_MAX_DEPTH];
+    struct relay_profile_counter *pages[PROFILE_MAX_PAGES];
+};
+
+static char profile_file[1024];
+static LONG profile_next_id;
+static struct list profile_dlls = LIST_INIT( profile_dlls );
+static struct list profile_threads = LIST_INIT( profile_threads );
+
+static RTL_CRITICAL_SECTION profile_section;
+static RTL_CRITICAL_SECTION_DEBUG profile_section_debug =
+{
+    0, 0, &profile_section,
+    { &profile_section_debug.ProcessLocksList, &profile_section_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": profile_section") }
+};
+static RTL_CRITICAL_SECTION profile_section = { &profile_section_debug, -1, 0, 0, 0, 0 };
+
 static const WCHAR **debug_relay_excludelist;
 static const WCHAR **debug_relay_includelist;
 static const WCHAR **debug_snoop_excludelist;
@@ -325,6 +378,167 @@ static void print_timestamp(void)
     DPRINTF( "%3u.%03u:", ticks / 1000, ticks % 1000 );
 }
 
+/***********************************************************************
+ *           get_profile_thread
+ *
+ * Get the profile table of the current thread, creating it if needed.
+ */
+static struct relay_profile_thread *get_profile_thread(void)
+{
+    struct debug_info *info = ntdll_get_thread_data()->debug_info;
+    struct relay_profile_thread *thread = info->relay_profile;
+
+    if (thread) return thread;
+    if (!(thread = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*thread) ))) return NULL;
+    RtlEnterCriticalSection( &profile_section );
+    list_add_tail( &profile_threads, &thread->entry );
+    RtlLeaveCriticalSection( &profile_section );
+    return info->relay_profile = thread;
+}
+
+/***********************************************************************
+ *           get_profile_counter
+ */
+static struct relay_profile_counter *get_profile_counter( struct relay_profile_thread *thread,
+                                                          unsigned int id )
+{
+    struct relay_profile_counter **page = &thread->pages[id / PROFILE_PAGE_SIZE];
+
+    if (!*page && !(*page = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                             PROFILE_PAGE_SIZE * sizeof(**page) )))
+        return NULL;
+    return *page + id % PROFILE_PAGE_SIZE;
+}
+
+/***********************************************************************
+ *           profile_entry
+ *
+ * Count a call and remember its start time.
+ */
+static void profile_entry( const struct relay_private_data *data, WORD ordinal, const INT_PTR *stack )
+{
+    struct relay_profile_thread *thread;
+    struct relay_profile_counter *counter;
+    LARGE_INTEGER now;
+
+    if (data->profile_id == ~0u || !(thread = get_profile_thread())) return;
+    if (!(counter = get_profile_counter( thread, data->profile_id + ordinal ))) return;
+    counter->calls++;
+    if (thread->depth == PROFILE_MAX_DEPTH) return;  /* too deep, don't time it */
+    NtQueryPerformanceCounter( &now, NULL );
+    thread->frames[thread->depth].stack = stack;
+    thread->frames[thread->depth].start = now.QuadPart;
+    thread->depth++;
+}
+
+/***********************************************************************
+ *           profile_exit
+ *
+ * Account the time of a call that returns.
+ */
+static void profile_exit( const struct relay_private_data *data, WORD ordinal, const INT_PTR *stack )
+{
+    struct relay_profile_thread *thread;
+    struct relay_profile_counter *counter;
+    LARGE_INTEGER now;
+    ULONGLONG elapsed;
+    unsigned int bucket;
+
+    if (data->profile_id == ~0u || !(thread = get_profile_thread())) return;
+    NtQueryPerformanceCounter( &now, NULL );
+
+    /* drop frames of nested calls that were unwound without returning */
+    while (thread->depth && thread->frames[thread->depth - 1].stack < stack) thread->depth--;
+    if (!thread->depth || thread->frames[thread->depth - 1].stack != stack) return;
+    thread->depth--;
+
+    if (!(counter = get_profile_counter( thread, data->profile_id + ordinal ))) return;
+    elapsed = now.QuadPart - thread->frames[thread->depth].start;
+    counter->time += elapsed;
+    for (bucket = 0; elapsed && bucket < PROFILE_BUCKETS - 1; bucket++) elapsed >>= 1;
+    counter->histogram[bucket]++;
+}
+
+/***********************************************************************
+ *           RELAY_InitProfile
+ *
+ * Enable relay profiling if WINERELAYPROFILE is set.
+ */
+void RELAY_InitProfile(void)
+{
+    const char *prefix = getenv( "WINERELAYPROFILE" );
+
+    if (!prefix || !*prefix) return;
+    if (snprintf( profile_file, sizeof(profile_file), "%s.%u", prefix, (unsigned int)getpid() )
+        >= sizeof(profile_file))
+        return;
+    relay_profile = TRUE;
+}
+
+/* format an unsigned 64-bit value in decimal */
+static const char *profile_ulonglong( ULONGLONG val, char buffer[21] )
+{
+    char *p = buffer + 20;
+
+    *p = 0;
+    do *--p = '0' + val % 10; while (val /= 10);
+    return p;
+}
+
+/***********************************************************************
+ *           RELAY_DumpProfile
+ *
+ * Write the accumulated profile data, one line per called entry point.
+ */
+void RELAY_DumpProfile(void)
+{
+    struct relay_private_data *data;
+    struct relay_profile_thread *thread;
+    struct relay_profile_counter total, *counter;
+    unsigned int i, j;
+    char calls[21], time[21];
+    FILE *f;
+
+    if (!relay_profile) return;
+    if (!(f = fopen( profile_file, "w" )))
+    {
+        ERR( "cannot create %s\n", profile_file );
+        return;
+    }
+
+    fprintf( f, "dll\tordinal\tfunction\tcalls\ttime" );
+    for (j = 0; j < PROFILE_BUCKETS - 1; j++) fprintf( f, "\tlt%u", 1u << j );
+    fprintf( f, "\tmore\n" );
+
+    RtlEnterCriticalSection( &profile_section );
+    LIST_FOR_EACH_ENTRY( data, &profile_dlls, struct relay_private_data, profile_entry )
+    {
+        for (i = 0; i < data->nb_entry_points; i++)
+        {
+            unsigned int id = data->profile_id + i;
+
+            memset( &total, 0, sizeof(total) );
+            LIST_FOR_EACH_ENTRY( thread, &profile_threads, struct relay_profile_thread, entry )
+            {
+                if (!thread->pages[id / PROFILE_PAGE_SIZE]) continue;
+                counter = thread->pages[id / PROFILE_PAGE_SIZE] + id % PROFILE_PAGE_SIZE;
+                total.calls += counter->calls;
+                total.time += counter->time;
+                for (j = 0; j < PROFILE_BUCKETS; j++) total.histogram[j] += counter->histogram[j];
+            }
+            if (!total.calls) continue;
+
+            fprintf( f, "%s\t%u\t%s\t%s\t%s", data->dllname, data->base + i,
+                     data->entry_points[i].name ? data->entry_points[i].name : "",
+                     profile_ulonglong( total.calls, calls ), profile_ulonglong( total.time, time ) );
+            for (j = 0; j < PROFILE_BUCKETS; j++) fprintf( f, "\t%u", total.histogram[j] );
+            fprintf( f, "\n" );
+        }
+    }
+    RtlLeaveCriticalSection( &profile_section );
+    fclose( f );
+}
+
 /***********************************************************************
  *           relay_trace_entry
  *
@@ -337,6 +551,8 @@ void * WINAPI relay_trace_entry( struct relay_descr *descr, unsigned int idx, co
     struct relay_private_data *data = descr->private;
     struct relay_entry_point *entry_point = data->entry_points + ordinal;
 
+    if (relay_profile) profile_entry( data, ordinal, stack );
+
     if (TRACE_ON(relay))
     {
         if (TRACE_ON(timestamp)) print_timestamp();
@@ -365,6 +581,8 @@ void WINAPI relay_trace_exit( struct relay_descr *descr, unsigned int idx,
     struct relay_private_data *data = descr->private;
     struct relay_entry_point *entry_point = data->entry_points + ordinal;
 
+    if (relay_profile) profile_exit( data, ordinal, stack );
+
     if (!TRACE_ON(relay)) return;
 
     if (TRACE_ON(timestamp)) print_timestamp();
@@ -522,7 +740,9 @@ void WINAPI __regs_relay_call_regs( struct relay_descr *descr, unsigned int idx,
     memcpy( args_copy, args, nb_args * sizeof(args[0]) );
     args_copy[nb_args++] = (INT_PTR)context;  /* append context argument */
 
+    if (relay_profile) profile_entry( data, ordinal, args );
     call_entry_point( orig_func + 12 + *(int *)(orig_func + 1), nb_args, args_copy, 0 );
+    if (relay_profile) profile_exit( data, ordinal, args );
 
     if (TRACE_ON(relay))
     {
@@ -688,6 +908,44 @@ FARPROC RELAY_GetProcAddress( HMODULE module, const IMAGE_EXPORT_DIRECTORY *expo
 }
 
 
+/***********************************************************************
+ *           setup_profile
+ *
+ * Allocate profile ids for the entry points of a dll.
+ */
+static void setup_profile( struct relay_private_data *data )
+{
+    unsigned int i, len = 0;
+    LONG id;
+    char *names = NULL;
+
+    id = interlocked_xchg_add( &profile_next_id, data->nb_entry_points );
+    if (id + data->nb_entry_points > PROFILE_MAX_PAGES * PROFILE_PAGE_SIZE)
+    {
+        ERR( "too many entry points, not profiling %s\n", data->dllname );
+        return;
+    }
+
+    /* keep a copy of the names, the dll may be unloaded before the profile is written */
+    for (i = 0; i < data->nb_entry_points; i++)
+        if (data->entry_points[i].orig_func && data->entry_points[i].name)
+            len += strlen( data->entry_points[i].name ) + 1;
+    if (len && !(names = RtlAllocateHeap( GetProcessHeap(), 0, len ))) return;
+    for (i = 0; i < data->nb_entry_points; i++)
+    {
+        if (!data->entry_points[i].orig_func || !data->entry_points[i].name) continue;
+        strcpy( names, data->entry_points[i].name );
+        data->entry_points[i].name = names;
+        names += strlen( names ) + 1;
+    }
+
+    data->profile_id = id;
+    RtlEnterCriticalSection( &profile_section );
+    list_add_tail( &profile_dlls, &data->profile_entry );
+    RtlLeaveCriticalSection( &profile_section );
+}
+
+
 /***********************************************************************
  *           RELAY_SetupDLL
  *
@@ -749,6 +1007,10 @@ void RELAY_SetupDLL( HMODULE module )
         data->entry_points[i].orig_func = (char *)module + *funcs;
         *funcs = entry_point_rva + descr->entry_point_offsets[i];
     }
+
+    data->nb_entry_points = exports->NumberOfFunctions;
+    data->profile_id = ~0u;
+    if (relay_profile) setup_profile( data );
 }
 
 #else  /* __i386__ || __x86_64__ || __arm__ */
@@ -763,6 +1025,14 @@ void RELAY_SetupDLL( HMODULE module )
 {
 }
 
+void RELAY_InitProfile(void)
+{
+}
+
+void RELAY_DumpProfile(void)
+{
+}
+
 #endif  /* __i386__ || __x86_64__ || __arm__ */
 
 
@@ -128,6 +128,9 @@ static RTL_CRITICAL_SECTION_DEBUG critsect_debug =
 };
 static RTL_CRITICAL_SECTION fd_cache_section = { &critsect_debug, -1, 0, 0, 0, 0 };
 
+/* handles being closed by the server, they must not be added back to the caches */
+static struct list closing_handles = LIST_INIT( closing_handles );
+
 /* atomically exchange a 64-bit value */
 static inline LONG64 interlocked_xchg64( LONG64 *dest, LONG64 val )
 {
@@ -313,6 +316,83 @@ unsigned int wine_server_call( void *req_ptr )
 }
 
 
+/***********************************************************************
+ *           wine_server_queue_request (NTDLL.@)
+ *
+ * Add a request to a batch, to be sent later with wine_server_call_batch.
+ *
+ * PARAMS
+ *     batch   [I/O] Batch initialized with wine_server_init_batch
+ *     req_ptr [I]   Request filled between SERVER_START_REQ and SERVER_END_REQ
+ *
+ * RETURNS
+ *     STATUS_SUCCESS, or STATUS_BUFFER_TOO_SMALL if the batch is full.
+ *
+ * NOTES
+ *     The reply of a batched request is discarded, only its status is
+ *     returned. Requests that need reply data, or that wait, can't be
+ *     batched.
+ */
+unsigned int CDECL wine_server_queue_request( struct __server_batch *batch, void *req_ptr )
+{
+    const struct __server_request_info * const req = req_ptr;
+    data_size_t size = req->u.req.request_header.request_size;
+    struct request_header *header;
+    char *ptr = batch->data + batch->size;
+    unsigned int i;
+
+    if (batch->count >= sizeof(batch->status) / sizeof(batch->status[0]) ||
+        size > sizeof(batch->data) - sizeof(req->u.req) ||
+        ((sizeof(req->u.req) + size + 7) & ~7) > sizeof(batch->data) - batch->size)
+        return STATUS_BUFFER_TOO_SMALL;
+
+    memcpy( ptr, &req->u.req, sizeof(req->u.req) );
+    header = (struct request_header *)ptr;
+    header->reply_size = 0;
+    ptr += sizeof(req->u.req);
+    for (i = 0; i < req->data_count; i++)
+    {
+        memcpy( ptr, req->data[i].ptr, req->data[i].size );
+        ptr += req->data[i].size;
+    }
+    batch->size += (sizeof(req->u.req) + size + 7) & ~7;
+    batch->count++;
+    return STATUS_SUCCESS;
+}
+
+
+/***********************************************************************
+ *           wine_server_call_batch (NTDLL.@)
+ *
+ * Send all the requests of a batch with a single server call. The server
+ * processes them in order and stores the status of each one in the
+ * status array of the batch.
+ *
+ * RETURNS
+ *     The first failure status, or STATUS_SUCCESS if all requests succeeded.
+ */
+unsigned int CDECL wine_server_call_batch( struct __server_batch *batch )
+{
+    unsigned int i, ret, count = 0;
+
+    if (!batch->count) return STATUS_SUCCESS;
+
+    SERVER_START_REQ( batch )
+    {
+        wine_server_add_data( req, batch->data, batch->size );
+        wine_server_set_reply( req, batch->status, batch->count * sizeof(batch->status[0]) );
+        ret = wine_server_call( req );
+        count = min( reply->count, batch->count );
+    }
+    SERVER_END_REQ;
+
+    /* requests that didn't get processed fail with the status of the batch itself */
+    for (i = count; i < batch->count; i++) batch->status[i] = ret ? ret : STATUS_INTERNAL_ERROR;
+    for (i = 0; i < batch->count; i++) if (batch->status[i]) return batch->status[i];
+    return ret;
+}
+
+
 /***********************************************************************
  *           server_enter_uninterrupted_section
  */
@@ -570,6 +650,10 @@ static BOOL invoke_apc( const apc_call_t *call, apc_result_t *result )
         else result->create_thread.status = STATUS_INVALID_PARAMETER;
         break;
     }
+    case APC_CLOSE_HANDLE:
+        result->type = call->type;
+        result->close_handle.status = close_handle( wine_server_ptr_handle(call->close_handle.handle) );
+        break;
     default:
         server_protocol_error( "get_apc_request: bad type %d\n", call->type );
         break;
@@ -810,7 +894,8 @@ union fd_cache_entry
     struct
     {
         int fd;
-        enum server_fd_type type : 5;
+        enum server_fd_type type : 4;
+        unsigned int        skip_port : 1;  /* FILE_SKIP_COMPLETION_PORT_ON_SUCCESS is set */
         unsigned int        access : 3;
         unsigned int        options : 24;
     } s;
@@ -818,6 +903,7 @@ union fd_cache_entry
 #include "poppack.h"
 
 C_ASSERT( sizeof(union fd_cache_entry) == sizeof(LONG64) );
+C_ASSERT( FD_TYPE_NB_TYPES <= 16 );
 
 #define FD_CACHE_BLOCK_SIZE  (65536 / sizeof(union fd_cache_entry))
 #define FD_CACHE_ENTRIES     128
@@ -825,6 +911,15 @@ C_ASSERT( sizeof(union fd_cache_entry) == sizeof(LONG64) );
 static union fd_cache_entry *fd_cache[FD_CACHE_ENTRIES];
 static union fd_cache_entry fd_cache_initial_block[FD_CACHE_BLOCK_SIZE];
 
+/* object types of the handles, stored as an index in type_names plus one, 0 if unknown */
+static BYTE *type_cache[FD_CACHE_ENTRIES];
+static BYTE type_cache_initial_block[FD_CACHE_BLOCK_SIZE];
+
+#define MAX_CACHED_TYPES 64
+
+static UNICODE_STRING type_names[MAX_CACHED_TYPES];
+static int type_names_count;
+
 static inline unsigned int handle_to_index( HANDLE handle, unsigned int *entry )
 {
     unsigned int idx = (wine_server_obj_handle(handle) >> 2) - 1;
@@ -833,17 +928,33 @@ static inline unsigned int handle_to_index( HANDLE handle, unsigned int *entry )
 }
 
 
+/***********************************************************************
+ *           is_handle_closing
+ *
+ * Caller must hold fd_cache_section.
+ */
+static BOOL is_handle_closing( HANDLE handle )
+{
+    struct closing_handle *closing;
+
+    LIST_FOR_EACH_ENTRY( closing, &closing_handles, struct closing_handle, entry )
+        if (closing->handle == handle) return TRUE;
+    return FALSE;
+}
+
+
 /***********************************************************************
  *           add_fd_to_cache
  *
  * Caller must hold fd_cache_section.
  */
 static BOOL add_fd_to_cache( HANDLE handle, int fd, enum server_fd_type type,
-                            unsigned int access, unsigned int options )
+                            unsigned int access, unsigned int options, unsigned int comp_flags )
 {
     unsigned int entry, idx = handle_to_index( handle, &entry );
     union fd_cache_entry cache;
 
+    if (is_handle_closing( handle )) return FALSE;
     if (entry >= FD_CACHE_ENTRIES)
     {
         FIXME( "too many allocated handles, not caching %p\n", handle );
@@ -865,6 +976,7 @@ static BOOL add_fd_to_cache( HANDLE handle, int fd, enum server_fd_type type,
     /* store fd+1 so that 0 can be used as the unset value */
     cache.s.fd = fd + 1;
     cache.s.type = type;
+    cache.s.skip_port = (comp_flags & FILE_SKIP_COMPLETION_PORT_ON_SUCCESS) != 0;
     cache.s.access = access;
     cache.s.options = options;
     cache.data = interlocked_xchg64( &fd_cache[entry][idx].data, cache.data );
@@ -912,11 +1024,275 @@ int server_remove_fd_from_cache( HANDLE handle )
         cache.data = interlocked_xchg64( &fd_cache[entry][idx].data, 0 );
         if (cache.s.type != FD_TYPE_INVALID) fd = cache.s.fd - 1;
     }
+    /* the handle value may get reused for another object */
+    if (entry < FD_CACHE_ENTRIES && type_cache[entry]) type_cache[entry][idx] = 0;
 
     return fd;
 }
 
 
+/***********************************************************************
+ *           server_set_fd_completion_flags
+ *
+ * Record completion notification flags that were set on a handle.
+ */
+void server_set_fd_completion_flags( HANDLE handle, unsigned int flags )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+    union fd_cache_entry cache;
+    sigset_t sigset;
+
+    if (!(flags & FILE_SKIP_COMPLETION_PORT_ON_SUCCESS)) return;
+
+    /* the lock keeps the entry from being removed and reused under us */
+    server_enter_uninterrupted_section( &fd_cache_section, &sigset );
+    if (entry < FD_CACHE_ENTRIES && fd_cache[entry])
+    {
+        cache.data = fd_cache[entry][idx].data;
+        if (cache.data && cache.s.type != FD_TYPE_INVALID)
+        {
+            cache.s.skip_port = 1;
+            interlocked_xchg64( &fd_cache[entry][idx].data, cache.data );
+        }
+    }
+    server_leave_uninterrupted_section( &fd_cache_section, &sigset );
+}
+
+
+/***********************************************************************
+ *           server_skip_fd_completion
+ *
+ * Check whether the completion of an operation that finished synchronously
+ * can be dropped without asking the server. The flags can't be cleared once
+ * they are set, so the cached value can only be out of date in the safe
+ * direction.
+ */
+BOOL server_skip_fd_completion( HANDLE handle, NTSTATUS status )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+    union fd_cache_entry cache;
+
+    if (status & 0x80000000) return FALSE;
+    if (entry >= FD_CACHE_ENTRIES || !fd_cache[entry]) return FALSE;
+
+    cache.data = interlocked_cmpxchg64( &fd_cache[entry][idx].data, 0, 0 );
+    return cache.data && cache.s.type != FD_TYPE_INVALID && cache.s.skip_port;
+}
+
+
+/***********************************************************************
+ *           add_type_to_cache
+ *
+ * Caller must hold fd_cache_section.
+ */
+static const UNICODE_STRING *add_type_to_cache( HANDLE handle, const WCHAR *name, data_size_t len )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+    int i;
+
+    if (entry >= FD_CACHE_ENTRIES || is_handle_closing( handle )) return NULL;
+
+    for (i = 0; i < type_names_count; i++)
+        if (type_names[i].Length == len && !memcmp( type_names[i].Buffer, name, len )) break;
+
+    if (i == type_names_count)
+    {
+        WCHAR *buffer;
+
+        if (i == MAX_CACHED_TYPES) return NULL;
+        if (!(buffer = RtlAllocateHeap( GetProcessHeap(), 0, len + sizeof(WCHAR) ))) return NULL;
+        memcpy( buffer, name, len );
+        buffer[len / sizeof(WCHAR)] = 0;
+        type_names[i].Buffer = buffer;
+        type_names[i].Length = len;
+        type_names[i].MaximumLength = len + sizeof(WCHAR);
+        interlocked_xchg( &type_names_count, i + 1 );
+    }
+
+    if (!type_cache[entry])
+    {
+        if (!entry) type_cache[0] = type_cache_initial_block;
+        else
+        {
+            void *ptr = wine_anon_mmap( NULL, FD_CACHE_BLOCK_SIZE, PROT_READ | PROT_WRITE, 0 );
+            if (ptr == MAP_FAILED) return NULL;
+            type_cache[entry] = ptr;
+        }
+    }
+    type_cache[entry][idx] = i + 1;
+    return &type_names[i];
+}
+
+
+/***********************************************************************
+ *           get_cached_type
+ */
+static inline const UNICODE_STRING *get_cached_type( HANDLE handle )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+    BYTE type;
+
+    if (entry >= FD_CACHE_ENTRIES || !type_cache[entry]) return NULL;
+    if (!(type = type_cache[entry][idx])) return NULL;
+    return &type_names[type - 1];
+}
+
+
+/***********************************************************************
+ *           server_get_object_type
+ *
+ * Retrieve the object type name of a handle, going through the cache.
+ * Object types can't change, so the cache entry stays valid until the
+ * handle is closed. The returned string must not be freed.
+ * Return FALSE if the type can't be cached, the caller has to ask the
+ * server directly then.
+ */
+BOOL server_get_object_type( HANDLE handle, UNICODE_STRING *name, NTSTATUS *status )
+{
+    WCHAR buffer[64];
+    const UNICODE_STRING *type;
+    sigset_t sigset;
+    BOOL ret = TRUE;
+
+    if ((type = get_cached_type( handle )))
+    {
+        *name = *type;
+        *status = STATUS_SUCCESS;
+        return TRUE;
+    }
+
+    /* the lock is held across the request, so that the handle can't be closed
+     * and reused for another object before its type is cached */
+    server_enter_uninterrupted_section( &fd_cache_section, &sigset );
+    if ((type = get_cached_type( handle )))
+    {
+        *name = *type;
+        *status = STATUS_SUCCESS;
+    }
+    else
+    {
+        SERVER_START_REQ( get_object_type )
+        {
+            req->handle = wine_server_obj_handle( handle );
+            wine_server_set_reply( req, buffer, sizeof(buffer) );
+            if (!(*status = wine_server_call( req )))
+            {
+                if (!reply->total)  /* no name */
+                {
+                    name->Buffer = NULL;
+                    name->Length = name->MaximumLength = 0;
+                }
+                else if (reply->total != wine_server_reply_size( reply ) ||
+                         !(type = add_type_to_cache( handle, buffer, reply->total )))
+                    ret = FALSE;
+                else
+                    *name = *type;
+            }
+        }
+        SERVER_END_REQ;
+    }
+    server_leave_uninterrupted_section( &fd_cache_section, &sigset );
+    return ret;
+}
+
+
+/***********************************************************************
+ *           server_begin_close_handle
+ *
+ * Remove a handle from the caches before asking the server to close it.
+ * Until server_end_close_handle() is called, lookups of the handle made
+ * by other threads can't add it back. The cached unix fd is returned,
+ * it should be closed once the server call is done.
+ */
+int server_begin_close_handle( HANDLE handle, struct closing_handle *closing )
+{
+    sigset_t sigset;
+    int fd;
+
+    closing->handle = handle;
+    server_enter_uninterrupted_section( &fd_cache_section, &sigset );
+    fd = server_remove_fd_from_cache( handle );
+    list_add_head( &closing_handles, &closing->entry );
+    server_leave_uninterrupted_section( &fd_cache_section, &sigset );
+    return fd;
+}
+
+
+/***********************************************************************
+ *           server_end_close_handle
+ */
+void server_end_close_handle( struct closing_handle *closing )
+{
+    sigset_t sigset;
+
+    server_enter_uninterrupted_section( &fd_cache_section, &sigset );
+    list_remove( &closing->entry );
+    server_leave_uninterrupted_section( &fd_cache_section, &sigset );
+}
+
+
+/***********************************************************************
+ *           server_close_handle
+ *
+ * Close a handle and remove it from the handle caches.
+ */
+NTSTATUS server_close_handle( HANDLE handle )
+{
+    struct closing_handle closing;
+    NTSTATUS ret;
+    int fd;
+
+    fd = server_begin_close_handle( handle, &closing );
+    SERVER_START_REQ( close_handle )
+    {
+        req->handle = wine_server_obj_handle( handle );
+        ret = wine_server_call( req );
+    }
+    SERVER_END_REQ;
+    server_end_close_handle( &closing );
+
+    if (fd != -1) close( fd );
+    return ret;
+}
+
+
+/***********************************************************************
+ *           server_close_handles
+ *
+ * Close several handles with a single server call. Null handles are ignored.
+ */
+void server_close_handles( const HANDLE *handles, unsigned int count )
+{
+    struct __server_batch batch;
+    struct closing_handle closing[16];
+    int fds[16];
+    unsigned int i, queued = 0;
+
+    assert( count <= sizeof(fds) / sizeof(fds[0]) );
+
+    wine_server_init_batch( &batch );
+    for (i = 0; i < count; i++)
+    {
+        if (!handles[i]) continue;
+        fds[queued] = server_begin_close_handle( handles[i], &closing[queued] );
+        queued++;
+        SERVER_START_REQ( close_handle )
+        {
+            req->handle = wine_server_obj_handle( handles[i] );
+            wine_server_queue_request( &batch, req );
+        }
+        SERVER_END_REQ;
+    }
+    wine_server_call_batch( &batch );
+
+    for (i = 0; i < queued; i++)
+    {
+        server_end_close_handle( &closing[i] );
+        if (fds[i] != -1) close( fds[i] );
+    }
+}
+
+
 /***********************************************************************
  *           server_get_unix_fd
  *
@@ -953,14 +1329,14 @@ int server_get_unix_fd( HANDLE handle, unsigned int wanted_access, int *unix_fd,
                 {
                     assert( wine_server_ptr_handle(fd_handle) == handle );
                     *needs_close = (!reply->cacheable ||
-                                    !add_fd_to_cache( handle, fd, reply->type,
-                                                      reply->access, reply->options ));
+                                    !add_fd_to_cache( handle, fd, reply->type, reply->access,
+                                                      reply->options, reply->comp_flags ));
                 }
                 else ret = STATUS_TOO_MANY_OPENED_FILES;
             }
             else if (reply->cacheable)
             {
-                add_fd_to_cache( handle, ret, FD_TYPE_INVALID, 0, 0 );
+                add_fd_to_cache( handle, ret, FD_TYPE_INVALID, 0, 0, 0 );
             }
         }
         SERVER_END_REQ;
@@ -72,6 +72,7 @@ static NTSTATUS (WINAPI *pNtCreateIoCompletion)(PHANDLE, ACCESS_MASK, POBJECT_AT
 static NTSTATUS (WINAPI *pNtOpenIoCompletion)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES);
 static NTSTATUS (WINAPI *pNtQueryIoCompletion)(HANDLE, IO_COMPLETION_INFORMATION_CLASS, PVOID, ULONG, PULONG);
 static NTSTATUS (WINAPI *pNtRemoveIoCompletion)(HANDLE, PULONG_PTR, PULONG_PTR, PIO_STATUS_BLOCK, PLARGE_INTEGER);
+static NTSTATUS (WINAPI *pNtRemoveIoCompletionEx)(HANDLE, FILE_IO_COMPLETION_INFORMATION *, ULONG, ULONG *, LARGE_INTEGER *, BOOLEAN);
 static NTSTATUS (WINAPI *pNtSetIoCompletion)(HANDLE, ULONG_PTR, ULONG_PTR, NTSTATUS, SIZE_T);
 static NTSTATUS (WINAPI *pNtSetInformationFile)(HANDLE, PIO_STATUS_BLOCK, PVOID, ULONG, FILE_INFORMATION_CLASS);
 static NTSTATUS (WINAPI *pNtQueryInformationFile)(HANDLE, PIO_STATUS_BLOCK, PVOID, ULONG, FILE_INFORMATION_CLASS);
@@ -1178,6 +1179,57 @@ static void test_iocp_setcompletion(HANDLE h)
     ok( !count, "Unexpected msg count: %d\n", count );
 }
 
+static void test_iocp_removecompletionex(HANDLE h)
+{
+    FILE_IO_COMPLETION_INFORMATION info[4];
+    LARGE_INTEGER timeout;
+    NTSTATUS res;
+    ULONG count, i;
+
+    if (!pNtRemoveIoCompletionEx)
+    {
+        win_skip( "NtRemoveIoCompletionEx not available\n" );
+        return;
+    }
+
+    for (i = 0; i < 3; i++)
+    {
+        res = pNtSetIoCompletion( h, CKEY_FIRST + i, CVALUE_FIRST + i, STATUS_SUCCESS, i );
+        ok( res == STATUS_SUCCESS, "NtSetIoCompletion failed: %x\n", res );
+    }
+    count = get_pending_msgs(h);
+    ok( count == 3, "Unexpected msg count: %d\n", count );
+
+    memset( info, 0xcc, sizeof(info) );
+    count = 0xdeadbeef;
+    res = pNtRemoveIoCompletionEx( h, info, 2, &count, NULL, FALSE );
+    ok( res == STATUS_SUCCESS, "NtRemoveIoCompletionEx failed: %x\n", res );
+    ok( count == 2, "wrong count %u\n", count );
+    for (i = 0; i < 2; i++)
+    {
+        ok( info[i].CompletionKey == CKEY_FIRST + i, "%u: wrong key %lx\n", i, info[i].CompletionKey );
+        ok( info[i].CompletionValue == CVALUE_FIRST + i, "%u: wrong value %lx\n", i, info[i].CompletionValue );
+        ok( U(info[i].IoStatusBlock).Status == STATUS_SUCCESS, "%u: wrong status %x\n",
+            i, U(info[i].IoStatusBlock).Status );
+        ok( info[i].IoStatusBlock.Information == i, "%u: wrong information %lu\n",
+            i, info[i].IoStatusBlock.Information );
+    }
+    ok( info[2].CompletionKey == (ULONG_PTR)0xcccccccccccccccc, "entry 2 modified\n" );
+
+    count = 0xdeadbeef;
+    res = pNtRemoveIoCompletionEx( h, info, 4, &count, NULL, FALSE );
+    ok( res == STATUS_SUCCESS, "NtRemoveIoCompletionEx failed: %x\n", res );
+    ok( count == 1, "wrong count %u\n", count );
+    ok( info[0].CompletionKey == CKEY_FIRST + 2, "wrong key %lx\n", info[0].CompletionKey );
+
+    timeout.QuadPart = 0;
+    res = pNtRemoveIoCompletionEx( h, info, 4, &count, &timeout, FALSE );
+    ok( res == STATUS_TIMEOUT, "NtRemoveIoCompletionEx returned %x\n", res );
+
+    count = get_pending_msgs(h);
+    ok( !count, "Unexpected msg count: %d\n", count );
+}
+
 static void test_iocp_fileio(HANDLE h)
 {
     static const char pipe_name[] = "\\\\.\\pipe\\iocompletiontestnamedpipe";
@@ -2803,6 +2855,112 @@ static void test_file_both_information(void)
     CloseHandle( h );
 }
 
+static void test_file_completion_information(void)
+{
+    FILE_IO_COMPLETION_NOTIFICATION_INFORMATION info;
+    IO_STATUS_BLOCK io;
+    OVERLAPPED ov, *pov;
+    NTSTATUS status;
+    DWORD num_bytes;
+    HANDLE port, h;
+    ULONG_PTR key;
+    BYTE buf[256];
+    BOOL ret;
+    int i;
+
+    if (!(h = create_temp_file(0))) return;
+
+    status = pNtSetInformationFile(h, &io, &info, sizeof(info) - 1, FileIoCompletionNotificationInformation);
+    ok(status == STATUS_INFO_LENGTH_MISMATCH || broken(status == STATUS_INVALID_INFO_CLASS /* XP */),
+       "expected STATUS_INFO_LENGTH_MISMATCH, got %08x\n", status);
+    if (status == STATUS_INVALID_INFO_CLASS)
+    {
+        win_skip("FileIoCompletionNotificationInformation class not supported\n");
+        CloseHandle(h);
+        return;
+    }
+
+    /* completion modes require an asynchronous handle */
+    info.Flags = FILE_SKIP_COMPLETION_PORT_ON_SUCCESS;
+    status = pNtSetInformationFile(h, &io, &info, sizeof(info), FileIoCompletionNotificationInformation);
+    ok(status == STATUS_INVALID_PARAMETER, "expected STATUS_INVALID_PARAMETER, got %08x\n", status);
+    CloseHandle(h);
+
+    if (!(h = create_temp_file(FILE_FLAG_OVERLAPPED))) return;
+
+    info.Flags = FILE_SKIP_SET_EVENT_ON_HANDLE;
+    status = pNtSetInformationFile(h, &io, &info, sizeof(info), FileIoCompletionNotificationInformation);
+    ok(status == STATUS_SUCCESS, "expected STATUS_SUCCESS, got %08x\n", status);
+
+    info.Flags = FILE_SKIP_SET_USER_EVENT_ON_FAST_IO;
+    status = pNtSetInformationFile(h, &io, &info, sizeof(info), FileIoCompletionNotificationInformation);
+    ok(status == STATUS_SUCCESS, "expected STATUS_SUCCESS, got %08x\n", status);
+
+    CloseHandle(h);
+
+    if (!(h = create_temp_file(FILE_FLAG_OVERLAPPED))) return;
+
+    port = CreateIoCompletionPort(h, NULL, CKEY_FIRST, 0);
+    ok(port != NULL, "CreateIoCompletionPort failed, error %u\n", GetLastError());
+    memset(buf, 0x55, sizeof(buf));
+
+    /* without completion modes every operation queues a completion */
+    memset(&ov, 0, sizeof(ov));
+    ret = WriteFile(h, buf, sizeof(buf), &num_bytes, &ov);
+    ok(ret || GetLastError() == ERROR_IO_PENDING, "WriteFile failed, error %u\n", GetLastError());
+    pov = NULL;
+    ret = GetQueuedCompletionStatus(port, &num_bytes, &key, &pov, 1000);
+    ok(ret, "GetQueuedCompletionStatus failed, error %u\n", GetLastError());
+    ok(key == CKEY_FIRST, "expected key %x, got %lx\n", CKEY_FIRST, key);
+    ok(pov == &ov, "expected %p, got %p\n", &ov, pov);
+
+    info.Flags = FILE_SKIP_COMPLETION_PORT_ON_SUCCESS;
+    status = pNtSetInformationFile(h, &io, &info, sizeof(info), FileIoCompletionNotificationInformation);
+    ok(status == STATUS_SUCCESS, "expected STATUS_SUCCESS, got %08x\n", status);
+
+    /* operations completing asynchronously still queue a completion */
+    for (i = 0; i < 10; i++)
+    {
+        memset(&ov, 0, sizeof(ov));
+        ov.Offset = (i + 1) * sizeof(buf);
+        ret = WriteFile(h, buf, sizeof(buf), &num_bytes, &ov);
+        if (ret || GetLastError() != ERROR_IO_PENDING) break;
+        ret = GetQueuedCompletionStatus(port, &num_bytes, &key, &pov, 1000);
+        ok(ret, "GetQueuedCompletionStatus failed, error %u\n", GetLastError());
+        ok(pov == &ov, "expected %p, got %p\n", &ov, pov);
+        ret = FALSE;
+    }
+    ok(ret, "WriteFile never completed synchronously, error %u\n", GetLastError());
+
+    /* ... but synchronous success does not */
+    ret = GetQueuedCompletionStatus(port, &num_bytes, &key, &pov, 0);
+    ok(!ret && GetLastError() == WAIT_TIMEOUT,
+       "expected WAIT_TIMEOUT, got %d, error %u\n", ret, GetLastError());
+
+    /* flags can't be cleared once they are set */
+    info.Flags = 0;
+    status = pNtSetInformationFile(h, &io, &info, sizeof(info), FileIoCompletionNotificationInformation);
+    ok(status == STATUS_SUCCESS, "expected STATUS_SUCCESS, got %08x\n", status);
+
+    memset(&ov, 0, sizeof(ov));
+    ret = ReadFile(h, buf, sizeof(buf), &num_bytes, &ov);
+    if (ret)
+    {
+        ret = GetQueuedCompletionStatus(port, &num_bytes, &key, &pov, 0);
+        ok(!ret && GetLastError() == WAIT_TIMEOUT,
+           "expected WAIT_TIMEOUT, got %d, error %u\n", ret, GetLastError());
+    }
+    else
+    {
+        ok(GetLastError() == ERROR_IO_PENDING, "ReadFile failed, error %u\n", GetLastError());
+        ret = GetQueuedCompletionStatus(port, &num_bytes, &key, &pov, 1000);
+        ok(ret, "GetQueuedCompletionStatus failed, error %u\n", GetLastError());
+    }
+
+    CloseHandle(port);
+    CloseHandle(h);
+}
+
 static void test_file_disposition_information(void)
 {
     char tmp_path[MAX_PATH], buffer[MAX_PATH + 16];
@@ -2992,6 +3150,7 @@ static void test_iocompletion(void)
     if ( h && h != INVALID_HANDLE_VALUE)
     {
         test_iocp_setcompletion(h);
+        test_iocp_removecompletionex(h);
         test_iocp_fileio(h);
         pNtClose(h);
     }
@@ -4189,6 +4348,7 @@ START_TEST(file)
     pNtOpenIoCompletion     = (void *)GetProcAddress(hntdll, "NtOpenIoCompletion");
     pNtQueryIoCompletion    = (void *)GetProcAddress(hntdll, "NtQueryIoCompletion");
     pNtRemoveIoCompletion   = (void *)GetProcAddress(hntdll, "NtRemoveIoCompletion");
+    pNtRemoveIoCompletionEx = (void *)GetProcAddress(hntdll, "NtRemoveIoCompletionEx");
     pNtSetIoCompletion      = (void *)GetProcAddress(hntdll, "NtSetIoCompletion");
     pNtSetInformationFile   = (void *)GetProcAddress(hntdll, "NtSetInformationFile");
     pNtQueryInformationFile = (void *)GetProcAddress(hntdll, "NtQueryInformationFile");
@@ -4214,6 +4374,7 @@ START_TEST(file)
     test_file_rename_information();
     test_file_link_information();
     test_file_disposition_information();
+    test_file_completion_information();
     test_query_volume_information_file();
     test_query_attribute_information_file();
 }
@@ -24,6 +24,7 @@
 #include "stdio.h"
 #include "winnt.h"
 #include "stdlib.h"
+#include "wine/server.h"
 
 static HANDLE   (WINAPI *pCreateWaitableTimerA)(SECURITY_ATTRIBUTES*, BOOL, LPCSTR);
 static BOOLEAN  (WINAPI *pRtlCreateUnicodeStringFromAsciiz)(PUNICODE_STRING, LPCSTR);
@@ -69,6 +70,8 @@ static NTSTATUS (WINAPI *pNtWaitForKeyedEvent)( HANDLE, const void *, BOOLEAN, c
 static NTSTATUS (WINAPI *pNtReleaseKeyedEvent)( HANDLE, const void *, BOOLEAN, const LARGE_INTEGER * );
 static NTSTATUS (WINAPI *pNtCreateIoCompletion)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES, ULONG);
 static NTSTATUS (WINAPI *pNtOpenIoCompletion)( PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES );
+static unsigned int (CDECL *pwine_server_queue_request)( struct __server_batch *, void * );
+static unsigned int (CDECL *pwine_server_call_batch)( struct __server_batch * );
 
 #define KEYEDEVENT_WAIT       0x0001
 #define KEYEDEVENT_WAKE       0x0002
@@ -1279,10 +1282,11 @@ static void test_query_object(void)
     static const WCHAR type_iocompletion[] = {'I','o','C','o','m','p','l','e','t','i','o','n'};
     static const WCHAR type_directory[] = {'D','i','r','e','c','t','o','r','y'};
     static const WCHAR type_section[] = {'S','e','c','t','i','o','n'};
-    HANDLE handle;
+    HANDLE handle, handle2, process;
     char buffer[1024];
     NTSTATUS status;
     ULONG len, expected_len;
+    BOOL ret;
     OBJECT_ATTRIBUTES attr;
     UNICODE_STRING path, session, *str;
     char dir[MAX_PATH], tmp_path[MAX_PATH], file1[MAX_PATH + 16];
@@ -1434,6 +1438,51 @@ static void test_query_object(void)
                   "wrong/bad type name %s (%p)\n", wine_dbgstr_w(str->Buffer), str->Buffer );
     pNtClose( handle );
 
+    /* the type of a handle closed by DuplicateHandle must not be reused for the next object */
+    handle = CreateEventA( NULL, FALSE, FALSE, NULL );
+    status = pNtQueryObject( handle, ObjectTypeInformation, buffer, sizeof(buffer), &len );
+    ok( status == STATUS_SUCCESS, "NtQueryObject failed %x\n", status );
+    ret = DuplicateHandle( GetCurrentProcess(), handle, GetCurrentProcess(), &handle2, 0, FALSE,
+                           DUPLICATE_SAME_ACCESS | DUPLICATE_CLOSE_SOURCE );
+    ok( ret, "DuplicateHandle failed %u\n", GetLastError() );
+    status = pNtCreateIoCompletion( &handle, IO_COMPLETION_ALL_ACCESS, NULL, 0 );
+    ok( status == STATUS_SUCCESS, "NtCreateIoCompletion failed %x\n", status);
+    memset( buffer, 0, sizeof(buffer) );
+    status = pNtQueryObject( handle, ObjectTypeInformation, buffer, sizeof(buffer), &len );
+    ok( status == STATUS_SUCCESS, "NtQueryObject failed %x\n", status );
+    str = (UNICODE_STRING *)buffer;
+    ok( str->Buffer && !memcmp( str->Buffer, type_iocompletion, sizeof(type_iocompletion) ),
+                  "wrong/bad type name %s (%p)\n", wine_dbgstr_w(str->Buffer), str->Buffer );
+    memset( buffer, 0, sizeof(buffer) );
+    status = pNtQueryObject( handle2, ObjectTypeInformation, buffer, sizeof(buffer), &len );
+    ok( status == STATUS_SUCCESS, "NtQueryObject failed %x\n", status );
+    str = (UNICODE_STRING *)buffer;
+    ok( str->Buffer && !memcmp( str->Buffer, type_event, sizeof(type_event) ),
+                  "wrong/bad type name %s (%p)\n", wine_dbgstr_w(str->Buffer), str->Buffer );
+    pNtClose( handle2 );
+    pNtClose( handle );
+
+    /* same thing through a real process handle */
+    process = OpenProcess( PROCESS_DUP_HANDLE, FALSE, GetCurrentProcessId() );
+    ok( process != NULL, "OpenProcess failed %u\n", GetLastError() );
+    handle = CreateEventA( NULL, FALSE, FALSE, NULL );
+    status = pNtQueryObject( handle, ObjectTypeInformation, buffer, sizeof(buffer), &len );
+    ok( status == STATUS_SUCCESS, "NtQueryObject failed %x\n", status );
+    ret = DuplicateHandle( process, handle, GetCurrentProcess(), &handle2, 0, FALSE,
+                           DUPLICATE_SAME_ACCESS | DUPLICATE_CLOSE_SOURCE );
+    ok( ret, "DuplicateHandle failed %u\n", GetLastError() );
+    status = pNtCreateIoCompletion( &handle, IO_COMPLETION_ALL_ACCESS, NULL, 0 );
+    ok( status == STATUS_SUCCESS, "NtCreateIoCompletion failed %x\n", status);
+    memset( buffer, 0, sizeof(buffer) );
+    status = pNtQueryObject( handle, ObjectTypeInformation, buffer, sizeof(buffer), &len );
+    ok( status == STATUS_SUCCESS, "NtQueryObject failed %x\n", status );
+    str = (UNICODE_STRING *)buffer;
+    ok( str->Buffer && !memcmp( str->Buffer, type_iocompletion, sizeof(type_iocompletion) ),
+                  "wrong/bad type name %s (%p)\n", wine_dbgstr_w(str->Buffer), str->Buffer );
+    pNtClose( handle2 );
+    pNtClose( handle );
+    CloseHandle( process );
+
     status = pNtCreateDirectoryObject( &handle, DIRECTORY_QUERY, NULL );
     ok(status == STATUS_SUCCESS, "Failed to create Directory %08x\n", status);
     len = 0;
@@ -1979,6 +2028,97 @@ static void test_mutant(void)
     NtClose( mutant );
 }
 
+static void test_server_batch(void)
+{
+    struct __server_batch batch;
+    HANDLE event1, event2;
+    unsigned int status, i;
+
+    if (!pwine_server_queue_request || !pwine_server_call_batch)
+    {
+        win_skip( "server request batches are not supported\n" );
+        return;
+    }
+
+    event1 = CreateEventA( NULL, FALSE, FALSE, NULL );
+    event2 = CreateEventA( NULL, FALSE, FALSE, NULL );
+
+    wine_server_init_batch( &batch );
+    status = pwine_server_call_batch( &batch );
+    ok( !status, "empty batch failed %x\n", status );
+
+    SERVER_START_REQ( close_handle )
+    {
+        req->handle = wine_server_obj_handle( event1 );
+        status = pwine_server_queue_request( &batch, req );
+        ok( !status, "queueing failed %x\n", status );
+    }
+    SERVER_END_REQ;
+    SERVER_START_REQ( close_handle )
+    {
+        req->handle = 0xdeadbee0;
+        status = pwine_server_queue_request( &batch, req );
+        ok( !status, "queueing failed %x\n", status );
+    }
+    SERVER_END_REQ;
+    SERVER_START_REQ( select )
+    {
+        req->flags = SELECT_INTERRUPTIBLE;
+        status = pwine_server_queue_request( &batch, req );
+        ok( !status, "queueing failed %x\n", status );
+    }
+    SERVER_END_REQ;
+    SERVER_START_REQ( batch )
+    {
+        status = pwine_server_queue_request( &batch, req );
+        ok( !status, "queueing failed %x\n", status );
+    }
+    SERVER_END_REQ;
+    SERVER_START_REQ( close_handle )
+    {
+        req->handle = wine_server_obj_handle( event2 );
+        status = pwine_server_queue_request( &batch, req );
+        ok( !status, "queueing failed %x\n", status );
+    }
+    SERVER_END_REQ;
+    ok( batch.count == 5, "wrong count %u\n", batch.count );
+
+    status = pwine_server_call_batch( &batch );
+    ok( status == STATUS_INVALID_HANDLE, "wrong status %x\n", status );
+    ok( !batch.status[0], "wrong status %x\n", batch.status[0] );
+    ok( batch.status[1] == STATUS_INVALID_HANDLE, "wrong status %x\n", batch.status[1] );
+    ok( batch.status[2] == STATUS_INVALID_PARAMETER, "select not rejected %x\n", batch.status[2] );
+    ok( batch.status[3] == STATUS_INVALID_PARAMETER, "nested batch not rejected %x\n", batch.status[3] );
+    ok( !batch.status[4], "wrong status %x\n", batch.status[4] );
+
+    /* both events were closed */
+    status = pNtClose( event1 );
+    ok( status == STATUS_INVALID_HANDLE, "handle still valid %x\n", status );
+    status = pNtClose( event2 );
+    ok( status == STATUS_INVALID_HANDLE, "handle still valid %x\n", status );
+
+    /* a full batch refuses more requests without overflowing */
+    wine_server_init_batch( &batch );
+    for (i = 0; i < 1000; i++)
+    {
+        SERVER_START_REQ( close_handle )
+        {
+            req->handle = 0xdeadbee0;
+            wine_server_add_data( req, &i, 3 );
+            status = pwine_server_queue_request( &batch, req );
+        }
+        SERVER_END_REQ;
+        if (status) break;
+    }
+    ok( status == STATUS_BUFFER_TOO_SMALL, "wrong status %x\n", status );
+    ok( batch.size <= sizeof(batch.data), "batch overflow %u\n", batch.size );
+    ok( i == batch.count, "wrong count %u/%u\n", i, batch.count );
+    status = pwine_server_call_batch( &batch );
+    ok( status == STATUS_INVALID_HANDLE, "wrong status %x\n", status );
+    for (i = 0; i < batch.count; i++)
+        ok( batch.status[i] == STATUS_INVALID_HANDLE, "%u: wrong status %x\n", i, batch.status[i] );
+}
+
 START_TEST(om)
 {
     HMODULE hntdll = GetModuleHandleA("ntdll.dll");
@@ -2010,6 +2150,8 @@ START_TEST(om)
     pNtReleaseMutant        = (void *)GetProcAddress(hntdll, "NtReleaseMutant");
     pNtOpenFile             = (void *)GetProcAddress(hntdll, "NtOpenFile");
     pNtClose                = (void *)GetProcAddress(hntdll, "NtClose");
+    pwine_server_queue_request = (void *)GetProcAddress(hntdll, "wine_server_queue_request");
+    pwine_server_call_batch = (void *)GetProcAddress(hntdll, "wine_server_call_batch");
     pRtlInitUnicodeString   = (void *)GetProcAddress(hntdll, "RtlInitUnicodeString");
     pNtCreateNamedPipeFile  = (void *)GetProcAddress(hntdll, "NtCreateNamedPipeFile");
     pNtOpenDirectoryObject  = (void *)GetProcAddress(hntdll, "NtOpenDirectoryObject");
@@ -2044,4 +2186,5 @@ START_TEST(om)
     test_mutant();
     test_keyed_events();
     test_null_device();
+    test_server_batch();
 }
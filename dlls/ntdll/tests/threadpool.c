@@ -22,18 +22,21 @@
 
 static HMODULE hntdll = 0;
 static NTSTATUS (WINAPI *pTpAllocCleanupGroup)(TP_CLEANUP_GROUP **);
+static NTSTATUS (WINAPI *pTpAllocIoCompletion)(TP_IO **,HANDLE,PTP_IO_CALLBACK,PVOID,TP_CALLBACK_ENVIRON *);
 static NTSTATUS (WINAPI *pTpAllocPool)(TP_POOL **,PVOID);
 static NTSTATUS (WINAPI *pTpAllocTimer)(TP_TIMER **,PTP_TIMER_CALLBACK,PVOID,TP_CALLBACK_ENVIRON *);
 static NTSTATUS (WINAPI *pTpAllocWait)(TP_WAIT **,PTP_WAIT_CALLBACK,PVOID,TP_CALLBACK_ENVIRON *);
 static NTSTATUS (WINAPI *pTpAllocWork)(TP_WORK **,PTP_WORK_CALLBACK,PVOID,TP_CALLBACK_ENVIRON *);
 static NTSTATUS (WINAPI *pTpCallbackMayRunLong)(TP_CALLBACK_INSTANCE *);
 static VOID     (WINAPI *pTpCallbackReleaseSemaphoreOnCompletion)(TP_CALLBACK_INSTANCE *,HANDLE,DWORD);
+static VOID     (WINAPI *pTpCancelAsyncIoOperation)(TP_IO *);
 static VOID     (WINAPI *pTpDisassociateCallback)(TP_CALLBACK_INSTANCE *);
 static BOOL     (WINAPI *pTpIsTimerSet)(TP_TIMER *);
 static VOID     (WINAPI *pTpReleaseWait)(TP_WAIT *);
 static VOID     (WINAPI *pTpPostWork)(TP_WORK *);
 static VOID     (WINAPI *pTpReleaseCleanupGroup)(TP_CLEANUP_GROUP *);
 static VOID     (WINAPI *pTpReleaseCleanupGroupMembers)(TP_CLEANUP_GROUP *,BOOL,PVOID);
+static VOID     (WINAPI *pTpReleaseIoCompletion)(TP_IO *);
 static VOID     (WINAPI *pTpReleasePool)(TP_POOL *);
 static VOID     (WINAPI *pTpReleaseTimer)(TP_TIMER *);
 static VOID     (WINAPI *pTpReleaseWork)(TP_WORK *);
@@ -41,6 +44,8 @@ static VOID     (WINAPI *pTpSetPoolMaxThreads)(TP_POOL *,DWORD);
 static VOID     (WINAPI *pTpSetTimer)(TP_TIMER *,LARGE_INTEGER *,LONG,LONG);
 static VOID     (WINAPI *pTpSetWait)(TP_WAIT *,HANDLE,LARGE_INTEGER *);
 static NTSTATUS (WINAPI *pTpSimpleTryPost)(PTP_SIMPLE_CALLBACK,PVOID,TP_CALLBACK_ENVIRON *);
+static VOID     (WINAPI *pTpStartAsyncIoOperation)(TP_IO *);
+static VOID     (WINAPI *pTpWaitForIoCompletion)(TP_IO *,BOOL);
 static VOID     (WINAPI *pTpWaitForTimer)(TP_TIMER *,BOOL);
 static VOID     (WINAPI *pTpWaitForWait)(TP_WAIT *,BOOL);
 static VOID     (WINAPI *pTpWaitForWork)(TP_WORK *,BOOL);
@@ -63,17 +68,20 @@ static BOOL init_threadpool(void)
     }
 
     NTDLL_GET_PROC(TpAllocCleanupGroup);
+    NTDLL_GET_PROC(TpAllocIoCompletion);
     NTDLL_GET_PROC(TpAllocPool);
     NTDLL_GET_PROC(TpAllocTimer);
     NTDLL_GET_PROC(TpAllocWait);
     NTDLL_GET_PROC(TpAllocWork);
     NTDLL_GET_PROC(TpCallbackMayRunLong);
     NTDLL_GET_PROC(TpCallbackReleaseSemaphoreOnCompletion);
+    NTDLL_GET_PROC(TpCancelAsyncIoOperation);
     NTDLL_GET_PROC(TpDisassociateCallback);
     NTDLL_GET_PROC(TpIsTimerSet);
     NTDLL_GET_PROC(TpPostWork);
     NTDLL_GET_PROC(TpReleaseCleanupGroup);
     NTDLL_GET_PROC(TpReleaseCleanupGroupMembers);
+    NTDLL_GET_PROC(TpReleaseIoCompletion);
     NTDLL_GET_PROC(TpReleasePool);
     NTDLL_GET_PROC(TpReleaseTimer);
     NTDLL_GET_PROC(TpReleaseWait);
@@ -82,6 +90,8 @@ static BOOL init_threadpool(void)
     NTDLL_GET_PROC(TpSetTimer);
     NTDLL_GET_PROC(TpSetWait);
     NTDLL_GET_PROC(TpSimpleTryPost);
+    NTDLL_GET_PROC(TpStartAsyncIoOperation);
+    NTDLL_GET_PROC(TpWaitForIoCompletion);
     NTDLL_GET_PROC(TpWaitForTimer);
     NTDLL_GET_PROC(TpWaitForWait);
     NTDLL_GET_PROC(TpWaitForWork);
@@ -1897,6 +1907,129 @@ static void test_tp_multi_wait(void)
     CloseHandle(semaphore);
 }
 
+static struct
+{
+    HANDLE semaphore;
+    LONG count;
+    void *cvalue;
+    IO_STATUS_BLOCK iosb;
+    TP_IO *io;
+} io_info;
+
+static void CALLBACK io_cb(TP_CALLBACK_INSTANCE *instance, void *userdata,
+                           void *cvalue, IO_STATUS_BLOCK *iosb, TP_IO *io)
+{
+    trace("Running io callback\n");
+    ok(userdata == &io_info, "expected userdata %p, got %p\n", &io_info, userdata);
+    InterlockedIncrement(&io_info.count);
+    io_info.cvalue = cvalue;
+    io_info.iosb = *iosb;
+    io_info.io = io;
+    ReleaseSemaphore(io_info.semaphore, 1, NULL);
+}
+
+static void test_tp_io(void)
+{
+    static const char pipe_name[] = "\\\\.\\pipe\\wine_tp_io_test";
+    TP_CALLBACK_ENVIRON environment;
+    OVERLAPPED ovl, ovl2;
+    HANDLE client, server;
+    char in[2], in2[2];
+    NTSTATUS status;
+    TP_POOL *pool;
+    DWORD result;
+    TP_IO *io;
+    BOOL ret;
+
+    if (!pTpAllocIoCompletion)
+    {
+        win_skip("TpAllocIoCompletion not available, skipping tests\n");
+        return;
+    }
+
+    io_info.semaphore = CreateSemaphoreW(NULL, 0, 2, NULL);
+    ok(io_info.semaphore != NULL, "failed to create semaphore\n");
+
+    /* allocate new threadpool */
+    pool = NULL;
+    status = pTpAllocPool(&pool, NULL);
+    ok(!status, "TpAllocPool failed with status %x\n", status);
+    ok(pool != NULL, "expected pool != NULL\n");
+
+    memset(&environment, 0, sizeof(environment));
+    environment.Version = 1;
+    environment.Pool = pool;
+
+    server = CreateNamedPipeA(pipe_name, PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED,
+                              0, 1, 1024, 1024, 0, NULL);
+    ok(server != INVALID_HANDLE_VALUE, "CreateNamedPipe failed with error %u\n", GetLastError());
+    client = CreateFileA(pipe_name, GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+    ok(client != INVALID_HANDLE_VALUE, "CreateFile failed with error %u\n", GetLastError());
+
+    io = NULL;
+    status = pTpAllocIoCompletion(&io, server, io_cb, &io_info, &environment);
+    ok(!status, "TpAllocIoCompletion failed with status %x\n", status);
+    ok(io != NULL, "expected io != NULL\n");
+
+    /* no pending operations, should return immediately */
+    pTpWaitForIoCompletion(io, FALSE);
+    pTpWaitForIoCompletion(io, TRUE);
+
+    /* single operation */
+    memset(&ovl, 0, sizeof(ovl));
+    pTpStartAsyncIoOperation(io);
+    ret = ReadFile(server, in, sizeof(in), NULL, &ovl);
+    ok(!ret && GetLastError() == ERROR_IO_PENDING, "ReadFile returned %d, error %u\n", ret, GetLastError());
+    ret = WriteFile(client, "ab", 2, &result, NULL);
+    ok(ret, "WriteFile failed with error %u\n", GetLastError());
+
+    result = WaitForSingleObject(io_info.semaphore, 1000);
+    ok(result == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", result);
+    pTpWaitForIoCompletion(io, FALSE);
+    ok(io_info.count == 1, "expected 1 callback, got %u\n", io_info.count);
+    ok(io_info.cvalue == &ovl, "expected cvalue %p, got %p\n", &ovl, io_info.cvalue);
+    ok(U(io_info.iosb).Status == STATUS_SUCCESS, "got status %x\n", U(io_info.iosb).Status);
+    ok(io_info.iosb.Information == 2, "got information %lu\n", io_info.iosb.Information);
+    ok(io_info.io == io, "expected io %p, got %p\n", io, io_info.io);
+
+    /* multiple operations are dispatched individually */
+    memset(&ovl, 0, sizeof(ovl));
+    memset(&ovl2, 0, sizeof(ovl2));
+    pTpStartAsyncIoOperation(io);
+    pTpStartAsyncIoOperation(io);
+    ret = ReadFile(server, in, sizeof(in), NULL, &ovl);
+    ok(!ret && GetLastError() == ERROR_IO_PENDING, "ReadFile returned %d, error %u\n", ret, GetLastError());
+    ret = ReadFile(server, in2, sizeof(in2), NULL, &ovl2);
+    ok(!ret && GetLastError() == ERROR_IO_PENDING, "ReadFile returned %d, error %u\n", ret, GetLastError());
+    ret = WriteFile(client, "cd", 2, &result, NULL);
+    ok(ret, "WriteFile failed with error %u\n", GetLastError());
+    ret = WriteFile(client, "ef", 2, &result, NULL);
+    ok(ret, "WriteFile failed with error %u\n", GetLastError());
+
+    result = WaitForSingleObject(io_info.semaphore, 1000);
+    ok(result == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", result);
+    result = WaitForSingleObject(io_info.semaphore, 1000);
+    ok(result == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", result);
+    pTpWaitForIoCompletion(io, FALSE);
+    ok(io_info.count == 3, "expected 3 callbacks, got %u\n", io_info.count);
+    ok(!memcmp(in, "cd", 2), "got wrong data %.2s\n", in);
+    ok(!memcmp(in2, "ef", 2), "got wrong data %.2s\n", in2);
+
+    /* cancelled operations don't get a callback */
+    pTpStartAsyncIoOperation(io);
+    pTpCancelAsyncIoOperation(io);
+    pTpWaitForIoCompletion(io, FALSE);
+    result = WaitForSingleObject(io_info.semaphore, 100);
+    ok(result == WAIT_TIMEOUT, "WaitForSingleObject returned %u\n", result);
+    ok(io_info.count == 3, "expected 3 callbacks, got %u\n", io_info.count);
+
+    CloseHandle(client);
+    CloseHandle(server);
+    pTpReleaseIoCompletion(io);
+    pTpReleasePool(pool);
+    CloseHandle(io_info.semaphore);
+}
+
 START_TEST(threadpool)
 {
     test_RtlQueueWorkItem();
@@ -1916,4 +2049,5 @@ START_TEST(threadpool)
     test_tp_window_length();
     test_tp_wait();
     test_tp_multi_wait();
+    test_tp_io();
 }
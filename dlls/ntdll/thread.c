@@ -311,7 +311,12 @@ HANDLE thread_init(void)
 
     debug_info.str_pos = debug_info.strings;
     debug_info.out_pos = debug_info.output;
+    debug_info.log_chunk = NULL;
+    debug_info.log_function = NULL;
+    debug_info.log_last_channel = NULL;
+    debug_info.relay_profile = NULL;
     debug_init();
+    RELAY_InitProfile();
 
     /* setup the server connection */
     server_init_process();
@@ -438,6 +443,10 @@ static void start_thread( struct startup_info *info )
 
     debug_info.str_pos = debug_info.strings;
     debug_info.out_pos = debug_info.output;
+    debug_info.log_chunk = NULL;
+    debug_info.log_function = NULL;
+    debug_info.log_last_channel = NULL;
+    debug_info.relay_profile = NULL;
     thread_data->debug_info = &debug_info;
     thread_data->pthread_id = pthread_self();
 
@@ -115,6 +115,7 @@ struct timer_queue
 
 #define THREADPOOL_WORKER_TIMEOUT 5000
 #define MAXIMUM_WAITQUEUE_OBJECTS (MAXIMUM_WAIT_OBJECTS - 1)
+#define MAXIMUM_IOQUEUE_COMPLETIONS 64
 
 /* internal threadpool representation */
 struct threadpool
@@ -138,12 +139,20 @@ enum threadpool_objtype
     TP_OBJECT_TYPE_SIMPLE,
     TP_OBJECT_TYPE_WORK,
     TP_OBJECT_TYPE_TIMER,
-    TP_OBJECT_TYPE_WAIT
+    TP_OBJECT_TYPE_WAIT,
+    TP_OBJECT_TYPE_IO
+};
+
+struct io_completion
+{
+    IO_STATUS_BLOCK         iosb;
+    ULONG_PTR               cvalue;
 };
 
 /* internal threadpool object representation */
 struct threadpool_object
 {
+    void                   *win32_callback; /* leave space for kernel32 to store the win32 callback */
     LONG                    refcount;
     BOOL                    shutdown;
     /* read-only information */
@@ -199,6 +208,17 @@ struct threadpool_object
             ULONGLONG       timeout;
             HANDLE          handle;
         } wait;
+        struct
+        {
+            PTP_IO_CALLBACK callback;
+            /* information about the I/O object, locked via .pool->cs */
+            unsigned int    pending_count;
+            BOOL            shutting_down;
+            BOOL            unbound;
+            unsigned int    completion_count;
+            unsigned int    completion_max;
+            struct io_completion *completions;
+        } io;
     } u;
 };
 
@@ -280,6 +300,31 @@ static RTL_CRITICAL_SECTION_DEBUG waitqueue_debug =
       0, 0, { (DWORD_PTR)(__FILE__ ": waitqueue.cs") }
 };
 
+/* global I/O completion queue object */
+static RTL_CRITICAL_SECTION_DEBUG ioqueue_debug;
+
+static struct
+{
+    CRITICAL_SECTION        cs;
+    LONG                    objcount;
+    BOOL                    thread_running;
+    HANDLE                  port;
+}
+ioqueue =
+{
+    { &ioqueue_debug, -1, 0, 0, 0, 0 },         /* cs */
+    0,                                          /* objcount */
+    FALSE,                                      /* thread_running */
+    NULL                                        /* port */
+};
+
+static RTL_CRITICAL_SECTION_DEBUG ioqueue_debug =
+{
+    0, 0, &ioqueue.cs,
+    { &ioqueue_debug.ProcessLocksList, &ioqueue_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": ioqueue.cs") }
+};
+
 struct waitqueue_bucket
 {
     struct list             bucket_entry;
@@ -315,6 +360,13 @@ static inline struct threadpool_object *impl_from_TP_WAIT( TP_WAIT *wait )
     return object;
 }
 
+static inline struct threadpool_object *impl_from_TP_IO( TP_IO *io )
+{
+    struct threadpool_object *object = (struct threadpool_object *)io;
+    assert( object->type == TP_OBJECT_TYPE_IO );
+    return object;
+}
+
 static inline struct threadpool_group *impl_from_TP_CLEANUP_GROUP( TP_CLEANUP_GROUP *group )
 {
     return (struct threadpool_group *)group;
@@ -1626,6 +1678,201 @@ static void tp_waitqueue_unlock( struct threadpool_object *wait )
     RtlLeaveCriticalSection( &waitqueue.cs );
 }
 
+/***********************************************************************
+ *           ioqueue_thread_proc    (internal)
+ *
+ * Dequeues completion messages from the shared I/O completion port in
+ * batches and hands them over to the threadpools of the I/O objects.
+ */
+static void CALLBACK ioqueue_thread_proc( void *param )
+{
+    FILE_IO_COMPLETION_INFORMATION info[MAXIMUM_IOQUEUE_COMPLETIONS];
+    struct threadpool_object *io;
+    struct io_completion *completion;
+    LARGE_INTEGER timeout, *ptimeout;
+    ULONG count, i;
+    NTSTATUS status;
+    BOOL destroy;
+
+    TRACE( "starting I/O completion thread\n" );
+
+    RtlEnterCriticalSection( &ioqueue.cs );
+
+    for (;;)
+    {
+        /* If all I/O objects have been destroyed and no new ones are created
+         * within some amount of time, then we can shutdown this thread. */
+        timeout.QuadPart = (ULONGLONG)THREADPOOL_WORKER_TIMEOUT * -10000;
+        ptimeout = ioqueue.objcount ? NULL : &timeout;
+        RtlLeaveCriticalSection( &ioqueue.cs );
+        status = NtRemoveIoCompletionEx( ioqueue.port, info, MAXIMUM_IOQUEUE_COMPLETIONS, &count,
+                                         ptimeout, FALSE );
+        RtlEnterCriticalSection( &ioqueue.cs );
+
+        if (status == STATUS_TIMEOUT)
+        {
+            if (!ioqueue.objcount) break;
+            continue;
+        }
+        if (status)
+        {
+            ERR( "NtRemoveIoCompletionEx failed with status %x\n", status );
+            continue;
+        }
+
+        for (i = 0; i < count; i++)
+        {
+            io = (struct threadpool_object *)info[i].CompletionKey;
+            assert( io->type == TP_OBJECT_TYPE_IO );
+
+            TRACE( "io %p, cvalue %#lx, status %#x\n", io, info[i].CompletionValue,
+                   info[i].IoStatusBlock.u.Status );
+
+            RtlEnterCriticalSection( &io->pool->cs );
+
+            if (info[i].CompletionValue == (ULONG_PTR)&ioqueue)
+            {
+                /* Posted by tp_ioqueue_unlock, no further completions are expected. */
+                assert( io->u.io.shutting_down );
+                io->u.io.unbound = TRUE;
+            }
+            else if (!io->u.io.pending_count)
+            {
+                WARN( "unexpected completion for io %p without pending operation\n", io );
+            }
+            else if (io->u.io.shutting_down)
+            {
+                WARN( "dropping completion for io %p which is shutting down\n", io );
+                io->u.io.pending_count--;
+            }
+            else
+            {
+                io->u.io.pending_count--;
+
+                if (io->u.io.completion_count == io->u.io.completion_max)
+                {
+                    unsigned int new_max = max( 4, io->u.io.completion_max * 2 );
+                    struct io_completion *new_completions;
+
+                    if (io->u.io.completions)
+                        new_completions = RtlReAllocateHeap( GetProcessHeap(), 0, io->u.io.completions,
+                                                             new_max * sizeof(*new_completions) );
+                    else
+                        new_completions = RtlAllocateHeap( GetProcessHeap(), 0,
+                                                           new_max * sizeof(*new_completions) );
+                    if (new_completions)
+                    {
+                        io->u.io.completions    = new_completions;
+                        io->u.io.completion_max = new_max;
+                    }
+                }
+
+                /* if the completion can't be queued, it is dropped, but the
+                 * object still has to go through the destroy check below */
+                if (io->u.io.completion_count < io->u.io.completion_max)
+                {
+                    completion = &io->u.io.completions[io->u.io.completion_count++];
+                    completion->iosb   = info[i].IoStatusBlock;
+                    completion->cvalue = info[i].CompletionValue;
+                    tp_object_submit( io, FALSE );
+                }
+                else ERR( "failed to queue completion for io %p\n", io );
+            }
+
+            destroy = io->u.io.unbound && !io->u.io.pending_count;
+            RtlLeaveCriticalSection( &io->pool->cs );
+
+            if (destroy)
+            {
+                /* Release the reference held by the I/O queue. */
+                ioqueue.objcount--;
+                tp_object_release( io );
+            }
+        }
+    }
+
+    ioqueue.thread_running = FALSE;
+    RtlLeaveCriticalSection( &ioqueue.cs );
+
+    TRACE( "terminating I/O completion thread\n" );
+    RtlExitUserThread( 0 );
+}
+
+/***********************************************************************
+ *           tp_ioqueue_lock    (internal)
+ *
+ * Associates a file with the shared I/O completion port. When the lock
+ * is acquired successfully, it is guaranteed that the completion thread
+ * is running.
+ */
+static NTSTATUS tp_ioqueue_lock( struct threadpool_object *io, HANDLE file )
+{
+    FILE_COMPLETION_INFORMATION info;
+    IO_STATUS_BLOCK iosb;
+    NTSTATUS status = STATUS_SUCCESS;
+    HANDLE thread;
+    assert( io->type == TP_OBJECT_TYPE_IO );
+
+    io->u.io.pending_count      = 0;
+    io->u.io.shutting_down      = FALSE;
+    io->u.io.unbound            = FALSE;
+    io->u.io.completion_count   = 0;
+    io->u.io.completion_max     = 0;
+    io->u.io.completions        = NULL;
+
+    RtlEnterCriticalSection( &ioqueue.cs );
+
+    if (!ioqueue.port)
+        status = NtCreateIoCompletion( &ioqueue.port, IO_COMPLETION_ALL_ACCESS, NULL, 0 );
+
+    if (!status)
+    {
+        info.CompletionPort = ioqueue.port;
+        info.CompletionKey  = (ULONG_PTR)io;
+        status = NtSetInformationFile( file, &iosb, &info, sizeof(info), FileCompletionInformation );
+    }
+
+    if (!status && !ioqueue.thread_running)
+    {
+        status = RtlCreateUserThread( GetCurrentProcess(), NULL, FALSE, NULL, 0, 0,
+                                      ioqueue_thread_proc, NULL, &thread, NULL );
+        if (status == STATUS_SUCCESS)
+        {
+            ioqueue.thread_running = TRUE;
+            NtClose( thread );
+        }
+    }
+
+    if (!status)
+        ioqueue.objcount++;
+
+    RtlLeaveCriticalSection( &ioqueue.cs );
+    return status;
+}
+
+/***********************************************************************
+ *           tp_ioqueue_unlock    (internal)
+ */
+static void tp_ioqueue_unlock( struct threadpool_object *io )
+{
+    NTSTATUS status;
+    assert( io->type == TP_OBJECT_TYPE_IO );
+
+    RtlEnterCriticalSection( &io->pool->cs );
+    if (io->u.io.shutting_down)
+    {
+        RtlLeaveCriticalSection( &io->pool->cs );
+        return;
+    }
+    io->u.io.shutting_down = TRUE;
+    RtlLeaveCriticalSection( &io->pool->cs );
+
+    /* The completion port delivers messages in order, so once the completion
+     * thread sees this message all earlier completions have been handled. */
+    status = NtSetIoCompletion( ioqueue.port, (ULONG_PTR)io, (ULONG_PTR)&ioqueue, STATUS_SUCCESS, 0 );
+    if (status) ERR( "failed to post shutdown message for io %p, status %x\n", io, status );
+}
+
 /***********************************************************************
  *           tp_threadpool_alloc    (internal)
  *
@@ -1836,6 +2083,7 @@ static void tp_object_initialize( struct threadpool_object *object, struct threa
 {
     BOOL is_simple_callback = (object->type == TP_OBJECT_TYPE_SIMPLE);
 
+    object->win32_callback          = NULL;
     object->refcount                = 1;
     object->shutdown                = FALSE;
 
@@ -1961,6 +2209,8 @@ static void tp_object_cancel( struct threadpool_object *object )
 
         if (object->type == TP_OBJECT_TYPE_WAIT)
             object->u.wait.signaled = 0;
+        else if (object->type == TP_OBJECT_TYPE_IO)
+            object->u.io.completion_count = 0;
     }
     RtlLeaveCriticalSection( &pool->cs );
 
@@ -2003,6 +2253,8 @@ static void tp_object_prepare_shutdown( struct threadpool_object *object )
         tp_timerqueue_unlock( object );
     else if (object->type == TP_OBJECT_TYPE_WAIT)
         tp_waitqueue_unlock( object );
+    else if (object->type == TP_OBJECT_TYPE_IO)
+        tp_ioqueue_unlock( object );
 }
 
 /***********************************************************************
@@ -2043,6 +2295,9 @@ static BOOL tp_object_release( struct threadpool_object *object )
     if (object->race_dll)
         LdrUnloadDll( object->race_dll );
 
+    if (object->type == TP_OBJECT_TYPE_IO)
+        RtlFreeHeap( GetProcessHeap(), 0, object->u.io.completions );
+
     RtlFreeHeap( GetProcessHeap(), 0, object );
     return TRUE;
 }
@@ -2056,6 +2311,7 @@ static void CALLBACK threadpool_worker_proc( void *param )
     struct threadpool_instance instance;
     struct threadpool *pool = param;
     TP_WAIT_RESULT wait_result = 0;
+    struct io_completion completion;
     LARGE_INTEGER timeout;
     struct list *ptr;
     NTSTATUS status;
@@ -2084,6 +2340,15 @@ static void CALLBACK threadpool_worker_proc( void *param )
                 if (wait_result == WAIT_OBJECT_0) object->u.wait.signaled--;
             }
 
+            /* For I/O objects fetch the oldest queued completion. */
+            else if (object->type == TP_OBJECT_TYPE_IO)
+            {
+                assert( object->u.io.completion_count > 0 );
+                completion = object->u.io.completions[0];
+                memmove( &object->u.io.completions[0], &object->u.io.completions[1],
+                         --object->u.io.completion_count * sizeof(completion) );
+            }
+
             /* Leave critical section and do the actual callback. */
             object->num_associated_callbacks++;
             object->num_running_callbacks++;
@@ -2141,6 +2406,17 @@ static void CALLBACK threadpool_worker_proc( void *param )
                     break;
                 }
 
+                case TP_OBJECT_TYPE_IO:
+                {
+                    TRACE( "executing I/O callback %p(%p, %p, %#lx, %p, %p)\n",
+                           object->u.io.callback, callback_instance, object->userdata,
+                           completion.cvalue, &completion.iosb, object );
+                    object->u.io.callback( callback_instance, object->userdata,
+                                           (void *)completion.cvalue, &completion.iosb, (TP_IO *)object );
+                    TRACE( "callback %p returned\n", object->u.io.callback );
+                    break;
+                }
+
                 default:
                     assert(0);
                     break;
@@ -2240,6 +2516,50 @@ NTSTATUS WINAPI TpAllocCleanupGroup( TP_CLEANUP_GROUP **out )
     return tp_group_alloc( (struct threadpool_group **)out );
 }
 
+/***********************************************************************
+ *           TpAllocIoCompletion    (NTDLL.@)
+ */
+NTSTATUS WINAPI TpAllocIoCompletion( TP_IO **out, HANDLE file, PTP_IO_CALLBACK callback,
+                                     PVOID userdata, TP_CALLBACK_ENVIRON *environment )
+{
+    struct threadpool_object *object;
+    struct threadpool *pool;
+    NTSTATUS status;
+
+    TRACE( "%p %p %p %p %p\n", out, file, callback, userdata, environment );
+
+    object = RtlAllocateHeap( GetProcessHeap(), 0, sizeof(*object) );
+    if (!object)
+        return STATUS_NO_MEMORY;
+
+    status = tp_threadpool_lock( &pool, environment );
+    if (status)
+    {
+        RtlFreeHeap( GetProcessHeap(), 0, object );
+        return status;
+    }
+
+    object->type = TP_OBJECT_TYPE_IO;
+    object->u.io.callback = callback;
+
+    status = tp_ioqueue_lock( object, file );
+    if (status)
+    {
+        tp_threadpool_unlock( pool );
+        RtlFreeHeap( GetProcessHeap(), 0, object );
+        return status;
+    }
+
+    tp_object_initialize( object, pool, userdata, environment );
+
+    /* Keep an additional reference for the I/O queue, it is released when
+     * the completion thread has processed the shutdown message. */
+    interlocked_inc( &object->refcount );
+
+    *out = (TP_IO *)object;
+    return STATUS_SUCCESS;
+}
+
 /***********************************************************************
  *           TpAllocPool    (NTDLL.@)
  */
@@ -2474,6 +2794,23 @@ VOID WINAPI TpCallbackUnloadDllOnCompletion( TP_CALLBACK_INSTANCE *instance, HMO
         this->cleanup.library = module;
 }
 
+/***********************************************************************
+ *           TpCancelAsyncIoOperation    (NTDLL.@)
+ */
+VOID WINAPI TpCancelAsyncIoOperation( TP_IO *io )
+{
+    struct threadpool_object *this = impl_from_TP_IO( io );
+
+    TRACE( "%p\n", io );
+
+    RtlEnterCriticalSection( &this->pool->cs );
+    if (this->u.io.pending_count)
+        this->u.io.pending_count--;
+    else
+        WARN( "no pending operation for io %p\n", io );
+    RtlLeaveCriticalSection( &this->pool->cs );
+}
+
 /***********************************************************************
  *           TpDisassociateCallback    (NTDLL.@)
  */
@@ -2615,6 +2952,20 @@ VOID WINAPI TpReleaseCleanupGroupMembers( TP_CLEANUP_GROUP *group, BOOL cancel_p
     }
 }
 
+/***********************************************************************
+ *           TpReleaseIoCompletion    (NTDLL.@)
+ */
+VOID WINAPI TpReleaseIoCompletion( TP_IO *io )
+{
+    struct threadpool_object *this = impl_from_TP_IO( io );
+
+    TRACE( "%p\n", io );
+
+    tp_object_prepare_shutdown( this );
+    this->shutdown = TRUE;
+    tp_object_release( this );
+}
+
 /***********************************************************************
  *           TpReleasePool    (NTDLL.@)
  */
@@ -2883,6 +3234,34 @@ NTSTATUS WINAPI TpSimpleTryPost( PTP_SIMPLE_CALLBACK callback, PVOID userdata,
     return STATUS_SUCCESS;
 }
 
+/***********************************************************************
+ *           TpStartAsyncIoOperation    (NTDLL.@)
+ */
+VOID WINAPI TpStartAsyncIoOperation( TP_IO *io )
+{
+    struct threadpool_object *this = impl_from_TP_IO( io );
+
+    TRACE( "%p\n", io );
+
+    RtlEnterCriticalSection( &this->pool->cs );
+    this->u.io.pending_count++;
+    RtlLeaveCriticalSection( &this->pool->cs );
+}
+
+/***********************************************************************
+ *           TpWaitForIoCompletion    (NTDLL.@)
+ */
+VOID WINAPI TpWaitForIoCompletion( TP_IO *io, BOOL cancel_pending )
+{
+    struct threadpool_object *this = impl_from_TP_IO( io );
+
+    TRACE( "%p %d\n", io, cancel_pending );
+
+    if (cancel_pending)
+        tp_object_cancel( this );
+    tp_object_wait( this, FALSE );
+}
+
 /***********************************************************************
  *           TpWaitForTimer    (NTDLL.@)
  */
@@ -54,6 +54,7 @@
 #include "wine/server.h"
 #include "wine/exception.h"
 #include "wine/list.h"
+#include "wine/rbtree.h"
 #include "wine/debug.h"
 #include "ntdll_misc.h"
 
@@ -67,7 +68,7 @@ WINE_DECLARE_DEBUG_CHANNEL(module);
 /* File view */
 struct file_view
 {
-    struct list   entry;       /* Entry in global view list */
+    struct wine_rb_entry entry; /* Entry in global views tree */
     void         *base;        /* Base address */
     size_t        size;        /* Size in bytes */
     HANDLE        mapping;     /* Handle to the file mapping */
@@ -98,7 +99,8 @@ static const BYTE VIRTUAL_Win32Flags[16] =
     PAGE_EXECUTE_WRITECOPY      /* READ | WRITE | EXEC | WRITECOPY */
 };
 
-static struct list views_list = LIST_INIT(views_list);
+static int compare_view( const void *addr, const struct wine_rb_entry *entry );
+static struct wine_rb_tree views_tree = { compare_view };
 
 static RTL_CRITICAL_SECTION csVirtual;
 static RTL_CRITICAL_SECTION_DEBUG critsect_debug =
@@ -235,7 +237,7 @@ static void VIRTUAL_Dump(void)
 
     TRACE( "Dump of all virtual memory views:\n" );
     server_enter_uninterrupted_section( &csVirtual, &sigset );
-    LIST_FOR_EACH_ENTRY( view, &views_list, struct file_view, entry )
+    WINE_RB_FOR_EACH_ENTRY( view, &views_tree, struct file_view, entry )
     {
         VIRTUAL_DumpView( view );
     }
@@ -244,6 +246,71 @@ static void VIRTUAL_Dump(void)
 #endif
 
 
+/***********************************************************************
+ *           compare_view
+ *
+ * Compare an address with a view, for the views tree.
+ */
+static int compare_view( const void *addr, const struct wine_rb_entry *entry )
+{
+    const struct file_view *view = WINE_RB_ENTRY_VALUE( entry, const struct file_view, entry );
+
+    if ((const char *)addr < (const char *)view->base) return -1;
+    if ((const char *)addr >= (const char *)view->base + view->size) return 1;
+    return 0;
+}
+
+
+/***********************************************************************
+ *           find_view_below
+ *
+ * Find the last view starting below a given address.
+ * The csVirtual section must be held by caller.
+ */
+static struct wine_rb_entry *find_view_below( const void *addr )
+{
+    struct wine_rb_entry *ptr = views_tree.root, *ret = NULL;
+
+    while (ptr)
+    {
+        struct file_view *view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
+
+        if ((const char *)view->base < (const char *)addr)
+        {
+            ret = ptr;
+            ptr = ptr->right;
+        }
+        else ptr = ptr->left;
+    }
+    return ret;
+}
+
+
+/***********************************************************************
+ *           find_view_above
+ *
+ * Find the first view ending above a given address.
+ * The csVirtual section must be held by caller.
+ */
+static struct wine_rb_entry *find_view_above( const void *addr )
+{
+    struct wine_rb_entry *ptr = views_tree.root, *ret = NULL;
+
+    while (ptr)
+    {
+        struct file_view *view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
+
+        if ((const char *)view->base + view->size > (const char *)addr)
+        {
+            ret = ptr;
+            ptr = ptr->left;
+        }
+        else ptr = ptr->right;
+    }
+    return ret;
+}
+
+
 /***********************************************************************
  *           VIRTUAL_FindView
  *
@@ -258,17 +325,14 @@ static void VIRTUAL_Dump(void)
  */
 static struct file_view *VIRTUAL_FindView( const void *addr, size_t size )
 {
+    struct wine_rb_entry *ptr;
     struct file_view *view;
 
-    LIST_FOR_EACH_ENTRY( view, &views_list, struct file_view, entry )
-    {
-        if (view->base > addr) break;  /* no matching view */
-        if ((const char *)view->base + view->size <= (const char *)addr) continue;
-        if ((const char *)view->base + view->size < (const char *)addr + size) break;  /* size too large */
-        if ((const char *)addr + size < (const char *)addr) break; /* overflow */
-        return view;
-    }
-    return NULL;
+    if (!(ptr = wine_rb_get( &views_tree, addr ))) return NULL;
+    view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
+    if ((const char *)view->base + view->size < (const char *)addr + size) return NULL;  /* size too large */
+    if ((const char *)addr + size < (const char *)addr) return NULL; /* overflow */
+    return view;
 }
 
 
@@ -291,14 +355,13 @@ static inline UINT_PTR get_mask( ULONG zero_bits )
  */
 static struct file_view *find_view_range( const void *addr, size_t size )
 {
+    struct wine_rb_entry *ptr;
     struct file_view *view;
 
-    LIST_FOR_EACH_ENTRY( view, &views_list, struct file_view, entry )
-    {
-        if ((const char *)view->base >= (const char *)addr + size) break;
-        if ((const char *)view->base + view->size > (const char *)addr) return view;
-    }
-    return NULL;
+    if (!(ptr = find_view_above( addr ))) return NULL;
+    view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
+    if ((const char *)view->base >= (const char *)addr + size) return NULL;
+    return view;
 }
 
 
@@ -310,17 +373,19 @@ static struct file_view *find_view_range( const void *addr, size_t size )
  */
 static void *find_free_area( void *base, void *end, size_t size, size_t mask, int top_down )
 {
-    struct list *ptr;
+    struct wine_rb_entry *ptr;
     void *start;
 
+    /* Only the views that may overlap the candidate range need to be
+     * walked, so start from the closest one instead of the end of the tree. */
     if (top_down)
     {
         start = ROUND_ADDR( (char *)end - size, mask );
         if (start >= end || start < base) return NULL;
 
-        for (ptr = views_list.prev; ptr != &views_list; ptr = ptr->prev)
+        for (ptr = find_view_below( (char *)start + size ); ptr; ptr = wine_rb_prev( ptr ))
         {
-            struct file_view *view = LIST_ENTRY( ptr, struct file_view, entry );
+            struct file_view *view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
 
             if ((char *)view->base + view->size <= (char *)start) break;
             if ((char *)view->base >= (char *)start + size) continue;
@@ -334,9 +399,9 @@ static void *find_free_area( void *base, void *end, size_t size, size_t mask, in
         start = ROUND_ADDR( (char *)base + mask, mask );
         if (start >= end || (char *)end - (char *)start < size) return NULL;
 
-        for (ptr = views_list.next; ptr != &views_list; ptr = ptr->next)
+        for (ptr = find_view_above( start ); ptr; ptr = wine_rb_next( ptr ))
         {
-            struct file_view *view = LIST_ENTRY( ptr, struct file_view, entry );
+            struct file_view *view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
 
             if ((char *)view->base >= (char *)start + size) break;
             if ((char *)view->base + view->size <= (char *)start) continue;
@@ -381,20 +446,21 @@ static void add_reserved_area( void *addr, size_t size )
  */
 static void remove_reserved_area( void *addr, size_t size )
 {
-    struct file_view *view;
+    struct wine_rb_entry *ptr;
 
     TRACE( "removing %p-%p\n", addr, (char *)addr + size );
     wine_mmap_remove_reserved_area( addr, size, 0 );
 
     /* unmap areas not covered by an existing view */
-    LIST_FOR_EACH_ENTRY( view, &views_list, struct file_view, entry )
+    for (ptr = find_view_above( addr ); ptr; ptr = wine_rb_next( ptr ))
     {
+        struct file_view *view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
+
         if ((char *)view->base >= (char *)addr + size)
         {
             munmap( addr, size );
             break;
         }
-        if ((char *)view->base + view->size <= (char *)addr) continue;
         if (view->base > addr) munmap( addr, (char *)view->base - (char *)addr );
         if ((char *)view->base + view->size > (char *)addr + size) break;
         size = (char *)addr + size - ((char *)view->base + view->size);
@@ -439,7 +505,7 @@ static inline void unmap_area( void *addr, size_t size )
 static void delete_view( struct file_view *view ) /* [in] View */
 {
     if (!(view->protect & VPROT_SYSTEM)) unmap_area( view->base, view->size );
-    list_remove( &view->entry );
+    wine_rb_remove( &views_tree, &view->entry );
     if (view->mapping) close_handle( view->mapping );
     RtlFreeHeap( virtual_heap, 0, view );
 }
@@ -452,8 +518,7 @@ static void delete_view( struct file_view *view ) /* [in] View */
  */
 static NTSTATUS create_view( struct file_view **view_ret, void *base, size_t size, unsigned int vprot )
 {
-    struct file_view *view;
-    struct list *ptr;
+    struct file_view *view, *prev;
     int unix_prot = VIRTUAL_GetUnixProt( vprot );
 
     assert( !((UINT_PTR)base & page_mask) );
@@ -474,44 +539,21 @@ static NTSTATUS create_view( struct file_view **view_ret, void *base, size_t siz
     view->protect = vprot;
     memset( view->prot, vprot, size >> page_shift );
 
-    /* Insert it in the linked list */
-
-    LIST_FOR_EACH( ptr, &views_list )
-    {
-        struct file_view *next = LIST_ENTRY( ptr, struct file_view, entry );
-        if (next->base > base) break;
-    }
-    list_add_before( ptr, &view->entry );
-
     /* Check for overlapping views. This can happen if the previous view
      * was a system view that got unmapped behind our back. In that case
      * we recover by simply deleting it. */
 
-    if ((ptr = list_prev( &views_list, &view->entry )) != NULL)
+    while ((prev = find_view_range( base, size )))
     {
-        struct file_view *prev = LIST_ENTRY( ptr, struct file_view, entry );
-        if ((char *)prev->base + prev->size > (char *)base)
-        {
-            TRACE( "overlapping prev view %p-%p for %p-%p\n",
-                   prev->base, (char *)prev->base + prev->size,
-                   base, (char *)base + view->size );
-            assert( prev->protect & VPROT_SYSTEM );
-            delete_view( prev );
-        }
-    }
-    if ((ptr = list_next( &views_list, &view->entry )) != NULL)
-    {
-        struct file_view *next = LIST_ENTRY( ptr, struct file_view, entry );
-        if ((char *)base + view->size > (char *)next->base)
-        {
-            TRACE( "overlapping next view %p-%p for %p-%p\n",
-                   next->base, (char *)next->base + next->size,
-                   base, (char *)base + view->size );
-            assert( next->protect & VPROT_SYSTEM );
-            delete_view( next );
-        }
+        TRACE( "overlapping view %p-%p for %p-%p\n",
+               prev->base, (char *)prev->base + prev->size,
+               base, (char *)base + view->size );
+        assert( prev->protect & VPROT_SYSTEM );
+        delete_view( prev );
     }
 
+    wine_rb_put( &views_tree, view->base, &view->entry );
+
     *view_ret = view;
     VIRTUAL_DEBUG_DUMP_VIEW( view );
 
@@ -985,13 +1027,13 @@ static NTSTATUS allocate_dos_memory( struct file_view **view, unsigned int vprot
     void * const low_64k = (void *)0x10000;
     const size_t dosmem_size = 0x110000;
     int unix_prot = VIRTUAL_GetUnixProt( vprot );
-    struct list *ptr;
+    struct wine_rb_entry *ptr;
 
     /* check for existing view */
 
-    if ((ptr = list_head( &views_list )))
+    if ((ptr = wine_rb_head( views_tree.root )))
     {
-        struct file_view *first_view = LIST_ENTRY( ptr, struct file_view, entry );
+        struct file_view *first_view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
         if (first_view->base < (void *)dosmem_size) return STATUS_CONFLICTING_ADDRESSES;
     }
 
@@ -1062,7 +1104,8 @@ static NTSTATUS stat_mapping_file( struct file_view *view, struct stat *st )
  * Map an executable (PE format) image into memory.
  */
 static NTSTATUS map_image( HANDLE hmapping, int fd, char *base, SIZE_T total_size, SIZE_T mask,
-                           SIZE_T header_size, int shared_fd, HANDLE dup_mapping, unsigned int map_vprot, PVOID *addr_ptr )
+                           SIZE_T header_size, int shared_fd, int aligned_fd, HANDLE dup_mapping,
+                           unsigned int map_vprot, PVOID *addr_ptr )
 {
     IMAGE_DOS_HEADER *dos;
     IMAGE_NT_HEADERS *nt;
@@ -1214,14 +1257,30 @@ static NTSTATUS map_image( HANDLE hmapping, int fd, char *base, SIZE_T total_siz
 
         /* Note: if the section is not aligned properly map_file_into_view will magically
          *       fall back to read(), so we don't need to check anything here.
+         *       The server usually provides a copy of such sections stored at their
+         *       virtual address though, which can be mapped directly.
          */
         end = file_start + file_size;
         if (sec->PointerToRawData >= st.st_size ||
             end > ((st.st_size + sector_align) & ~sector_align) ||
-            end < file_start ||
-            map_file_into_view( view, fd, sec->VirtualAddress, file_size, file_start,
-                                VPROT_COMMITTED | VPROT_READ | VPROT_WRITECOPY,
-                                !dup_mapping ) != STATUS_SUCCESS)
+            end < file_start)
+        {
+            ERR_(module)( "Could not map section %.8s, file probably truncated\n", sec->Name );
+            goto error;
+        }
+        if (aligned_fd != -1 && (file_start & page_mask) &&
+            sec->VirtualAddress < total_size && file_size <= total_size - sec->VirtualAddress)
+        {
+            if (map_file_into_view( view, aligned_fd, sec->VirtualAddress, file_size, sec->VirtualAddress,
+                                    VPROT_COMMITTED | VPROT_READ | VPROT_WRITECOPY, FALSE ) != STATUS_SUCCESS)
+            {
+                ERR_(module)( "Could not map aligned section %.8s\n", sec->Name );
+                goto error;
+            }
+        }
+        else if (map_file_into_view( view, fd, sec->VirtualAddress, file_size, file_start,
+                                     VPROT_COMMITTED | VPROT_READ | VPROT_WRITECOPY,
+                                     !dup_mapping ) != STATUS_SUCCESS)
         {
             ERR_(module)( "Could not map section %.8s, file probably truncated\n", sec->Name );
             goto error;
@@ -1753,7 +1812,7 @@ void VIRTUAL_SetForceExec( BOOL enable )
     {
         force_exec_prot = enable;
 
-        LIST_FOR_EACH_ENTRY( view, &views_list, struct file_view, entry )
+        WINE_RB_FOR_EACH_ENTRY( view, &views_tree, struct file_view, entry )
         {
             UINT i, count;
             char *addr = view->base;
@@ -2254,8 +2313,8 @@ NTSTATUS WINAPI NtQueryVirtualMemory( HANDLE process, LPCVOID addr,
                                       SIZE_T len, SIZE_T *res_len )
 {
     struct file_view *view;
-    char *base, *alloc_base = 0;
-    struct list *ptr;
+    char *base, *alloc_base = 0, *alloc_end = working_set_limit;
+    struct wine_rb_entry *ptr;
     SIZE_T size = 0;
     MEMORY_BASIC_INFORMATION *info = buffer;
     sigset_t sigset;
@@ -2311,31 +2370,31 @@ NTSTATUS WINAPI NtQueryVirtualMemory( HANDLE process, LPCVOID addr,
     /* Find the view containing the address */
 
     server_enter_uninterrupted_section( &csVirtual, &sigset );
-    ptr = list_head( &views_list );
-    for (;;)
+    ptr = views_tree.root;
+    view = NULL;
+    while (ptr)
     {
-        if (!ptr)
+        struct file_view *cur = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
+
+        if ((char *)cur->base > base)
         {
-            size = (char *)working_set_limit - alloc_base;
-            view = NULL;
-            break;
+            alloc_end = cur->base;
+            ptr = ptr->left;
         }
-        view = LIST_ENTRY( ptr, struct file_view, entry );
-        if ((char *)view->base > base)
+        else if ((char *)cur->base + cur->size <= base)
         {
-            size = (char *)view->base - alloc_base;
-            view = NULL;
-            break;
+            alloc_base = (char *)cur->base + cur->size;
+            ptr = ptr->right;
         }
-        if ((char *)view->base + view->size > base)
+        else
         {
+            view = cur;
             alloc_base = view->base;
-            size = view->size;
+            alloc_end = (char *)view->base + view->size;
             break;
         }
-        alloc_base = (char *)view->base + view->size;
-        ptr = list_next( &views_list, ptr );
     }
+    size = alloc_end - alloc_base;
 
     /* Fill the info structure */
 
@@ -2536,10 +2595,11 @@ NTSTATUS WINAPI NtMapViewOfSection( HANDLE handle, HANDLE process, PVOID *addr_p
     ACCESS_MASK access;
     SIZE_T size, mask = get_mask( zero_bits );
     int unix_handle = -1, needs_close;
+    int aligned_fd = -1, aligned_needs_close = 0;
     unsigned int map_vprot, vprot, sec_flags;
     struct file_view *view;
     pe_image_info_t image_info;
-    HANDLE dup_mapping, shared_file;
+    HANDLE dup_mapping, shared_file, aligned_file;
     LARGE_INTEGER offset;
     sigset_t sigset;
 
@@ -2621,6 +2681,7 @@ NTSTATUS WINAPI NtMapViewOfSection( HANDLE handle, HANDLE process, PVOID *addr_p
         full_size   = reply->size;
         dup_mapping = wine_server_ptr_handle( reply->mapping );
         shared_file = wine_server_ptr_handle( reply->shared_file );
+        aligned_file = wine_server_ptr_handle( reply->aligned_file );
     }
     SERVER_END_REQ;
     if (res) return res;
@@ -2644,6 +2705,10 @@ NTSTATUS WINAPI NtMapViewOfSection( HANDLE handle, HANDLE process, PVOID *addr_p
             res = STATUS_INVALID_PARAMETER;
             goto done;
         }
+        /* not fatal, the unaligned sections are read by hand without it */
+        if (aligned_file && server_get_unix_fd( aligned_file, FILE_READ_DATA, &aligned_fd,
+                                                &aligned_needs_close, NULL, NULL ))
+            aligned_fd = -1;
         if (shared_file)
         {
             int shared_fd, shared_needs_close;
@@ -2651,14 +2716,22 @@ NTSTATUS WINAPI NtMapViewOfSection( HANDLE handle, HANDLE process, PVOID *addr_p
             if ((res = server_get_unix_fd( shared_file, FILE_READ_DATA|FILE_WRITE_DATA,
                                            &shared_fd, &shared_needs_close, NULL, NULL ))) goto done;
             res = map_image( handle, unix_handle, base, size, mask, image_info.header_size,
-                             shared_fd, dup_mapping, map_vprot, addr_ptr );
+                             shared_fd, aligned_fd, dup_mapping, map_vprot, addr_ptr );
             if (shared_needs_close) close( shared_fd );
-            close_handle( shared_file );
         }
         else
         {
             res = map_image( handle, unix_handle, base, size, mask, image_info.header_size,
-                             -1, dup_mapping, map_vprot, addr_ptr );
+                             -1, aligned_fd, dup_mapping, map_vprot, addr_ptr );
+        }
+        if (aligned_needs_close) close( aligned_fd );
+        if (shared_file || aligned_file)
+        {
+            HANDLE handles[2];
+
+            handles[0] = shared_file;
+            handles[1] = aligned_file;
+            server_close_handles( handles, 2 );
         }
         if (needs_close) close( unix_handle );
         if (res >= 0) *size_ptr = size;
@@ -2726,6 +2799,9 @@ NTSTATUS WINAPI NtMapViewOfSection( HANDLE handle, HANDLE process, PVOID *addr_p
 
 done:
     if (dup_mapping) close_handle( dup_mapping );
+    if (aligned_needs_close) close( aligned_fd );
+    if (aligned_file) close_handle( aligned_file );
+    if (shared_file) close_handle( shared_file );
     if (needs_close) close( unix_handle );
     return res;
 }
@@ -225,6 +225,73 @@ static void ref_count_test(LPCWSTR type_lib)
     ok(ITypeLib_Release(iface) == 0, "ITypeLib should be destroyed here.\n");
 }
 
+static void test_typeinfo_lookup(void)
+{
+    ITypeLib *typelib, *typelib2;
+    ITypeComp *tcomp, *tcomp2;
+    ITypeInfo *ti, *ti2;
+    TYPEATTR *attr;
+    FUNCDESC *desc;
+    BSTR name;
+    UINT count, i;
+    HRESULT hr;
+
+    hr = LoadTypeLib(wszStdOle2, &typelib);
+    ok(hr == S_OK, "got %08x\n", hr);
+    hr = LoadTypeLib(wszStdOle2, &typelib2);
+    ok(hr == S_OK, "got %08x\n", hr);
+    ok(typelib == typelib2, "got different typelibs %p %p\n", typelib, typelib2);
+    ITypeLib_Release(typelib2);
+
+    hr = ITypeLib_GetTypeComp(typelib, &tcomp);
+    ok(hr == S_OK, "got %08x\n", hr);
+
+    count = ITypeLib_GetTypeInfoCount(typelib);
+    ok(count > 0, "got %u\n", count);
+    for (i = 0; i < count; i++)
+    {
+        hr = ITypeLib_GetTypeInfo(typelib, i, &ti);
+        ok(hr == S_OK, "%u: got %08x\n", i, hr);
+        hr = ITypeInfo_GetTypeAttr(ti, &attr);
+        ok(hr == S_OK, "%u: got %08x\n", i, hr);
+
+        if (!IsEqualGUID(&attr->guid, &GUID_NULL))
+        {
+            hr = ITypeLib_GetTypeInfoOfGuid(typelib, &attr->guid, &ti2);
+            ok(hr == S_OK, "%u: got %08x\n", i, hr);
+            ok(ti2 == ti, "%u: got %p, expected %p\n", i, ti2, ti);
+            ITypeInfo_Release(ti2);
+        }
+
+        if (attr->cFuncs)
+        {
+            hr = ITypeInfo_GetFuncDesc(ti, 0, &desc);
+            ok(hr == S_OK, "%u: got %08x\n", i, hr);
+            ITypeInfo_ReleaseFuncDesc(ti, desc);
+        }
+
+        hr = ITypeLib_GetDocumentation(typelib, i, &name, NULL, NULL, NULL);
+        ok(hr == S_OK, "%u: got %08x\n", i, hr);
+        ti2 = NULL;
+        tcomp2 = NULL;
+        hr = ITypeComp_BindType(tcomp, name, LHashValOfNameSys(SYS_WIN32, LOCALE_NEUTRAL, name), &ti2, &tcomp2);
+        ok(hr == S_OK, "%u: got %08x\n", i, hr);
+        ok(ti2 == ti, "%u: %s got %p, expected %p\n", i, wine_dbgstr_w(name), ti2, ti);
+        if (ti2) ITypeInfo_Release(ti2);
+        if (tcomp2) ITypeComp_Release(tcomp2);
+        SysFreeString(name);
+
+        ITypeInfo_ReleaseTypeAttr(ti, attr);
+        ITypeInfo_Release(ti);
+    }
+
+    hr = ITypeLib_GetTypeInfoOfGuid(typelib, &IID_IClassFactory, &ti);
+    ok(hr == TYPE_E_ELEMENTNOTFOUND, "got %08x\n", hr);
+
+    ITypeComp_Release(tcomp);
+    ITypeLib_Release(typelib);
+}
+
 static void test_TypeComp(void)
 {
     ITypeComp *pTypeComp, *tcomp, *pTypeComp_tmp;
@@ -6257,6 +6324,7 @@ START_TEST(typelib)
     init_function_pointers();
 
     ref_count_test(wszStdOle2);
+    test_typeinfo_lookup();
     test_TypeComp();
     test_CreateDispTypeInfo();
     test_TypeInfo();
@@ -1121,6 +1121,24 @@ typedef struct tagITypeLibImpl
     struct list ref_list;       /* list of ref types in this typelib */
     HREFTYPE dispatch_href;     /* reference to IDispatch, -1 if unused */
 
+    /* names, strings and guids sorted by offset, used while reading MSFT typelibs */
+    TLBString **msft_names;
+    UINT msft_name_count;
+    TLBString **msft_strings;
+    UINT msft_string_count;
+    TLBGuid **msft_guids;
+    UINT msft_guid_count;
+
+    /* image of MSFT typelibs whose typeinfo members are read on demand */
+    IUnknown *msft_file;
+    void *msft_image;
+    DWORD msft_length;
+    MSFT_SegDir msft_segdir;
+
+    /* hash tables of typeinfo indices by guid and by name, NULL if out of date */
+    int *typeinfo_index;
+    UINT typeinfo_index_size;
+
 
     /* typelibs are cached, keyed by path and index, so store the linked list info within them */
     struct list entry;
@@ -1153,7 +1171,7 @@ static inline ITypeLibImpl *impl_from_ICreateTypeLib2( ICreateTypeLib2 *iface )
 }
 
 /* ITypeLib methods */
-static ITypeLib2* ITypeLib2_Constructor_MSFT(LPVOID pLib, DWORD dwTLBLength);
+static ITypeLib2* ITypeLib2_Constructor_MSFT(LPVOID pLib, DWORD dwTLBLength, IUnknown *file);
 static ITypeLib2* ITypeLib2_Constructor_SLTG(LPVOID pLib, DWORD dwTLBLength);
 
 /*======================= ITypeInfo implementation =======================*/
@@ -1231,6 +1249,7 @@ typedef struct tagITypeInfoImpl
     LONG ref;
     BOOL not_attached_to_typelib;
     BOOL needs_layout;
+    LONG members_pending;       /* functions, variables and impltypes not read yet */
 
     TLBGuid *guid;
     TYPEATTR typeattr;
@@ -1756,6 +1775,97 @@ static inline ITypeInfoImpl *TLB_get_typeinfo_by_name(ITypeInfoImpl **typeinfos,
     return NULL;
 }
 
+static inline UINT TLB_hash_guid(const GUID *guid)
+{
+    const DWORD *data = (const DWORD *)guid;
+    return data[0] ^ data[1] ^ data[2] ^ data[3];
+}
+
+static UINT TLB_hash_name(const OLECHAR *name)
+{
+    UINT hash = 0;
+
+    /* names are compared case insensitively */
+    while (*name) hash = hash * 31 + toupperW(*name++);
+    return hash;
+}
+
+/*
+ * build the hash tables used by TLB_find_typeinfo_by_guid and
+ * TLB_find_typeinfo_by_name
+ */
+static void TLB_build_typeinfo_index(ITypeLibImpl *lib)
+{
+    UINT size = 16, mask, i, pos;
+    int *guids, *names;
+
+    while (size < 2 * lib->TypeInfoCount) size *= 2;
+    if (!(lib->typeinfo_index = heap_alloc(2 * size * sizeof(int)))) return;
+    lib->typeinfo_index_size = size;
+    memset(lib->typeinfo_index, 0xff, 2 * size * sizeof(int));
+
+    guids = lib->typeinfo_index;
+    names = lib->typeinfo_index + size;
+    mask = size - 1;
+
+    /* linear probing in insertion order keeps the first match of duplicates first */
+    for (i = 0; i < lib->TypeInfoCount; i++)
+    {
+        ITypeInfoImpl *info = lib->typeinfos[i];
+
+        pos = TLB_hash_guid(TLB_get_guid_null(info->guid)) & mask;
+        while (guids[pos] != -1) pos = (pos + 1) & mask;
+        guids[pos] = i;
+
+        if (!info->Name) continue;
+        pos = TLB_hash_name(info->Name->str) & mask;
+        while (names[pos] != -1) pos = (pos + 1) & mask;
+        names[pos] = i;
+    }
+}
+
+/* called when the typeinfos are modified through ICreateTypeLib2 or ICreateTypeInfo2 */
+static void TLB_invalidate_typeinfo_index(ITypeLibImpl *lib)
+{
+    heap_free(lib->typeinfo_index);
+    lib->typeinfo_index = NULL;
+}
+
+static ITypeInfoImpl *TLB_find_typeinfo_by_guid(ITypeLibImpl *lib, REFGUID guid)
+{
+    UINT pos, mask = lib->typeinfo_index_size - 1;
+    int i;
+
+    if (!lib->typeinfo_index)
+    {
+        for (i = 0; i < lib->TypeInfoCount; ++i)
+            if (IsEqualIID(TLB_get_guid_null(lib->typeinfos[i]->guid), guid))
+                return lib->typeinfos[i];
+        return NULL;
+    }
+
+    for (pos = TLB_hash_guid(guid) & mask; (i = lib->typeinfo_index[pos]) != -1; pos = (pos + 1) & mask)
+        if (IsEqualIID(TLB_get_guid_null(lib->typeinfos[i]->guid), guid))
+            return lib->typeinfos[i];
+    return NULL;
+}
+
+static ITypeInfoImpl *TLB_find_typeinfo_by_name(ITypeLibImpl *lib, const OLECHAR *name)
+{
+    UINT pos, mask = lib->typeinfo_index_size - 1;
+    const int *names;
+    int i;
+
+    if (!lib->typeinfo_index)
+        return TLB_get_typeinfo_by_name(lib->typeinfos, lib->TypeInfoCount, name);
+
+    names = lib->typeinfo_index + lib->typeinfo_index_size;
+    for (pos = TLB_hash_name(name) & mask; (i = names[pos]) != -1; pos = (pos + 1) & mask)
+        if (!lstrcmpiW(TLB_get_bstr(lib->typeinfos[i]->Name), name))
+            return lib->typeinfos[i];
+    return NULL;
+}
+
 static void TLBVarDesc_Constructor(TLBVarDesc *var_desc)
 {
     list_init(&var_desc->custdata_list);
@@ -2114,8 +2224,21 @@ static HRESULT MSFT_ReadAllGuids(TLBContext *pcx)
 
 static TLBGuid *MSFT_ReadGuid( int offset, TLBContext *pcx)
 {
+    ITypeLibImpl *lib = pcx->pLibInfo;
     TLBGuid *ret;
 
+    if (lib->msft_guids)
+    {
+        /* the guid table is an array of fixed size entries */
+        UINT idx = offset / sizeof(MSFT_GuidEntry);
+
+        if (offset < 0 || offset % sizeof(MSFT_GuidEntry) || idx >= lib->msft_guid_count)
+            return NULL;
+        ret = lib->msft_guids[idx];
+        TRACE_(typelib)("%s\n", debugstr_guid(&ret->guid));
+        return ret;
+    }
+
     LIST_FOR_EACH_ENTRY(ret, &pcx->pLibInfo->guid_list, TLBGuid, entry){
         if(ret->offset == offset){
             TRACE_(typelib)("%s\n", debugstr_guid(&ret->guid));
@@ -2189,10 +2312,33 @@ static HRESULT MSFT_ReadAllNames(TLBContext *pcx)
     }
 }
 
+/* binary search of a string table sorted by offset */
+static TLBString *MSFT_FindStringByOffset( TLBString **table, UINT count, int offset )
+{
+    int min = 0, max = count - 1;
+
+    while (min <= max)
+    {
+        int pos = (min + max) / 2;
+
+        if (table[pos]->offset == offset)
+        {
+            TRACE_(typelib)("%s\n", debugstr_w(table[pos]->str));
+            return table[pos];
+        }
+        if ((int)table[pos]->offset < offset) min = pos + 1;
+        else max = pos - 1;
+    }
+    return NULL;
+}
+
 static TLBString *MSFT_ReadName( TLBContext *pcx, int offset)
 {
     TLBString *tlbstr;
 
+    if (pcx->pLibInfo->msft_names)
+        return MSFT_FindStringByOffset(pcx->pLibInfo->msft_names, pcx->pLibInfo->msft_name_count, offset);
+
     LIST_FOR_EACH_ENTRY(tlbstr, &pcx->pLibInfo->name_list, TLBString, entry) {
         if (tlbstr->offset == offset) {
             TRACE_(typelib)("%s\n", debugstr_w(tlbstr->str));
@@ -2207,6 +2353,9 @@ static TLBString *MSFT_ReadString( TLBContext *pcx, int offset)
 {
     TLBString *tlbstr;
 
+    if (pcx->pLibInfo->msft_strings)
+        return MSFT_FindStringByOffset(pcx->pLibInfo->msft_strings, pcx->pLibInfo->msft_string_count, offset);
+
     LIST_FOR_EACH_ENTRY(tlbstr, &pcx->pLibInfo->string_list, TLBString, entry) {
         if (tlbstr->offset == offset) {
             TRACE_(typelib)("%s\n", debugstr_w(tlbstr->str));
@@ -2662,13 +2811,67 @@ static void TLB_fix_32on64_typeinfo(ITypeInfoImpl *info)
 }
 #endif
 
+/*
+ * read the functions, variables, implemented types and custom data of a
+ * typeinfo record
+ */
+static void MSFT_DoTypeInfoMembers(TLBContext *pcx, ITypeInfoImpl *ptiRet)
+{
+    MSFT_TypeInfoBase tiBase;
+
+    MSFT_ReadLEDWords(&tiBase, sizeof(tiBase) ,pcx ,
+                      pcx->pTblDir->pTypeInfoTab.offset+ptiRet->index*sizeof(tiBase));
+
+    /* functions */
+    if(ptiRet->typeattr.cFuncs >0 )
+        MSFT_DoFuncs(pcx, ptiRet, ptiRet->typeattr.cFuncs,
+		    ptiRet->typeattr.cVars,
+		    tiBase.memoffset, &ptiRet->funcdescs);
+    /* variables */
+    if(ptiRet->typeattr.cVars >0 )
+        MSFT_DoVars(pcx, ptiRet, ptiRet->typeattr.cFuncs,
+		   ptiRet->typeattr.cVars,
+		   tiBase.memoffset, &ptiRet->vardescs);
+    if(ptiRet->typeattr.cImplTypes >0 ) {
+        switch(ptiRet->typeattr.typekind)
+        {
+        case TKIND_COCLASS:
+            MSFT_DoImplTypes(pcx, ptiRet, ptiRet->typeattr.cImplTypes,
+                tiBase.datatype1);
+            break;
+        case TKIND_DISPATCH:
+            /* This is not -1 when the interface is a non-base dual interface or
+               when a dispinterface wraps an interface, i.e., the idl 'dispinterface x {interface y;};'.
+               Note however that GetRefTypeOfImplType(0) always returns a ref to IDispatch and
+               not this interface.
+            */
+
+            if (tiBase.datatype1 != -1)
+            {
+                ptiRet->impltypes = TLBImplType_Alloc(1);
+                ptiRet->impltypes[0].hRef = tiBase.datatype1;
+            }
+            break;
+        default:
+            ptiRet->impltypes = TLBImplType_Alloc(1);
+            ptiRet->impltypes[0].hRef = tiBase.datatype1;
+            break;
+       }
+    }
+    MSFT_CustData(pcx, tiBase.oCustData, ptiRet->pcustdata_list);
+
+    if (TRACE_ON(typelib))
+      dump_TypeInfo(ptiRet);
+}
+
 /*
  * process a typeinfo record
  */
 static ITypeInfoImpl * MSFT_DoTypeInfo(
     TLBContext *pcx,
     int count,
-    ITypeLibImpl * pLibInfo)
+    ITypeLibImpl * pLibInfo,
+    BOOL lazy)
 {
     MSFT_TypeInfoBase tiBase;
     ITypeInfoImpl *ptiRet;
@@ -2706,7 +2909,6 @@ static ITypeInfoImpl * MSFT_DoTypeInfo(
 /*  FIXME: */
 /*    IDLDESC  idldescType; *//* never saw this one != zero  */
 
-/* name, eventually add to a hash table */
     ptiRet->Name=MSFT_ReadName(pcx, tiBase.NameOffset);
     ptiRet->hreftype = MSFT_ReadHreftype(pcx, tiBase.NameOffset);
     TRACE_(typelib)("reading %s\n", debugstr_w(TLB_get_bstr(ptiRet->Name)));
@@ -2721,54 +2923,56 @@ static ITypeInfoImpl * MSFT_DoTypeInfo(
 /* note: InfoType's Help file and HelpStringDll come from the containing
  * library. Further HelpString and Docstring appear to be the same thing :(
  */
-    /* functions */
-    if(ptiRet->typeattr.cFuncs >0 )
-        MSFT_DoFuncs(pcx, ptiRet, ptiRet->typeattr.cFuncs,
-		    ptiRet->typeattr.cVars,
-		    tiBase.memoffset, &ptiRet->funcdescs);
-    /* variables */
-    if(ptiRet->typeattr.cVars >0 )
-        MSFT_DoVars(pcx, ptiRet, ptiRet->typeattr.cFuncs,
-		   ptiRet->typeattr.cVars,
-		   tiBase.memoffset, &ptiRet->vardescs);
-    if(ptiRet->typeattr.cImplTypes >0 ) {
-        switch(ptiRet->typeattr.typekind)
-        {
-        case TKIND_COCLASS:
-            MSFT_DoImplTypes(pcx, ptiRet, ptiRet->typeattr.cImplTypes,
-                tiBase.datatype1);
-            break;
-        case TKIND_DISPATCH:
-            /* This is not -1 when the interface is a non-base dual interface or
-               when a dispinterface wraps an interface, i.e., the idl 'dispinterface x {interface y;};'.
-               Note however that GetRefTypeOfImplType(0) always returns a ref to IDispatch and
-               not this interface.
-            */
-
-            if (tiBase.datatype1 != -1)
-            {
-                ptiRet->impltypes = TLBImplType_Alloc(1);
-                ptiRet->impltypes[0].hRef = tiBase.datatype1;
-            }
-            break;
-        default:
-            ptiRet->impltypes = TLBImplType_Alloc(1);
-            ptiRet->impltypes[0].hRef = tiBase.datatype1;
-            break;
-       }
-    }
-    MSFT_CustData(pcx, tiBase.oCustData, ptiRet->pcustdata_list);
-
     TRACE_(typelib)("%s guid: %s kind:%s\n",
        debugstr_w(TLB_get_bstr(ptiRet->Name)),
        debugstr_guid(TLB_get_guidref(ptiRet->guid)),
        typekind_desc[ptiRet->typeattr.typekind]);
-    if (TRACE_ON(typelib))
-      dump_TypeInfo(ptiRet);
+
+    /* the members are only read when the typeinfo is first handed out */
+    if (lazy)
+        ptiRet->members_pending = TRUE;
+    else
+        MSFT_DoTypeInfoMembers(pcx, ptiRet);
 
     return ptiRet;
 }
 
+static CRITICAL_SECTION typeinfo_load_section;
+static CRITICAL_SECTION_DEBUG typeinfo_load_section_debug =
+{
+    0, 0, &typeinfo_load_section,
+    { &typeinfo_load_section_debug.ProcessLocksList, &typeinfo_load_section_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": typeinfo_load_section") }
+};
+static CRITICAL_SECTION typeinfo_load_section = { &typeinfo_load_section_debug, -1, 0, 0, 0, 0 };
+
+/*
+ * make sure the members of a typeinfo have been read from the typelib image
+ */
+static ITypeInfoImpl *TLB_load_typeinfo(ITypeInfoImpl *info)
+{
+    ITypeLibImpl *lib = info->pTypeLib;
+    TLBContext cx;
+
+    if (!info->members_pending) return info;
+
+    EnterCriticalSection(&typeinfo_load_section);
+    if (info->members_pending)
+    {
+        TRACE_(typelib)("reading members of %s\n", debugstr_w(TLB_get_bstr(info->Name)));
+        cx.oStart = 0;
+        cx.pos = 0;
+        cx.length = lib->msft_length;
+        cx.mapping = lib->msft_image;
+        cx.pTblDir = &lib->msft_segdir;
+        cx.pLibInfo = lib;
+        MSFT_DoTypeInfoMembers(&cx, info);
+        InterlockedExchange(&info->members_pending, FALSE);
+    }
+    LeaveCriticalSection(&typeinfo_load_section);
+    return info;
+}
+
 static HRESULT MSFT_ReadAllStrings(TLBContext *pcx)
 {
     char *string;
@@ -2814,6 +3018,36 @@ static HRESULT MSFT_ReadAllStrings(TLBContext *pcx)
     }
 }
 
+static TLBString **MSFT_BuildStringTable(struct list *string_list, UINT *count)
+{
+    TLBString **table, *tlbstr;
+    UINT i = 0;
+
+    *count = list_count(string_list);
+    if (!(table = heap_alloc(*count * sizeof(*table)))) return NULL;
+    /* the lists are filled in file order, so the table is sorted by offset */
+    LIST_FOR_EACH_ENTRY(tlbstr, string_list, TLBString, entry)
+        table[i++] = tlbstr;
+    return table;
+}
+
+/* index the names, strings and guids by offset, the typeinfos refer to them
+ * thousands of times in big typelibs */
+static void MSFT_BuildLookupTables(TLBContext *pcx)
+{
+    ITypeLibImpl *lib = pcx->pLibInfo;
+    TLBGuid *guid;
+    UINT i = 0;
+
+    lib->msft_names = MSFT_BuildStringTable(&lib->name_list, &lib->msft_name_count);
+    lib->msft_strings = MSFT_BuildStringTable(&lib->string_list, &lib->msft_string_count);
+
+    lib->msft_guid_count = list_count(&lib->guid_list);
+    if (!(lib->msft_guids = heap_alloc(lib->msft_guid_count * sizeof(*lib->msft_guids)))) return;
+    LIST_FOR_EACH_ENTRY(guid, &lib->guid_list, TLBGuid, entry)
+        lib->msft_guids[i++] = guid;
+}
+
 static HRESULT MSFT_ReadAllRefs(TLBContext *pcx)
 {
     TLBRefType *ref;
@@ -3393,7 +3627,7 @@ static HRESULT TLB_ReadTypeLib(LPCWSTR pszFileName, LPWSTR pszPath, UINT cchPath
         {
             DWORD dwSignature = FromLEDWord(*((DWORD*) pBase));
             if (dwSignature == MSFT_SIGNATURE)
-                *ppTypeLib = ITypeLib2_Constructor_MSFT(pBase, dwTLBLength);
+                *ppTypeLib = ITypeLib2_Constructor_MSFT(pBase, dwTLBLength, pFile);
             else if (dwSignature == SLTG_SIGNATURE)
                 *ppTypeLib = ITypeLib2_Constructor_SLTG(pBase, dwTLBLength);
             else
@@ -3463,8 +3697,11 @@ static ITypeLibImpl* TypeLibImpl_Constructor(void)
  *	ITypeLib2_Constructor_MSFT
  *
  * loading an MSFT typelib from an in-memory image
+ *
+ * If file is not NULL, it keeps the image alive and the members of the
+ * typeinfos are only read when they are first needed.
  */
-static ITypeLib2* ITypeLib2_Constructor_MSFT(LPVOID pLib, DWORD dwTLBLength)
+static ITypeLib2* ITypeLib2_Constructor_MSFT(LPVOID pLib, DWORD dwTLBLength, IUnknown *file)
 {
     TLBContext cx;
     LONG lPSegDir;
@@ -3516,6 +3753,7 @@ static ITypeLib2* ITypeLib2_Constructor_MSFT(LPVOID pLib, DWORD dwTLBLength)
     MSFT_ReadAllNames(&cx);
     MSFT_ReadAllStrings(&cx);
     MSFT_ReadAllGuids(&cx);
+    MSFT_BuildLookupTables(&cx);
 
     /* now fill our internal data */
     /* TLIBATTR fields */
@@ -3653,6 +3891,15 @@ static ITypeLib2* ITypeLib2_Constructor_MSFT(LPVOID pLib, DWORD dwTLBLength)
 
     pTypeLibImpl->dispatch_href = tlbHeader.dispatchpos;
 
+    if (file)
+    {
+        IUnknown_AddRef(file);
+        pTypeLibImpl->msft_file = file;
+        pTypeLibImpl->msft_image = pLib;
+        pTypeLibImpl->msft_length = dwTLBLength;
+        pTypeLibImpl->msft_segdir = tlbSegDir;
+    }
+
     /* type infos */
     if(tlbHeader.nrtypeinfos >= 0 )
     {
@@ -3662,7 +3909,7 @@ static ITypeLib2* ITypeLib2_Constructor_MSFT(LPVOID pLib, DWORD dwTLBLength)
 
         for(i = 0; i < tlbHeader.nrtypeinfos; i++)
         {
-            *ppTI = MSFT_DoTypeInfo(&cx, i, pTypeLibImpl);
+            *ppTI = MSFT_DoTypeInfo(&cx, i, pTypeLibImpl, file != NULL);
 
             ++ppTI;
             (pTypeLibImpl->TypeInfoCount)++;
@@ -3676,6 +3923,8 @@ static ITypeLib2* ITypeLib2_Constructor_MSFT(LPVOID pLib, DWORD dwTLBLength)
     }
 #endif
 
+    TLB_build_typeinfo_index(pTypeLibImpl);
+
     TRACE("(%p)\n", pTypeLibImpl);
     return &pTypeLibImpl->ITypeLib2_iface;
 }
@@ -4813,6 +5062,11 @@ static ULONG WINAPI ITypeLib2_fnRelease( ITypeLib2 *iface)
           ITypeInfoImpl_Destroy(This->typeinfos[i]);
       }
       heap_free(This->typeinfos);
+      heap_free(This->typeinfo_index);
+      heap_free(This->msft_names);
+      heap_free(This->msft_strings);
+      heap_free(This->msft_guids);
+      if (This->msft_file) IUnknown_Release(This->msft_file);
       heap_free(This);
       return 0;
     }
@@ -4850,7 +5104,7 @@ static HRESULT WINAPI ITypeLib2_fnGetTypeInfo(
     if(index >= This->TypeInfoCount)
         return TYPE_E_ELEMENTNOTFOUND;
 
-    *ppTInfo = (ITypeInfo *)&This->typeinfos[index]->ITypeInfo2_iface;
+    *ppTInfo = (ITypeInfo *)&TLB_load_typeinfo(This->typeinfos[index])->ITypeInfo2_iface;
     ITypeInfo_AddRef(*ppTInfo);
 
     return S_OK;
@@ -4892,19 +5146,16 @@ static HRESULT WINAPI ITypeLib2_fnGetTypeInfoOfGuid(
     ITypeInfo **ppTInfo)
 {
     ITypeLibImpl *This = impl_from_ITypeLib2(iface);
-    int i;
+    ITypeInfoImpl *info;
 
     TRACE("%p %s %p\n", This, debugstr_guid(guid), ppTInfo);
 
-    for(i = 0; i < This->TypeInfoCount; ++i){
-        if(IsEqualIID(TLB_get_guid_null(This->typeinfos[i]->guid), guid)){
-            *ppTInfo = (ITypeInfo *)&This->typeinfos[i]->ITypeInfo2_iface;
-            ITypeInfo_AddRef(*ppTInfo);
-            return S_OK;
-        }
-    }
+    if (!(info = TLB_find_typeinfo_by_guid(This, guid)))
+        return TYPE_E_ELEMENTNOTFOUND;
 
-    return TYPE_E_ELEMENTNOTFOUND;
+    *ppTInfo = (ITypeInfo *)&TLB_load_typeinfo(info)->ITypeInfo2_iface;
+    ITypeInfo_AddRef(*ppTInfo);
+    return S_OK;
 }
 
 /* ITypeLib::GetLibAttr
@@ -5066,7 +5317,7 @@ static HRESULT WINAPI ITypeLib2_fnIsName(
 
     *pfName=TRUE;
     for(tic = 0; tic < This->TypeInfoCount; ++tic){
-        ITypeInfoImpl *pTInfo = This->typeinfos[tic];
+        ITypeInfoImpl *pTInfo = TLB_load_typeinfo(This->typeinfos[tic]);
         if(!TLB_str_memcmp(szNameBuf, pTInfo->Name, nNameBufLen)) goto ITypeLib2_fnIsName_exit;
         for(fdc = 0; fdc < pTInfo->typeattr.cFuncs; ++fdc) {
             TLBFuncDesc *pFInfo = &pTInfo->funcdescs[fdc];
@@ -5118,7 +5369,7 @@ static HRESULT WINAPI ITypeLib2_fnFindName(
 
     len = (lstrlenW(name) + 1)*sizeof(WCHAR);
     for(tic = 0; count < *found && tic < This->TypeInfoCount; ++tic) {
-        ITypeInfoImpl *pTInfo = This->typeinfos[tic];
+        ITypeInfoImpl *pTInfo = TLB_load_typeinfo(This->typeinfos[tic]);
         TLBVarDesc *var;
         UINT fdc;
 
@@ -5388,6 +5639,12 @@ static HRESULT WINAPI ITypeLibComp_fnBind(
         /* FIXME: check wFlags here? */
         /* FIXME: we should use a hash table to look this info up using lHash
          * instead of an O(n) search */
+        if ((pTypeInfo->typeattr.typekind == TKIND_ENUM) ||
+            (pTypeInfo->typeattr.typekind == TKIND_MODULE) ||
+            ((pTypeInfo->typeattr.typekind == TKIND_COCLASS) &&
+             (pTypeInfo->typeattr.wTypeFlags & TYPEFLAG_FAPPOBJECT)))
+            TLB_load_typeinfo(pTypeInfo);
+
         if ((pTypeInfo->typeattr.typekind == TKIND_ENUM) ||
             (pTypeInfo->typeattr.typekind == TKIND_MODULE))
         {
@@ -5516,12 +5773,13 @@ static HRESULT WINAPI ITypeLibComp_fnBindType(
     if(!szName || !ppTInfo || !ppTComp)
         return E_INVALIDARG;
 
-    info = TLB_get_typeinfo_by_name(This->typeinfos, This->TypeInfoCount, szName);
+    info = TLB_find_typeinfo_by_name(This, szName);
     if(!info){
         *ppTInfo = NULL;
         *ppTComp = NULL;
         return S_OK;
     }
+    TLB_load_typeinfo(info);
 
     *ppTInfo = (ITypeInfo *)&info->ITypeInfo2_iface;
     ITypeInfo_AddRef(*ppTInfo);
@@ -5616,6 +5874,13 @@ static void ITypeInfoImpl_Destroy(ITypeInfoImpl *This)
 
     TRACE("destroying ITypeInfo(%p)\n",This);
 
+    /* the members were never read */
+    if (This->members_pending)
+    {
+        heap_free(This);
+        return;
+    }
+
     for (i = 0; i < This->typeattr.cFuncs; ++i)
     {
         int j;
@@ -7639,7 +7904,7 @@ static HRESULT WINAPI ITypeInfo_fnGetRefTypeInfo(
                 if (This->pTypeLib->typeinfos[i]->hreftype == (hRefType&(~0x3)))
                 {
                     result = S_OK;
-                    *ppTInfo = (ITypeInfo*)&This->pTypeLib->typeinfos[i]->ITypeInfo2_iface;
+                    *ppTInfo = (ITypeInfo*)&TLB_load_typeinfo(This->pTypeLib->typeinfos[i])->ITypeInfo2_iface;
                     ITypeInfo_AddRef(*ppTInfo);
                     goto end;
                 }
@@ -8678,7 +8943,7 @@ static HRESULT WINAPI ICreateTypeLib2_fnCreateTypeInfo(ICreateTypeLib2 *iface,
     if (!ctinfo || !name)
         return E_INVALIDARG;
 
-    info = TLB_get_typeinfo_by_name(This->typeinfos, This->TypeInfoCount, name);
+    info = TLB_find_typeinfo_by_name(This, name);
     if (info)
         return TYPE_E_NAMECONFLICT;
 
@@ -8729,6 +8994,7 @@ static HRESULT WINAPI ICreateTypeLib2_fnCreateTypeInfo(ICreateTypeLib2 *iface,
     info->hreftype = info->index * sizeof(MSFT_TypeInfoBase);
 
     ++This->TypeInfoCount;
+    TLB_invalidate_typeinfo_index(This);
 
     return S_OK;
 }
@@ -9890,6 +10156,9 @@ static HRESULT WINAPI ICreateTypeLib2_fnSaveAllChanges(ICreateTypeLib2 *iface)
 
     TRACE("%p\n", This);
 
+    for(i = 0; i < This->TypeInfoCount; ++i)
+        TLB_load_typeinfo(This->typeinfos[i]);
+
     for(i = 0; i < This->TypeInfoCount; ++i)
         if(This->typeinfos[i]->needs_layout)
             ICreateTypeInfo2_LayOut(&This->typeinfos[i]->ICreateTypeInfo2_iface);
@@ -10187,6 +10456,7 @@ static HRESULT WINAPI ICreateTypeInfo2_fnSetGuid(ICreateTypeInfo2 *iface,
     TRACE("%p %s\n", This, debugstr_guid(guid));
 
     This->guid = TLB_append_guid(&This->pTypeLib->guid_list, guid, This->hreftype);
+    TLB_invalidate_typeinfo_index(This->pTypeLib);
 
     return S_OK;
 }
@@ -11147,6 +11417,7 @@ static HRESULT WINAPI ICreateTypeInfo2_fnSetName(ICreateTypeInfo2 *iface,
         return E_INVALIDARG;
 
     This->Name = TLB_append_str(&This->pTypeLib->name_list, name);
+    TLB_invalidate_typeinfo_index(This->pTypeLib);
 
     return S_OK;
 }
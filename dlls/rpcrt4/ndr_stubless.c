@@ -483,6 +483,360 @@ void client_do_args( PMIDL_STUB_MESSAGE pStubMsg, PFORMAT_STRING pFormat, enum s
     }
 }
 
+/* Compiled marshalling plans
+ *
+ * When all the parameters of a procedure are base types, flat structures or
+ * fixed arrays of base types, their wire representation only depends on the
+ * format string, so it is worked out once and each call then only does a
+ * sequence of aligned copies, without going through the type tables.
+ */
+
+#define PLAN_IN      0x01
+#define PLAN_OUT     0x02
+#define PLAN_RETURN  0x04
+#define PLAN_DEREF   0x08  /* the stack holds a pointer to the data */
+#define PLAN_REF     0x10  /* the pointer is a [ref] pointer */
+
+#define PLAN_HASH_SIZE 61
+
+struct ndr_plan_param
+{
+    unsigned short stack_offset;
+    unsigned short size;          /* size in memory and on the wire */
+    unsigned short alloc;         /* size to allocate for server-allocated [out] params */
+    unsigned char  align;         /* alignment mask on the wire */
+    unsigned char  flags;
+};
+
+struct ndr_plan
+{
+    struct ndr_plan      *next;         /* next plan in the hash bucket */
+    PFORMAT_STRING        params_format;
+    PFORMAT_STRING        type_format;
+    unsigned int          count;
+    BOOL                  compiled;     /* FALSE if the procedure must be interpreted */
+    ULONG                 in_size;      /* size of the [in] params, starting from an aligned buffer */
+    ULONG                 out_size;     /* size of the [out] and return params */
+    int                   retval_offset;
+    struct ndr_plan_param params[1];
+    /* followed by a copy of the NDR_PARAM_OIF descriptors */
+};
+
+/* plans are never freed and only added at the head of a bucket, so lookups
+ * don't need a lock; plan_section only serializes the compilation */
+static struct ndr_plan *plan_hash[PLAN_HASH_SIZE];
+
+static CRITICAL_SECTION plan_section;
+static CRITICAL_SECTION_DEBUG plan_section_debug =
+{
+    0, 0, &plan_section,
+    { &plan_section_debug.ProcessLocksList, &plan_section_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": plan_section") }
+};
+static CRITICAL_SECTION plan_section = { &plan_section_debug, -1, 0, 0, 0, 0 };
+
+static inline const NDR_PARAM_OIF *plan_descriptors( const struct ndr_plan *plan )
+{
+    return (const NDR_PARAM_OIF *)&plan->params[plan->count];
+}
+
+/* size of a base type that is copied unchanged to the wire, or 0 */
+static unsigned int plan_base_type_size( unsigned char fc )
+{
+    switch (fc)
+    {
+    case RPC_FC_BYTE:
+    case RPC_FC_CHAR:
+    case RPC_FC_SMALL:
+    case RPC_FC_USMALL:
+        return 1;
+    case RPC_FC_WCHAR:
+    case RPC_FC_SHORT:
+    case RPC_FC_USHORT:
+        return 2;
+    case RPC_FC_LONG:
+    case RPC_FC_ULONG:
+    case RPC_FC_ENUM32:
+    case RPC_FC_ERROR_STATUS_T:
+        return 4;
+    case RPC_FC_HYPER:
+    case RPC_FC_DOUBLE:
+        return 8;
+    default:  /* floats are promoted through varargs, the others have a different wire size */
+        return 0;
+    }
+}
+
+static BOOL plan_param( const NDR_PARAM_OIF *param, PFORMAT_STRING type_format,
+                        struct ndr_plan_param *p )
+{
+    PFORMAT_STRING fmt;
+
+    if (param->attr.IsPipe || param->attr.IsPartialIgnore) return FALSE;
+    if (param->attr.ServerAllocSize && param->attr.IsIn) return FALSE;
+
+    p->stack_offset = param->stack_offset;
+    p->alloc = param->attr.ServerAllocSize * 8;
+    p->flags = 0;
+    if (param->attr.IsIn) p->flags |= PLAN_IN;
+    if (param->attr.IsOut) p->flags |= PLAN_OUT;
+    if (param->attr.IsReturn) p->flags |= PLAN_RETURN;
+    if (param->attr.IsSimpleRef) p->flags |= PLAN_REF;
+
+    if (param->attr.IsBasetype)
+    {
+        if (!(p->size = plan_base_type_size( param->u.type_format_char ))) return FALSE;
+        p->align = p->size - 1;
+        if (param->attr.IsSimpleRef) p->flags |= PLAN_DEREF;
+        return TRUE;
+    }
+
+    if (!param->attr.IsByValue) p->flags |= PLAN_DEREF;
+    fmt = &type_format[param->u.type_offset];
+    switch (fmt[0])
+    {
+    case RPC_FC_SMFARRAY:
+        if (!plan_base_type_size( fmt[4] ) || fmt[5] != RPC_FC_END) return FALSE;
+        /* fall through */
+    case RPC_FC_STRUCT:
+        if (fmt[1] > 7) return FALSE;
+        p->align = fmt[1];
+        p->size = *(const WORD *)(fmt + 2);
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+static struct ndr_plan *compile_plan( PFORMAT_STRING type_format, PFORMAT_STRING format,
+                                      unsigned int count )
+{
+    const NDR_PARAM_OIF *params = (const NDR_PARAM_OIF *)format;
+    struct ndr_plan *plan;
+    unsigned int i;
+
+    if (!(plan = HeapAlloc( GetProcessHeap(), 0, FIELD_OFFSET( struct ndr_plan, params[count] ) +
+                            count * sizeof(*params) )))
+        return NULL;
+
+    plan->params_format = format;
+    plan->type_format = type_format;
+    plan->count = count;
+    plan->compiled = TRUE;
+    plan->in_size = plan->out_size = 0;
+    plan->retval_offset = -1;
+    memcpy( (NDR_PARAM_OIF *)plan_descriptors( plan ), params, count * sizeof(*params) );
+
+    for (i = 0; i < count && plan->compiled; i++)
+    {
+        struct ndr_plan_param *p = &plan->params[i];
+
+        if (!plan_param( &params[i], type_format, p ))
+        {
+            plan->compiled = FALSE;
+            break;
+        }
+        if (p->flags & PLAN_IN)
+            plan->in_size = ((plan->in_size + p->align) & ~p->align) + p->size;
+        if (p->flags & (PLAN_OUT | PLAN_RETURN))
+            plan->out_size = ((plan->out_size + p->align) & ~p->align) + p->size;
+        if (p->flags & PLAN_RETURN) plan->retval_offset = p->stack_offset;
+    }
+
+    TRACE( "format %p: %s, in size %u, out size %u\n", format,
+           plan->compiled ? "compiled" : "interpreted", plan->in_size, plan->out_size );
+    return plan;
+}
+
+static struct ndr_plan *find_plan( struct ndr_plan *plan, const MIDL_STUB_DESC *stub_desc,
+                                   PFORMAT_STRING format, unsigned int count )
+{
+    for (; plan; plan = plan->next)
+    {
+        /* the descriptors are compared too, in case the module was reloaded */
+        if (plan->params_format == format && plan->type_format == stub_desc->pFormatTypes &&
+            plan->count == count &&
+            !memcmp( plan_descriptors( plan ), format, count * sizeof(NDR_PARAM_OIF) ))
+            return plan;
+    }
+    return NULL;
+}
+
+/* retrieve the plan of a procedure, compiling it on first use */
+static const struct ndr_plan *get_plan( const MIDL_STUB_DESC *stub_desc, PFORMAT_STRING format,
+                                        unsigned int count )
+{
+    struct ndr_plan **bucket = &plan_hash[((ULONG_PTR)format >> 2) % PLAN_HASH_SIZE];
+    struct ndr_plan *plan;
+
+    /* the plan is fully initialized before it is published, and the reads
+     * through the head pointer depend on it */
+    if (!(plan = find_plan( *(struct ndr_plan * volatile *)bucket, stub_desc, format, count )))
+    {
+        EnterCriticalSection( &plan_section );
+        if (!(plan = find_plan( *bucket, stub_desc, format, count )) &&
+            (plan = compile_plan( stub_desc->pFormatTypes, format, count )))
+        {
+            plan->next = *bucket;
+            InterlockedExchangePointer( (void **)bucket, plan );
+        }
+        LeaveCriticalSection( &plan_section );
+    }
+    return plan && plan->compiled ? plan : NULL;
+}
+
+static void plan_buffer_size( MIDL_STUB_MESSAGE *pStubMsg, const struct ndr_plan *plan,
+                              ULONG size, unsigned char mask )
+{
+    unsigned int i;
+
+    if (!(pStubMsg->BufferLength & 7))
+    {
+        /* the alignment padding is the same as when starting from 0 */
+        if (pStubMsg->BufferLength + size < pStubMsg->BufferLength)
+            RpcRaiseException(RPC_X_BAD_STUB_DATA);
+        pStubMsg->BufferLength += size;
+        return;
+    }
+
+    for (i = 0; i < plan->count; i++)
+    {
+        const struct ndr_plan_param *p = &plan->params[i];
+        ULONG len;
+
+        if (!(p->flags & mask)) continue;
+        len = (pStubMsg->BufferLength + p->align) & ~p->align;
+        if (len < pStubMsg->BufferLength || len + p->size < len)
+            RpcRaiseException(RPC_X_BAD_STUB_DATA);
+        pStubMsg->BufferLength = len + p->size;
+    }
+}
+
+static void plan_marshal( MIDL_STUB_MESSAGE *pStubMsg, const struct ndr_plan *plan, unsigned char mask )
+{
+    unsigned char *end = (unsigned char *)pStubMsg->RpcMsg->Buffer + pStubMsg->BufferLength;
+    unsigned int i;
+
+    for (i = 0; i < plan->count; i++)
+    {
+        const struct ndr_plan_param *p = &plan->params[i];
+        unsigned char *pArg = pStubMsg->StackTop + p->stack_offset;
+        unsigned int pad;
+
+        if (!(p->flags & mask)) continue;
+        if (p->flags & PLAN_DEREF) pArg = *(unsigned char **)pArg;
+
+        pad = (p->align + 1 - (ULONG_PTR)pStubMsg->Buffer) & p->align;
+        if (pStubMsg->Buffer + pad + p->size < pStubMsg->Buffer ||
+            pStubMsg->Buffer + pad + p->size > end)
+        {
+            ERR("buffer overflow - Buffer = %p, BufferEnd = %p, size = %u\n",
+                pStubMsg->Buffer, end, pad + p->size);
+            RpcRaiseException(RPC_X_BAD_STUB_DATA);
+        }
+        memset( pStubMsg->Buffer, 0, pad );
+        memcpy( pStubMsg->Buffer + pad, pArg, p->size );
+        pStubMsg->Buffer += pad + p->size;
+    }
+}
+
+static unsigned char *plan_unmarshal_param( MIDL_STUB_MESSAGE *pStubMsg, const struct ndr_plan_param *p )
+{
+    unsigned char *buffer;
+
+    buffer = (unsigned char *)(((ULONG_PTR)pStubMsg->Buffer + p->align) & ~(ULONG_PTR)p->align);
+    if (buffer + p->size < buffer || buffer + p->size > pStubMsg->BufferEnd)
+    {
+        ERR("buffer overflow - Buffer = %p, BufferEnd = %p, size = %u\n",
+            buffer, pStubMsg->BufferEnd, p->size);
+        RpcRaiseException(RPC_X_BAD_STUB_DATA);
+    }
+    pStubMsg->Buffer = buffer + p->size;
+    return buffer;
+}
+
+/* run a client phase from the plan, returns FALSE if the interpreter must be used instead */
+static BOOL plan_client_args( MIDL_STUB_MESSAGE *pStubMsg, const struct ndr_plan *plan,
+                              enum stubless_phase phase, unsigned char *pRetVal )
+{
+    unsigned int i;
+
+    switch (phase)
+    {
+    case STUBLESS_CALCSIZE:
+        for (i = 0; i < plan->count; i++)
+            if ((plan->params[i].flags & PLAN_REF) &&
+                !*(unsigned char **)(pStubMsg->StackTop + plan->params[i].stack_offset))
+                RpcRaiseException(RPC_X_NULL_REF_POINTER);
+        plan_buffer_size( pStubMsg, plan, plan->in_size, PLAN_IN );
+        return TRUE;
+    case STUBLESS_MARSHAL:
+        plan_marshal( pStubMsg, plan, PLAN_IN );
+        return TRUE;
+    case STUBLESS_UNMARSHAL:
+        for (i = 0; i < plan->count; i++)
+        {
+            const struct ndr_plan_param *p = &plan->params[i];
+            unsigned char *pArg = pStubMsg->StackTop + p->stack_offset;
+
+            if (!(p->flags & PLAN_OUT)) continue;
+            if ((p->flags & PLAN_RETURN) && pRetVal) pArg = pRetVal;
+            if (p->flags & PLAN_DEREF) pArg = *(unsigned char **)pArg;
+            memcpy( pArg, plan_unmarshal_param( pStubMsg, p ), p->size );
+        }
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+/* run a server phase from the plan, returns FALSE if the interpreter must be used instead */
+static BOOL plan_stub_args( MIDL_STUB_MESSAGE *pStubMsg, const struct ndr_plan *plan,
+                            enum stubless_phase phase, LONG_PTR **retval_ptr )
+{
+    unsigned int i;
+
+    switch (phase)
+    {
+    case STUBLESS_UNMARSHAL:
+        for (i = 0; i < plan->count; i++)
+        {
+            const struct ndr_plan_param *p = &plan->params[i];
+            unsigned char *pArg = pStubMsg->StackTop + p->stack_offset;
+            unsigned char *buffer;
+
+            if (p->alloc)
+                *(void **)pArg = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, p->alloc );
+            if (!(p->flags & PLAN_IN)) continue;
+
+            buffer = plan_unmarshal_param( pStubMsg, p );
+            if (!(p->flags & PLAN_DEREF)) memcpy( pArg, buffer, p->size );
+            /* for servers, we just point straight into the RPC buffer */
+            else if (!*(unsigned char **)pArg) *(unsigned char **)pArg = buffer;
+            else memcpy( *(unsigned char **)pArg, buffer, p->size );
+        }
+        break;
+    case STUBLESS_CALCSIZE:
+        plan_buffer_size( pStubMsg, plan, plan->out_size, PLAN_OUT | PLAN_RETURN );
+        break;
+    case STUBLESS_MARSHAL:
+        plan_marshal( pStubMsg, plan, PLAN_OUT | PLAN_RETURN );
+        break;
+    default:
+        return FALSE;
+    }
+    *retval_ptr = plan->retval_offset != -1 ? (LONG_PTR *)(pStubMsg->StackTop + plan->retval_offset) : NULL;
+    return TRUE;
+}
+
+static inline void client_plan_args( MIDL_STUB_MESSAGE *pStubMsg, const struct ndr_plan *plan,
+                                     PFORMAT_STRING pFormat, enum stubless_phase phase, void **fpu_args,
+                                     unsigned short number_of_params, unsigned char *pRetVal )
+{
+    if (plan && plan_client_args( pStubMsg, plan, phase, pRetVal )) return;
+    client_do_args( pStubMsg, pFormat, phase, fpu_args, number_of_params, pRetVal );
+}
+
 static unsigned int type_stack_size(unsigned char fc)
 {
     switch (fc)
@@ -628,6 +982,8 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
     PFORMAT_STRING pHandleFormat;
     /* correlation cache */
     ULONG_PTR NdrCorrCache[256];
+    /* compiled marshalling plan, if the procedure allows it */
+    const struct ndr_plan *plan = NULL;
 
     TRACE("pStubDesc %p, pFormat %p, ...\n", pStubDesc, pFormat);
 
@@ -706,6 +1062,8 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
             }
 #endif
         }
+
+        if (!Oif_flags.HasPipes) plan = get_plan(pStubDesc, pFormat, number_of_params);
     }
     else
     {
@@ -756,16 +1114,16 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
         if (pProcHeader->Oi_flags & RPC_FC_PROC_OIF_OBJECT)
         {
             TRACE( "INITOUT\n" );
-            client_do_args(&stubMsg, pFormat, STUBLESS_INITOUT, fpu_stack,
-                           number_of_params, (unsigned char *)&RetVal);
+            client_plan_args(&stubMsg, plan, pFormat, STUBLESS_INITOUT, fpu_stack,
+                             number_of_params, (unsigned char *)&RetVal);
         }
 
         __TRY
         {
             /* 2. CALCSIZE */
             TRACE( "CALCSIZE\n" );
-            client_do_args(&stubMsg, pFormat, STUBLESS_CALCSIZE, fpu_stack,
-                           number_of_params, (unsigned char *)&RetVal);
+            client_plan_args(&stubMsg, plan, pFormat, STUBLESS_CALCSIZE, fpu_stack,
+                             number_of_params, (unsigned char *)&RetVal);
 
             /* 3. GETBUFFER */
             TRACE( "GETBUFFER\n" );
@@ -795,8 +1153,8 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
 
             /* 4. MARSHAL */
             TRACE( "MARSHAL\n" );
-            client_do_args(&stubMsg, pFormat, STUBLESS_MARSHAL, fpu_stack,
-                           number_of_params, (unsigned char *)&RetVal);
+            client_plan_args(&stubMsg, plan, pFormat, STUBLESS_MARSHAL, fpu_stack,
+                             number_of_params, (unsigned char *)&RetVal);
 
             /* 5. SENDRECEIVE */
             TRACE( "SENDRECEIVE\n" );
@@ -833,8 +1191,8 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
 
             /* 6. UNMARSHAL */
             TRACE( "UNMARSHAL\n" );
-            client_do_args(&stubMsg, pFormat, STUBLESS_UNMARSHAL, fpu_stack,
-                           number_of_params, (unsigned char *)&RetVal);
+            client_plan_args(&stubMsg, plan, pFormat, STUBLESS_UNMARSHAL, fpu_stack,
+                             number_of_params, (unsigned char *)&RetVal);
         }
         __EXCEPT_ALL
         {
@@ -842,8 +1200,8 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
             {
                 /* 7. FREE */
                 TRACE( "FREE\n" );
-                client_do_args(&stubMsg, pFormat, STUBLESS_FREE, fpu_stack,
-                               number_of_params, (unsigned char *)&RetVal);
+                client_plan_args(&stubMsg, plan, pFormat, STUBLESS_FREE, fpu_stack,
+                                 number_of_params, (unsigned char *)&RetVal);
                 RetVal = NdrProxyErrorHandler(GetExceptionCode());
             }
             else
@@ -878,8 +1236,8 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
     {
         /* 2. CALCSIZE */
         TRACE( "CALCSIZE\n" );
-        client_do_args(&stubMsg, pFormat, STUBLESS_CALCSIZE, fpu_stack,
-                       number_of_params, (unsigned char *)&RetVal);
+        client_plan_args(&stubMsg, plan, pFormat, STUBLESS_CALCSIZE, fpu_stack,
+                         number_of_params, (unsigned char *)&RetVal);
 
         /* 3. GETBUFFER */
         TRACE( "GETBUFFER\n" );
@@ -900,8 +1258,8 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
 
         /* 4. MARSHAL */
         TRACE( "MARSHAL\n" );
-        client_do_args(&stubMsg, pFormat, STUBLESS_MARSHAL, fpu_stack,
-                       number_of_params, (unsigned char *)&RetVal);
+        client_plan_args(&stubMsg, plan, pFormat, STUBLESS_MARSHAL, fpu_stack,
+                         number_of_params, (unsigned char *)&RetVal);
 
         /* 5. SENDRECEIVE */
         TRACE( "SENDRECEIVE\n" );
@@ -927,8 +1285,8 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
 
         /* 6. UNMARSHAL */
         TRACE( "UNMARSHAL\n" );
-        client_do_args(&stubMsg, pFormat, STUBLESS_UNMARSHAL, fpu_stack,
-                       number_of_params, (unsigned char *)&RetVal);
+        client_plan_args(&stubMsg, plan, pFormat, STUBLESS_UNMARSHAL, fpu_stack,
+                         number_of_params, (unsigned char *)&RetVal);
     }
 
     if (ext_flags.HasNewCorrDesc)
@@ -1263,6 +1621,8 @@ LONG WINAPI NdrStubCall2(
     LONG_PTR *retval_ptr = NULL;
     /* correlation cache */
     ULONG_PTR NdrCorrCache[256];
+    /* compiled marshalling plan, if the procedure allows it */
+    const struct ndr_plan *plan = NULL;
 
     TRACE("pThis %p, pChannel %p, pRpcMsg %p, pdwStubPhase %p\n", pThis, pChannel, pRpcMsg, pdwStubPhase);
 
@@ -1372,6 +1732,8 @@ LONG WINAPI NdrStubCall2(
             pFormat += pExtensions->Size;
         }
 
+        if (!Oif_flags.HasPipes) plan = get_plan(pStubDesc, pFormat, number_of_params);
+
         if (Oif_flags.HasPipes)
         {
             FIXME("pipes not supported yet\n");
@@ -1459,7 +1821,8 @@ LONG WINAPI NdrStubCall2(
         case STUBLESS_MARSHAL:
         case STUBLESS_MUSTFREE:
         case STUBLESS_FREE:
-            retval_ptr = stub_do_args(&stubMsg, pFormat, phase, number_of_params);
+            if (!plan || !plan_stub_args(&stubMsg, plan, phase, &retval_ptr))
+                retval_ptr = stub_do_args(&stubMsg, pFormat, phase, number_of_params);
             break;
         default:
             ERR("shouldn't reach here. phase %d\n", phase);
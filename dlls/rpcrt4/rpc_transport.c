@@ -119,8 +119,14 @@ typedef struct _RpcConnection_np
   HANDLE pipe;
   HANDLE listen_thread;
   BOOL listening;
+  /* ncalrpc only */
+  HANDLE shm_section;     /* shared memory section used for the data */
+  struct lrpc_shm *shm;   /* mapped view of the section, NULL if data goes through the pipe */
+  BOOL handshake_done;    /* server side: handshake message received from the client */
 } RpcConnection_np;
 
+static RPC_STATUS rpcrt4_ncalrpc_shm_connect(RpcConnection_np *npc);
+
 static RpcConnection *rpcrt4_conn_np_alloc(void)
 {
   RpcConnection_np *npc = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(RpcConnection_np));
@@ -276,6 +282,9 @@ static RPC_STATUS rpcrt4_ncalrpc_open(RpcConnection* Connection)
   r = rpcrt4_conn_open_pipe(Connection, pname, TRUE);
   I_RpcFree(pname);
 
+  if (r == RPC_S_OK)
+    r = rpcrt4_ncalrpc_shm_connect(npc);
+
   return r;
 }
 
@@ -529,6 +538,335 @@ static int rpcrt4_conn_np_wait_for_incoming_data(RpcConnection *Connection)
     return -1;
 }
 
+/**** ncalrpc shared memory support ****/
+
+/* Once the pipe is connected the client sends a handshake message with the
+ * handle of an unnamed shared memory section holding one ring buffer per
+ * direction; the server duplicates it out of the client process and answers
+ * with an ack, or with a nack if it can't use the section, in which case both
+ * sides keep using the pipe. The data then goes through the rings and the pipe
+ * is only used to wake up a peer that is waiting for data or space, and to
+ * notice when the peer goes away. */
+
+#define LRPC_SHM_MAGIC      0x4d48534c  /* "LSHM" */
+#define LRPC_SHM_RING_SIZE  0x10000     /* must be a power of 2 */
+#define LRPC_SHM_ACK        0x4b43414c  /* "LACK" */
+#define LRPC_SHM_NACK       0x4b43414e  /* "NACK" */
+
+#define LRPC_WAIT_NONE      0
+#define LRPC_WAIT_DATA      1
+#define LRPC_WAIT_SPACE     2
+
+struct lrpc_shm_ring
+{
+  volatile LONG head;     /* total bytes written, only changed by the writer */
+  volatile LONG tail;     /* total bytes read, only changed by the reader */
+};
+
+struct lrpc_shm
+{
+  UUID cookie;                         /* must match the one in the handshake */
+  struct lrpc_shm_ring ring[2];        /* client to server, server to client */
+  volatile LONG waiting[2];            /* what the client/server is sleeping on */
+  char data[2][LRPC_SHM_RING_SIZE];
+};
+
+struct lrpc_shm_handshake
+{
+  DWORD magic;
+  DWORD ring_size;        /* 0 if the data goes through the pipe */
+  DWORD process_id;       /* client process */
+  DWORD section;          /* section handle in the client process */
+  UUID  cookie;           /* also stored in the section */
+};
+
+static unsigned int lrpc_shm_spin_count = ~0u;
+
+/* the options are a comma-separated list, "shm=no" disables shared memory */
+static BOOL rpcrt4_ncalrpc_shm_enabled(RpcConnection *Connection)
+{
+  static const WCHAR shm_noW[] = {'s','h','m','=','n','o',0};
+  const WCHAR *p = Connection->NetworkOptions;
+  int len = strlenW(shm_noW);
+
+  while (p && *p)
+  {
+    if (!strncmpiW(p, shm_noW, len) && (!p[len] || p[len] == ',')) return FALSE;
+    if ((p = strchrW(p, ','))) p++;
+  }
+  return TRUE;
+}
+
+static RPC_STATUS rpcrt4_ncalrpc_shm_map(RpcConnection_np *npc)
+{
+  if (lrpc_shm_spin_count == ~0u)
+  {
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    /* spinning only helps if the peer can run at the same time */
+    lrpc_shm_spin_count = si.dwNumberOfProcessors > 1 ? 1000 : 0;
+  }
+  npc->shm = MapViewOfFile(npc->shm_section, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(*npc->shm));
+  if (!npc->shm)
+  {
+    WARN("MapViewOfFile failed with error %u\n", GetLastError());
+    CloseHandle(npc->shm_section);
+    npc->shm_section = 0;
+    return RPC_S_OUT_OF_RESOURCES;
+  }
+  return RPC_S_OK;
+}
+
+static void rpcrt4_ncalrpc_shm_unmap(RpcConnection_np *npc)
+{
+  if (npc->shm)
+  {
+    UnmapViewOfFile(npc->shm);
+    npc->shm = NULL;
+  }
+  if (npc->shm_section)
+  {
+    CloseHandle(npc->shm_section);
+    npc->shm_section = 0;
+  }
+}
+
+static RPC_STATUS rpcrt4_ncalrpc_shm_connect(RpcConnection_np *npc)
+{
+  struct lrpc_shm_handshake handshake;
+  DWORD reply;
+
+  memset(&handshake, 0, sizeof(handshake));
+  handshake.magic = LRPC_SHM_MAGIC;
+
+  if (rpcrt4_ncalrpc_shm_enabled(&npc->common))
+  {
+    npc->shm_section = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                          0, sizeof(struct lrpc_shm), NULL);
+    if (npc->shm_section && rpcrt4_ncalrpc_shm_map(npc) == RPC_S_OK)
+    {
+      UuidCreate(&handshake.cookie);
+      npc->shm->cookie = handshake.cookie;
+      handshake.ring_size = LRPC_SHM_RING_SIZE;
+      handshake.process_id = GetCurrentProcessId();
+      handshake.section = HandleToULong(npc->shm_section);
+    }
+  }
+
+  if (rpcrt4_conn_np_write(&npc->common, &handshake, sizeof(handshake)) < 0)
+    return RPC_S_SERVER_UNAVAILABLE;
+  if (!handshake.ring_size)
+  {
+    TRACE("using pipe\n");
+    return RPC_S_OK;
+  }
+
+  /* don't touch the rings until the server has agreed to use them */
+  if (rpcrt4_conn_np_read(&npc->common, &reply, sizeof(reply)) < 0)
+    return RPC_S_SERVER_UNAVAILABLE;
+  if (reply != LRPC_SHM_ACK)
+  {
+    WARN("server refused shared memory (%08x), using pipe\n", reply);
+    rpcrt4_ncalrpc_shm_unmap(npc);
+  }
+  else TRACE("using shared memory\n");
+  return RPC_S_OK;
+}
+
+static RPC_STATUS rpcrt4_ncalrpc_shm_setup(RpcConnection_np *npc,
+                                           const struct lrpc_shm_handshake *handshake)
+{
+  RPC_STATUS status;
+  HANDLE process;
+  BOOL ret;
+
+  if (handshake->ring_size != LRPC_SHM_RING_SIZE)
+  {
+    WARN("unsupported ring size %u\n", handshake->ring_size);
+    return RPC_S_PROTOCOL_ERROR;
+  }
+  TRACE("using section %04x of process %04x\n", handshake->section, handshake->process_id);
+  if (!(process = OpenProcess(PROCESS_DUP_HANDLE, FALSE, handshake->process_id)))
+  {
+    WARN("OpenProcess failed with error %u\n", GetLastError());
+    return RPC_S_OUT_OF_RESOURCES;
+  }
+  ret = DuplicateHandle(process, ULongToHandle(handshake->section), GetCurrentProcess(),
+                        &npc->shm_section, FILE_MAP_READ | FILE_MAP_WRITE, FALSE, 0);
+  CloseHandle(process);
+  if (!ret)
+  {
+    WARN("DuplicateHandle failed with error %u\n", GetLastError());
+    npc->shm_section = 0;
+    return RPC_S_OUT_OF_RESOURCES;
+  }
+  if ((status = rpcrt4_ncalrpc_shm_map(npc)) != RPC_S_OK)
+    return status;
+
+  /* make sure the section was set up by our peer */
+  if (memcmp(&npc->shm->cookie, &handshake->cookie, sizeof(handshake->cookie)))
+  {
+    WARN("section cookie mismatch\n");
+    rpcrt4_ncalrpc_shm_unmap(npc);
+    return RPC_S_PROTOCOL_ERROR;
+  }
+  return RPC_S_OK;
+}
+
+static RPC_STATUS rpcrt4_ncalrpc_shm_accept(RpcConnection_np *npc)
+{
+  struct lrpc_shm_handshake handshake;
+  DWORD reply = LRPC_SHM_ACK;
+
+  if (rpcrt4_conn_np_read(&npc->common, &handshake, sizeof(handshake)) < 0)
+    return RPC_S_CALL_FAILED;
+  if (handshake.magic != LRPC_SHM_MAGIC)
+  {
+    WARN("invalid handshake %08x\n", handshake.magic);
+    return RPC_S_PROTOCOL_ERROR;
+  }
+  npc->handshake_done = TRUE;
+  if (!handshake.ring_size) return RPC_S_OK;
+
+  /* the client waits for our answer, so fall back to the pipe rather than
+   * dropping the connection if we can't use its section */
+  if (rpcrt4_ncalrpc_shm_setup(npc, &handshake) != RPC_S_OK)
+  {
+    rpcrt4_ncalrpc_shm_unmap(npc);
+    reply = LRPC_SHM_NACK;
+  }
+  if (rpcrt4_conn_np_write(&npc->common, &reply, sizeof(reply)) < 0)
+  {
+    rpcrt4_ncalrpc_shm_unmap(npc);
+    return RPC_S_CALL_FAILED;
+  }
+  return RPC_S_OK;
+}
+
+static inline LONG lrpc_shm_get(volatile LONG *ptr)
+{
+  /* also acts as a barrier for the ring contents */
+  return InterlockedCompareExchange((LONG *)ptr, 0, 0);
+}
+
+static inline BOOL lrpc_shm_ready(const struct lrpc_shm_ring *ring, LONG what)
+{
+  if (what == LRPC_WAIT_DATA) return ring->head != ring->tail;
+  return (ULONG)(ring->head - ring->tail) < LRPC_SHM_RING_SIZE;
+}
+
+/* wait until the ring has data or space, sleeping on the pipe if it takes too long */
+static BOOL lrpc_shm_wait(RpcConnection_np *npc, const struct lrpc_shm_ring *ring, LONG what)
+{
+  volatile LONG *waiting = &npc->shm->waiting[npc->common.server ? 1 : 0];
+  IO_STATUS_BLOCK io_status;
+  NTSTATUS status;
+  unsigned int i;
+  char bell;
+
+  for (i = 0; i < lrpc_shm_spin_count; i++)
+  {
+    if (lrpc_shm_ready(ring, what)) return TRUE;
+    YieldProcessor();
+  }
+
+  for (;;)
+  {
+    InterlockedExchange((LONG *)waiting, what);
+    if (lrpc_shm_ready(ring, what)) break;
+    status = NtReadFile(npc->pipe, NULL, NULL, NULL, &io_status, &bell, 1, NULL, NULL);
+    if (status && status != STATUS_BUFFER_OVERFLOW)
+    {
+      InterlockedExchange((LONG *)waiting, LRPC_WAIT_NONE);
+      return FALSE;
+    }
+  }
+  InterlockedExchange((LONG *)waiting, LRPC_WAIT_NONE);
+  return TRUE;
+}
+
+/* wake up the peer if it is sleeping on what we just provided */
+static void lrpc_shm_wake(RpcConnection_np *npc, LONG what)
+{
+  volatile LONG *waiting = &npc->shm->waiting[npc->common.server ? 0 : 1];
+
+  if (InterlockedCompareExchange((LONG *)waiting, LRPC_WAIT_NONE, what) == what)
+    rpcrt4_conn_np_write(&npc->common, "", 1);
+}
+
+static int rpcrt4_conn_ncalrpc_read(RpcConnection *Connection,
+                                    void *buffer, unsigned int count)
+{
+  RpcConnection_np *npc = (RpcConnection_np *) Connection;
+  struct lrpc_shm_ring *ring;
+  const char *data;
+  char *buf = buffer;
+  unsigned int bytes_left = count, pos, len;
+
+  if (Connection->server && !npc->handshake_done &&
+      rpcrt4_ncalrpc_shm_accept(npc) != RPC_S_OK)
+    return -1;
+  if (!npc->shm)
+    return rpcrt4_conn_np_read(Connection, buffer, count);
+
+  ring = &npc->shm->ring[Connection->server ? 0 : 1];
+  data = npc->shm->data[Connection->server ? 0 : 1];
+  while (bytes_left)
+  {
+    if (!lrpc_shm_ready(ring, LRPC_WAIT_DATA) && !lrpc_shm_wait(npc, ring, LRPC_WAIT_DATA))
+      return -1;
+    pos = ring->tail & (LRPC_SHM_RING_SIZE - 1);
+    len = min(bytes_left, (ULONG)(lrpc_shm_get(&ring->head) - ring->tail));
+    len = min(len, LRPC_SHM_RING_SIZE - pos);
+    memcpy(buf, data + pos, len);
+    InterlockedExchangeAdd((LONG *)&ring->tail, len);
+    lrpc_shm_wake(npc, LRPC_WAIT_SPACE);
+    bytes_left -= len;
+    buf += len;
+  }
+  return count;
+}
+
+static int rpcrt4_conn_ncalrpc_write(RpcConnection *Connection,
+                                     const void *buffer, unsigned int count)
+{
+  RpcConnection_np *npc = (RpcConnection_np *) Connection;
+  struct lrpc_shm_ring *ring;
+  char *data;
+  const char *buf = buffer;
+  unsigned int bytes_left = count, pos, len;
+
+  if (!npc->shm)
+    return rpcrt4_conn_np_write(Connection, buffer, count);
+
+  ring = &npc->shm->ring[Connection->server ? 1 : 0];
+  data = npc->shm->data[Connection->server ? 1 : 0];
+  while (bytes_left)
+  {
+    if (!lrpc_shm_ready(ring, LRPC_WAIT_SPACE) && !lrpc_shm_wait(npc, ring, LRPC_WAIT_SPACE))
+      return -1;
+    pos = ring->head & (LRPC_SHM_RING_SIZE - 1);
+    len = min(bytes_left, LRPC_SHM_RING_SIZE - (ULONG)(ring->head - lrpc_shm_get(&ring->tail)));
+    len = min(len, LRPC_SHM_RING_SIZE - pos);
+    memcpy(data + pos, buf, len);
+    InterlockedExchangeAdd((LONG *)&ring->head, len);
+    lrpc_shm_wake(npc, LRPC_WAIT_DATA);
+    bytes_left -= len;
+    buf += len;
+  }
+  return count;
+}
+
+static int rpcrt4_conn_ncalrpc_close(RpcConnection *Connection)
+{
+  RpcConnection_np *npc = (RpcConnection_np *) Connection;
+
+  rpcrt4_conn_np_close(Connection);
+  rpcrt4_ncalrpc_shm_unmap(npc);
+  npc->handshake_done = FALSE;
+  return 0;
+}
+
 static size_t rpcrt4_ncacn_np_get_top_of_tower(unsigned char *tower_data,
                                                const char *networkaddr,
                                                const char *endpoint)
@@ -3428,9 +3766,9 @@ static const struct connection_ops conn_protseq_list[] = {
     rpcrt4_conn_np_alloc,
     rpcrt4_ncalrpc_open,
     rpcrt4_ncalrpc_handoff,
-    rpcrt4_conn_np_read,
-    rpcrt4_conn_np_write,
-    rpcrt4_conn_np_close,
+    rpcrt4_conn_ncalrpc_read,
+    rpcrt4_conn_ncalrpc_write,
+    rpcrt4_conn_ncalrpc_close,
     rpcrt4_conn_np_cancel_call,
     rpcrt4_ncalrpc_np_is_server_listening,
     rpcrt4_conn_np_wait_for_incoming_data,
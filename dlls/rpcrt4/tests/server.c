@@ -825,6 +825,27 @@ void __cdecl s_full_pointer_null_test(int *a, int *b)
     ok(b == NULL, "Expected b to be NULL instead of %p\n", b);
 }
 
+int __cdecl s_flat_copy(flat_t *s, int a[4], flat_t *o, int b[4])
+{
+  int i, sum = s->a + s->b + s->c + s->d;
+
+  o->a = s->d;
+  o->b = s->c;
+  o->c = s->b;
+  o->d = s->a;
+  for (i = 0; i < 4; i++)
+  {
+    b[i] = a[3 - i] * 2;
+    sum += a[i];
+  }
+  return sum;
+}
+
+int __cdecl s_flat_copy_interp(flat_t *s, int a[4], flat_t *o, int b[4], int *p)
+{
+  return s_flat_copy(s, a, o, b) + (p ? *p : 0);
+}
+
 void __cdecl s_stop(void)
 {
   ok(RPC_S_OK == RpcMgmtStopServerListening(NULL), "RpcMgmtStopServerListening\n");
@@ -1543,6 +1564,91 @@ void __cdecl s_authinfo_test(unsigned int protseq, int secure)
     }
 }
 
+static void
+truncated_request_test(unsigned int proc, unsigned int len)
+{
+  RPC_MESSAGE msg;
+  ULONGLONG buffer[8];
+
+  memset(&msg, 0, sizeof(msg));
+  memset(buffer, 0, sizeof(buffer));
+  msg.RpcInterfaceInformation = s_IServer_v0_0_s_ifspec;
+  msg.ProcNum = proc;
+  msg.DataRepresentation = NDR_LOCAL_DATA_REPRESENTATION;
+  msg.Buffer = buffer;
+  msg.BufferLength = len;
+
+  RpcTryExcept
+  {
+    NdrServerCall2(&msg);
+    ok(0, "proc %u: expected an exception\n", proc);
+  }
+  RpcExcept(TRUE)
+  {
+    ok(RpcExceptionCode() == RPC_X_BAD_STUB_DATA, "proc %u: got exception %d\n", proc, RpcExceptionCode());
+  }
+  RpcEndExcept
+}
+
+static void
+plan_tests(void)
+{
+  const RPC_SERVER_INTERFACE *server_if = s_IServer_v0_0_s_ifspec;
+  unsigned int proc = server_if->DispatchTable->DispatchTableCount - 2;
+  flat_t s = {1, -2, 3, 0x12345678}, o1, o2;
+  int a[4] = {5, -6, 7, -8}, b1[4], b2[4], i, ret;
+
+  /* flat_copy goes through a compiled plan, flat_copy_interp through the interpreter */
+  memset(&o1, 0xcc, sizeof(o1));
+  memset(&o2, 0xcc, sizeof(o2));
+  memset(b1, 0xcc, sizeof(b1));
+  memset(b2, 0xcc, sizeof(b2));
+  ret = flat_copy(&s, a, &o1, b1);
+  ok(ret == 0x12345678 + 2 - 2, "got %d\n", ret);
+  ret = flat_copy_interp(&s, a, &o2, b2, NULL);
+  ok(ret == 0x12345678 + 2 - 2, "got %d\n", ret);
+  ok(o1.a == s.d && o1.b == s.c && o1.c == s.b && o1.d == s.a,
+     "got %d %d %d %d\n", o1.a, o1.b, o1.c, o1.d);
+  ok(!memcmp(&o1, &o2, sizeof(o1)), "structures differ\n");
+  for (i = 0; i < 4; i++)
+    ok(b1[i] == a[3 - i] * 2, "%d: got %d\n", i, b1[i]);
+  ok(!memcmp(b1, b2, sizeof(b1)), "arrays differ\n");
+
+  RpcTryExcept
+  {
+    flat_copy(NULL, a, &o1, b1);
+    ok(0, "expected an exception\n");
+  }
+  RpcExcept(TRUE)
+  {
+    ok(RpcExceptionCode() == RPC_X_NULL_REF_POINTER, "got exception %d\n", RpcExceptionCode());
+  }
+  RpcEndExcept
+
+  RpcTryExcept
+  {
+    flat_copy_interp(NULL, a, &o2, b2, NULL);
+    ok(0, "expected an exception\n");
+  }
+  RpcExcept(TRUE)
+  {
+    ok(RpcExceptionCode() == RPC_X_NULL_REF_POINTER, "got exception %d\n", RpcExceptionCode());
+  }
+  RpcEndExcept
+
+  /* the requests are called directly, without a binding */
+  if (strcmp(winetest_platform, "wine"))
+  {
+    skip("not calling the server stubs directly\n");
+    return;
+  }
+  /* the [in] parameters take 28 bytes on the wire */
+  truncated_request_test(proc, 20);
+  truncated_request_test(proc + 1, 20);
+  truncated_request_test(proc, 27);
+  truncated_request_test(proc + 1, 27);
+}
+
 static void
 run_tests(void)
 {
@@ -1551,6 +1657,56 @@ run_tests(void)
   pointer_tests();
   array_tests();
   context_handle_test();
+  plan_tests();
+}
+
+static void
+lrpc_round_trip_test(unsigned char *options)
+{
+  static unsigned char ncalrpc[] = "ncalrpc";
+  static unsigned char guid[] = "00000000-4114-0704-2301-000000000000";
+  RPC_BINDING_HANDLE old_handle = IServer_IfHandle;
+  LARGE_INTEGER freq, start, end;
+  unsigned char *binding;
+  RPC_STATUS status;
+  int i, n = 100000, *x, total = 0;
+
+  status = RpcStringBindingComposeA(NULL, ncalrpc, NULL, guid, options, &binding);
+  ok(status == RPC_S_OK, "RpcStringBindingCompose failed %d\n", status);
+  status = RpcBindingFromStringBindingA(binding, &IServer_IfHandle);
+  ok(status == RPC_S_OK, "RpcBindingFromStringBinding failed %d\n", status);
+  RpcStringFreeA(&binding);
+  if (status != RPC_S_OK)
+  {
+    IServer_IfHandle = old_handle;
+    return;
+  }
+
+  RpcTryExcept
+  {
+    /* large enough to need several fragments and wrap around the transport buffers */
+    x = HeapAlloc(GetProcessHeap(), 0, n * sizeof(*x));
+    for (i = 0; i < n; i++) total += x[i] = i % 7 - 3;
+    ok(sum_conf_array(x, n) == total, "RPC sum_conf_array\n");
+    HeapFree(GetProcessHeap(), 0, x);
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < 2000; i++) if (sum(i, 1) != i + 1) break;
+    QueryPerformanceCounter(&end);
+    ok(i == 2000, "RPC sum failed at %d\n", i);
+    trace("ncalrpc (%s): %d round trips, %.1f us each\n", options ? (char *)options : "default", i,
+          (end.QuadPart - start.QuadPart) * 1000000.0 / freq.QuadPart / max(i, 1));
+  }
+  RpcExcept(TRUE)
+  {
+    win_skip("ncalrpc round trips with options %s failed with exception %d\n",
+             options ? (char *)options : "(null)", RpcExceptionCode());
+  }
+  RpcEndExcept
+
+  RpcBindingFree(&IServer_IfHandle);
+  IServer_IfHandle = old_handle;
 }
 
 static void
@@ -1600,6 +1756,7 @@ client(const char *test)
   static unsigned char port[] = PORT;
   static unsigned char pipe[] = PIPE;
   static unsigned char guid[] = "00000000-4114-0704-2301-000000000000";
+  static unsigned char shm_no[] = "shm=no";
 
   unsigned char *binding;
 
@@ -1635,6 +1792,10 @@ client(const char *test)
     run_tests(); /* can cause RPC_X_BAD_STUB_DATA exception */
     authinfo_test(RPC_PROTSEQ_LRPC, 0);
     test_is_server_listening(IServer_IfHandle, RPC_S_OK);
+    lrpc_round_trip_test(NULL);
+    /* Wine-only option forcing the named pipe transport */
+    if (!strcmp(winetest_platform, "wine"))
+      lrpc_round_trip_test(shm_no);
 
     ok(RPC_S_OK == RpcStringFreeA(&binding), "RpcStringFree\n");
     ok(RPC_S_OK == RpcBindingFree(&IServer_IfHandle), "RpcBindingFree\n");
@@ -243,16 +243,19 @@ BOOL WINAPI DECLSPEC_HOTPATCH GetCursorPos( POINT *pt )
 
     if (!pt) return FALSE;
 
-    SERVER_START_REQ( set_cursor )
+    if (!(ret = get_shared_cursor_pos( pt, &last_change )))
     {
-        if ((ret = !wine_server_call( req )))
+        SERVER_START_REQ( set_cursor )
         {
-            pt->x = reply->new_x;
-            pt->y = reply->new_y;
-            last_change = reply->last_change;
+            if ((ret = !wine_server_call( req )))
+            {
+                pt->x = reply->new_x;
+                pt->y = reply->new_y;
+                last_change = reply->last_change;
+            }
         }
+        SERVER_END_REQ;
     }
-    SERVER_END_REQ;
 
     /* query new position from graphics driver if we haven't updated recently */
     if (ret && GetTickCount() - last_change > 100) ret = USER_Driver->pGetCursorPos( pt );
@@ -422,6 +425,7 @@ SHORT WINAPI DECLSPEC_HOTPATCH GetAsyncKeyState( INT key )
  */
 DWORD WINAPI GetQueueStatus( UINT flags )
 {
+    UINT wake_bits, changed_bits;
     DWORD ret;
 
     if (flags & ~(QS_ALLINPUT | QS_ALLPOSTMESSAGE | QS_SMRESULT))
@@ -432,6 +436,9 @@ DWORD WINAPI GetQueueStatus( UINT flags )
 
     check_for_events( flags );
 
+    if (get_shared_queue_bits( flags, &wake_bits, &changed_bits ))
+        return MAKELONG( changed_bits & flags, wake_bits & flags );
+
     SERVER_START_REQ( get_queue_status )
     {
         req->clear_bits = flags;
@@ -448,10 +455,13 @@ DWORD WINAPI GetQueueStatus( UINT flags )
  */
 BOOL WINAPI GetInputState(void)
 {
+    UINT wake_bits, changed_bits;
     DWORD ret;
 
     check_for_events( QS_INPUT );
 
+    if (get_shared_queue_bits( 0, &wake_bits, &changed_bits )) return wake_bits & (QS_KEY | QS_MOUSEBUTTON);
+
     SERVER_START_REQ( get_queue_status )
     {
         req->clear_bits = 0;
@@ -772,14 +782,19 @@ BOOL WINAPI AttachThreadInput( DWORD from, DWORD to, BOOL attach )
 SHORT WINAPI DECLSPEC_HOTPATCH GetKeyState(INT vkey)
 {
     SHORT retval = 0;
+    BYTE keystate[256];
 
-    SERVER_START_REQ( get_key_state )
+    if (get_shared_key_state( keystate )) retval = (signed char)keystate[vkey & 0xff];
+    else
     {
-        req->tid = GetCurrentThreadId();
-        req->key = vkey;
-        if (!wine_server_call( req )) retval = (signed char)reply->state;
+        SERVER_START_REQ( get_key_state )
+        {
+            req->tid = GetCurrentThreadId();
+            req->key = vkey;
+            if (!wine_server_call( req )) retval = (signed char)reply->state;
+        }
+        SERVER_END_REQ;
     }
-    SERVER_END_REQ;
     TRACE("key (0x%x) -> %x\n", vkey, retval);
     return retval;
 }
@@ -794,6 +809,8 @@ BOOL WINAPI DECLSPEC_HOTPATCH GetKeyboardState( LPBYTE state )
 
     TRACE("(%p)\n", state);
 
+    if (get_shared_key_state( state )) return TRUE;
+
     memset( state, 0, 256 );
     SERVER_START_REQ( get_key_state )
     {
@@ -2723,6 +2723,280 @@ static inline void call_sendmsg_callback( SENDASYNCPROC callback, HWND hwnd, UIN
 }
 
 
+/* state published by the server in shared memory */
+struct user_shared_memory
+{
+    const queue_shm_t   *queue;         /* queue state of the thread */
+    const input_shm_t   *input;         /* key state of the thread input */
+    unsigned int         input_id;      /* id of the mapped thread input */
+    const desktop_shm_t *desktop;       /* cursor state of the thread desktop */
+    DWORD                last_request;  /* time of the last get_message request */
+    BOOL                 pending;       /* did the last get_message request find nothing? */
+    HWND                 pending_hwnd;  /* parameters of that request */
+    UINT                 pending_first;
+    UINT                 pending_last;
+    UINT                 pending_flags;
+};
+
+/* force a get_message request at least this often, to keep the hung state and hooks up to date */
+#define MAX_SKIPPED_REQUEST_TIME 500
+
+static inline void shared_memory_barrier(void)
+{
+#ifdef __GNUC__
+    __sync_synchronize();
+#else
+    LONG dummy;
+    InterlockedExchange( &dummy, 0 );
+#endif
+}
+
+/* read a block of shared memory, retrying while the server is updating it */
+static void read_shared_memory( const void *shared, const volatile unsigned int *seq, void *data, size_t size )
+{
+    unsigned int start;
+
+    for (;;)
+    {
+        while ((start = *seq) & 1) Sleep( 0 );
+        shared_memory_barrier();
+        memcpy( data, shared, size );
+        shared_memory_barrier();
+        if (*seq == start) return;
+    }
+}
+
+/* desktop shared memory sections mapped in the process, they stay mapped until it exits */
+struct shared_section
+{
+    struct shared_section *next;
+    unsigned int           id;     /* unique id of the section */
+    const char            *base;   /* address of the view */
+};
+
+static struct shared_section *shared_sections;
+
+static CRITICAL_SECTION shared_section_cs;
+static CRITICAL_SECTION_DEBUG shared_section_cs_debug =
+{
+    0, 0, &shared_section_cs,
+    { &shared_section_cs_debug.ProcessLocksList, &shared_section_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": shared_section_cs") }
+};
+static CRITICAL_SECTION shared_section_cs = { &shared_section_cs_debug, -1, 0, 0, 0, 0 };
+
+/* return the view of a desktop shared memory section, mapping it on first use */
+static const char *get_shared_section( unsigned int id, HANDLE handle )
+{
+    struct shared_section *section;
+    const char *base = NULL;
+
+    EnterCriticalSection( &shared_section_cs );
+    for (section = shared_sections; section; section = section->next)
+        if (section->id == id) break;
+    if (section) base = section->base;
+    else if ((section = HeapAlloc( GetProcessHeap(), 0, sizeof(*section) )))
+    {
+        if ((base = MapViewOfFile( handle, FILE_MAP_READ, 0, 0, 0 )))
+        {
+            section->id   = id;
+            section->base = base;
+            section->next = shared_sections;
+            shared_sections = section;
+        }
+        else HeapFree( GetProcessHeap(), 0, section );
+    }
+    LeaveCriticalSection( &shared_section_cs );
+    return base;
+}
+
+/* return a read-only pointer to some state of the server */
+static const void *map_shared_memory( int type, unsigned int *id )
+{
+    const char *base = NULL;
+    unsigned int section_id = 0, offset = 0;
+    HANDLE handle = 0;
+
+    SERVER_START_REQ( get_shared_memory )
+    {
+        req->type = type;
+        if (!wine_server_call( req ))
+        {
+            handle     = wine_server_ptr_handle( reply->handle );
+            section_id = reply->section_id;
+            offset     = reply->offset;
+            if (id) *id = reply->id;
+        }
+    }
+    SERVER_END_REQ;
+
+    if (!handle) return NULL;
+    base = get_shared_section( section_id, handle );
+    CloseHandle( handle );
+    return base ? base + offset : NULL;
+}
+
+static struct user_shared_memory *get_shared_memory(void)
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+
+    if (!thread_info->shared_memory)
+        thread_info->shared_memory = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                                sizeof(*thread_info->shared_memory) );
+    return thread_info->shared_memory;
+}
+
+/* retrieve the queue state, mapping it if needed; this creates the server queue */
+static BOOL get_shared_queue_state( queue_shm_t *state )
+{
+    struct user_shared_memory *shared = get_shared_memory();
+
+    if (!shared) return FALSE;
+    if (!shared->queue && !(shared->queue = map_shared_memory( SHARED_MEMORY_QUEUE, NULL ))) return FALSE;
+    read_shared_memory( shared->queue, &shared->queue->seq, state, sizeof(*state) );
+    return TRUE;
+}
+
+/***********************************************************************
+ *           get_shared_key_state
+ *
+ * Retrieve the key state of the thread input from shared memory.
+ * Return FALSE if the queue state hasn't been mapped yet, so as not to create a queue.
+ */
+BOOL get_shared_key_state( BYTE *keystate )
+{
+    struct user_shared_memory *shared = get_user_thread_info()->shared_memory;
+    queue_shm_t queue;
+    input_shm_t input;
+    unsigned int id;
+
+    if (!shared || !shared->queue) return FALSE;
+    read_shared_memory( shared->queue, &shared->queue->seq, &queue, sizeof(queue) );
+    if (!shared->input || shared->input_id != queue.input_id)
+    {
+        shared->input = NULL;
+        if (!(shared->input = map_shared_memory( SHARED_MEMORY_INPUT, &id ))) return FALSE;
+        shared->input_id = id;
+        /* the thread input may have changed again while we were mapping it */
+        read_shared_memory( shared->queue, &shared->queue->seq, &queue, sizeof(queue) );
+        if (id != queue.input_id) return FALSE;
+    }
+    read_shared_memory( shared->input, &shared->input->seq, &input, sizeof(input) );
+    /* the block is reused once the thread input is gone */
+    if (input.id != shared->input_id) return FALSE;
+    memcpy( keystate, input.keystate, sizeof(input.keystate) );
+    return TRUE;
+}
+
+/***********************************************************************
+ *           get_shared_queue_bits
+ *
+ * Retrieve the queue status bits from shared memory, if this can be done
+ * without a server call. Changed bits in clear_bits have to be cleared by
+ * the server, so none of them may be set.
+ */
+BOOL get_shared_queue_bits( UINT clear_bits, UINT *wake_bits, UINT *changed_bits )
+{
+    struct user_shared_memory *shared = get_user_thread_info()->shared_memory;
+    queue_shm_t queue;
+
+    if (!shared || !shared->queue) return FALSE;
+    read_shared_memory( shared->queue, &shared->queue->seq, &queue, sizeof(queue) );
+    if (queue.changed_bits & clear_bits) return FALSE;
+    *wake_bits = queue.wake_bits;
+    *changed_bits = queue.changed_bits;
+    return TRUE;
+}
+
+/***********************************************************************
+ *           get_shared_cursor_pos
+ *
+ * Retrieve the cursor position of the thread desktop from shared memory.
+ */
+BOOL get_shared_cursor_pos( POINT *pt, DWORD *last_change )
+{
+    struct user_shared_memory *shared = get_shared_memory();
+    desktop_shm_t desktop;
+
+    if (!shared) return FALSE;
+    if (!shared->desktop && !(shared->desktop = map_shared_memory( SHARED_MEMORY_DESKTOP, NULL )))
+        return FALSE;
+    read_shared_memory( shared->desktop, &shared->desktop->seq, &desktop, sizeof(desktop) );
+    pt->x = desktop.cursor_x;
+    pt->y = desktop.cursor_y;
+    *last_change = desktop.cursor_last_change;
+    return TRUE;
+}
+
+/***********************************************************************
+ *           reset_shared_desktop
+ *
+ * Drop the desktop state mapping after the thread desktop changed.
+ */
+void reset_shared_desktop(void)
+{
+    struct user_shared_memory *shared = get_user_thread_info()->shared_memory;
+
+    if (shared) shared->desktop = NULL;
+}
+
+/***********************************************************************
+ *           free_shared_memory
+ */
+void free_shared_memory(void)
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    struct user_shared_memory *shared = thread_info->shared_memory;
+
+    if (!shared) return;
+    HeapFree( GetProcessHeap(), 0, shared );
+    thread_info->shared_memory = NULL;
+}
+
+/***********************************************************************
+ *           can_skip_get_message
+ *
+ * Check from the shared queue state whether a get_message request would find nothing,
+ * in which case it is not worth a server round-trip.
+ */
+static BOOL can_skip_get_message( HWND hwnd, UINT first, UINT last, UINT flags, UINT changed_mask )
+{
+    struct user_shared_memory *shared;
+    queue_shm_t state;
+    UINT filter = flags >> 16;
+
+    if (!get_shared_queue_state( &state )) return FALSE;
+    shared = get_user_thread_info()->shared_memory;
+    if (GetTickCount() - shared->last_request > MAX_SKIPPED_REQUEST_TIME) return FALSE;
+
+    if (!filter) filter = QS_ALLINPUT;
+    if (hwnd == HWND_TOPMOST) return FALSE;  /* the server signals the idle event */
+    if (state.wake_bits & QS_SENDMESSAGE) return FALSE;
+    if (state.changed_bits & filter & ~QS_SENDMESSAGE) return FALSE;
+    /* the server would have to update the masks it waits on */
+    if (state.wake_mask != (changed_mask & (QS_SENDMESSAGE | QS_SMRESULT))) return FALSE;
+    if (state.changed_mask != changed_mask) return FALSE;
+    if (!(state.wake_bits & filter)) return TRUE;
+    /* some messages are queued, but nothing changed since they didn't match the same request */
+    return shared->pending && shared->pending_hwnd == hwnd && shared->pending_first == first &&
+           shared->pending_last == last && shared->pending_flags == flags;
+}
+
+/* remember the outcome of a get_message request */
+static void set_get_message_result( HWND hwnd, UINT first, UINT last, UINT flags, BOOL pending )
+{
+    struct user_shared_memory *shared = get_user_thread_info()->shared_memory;
+
+    if (!shared) return;
+    shared->last_request  = GetTickCount();
+    shared->pending       = pending;
+    shared->pending_hwnd  = hwnd;
+    shared->pending_first = first;
+    shared->pending_last  = last;
+    shared->pending_flags = flags;
+}
+
+
 /***********************************************************************
  *           peek_message
  *
@@ -2749,6 +3023,14 @@ static BOOL peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags
         size_t size = 0;
         const message_data_t *msg_data = buffer;
 
+        if (!hw_id && can_skip_get_message( hwnd, first, last, flags, changed_mask ))
+        {
+            HeapFree( GetProcessHeap(), 0, buffer );
+            thread_info->wake_mask = changed_mask & (QS_SENDMESSAGE | QS_SMRESULT);
+            thread_info->changed_mask = changed_mask;
+            return FALSE;
+        }
+
         SERVER_START_REQ( get_message )
         {
             req->flags     = flags;
@@ -2777,6 +3059,9 @@ static BOOL peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags
         }
         SERVER_END_REQ;
 
+        if (res != STATUS_BUFFER_OVERFLOW)
+            set_get_message_result( hwnd, first, last, flags, res == STATUS_PENDING );
+
         if (res)
         {
             HeapFree( GetProcessHeap(), 0, buffer );
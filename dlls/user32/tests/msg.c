@@ -11136,6 +11136,104 @@ static void test_PeekMessage3(void)
     flush_events();
 }
 
+static DWORD WINAPI post_thread_message_proc(void *arg)
+{
+    PostThreadMessageA(GetWindowThreadProcessId(arg, NULL), WM_USER + 1, 0, 0);
+    return 0;
+}
+
+static void post_from_thread(HWND hwnd)
+{
+    HANDLE thread = CreateThread(NULL, 0, post_thread_message_proc, hwnd, 0, NULL);
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+/* state read repeatedly while nothing changes, as done by busy message loops */
+static void test_PeekMessage4(void)
+{
+    BYTE keystate[256], old_keystate[256];
+    POINT pt, old_pt;
+    DWORD qstatus;
+    HWND hwnd;
+    MSG msg;
+    BOOL ret;
+    int i;
+
+    hwnd = CreateWindowA("TestWindowClass", NULL, WS_OVERLAPPEDWINDOW, 100, 100, 200, 200, 0, 0, 0, NULL);
+    ok(hwnd != NULL, "CreateWindow failed\n");
+    flush_events();
+    GetQueueStatus(QS_ALLINPUT);
+
+    for (i = 0; i < 100; i++)
+    {
+        ret = PeekMessageA(&msg, 0, 0, 0, PM_REMOVE);
+        ok(!ret, "%d: got message %04x\n", i, msg.message);
+        if (ret) break;
+    }
+    qstatus = GetQueueStatus(QS_ALLINPUT);
+    ok(qstatus == 0, "wrong qstatus %08x\n", qstatus);
+
+    /* a message posted by another thread is seen right away */
+    post_from_thread(hwnd);
+    qstatus = GetQueueStatus(QS_ALLINPUT);
+    ok(qstatus == MAKELONG(QS_POSTMESSAGE, QS_POSTMESSAGE), "wrong qstatus %08x\n", qstatus);
+    qstatus = GetQueueStatus(QS_ALLINPUT);
+    ok(qstatus == MAKELONG(0, QS_POSTMESSAGE), "wrong qstatus %08x\n", qstatus);
+    qstatus = GetQueueStatus(QS_TIMER);
+    ok(qstatus == 0, "wrong qstatus %08x\n", qstatus);
+
+    /* nothing matches the filter, the posted message stays queued */
+    for (i = 0; i < 10; i++)
+    {
+        ret = PeekMessageA(&msg, 0, WM_USER + 2, WM_USER + 2, PM_REMOVE);
+        ok(!ret, "%d: got message %04x\n", i, msg.message);
+        if (ret) break;
+    }
+    qstatus = GetQueueStatus(QS_ALLINPUT);
+    ok(qstatus == MAKELONG(0, QS_POSTMESSAGE), "wrong qstatus %08x\n", qstatus);
+
+    /* the same filter again after another post */
+    post_from_thread(hwnd);
+    ret = PeekMessageA(&msg, 0, WM_USER + 2, WM_USER + 2, PM_REMOVE);
+    ok(!ret, "got message %04x\n", msg.message);
+    ret = PeekMessageA(&msg, 0, WM_USER + 1, WM_USER + 1, PM_REMOVE);
+    ok(ret && msg.message == WM_USER + 1, "expected WM_USER + 1, got %04x\n", ret ? msg.message : 0);
+    ret = PeekMessageA(&msg, 0, WM_USER + 1, WM_USER + 1, PM_REMOVE);
+    ok(ret && msg.message == WM_USER + 1, "expected WM_USER + 1, got %04x\n", ret ? msg.message : 0);
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_REMOVE);
+    ok(!ret, "got message %04x\n", msg.message);
+    qstatus = GetQueueStatus(QS_ALLINPUT);
+    ok(qstatus == 0, "wrong qstatus %08x\n", qstatus);
+
+    /* key state changes are visible to the next GetKeyState call */
+    GetKeyboardState(old_keystate);
+    memcpy(keystate, old_keystate, sizeof(keystate));
+    keystate['X'] = 0x80;
+    SetKeyboardState(keystate);
+    ok(GetKeyState('X') & 0x8000, "'X' isn't down\n");
+    memset(keystate, 0, sizeof(keystate));
+    GetKeyboardState(keystate);
+    ok(keystate['X'] == 0x80, "wrong state %02x\n", keystate['X']);
+    keystate['X'] = 0;
+    SetKeyboardState(keystate);
+    ok(!(GetKeyState('X') & 0x8000), "'X' is down\n");
+    SetKeyboardState(old_keystate);
+
+    /* and so are cursor moves */
+    GetCursorPos(&old_pt);
+    SetCursorPos(120, 130);
+    GetCursorPos(&pt);
+    ok(pt.x == 120 && pt.y == 130, "wrong cursor pos %d,%d\n", pt.x, pt.y);
+    SetCursorPos(140, 150);
+    GetCursorPos(&pt);
+    ok(pt.x == 140 && pt.y == 150, "wrong cursor pos %d,%d\n", pt.x, pt.y);
+    SetCursorPos(old_pt.x, old_pt.y);
+
+    DestroyWindow(hwnd);
+    flush_events();
+}
+
 static INT_PTR CALLBACK wm_quit_dlg_proc(HWND hwnd, UINT message, WPARAM wp, LPARAM lp)
 {
     struct recvd_message msg;
@@ -16067,6 +16165,7 @@ START_TEST(msg)
     test_PeekMessage();
     test_PeekMessage2();
     test_PeekMessage3();
+    test_PeekMessage4();
     test_WaitForInputIdle( test_argv[0] );
     test_scrollwindowex();
     test_messages();
@@ -185,6 +185,7 @@ struct user_thread_info
     HWND                          top_window;             /* Desktop window */
     HWND                          msg_window;             /* HWND_MESSAGE parent window */
     RAWINPUT                     *rawinput;
+    struct user_shared_memory    *shared_memory;          /* Server state mapped in shared memory */
 };
 
 C_ASSERT( sizeof(struct user_thread_info) <= sizeof(((TEB *)0)->Win32ClientInfo) );
@@ -238,6 +239,11 @@ extern LRESULT call_current_hook( HHOOK hhook, INT code, WPARAM wparam, LPARAM l
 extern DWORD get_input_codepage( void ) DECLSPEC_HIDDEN;
 extern BOOL map_wparam_AtoW( UINT message, WPARAM *wparam, enum wm_char_mapping mapping ) DECLSPEC_HIDDEN;
 extern NTSTATUS send_hardware_message( HWND hwnd, const INPUT *input, UINT flags ) DECLSPEC_HIDDEN;
+extern BOOL get_shared_key_state( BYTE *keystate ) DECLSPEC_HIDDEN;
+extern BOOL get_shared_queue_bits( UINT clear_bits, UINT *wake_bits, UINT *changed_bits ) DECLSPEC_HIDDEN;
+extern BOOL get_shared_cursor_pos( POINT *pt, DWORD *last_change ) DECLSPEC_HIDDEN;
+extern void reset_shared_desktop(void) DECLSPEC_HIDDEN;
+extern void free_shared_memory(void) DECLSPEC_HIDDEN;
 extern LRESULT MSG_SendInternalMessageTimeout( DWORD dest_pid, DWORD dest_tid,
                                                UINT msg, WPARAM wparam, LPARAM lparam,
                                                UINT flags, UINT timeout, PDWORD_PTR res_ptr ) DECLSPEC_HIDDEN;
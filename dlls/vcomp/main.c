@@ -59,6 +59,9 @@ static RTL_CRITICAL_SECTION vcomp_section = { &critsect_debug, -1, 0, 0, 0, 0 };
 #define VCOMP_DYNAMIC_FLAGS_GUIDED      0x03
 #define VCOMP_DYNAMIC_FLAGS_INCREMENT   0x40
 
+/* fan-in of the barrier combining tree */
+#define VCOMP_BARRIER_ARITY             4
+
 struct vcomp_thread_data
 {
     struct vcomp_team_data  *team;
@@ -82,6 +85,31 @@ struct vcomp_thread_data
     unsigned int            dynamic_type;
     unsigned int            dynamic_begin;
     unsigned int            dynamic_end;
+
+    /* chunked loop parameters, identical for all threads of the team */
+    unsigned int            dynamic_first;
+    unsigned int            dynamic_last;
+    unsigned int            dynamic_iterations;
+    int                     dynamic_step;
+    unsigned int            dynamic_chunksize;
+    unsigned int            dynamic_chunks;
+
+    /* chunks owned by this thread, other threads steal from the end */
+    SRWLOCK                 chunk_lock;
+    unsigned int            chunk_dynamic;
+    unsigned int            chunk_begin;
+    unsigned int            chunk_end;
+
+    /* stolen chunks which could not be published, only used by the owner */
+    unsigned int            stash_begin;
+    unsigned int            stash_end;
+};
+
+struct vcomp_barrier_node
+{
+    LONG                    count;
+    LONG                    expected;
+    int                     parent;
 };
 
 struct vcomp_team_data
@@ -89,6 +117,7 @@ struct vcomp_team_data
     CONDITION_VARIABLE      cond;
     int                     num_threads;
     int                     finished_threads;
+    struct vcomp_thread_data **threads;
 
     /* callback arguments */
     int                     nargs;
@@ -96,8 +125,8 @@ struct vcomp_team_data
     __ms_va_list            valist;
 
     /* barrier */
-    unsigned int            barrier;
-    int                     barrier_count;
+    LONG                    barrier;
+    struct vcomp_barrier_node *barrier_nodes;
 };
 
 struct vcomp_task_data
@@ -374,6 +403,12 @@ static struct vcomp_thread_data *vcomp_init_thread_data(void)
     thread_data->section        = 1;
     thread_data->dynamic        = 1;
     thread_data->dynamic_type   = 0;
+    InitializeSRWLock(&thread_data->chunk_lock);
+    thread_data->chunk_dynamic  = 1;
+    thread_data->chunk_begin    = 0;
+    thread_data->chunk_end      = 0;
+    thread_data->stash_begin    = 0;
+    thread_data->stash_end      = 0;
 
     vcomp_set_thread_data(thread_data);
     return thread_data;
@@ -1006,29 +1041,71 @@ void CDECL _vcomp_flush(void)
     TRACE("(): stub\n");
 }
 
+static int vcomp_barrier_size(int num_threads)
+{
+    int count = 0;
+
+    do
+    {
+        num_threads = (num_threads + VCOMP_BARRIER_ARITY - 1) / VCOMP_BARRIER_ARITY;
+        count += num_threads;
+    }
+    while (num_threads > 1);
+
+    return count;
+}
+
+/* Builds the combining tree: level 0 has one node per VCOMP_BARRIER_ARITY
+ * threads, each further level one node per VCOMP_BARRIER_ARITY nodes below. */
+static void vcomp_barrier_init(struct vcomp_barrier_node *nodes, int num_threads)
+{
+    int level = 0, width = num_threads, count, i;
+
+    do
+    {
+        count = (width + VCOMP_BARRIER_ARITY - 1) / VCOMP_BARRIER_ARITY;
+        for (i = 0; i < count; i++)
+        {
+            nodes[level + i].count      = 0;
+            nodes[level + i].expected   = min(VCOMP_BARRIER_ARITY, width - i * VCOMP_BARRIER_ARITY);
+            nodes[level + i].parent     = (count > 1) ? level + count + i / VCOMP_BARRIER_ARITY : -1;
+        }
+        level += count;
+        width  = count;
+    }
+    while (count > 1);
+}
+
 void CDECL _vcomp_barrier(void)
 {
-    struct vcomp_team_data *team_data = vcomp_init_thread_data()->team;
+    struct vcomp_thread_data *thread_data = vcomp_init_thread_data();
+    struct vcomp_team_data *team_data = thread_data->team;
+    struct vcomp_barrier_node *node;
+    LONG barrier;
 
     TRACE("()\n");
 
-    if (!team_data)
+    if (!team_data || team_data->num_threads == 1)
         return;
 
-    EnterCriticalSection(&vcomp_section);
-    if (++team_data->barrier_count >= team_data->num_threads)
-    {
-        team_data->barrier++;
-        team_data->barrier_count = 0;
-        WakeAllConditionVariable(&team_data->cond);
-    }
-    else
+    /* the last thread to arrive at a node continues to the parent node,
+     * the last one at the root releases all threads of the team */
+    barrier = team_data->barrier;
+    node = &team_data->barrier_nodes[thread_data->thread_num / VCOMP_BARRIER_ARITY];
+    while (InterlockedIncrement(&node->count) == node->expected)
     {
-        unsigned int barrier = team_data->barrier;
-        while (team_data->barrier == barrier)
-            SleepConditionVariableCS(&team_data->cond, &vcomp_section, INFINITE);
+        node->count = 0;
+        if (node->parent < 0)
+        {
+            InterlockedIncrement(&team_data->barrier);
+            WakeByAddressAll(&team_data->barrier);
+            return;
+        }
+        node = &team_data->barrier_nodes[node->parent];
     }
-    LeaveCriticalSection(&vcomp_section);
+
+    while (team_data->barrier == barrier)
+        WaitOnAddress(&team_data->barrier, &barrier, sizeof(barrier), INFINITE);
 }
 
 void CDECL _vcomp_set_num_threads(int num_threads)
@@ -1232,6 +1309,102 @@ void CDECL _vcomp_for_static_end(void)
     /* nothing to do here */
 }
 
+/* Chunked loops are scheduled with per-thread ranges of chunks. Every thread
+ * starts with an equal share and takes chunks from the beginning of its range,
+ * idle threads steal half of the remaining chunks from the end of the range of
+ * another thread. The caller must hold target->chunk_lock. */
+static void vcomp_init_chunks(struct vcomp_thread_data *thread_data,
+                              struct vcomp_thread_data *target, int num_threads)
+{
+    DWORD64 num_chunks = thread_data->dynamic_chunks;
+
+    target->chunk_dynamic   = thread_data->dynamic;
+    target->chunk_begin     = num_chunks * target->thread_num / num_threads;
+    target->chunk_end       = num_chunks * (target->thread_num + 1) / num_threads;
+}
+
+static BOOL vcomp_steal_chunks(struct vcomp_thread_data *thread_data, struct vcomp_thread_data *victim,
+                               unsigned int *begin, unsigned int *end)
+{
+    unsigned int count;
+    BOOL ret = FALSE;
+
+    AcquireSRWLockExclusive(&victim->chunk_lock);
+
+    /* if the victim did not reach the current loop yet, hand out its share on its behalf */
+    if (thread_data->dynamic - victim->chunk_dynamic == 1 && victim->chunk_begin == victim->chunk_end)
+        vcomp_init_chunks(thread_data, victim, thread_data->team->num_threads);
+
+    if (victim->chunk_dynamic == thread_data->dynamic &&
+        (count = victim->chunk_end - victim->chunk_begin))
+    {
+        *end = victim->chunk_end;
+        victim->chunk_end -= (count + 1) / 2;
+        *begin = victim->chunk_end;
+        ret = TRUE;
+    }
+
+    ReleaseSRWLockExclusive(&victim->chunk_lock);
+    return ret;
+}
+
+static BOOL vcomp_next_chunk(struct vcomp_thread_data *thread_data, unsigned int *chunk)
+{
+    struct vcomp_team_data *team_data = thread_data->team;
+    unsigned int begin, end;
+    int i;
+
+    if (thread_data->stash_begin != thread_data->stash_end)
+    {
+        *chunk = thread_data->stash_begin++;
+        return TRUE;
+    }
+
+    AcquireSRWLockExclusive(&thread_data->chunk_lock);
+    if (thread_data->chunk_dynamic == thread_data->dynamic &&
+        thread_data->chunk_begin != thread_data->chunk_end)
+    {
+        *chunk = thread_data->chunk_begin++;
+        ReleaseSRWLockExclusive(&thread_data->chunk_lock);
+        return TRUE;
+    }
+    ReleaseSRWLockExclusive(&thread_data->chunk_lock);
+
+    if (!team_data)
+        return FALSE;
+
+    for (i = 1; i < team_data->num_threads; i++)
+    {
+        struct vcomp_thread_data *victim;
+
+        victim = team_data->threads[(thread_data->thread_num + i) % team_data->num_threads];
+        if (!vcomp_steal_chunks(thread_data, victim, &begin, &end))
+            continue;
+
+        *chunk = begin++;
+        if (begin != end)
+        {
+            /* publish the remaining chunks, unless our range was already
+             * handed out for the next loop by another thread */
+            AcquireSRWLockExclusive(&thread_data->chunk_lock);
+            if (thread_data->chunk_dynamic == thread_data->dynamic)
+            {
+                thread_data->chunk_begin = begin;
+                thread_data->chunk_end   = end;
+            }
+            else
+            {
+                thread_data->stash_begin = begin;
+                thread_data->stash_end   = end;
+            }
+            ReleaseSRWLockExclusive(&thread_data->chunk_lock);
+        }
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
 void CDECL _vcomp_for_dynamic_init(unsigned int flags, unsigned int first, unsigned int last,
                                    int step, unsigned int chunksize)
 {
@@ -1287,6 +1460,28 @@ void CDECL _vcomp_for_dynamic_init(unsigned int flags, unsigned int first, unsig
             type = VCOMP_DYNAMIC_FLAGS_GUIDED;
         }
 
+        if (type == VCOMP_DYNAMIC_FLAGS_CHUNKED)
+        {
+            if (chunksize < 1)
+                chunksize = 1;
+
+            thread_data->dynamic++;
+            thread_data->dynamic_type       = type;
+            thread_data->dynamic_first      = first;
+            thread_data->dynamic_last       = last;
+            thread_data->dynamic_iterations = iterations;
+            thread_data->dynamic_step       = step;
+            thread_data->dynamic_chunksize  = chunksize;
+            thread_data->dynamic_chunks     = ((DWORD64)iterations + chunksize - 1) / chunksize;
+
+            /* another thread might already have handed out our share */
+            AcquireSRWLockExclusive(&thread_data->chunk_lock);
+            if ((int)(thread_data->dynamic - thread_data->chunk_dynamic) > 0)
+                vcomp_init_chunks(thread_data, thread_data, num_threads);
+            ReleaseSRWLockExclusive(&thread_data->chunk_lock);
+            return;
+        }
+
         EnterCriticalSection(&vcomp_section);
         thread_data->dynamic++;
         thread_data->dynamic_type = type;
@@ -1319,8 +1514,23 @@ int CDECL _vcomp_for_dynamic_next(unsigned int *begin, unsigned int *end)
         thread_data->dynamic_type = 0;
         return 1;
     }
-    else if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_CHUNKED ||
-             thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_GUIDED)
+    else if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_CHUNKED)
+    {
+        unsigned int chunk, offset, iterations;
+
+        if (!vcomp_next_chunk(thread_data, &chunk))
+            return 0;
+
+        offset      = chunk * thread_data->dynamic_chunksize;
+        iterations  = min(thread_data->dynamic_iterations - offset, thread_data->dynamic_chunksize);
+        *begin      = thread_data->dynamic_first + offset * thread_data->dynamic_step;
+        if (offset + iterations == thread_data->dynamic_iterations)
+            *end    = thread_data->dynamic_last;
+        else
+            *end    = *begin + (iterations - 1) * thread_data->dynamic_step;
+        return 1;
+    }
+    else if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_GUIDED)
     {
         unsigned int iterations = 0;
         EnterCriticalSection(&vcomp_section);
@@ -1417,11 +1627,12 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
     InitializeConditionVariable(&team_data.cond);
     team_data.num_threads       = 1;
     team_data.finished_threads  = 0;
+    team_data.threads           = NULL;
     team_data.nargs             = nargs;
     team_data.wrapper           = wrapper;
     __ms_va_start(team_data.valist, wrapper);
     team_data.barrier           = 0;
-    team_data.barrier_count     = 0;
+    team_data.barrier_nodes     = NULL;
 
     task_data.single            = 0;
     task_data.section           = 0;
@@ -1436,13 +1647,32 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
     thread_data.section         = 1;
     thread_data.dynamic         = 1;
     thread_data.dynamic_type    = 0;
+    InitializeSRWLock(&thread_data.chunk_lock);
+    thread_data.chunk_dynamic   = 1;
+    thread_data.chunk_begin     = 0;
+    thread_data.chunk_end       = 0;
+    thread_data.stash_begin     = 0;
+    thread_data.stash_end       = 0;
     list_init(&thread_data.entry);
     InitializeConditionVariable(&thread_data.cond);
 
+    if (num_threads > 1)
+    {
+        team_data.threads = HeapAlloc(GetProcessHeap(), 0, num_threads * sizeof(*team_data.threads));
+        team_data.barrier_nodes = HeapAlloc(GetProcessHeap(), 0,
+                vcomp_barrier_size(num_threads) * sizeof(*team_data.barrier_nodes));
+        if (!team_data.threads || !team_data.barrier_nodes)
+        {
+            ERR("could not allocate team data, running single threaded\n");
+            num_threads = 1;
+        }
+    }
+
     if (num_threads > 1)
     {
         struct list *ptr;
         EnterCriticalSection(&vcomp_section);
+        team_data.threads[0] = &thread_data;
 
         /* reuse existing threads (if any) */
         while (team_data.num_threads < num_threads && (ptr = list_head(&vcomp_idle_threads)))
@@ -1457,6 +1687,12 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
             data->section       = 1;
             data->dynamic       = 1;
             data->dynamic_type  = 0;
+            data->chunk_dynamic = 1;
+            data->chunk_begin   = 0;
+            data->chunk_end     = 0;
+            data->stash_begin   = 0;
+            data->stash_end     = 0;
+            team_data.threads[data->thread_num] = data;
             list_remove(&data->entry);
             list_add_tail(&thread_data.entry, &data->entry);
             WakeAllConditionVariable(&data->cond);
@@ -1481,6 +1717,12 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
             data->section       = 1;
             data->dynamic       = 1;
             data->dynamic_type  = 0;
+            InitializeSRWLock(&data->chunk_lock);
+            data->chunk_dynamic = 1;
+            data->chunk_begin   = 0;
+            data->chunk_end     = 0;
+            data->stash_begin   = 0;
+            data->stash_end     = 0;
             InitializeConditionVariable(&data->cond);
 
             thread = CreateThread(NULL, 0, _vcomp_fork_worker, data, 0, NULL);
@@ -1492,11 +1734,13 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
 
             GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
                                (const WCHAR *)vcomp_module, &module);
-            team_data.num_threads++;
+            team_data.threads[team_data.num_threads++] = data;
             list_add_tail(&thread_data.entry, &data->entry);
             CloseHandle(thread);
         }
 
+        /* the team threads only start running once we leave the critical section */
+        vcomp_barrier_init(team_data.barrier_nodes, team_data.num_threads);
         LeaveCriticalSection(&vcomp_section);
     }
 
@@ -1517,6 +1761,8 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
         assert(list_empty(&thread_data.entry));
     }
 
+    HeapFree(GetProcessHeap(), 0, team_data.threads);
+    HeapFree(GetProcessHeap(), 0, team_data.barrier_nodes);
     __ms_va_end(team_data.valist);
 }
 
@@ -1174,6 +1174,28 @@ static void CDECL for_dynamic_guided_cb(unsigned int flags, LONG *a, LONG *b, LO
     }
 }
 
+static void CDECL for_dynamic_late_cb(HANDLE event, LONG *a, LONG *b)
+{
+    unsigned int begin, end;
+
+    /* the other threads have to take over the iterations of the master */
+    if (pomp_get_thread_num() == 0)
+    {
+        DWORD result = WaitForSingleObject(event, 5000);
+        ok(result == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", result);
+    }
+
+    p_vcomp_for_dynamic_init(VCOMP_DYNAMIC_FLAGS_CHUNKED | VCOMP_DYNAMIC_FLAGS_INCREMENT, 0, 999, 1, 3);
+    while (p_vcomp_for_dynamic_next(&begin, &end))
+    {
+        ok(pomp_get_thread_num() != 0, "expected no iterations left for the master\n");
+        ok(end - begin == (begin == 999 ? 0 : 2), "got unexpected chunk %u-%u\n", begin, end);
+        InterlockedIncrement(b);
+        if (InterlockedExchangeAdd(a, end - begin + 1) + end - begin + 1 == 1000)
+            SetEvent(event);
+    }
+}
+
 static void test_vcomp_for_dynamic_init(void)
 {
     static const int guided_a[] = {0, 6041, 9072, 11179};
@@ -1182,6 +1204,7 @@ static void test_vcomp_for_dynamic_init(void)
     static const int guided_d[] = {1000, 1933, 2861, 3727};
     LONG a, b, c, d;
     int max_threads = pomp_get_max_threads();
+    HANDLE event;
     int i;
 
     /* test static scheduling */
@@ -1221,6 +1244,23 @@ static void test_vcomp_for_dynamic_init(void)
         ok(d == 14790, "expected d == 14790, got %d\n", d);
     }
 
+    /* test chunked scheduling with a thread arriving late */
+    event = CreateEventA(NULL, TRUE, FALSE, NULL);
+    ok(event != NULL, "CreateEventA failed %u\n", GetLastError());
+
+    for (i = 2; i <= 8; i *= 2)
+    {
+        pomp_set_num_threads(i);
+
+        ResetEvent(event);
+        a = b = 0;
+        p_vcomp_fork(TRUE, 3, for_dynamic_late_cb, event, &a, &b);
+        ok(a == 1000, "expected a == 1000, got %d\n", a);
+        ok(b == 334, "expected b == 334, got %d\n", b);
+    }
+
+    CloseHandle(event);
+
     /* test guided scheduling */
     a = b = c = d = 0;
     for_dynamic_guided_cb(VCOMP_DYNAMIC_FLAGS_GUIDED, &a, &b, &c, &d);
@@ -1278,6 +1318,41 @@ static void test_vcomp_for_dynamic_init(void)
     pomp_set_num_threads(max_threads);
 }
 
+static void CDECL barrier_cb(LONG *count)
+{
+    int num_threads = pomp_get_num_threads();
+    int i;
+
+    for (i = 1; i <= 50; i++)
+    {
+        InterlockedIncrement(count);
+        p_vcomp_barrier();
+        ok(*count == i * num_threads, "expected count == %d, got %d\n", i * num_threads, *count);
+        p_vcomp_barrier();
+    }
+}
+
+static void test_vcomp_barrier(void)
+{
+    int max_threads = pomp_get_max_threads();
+    LONG count;
+    int i;
+
+    count = 0;
+    barrier_cb(&count);
+    ok(count == 50, "expected count == 50, got %d\n", count);
+
+    for (i = 1; i <= 20; i += 3)
+    {
+        pomp_set_num_threads(i);
+        count = 0;
+        p_vcomp_fork(TRUE, 1, barrier_cb, &count);
+        ok(count == 50 * i, "expected count == %d, got %d\n", 50 * i, count);
+    }
+
+    pomp_set_num_threads(max_threads);
+}
+
 static void CDECL master_cb(HANDLE semaphore)
 {
     int num_threads = pomp_get_num_threads();
@@ -2184,6 +2259,7 @@ START_TEST(vcomp)
     test_vcomp_for_static_simple_init();
     test_vcomp_for_static_init();
     test_vcomp_for_dynamic_init();
+    test_vcomp_barrier();
     test_vcomp_master_begin();
     test_vcomp_single_begin();
     test_vcomp_enter_critsect();
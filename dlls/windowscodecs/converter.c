@@ -31,10 +31,12 @@
 #include "wincodecs_private.h"
 
 #include "wine/debug.h"
+#include "wine/simd.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(wincodecs);
 
 struct FormatConverter;
+struct direct_conversion;
 
 enum pixelformat {
     format_1bppIndexed,
@@ -74,6 +76,7 @@ typedef struct FormatConverter {
     LONG ref;
     IWICBitmapSource *source;
     const struct pixelformatinfo *dst_format, *src_format;
+    const struct direct_conversion *direct;
     WICBitmapDitherType dither;
     double alpha_threshold;
     WICBitmapPaletteType palette_type;
@@ -93,6 +96,14 @@ static inline float to_sRGB_component(float f)
     return 1.055f * powf(f, 1.0f/2.4f) - 0.055f;
 }
 
+static inline BYTE bgr_to_gray(BYTE b, BYTE g, BYTE r)
+{
+    float gray = (r * 0.2126f + g * 0.7152f + b * 0.0722f) / 255.0f;
+
+    gray = to_sRGB_component(gray) * 255.0f;
+    return (BYTE)floorf(gray + 0.51f);
+}
+
 #if 0 /* FIXME: enable once needed */
 static void from_sRGB(BYTE *bgr)
 {
@@ -1167,10 +1178,7 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
 
             for (x = 0; x < prc->Width; x++)
             {
-                float gray = (bgr[2] * 0.2126f + bgr[1] * 0.7152f + bgr[0] * 0.0722f) / 255.0f;
-
-                gray = to_sRGB_component(gray) * 255.0f;
-                dst[x] = (BYTE)floorf(gray + 0.51f);
+                dst[x] = bgr_to_gray(bgr[0], bgr[1], bgr[2]);
                 bgr += 3;
             }
             src += srcstride;
@@ -1182,6 +1190,478 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
     return hr;
 }
 
+/* Direct conversions between common format pairs. These convert one strip of
+ * rows at a time, in the caller's buffer whenever the source rows fit in it.
+ * The row functions therefore accept src == dst: the ones that widen the
+ * pixels walk the row backwards, the others forwards. */
+
+typedef void (*convert_row_func)(const BYTE *src, BYTE *dst, UINT width);
+
+struct direct_conversion {
+    enum pixelformat src_format;
+    enum pixelformat dst_format;
+    UINT src_bpp, dst_bpp; /* bytes per pixel */
+    convert_row_func convert_row;
+};
+
+#define DIRECT_STRIP_SIZE 0x10000
+
+#ifdef HAVE_SSE2_INTRINSICS
+
+static BOOL use_sse2;
+
+/* width must be a multiple of 16 */
+static void SSE2_FUNC gray8_to_bgra_sse2(const BYTE *src, BYTE *dst, UINT width)
+{
+    const __m128i alpha = _mm_set1_epi8(0xff);
+
+    while (width)
+    {
+        __m128i gray, gg, ga, out[4];
+
+        width -= 16;
+        gray = _mm_loadu_si128((const __m128i *)(src + width));
+        gg = _mm_unpacklo_epi8(gray, gray);
+        ga = _mm_unpacklo_epi8(gray, alpha);
+        out[0] = _mm_unpacklo_epi16(gg, ga);
+        out[1] = _mm_unpackhi_epi16(gg, ga);
+        gg = _mm_unpackhi_epi8(gray, gray);
+        ga = _mm_unpackhi_epi8(gray, alpha);
+        out[2] = _mm_unpacklo_epi16(gg, ga);
+        out[3] = _mm_unpackhi_epi16(gg, ga);
+        _mm_storeu_si128((__m128i *)(dst + 4 * width), out[0]);
+        _mm_storeu_si128((__m128i *)(dst + 4 * width + 16), out[1]);
+        _mm_storeu_si128((__m128i *)(dst + 4 * width + 32), out[2]);
+        _mm_storeu_si128((__m128i *)(dst + 4 * width + 48), out[3]);
+    }
+}
+
+/* c * alpha / 255 on two pixels widened to 16 bits, the alpha channel being
+ * multiplied by 255 so that it comes out unchanged */
+static inline __m128i SSE2_FUNC premultiply_pixels_sse2(__m128i pixels)
+{
+    const __m128i color_mask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+    const __m128i alpha_255 = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+    __m128i alpha, val;
+
+    alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, 0xff), 0xff);
+    alpha = _mm_or_si128(_mm_and_si128(alpha, color_mask), alpha_255);
+    val = _mm_add_epi16(_mm_mullo_epi16(pixels, alpha), _mm_set1_epi16(1));
+    return _mm_srli_epi16(_mm_add_epi16(val, _mm_srli_epi16(val, 8)), 8);
+}
+
+/* width must be a multiple of 4 */
+static void SSE2_FUNC bgra_to_pbgra_sse2(const BYTE *src, BYTE *dst, UINT width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    UINT x;
+
+    for (x = 0; x < width; x += 4)
+    {
+        __m128i pixels = _mm_loadu_si128((const __m128i *)(src + 4 * x));
+        __m128i lo = premultiply_pixels_sse2(_mm_unpacklo_epi8(pixels, zero));
+        __m128i hi = premultiply_pixels_sse2(_mm_unpackhi_epi8(pixels, zero));
+        _mm_storeu_si128((__m128i *)(dst + 4 * x), _mm_packus_epi16(lo, hi));
+    }
+}
+
+/* c * 255 / alpha on one pixel widened to 32 bits. (c * 255 + 0.5) / alpha is
+ * never within rounding distance of an integer, so the truncated float
+ * quotient is the integer one. Pixels with an alpha of 0 or 255 and the alpha
+ * channel itself are kept. */
+static inline __m128i SSE2_FUNC unpremultiply_pixel_sse2(__m128i pixel)
+{
+    const __m128i alpha_mask = _mm_set_epi32(-1, 0, 0, 0);
+    const __m128i byte_mask = _mm_set1_epi32(0xff);
+    __m128i alpha, keep, res;
+    __m128 val;
+
+    alpha = _mm_shuffle_epi32(pixel, 0xff);
+    keep = _mm_or_si128(_mm_cmpeq_epi32(alpha, _mm_setzero_si128()), _mm_cmpeq_epi32(alpha, byte_mask));
+    keep = _mm_or_si128(keep, alpha_mask);
+    val = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(pixel), _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f));
+    val = _mm_div_ps(val, _mm_cvtepi32_ps(_mm_max_epi16(alpha, _mm_set1_epi32(1))));
+    res = _mm_and_si128(_mm_cvttps_epi32(val), byte_mask);
+    return _mm_or_si128(_mm_and_si128(keep, pixel), _mm_andnot_si128(keep, res));
+}
+
+/* width must be a multiple of 4 */
+static void SSE2_FUNC pbgra_to_bgra_sse2(const BYTE *src, BYTE *dst, UINT width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    UINT x;
+
+    for (x = 0; x < width; x += 4)
+    {
+        __m128i pixels = _mm_loadu_si128((const __m128i *)(src + 4 * x));
+        __m128i lo = _mm_unpacklo_epi8(pixels, zero), hi = _mm_unpackhi_epi8(pixels, zero);
+
+        lo = _mm_packs_epi32(unpremultiply_pixel_sse2(_mm_unpacklo_epi16(lo, zero)),
+                             unpremultiply_pixel_sse2(_mm_unpackhi_epi16(lo, zero)));
+        hi = _mm_packs_epi32(unpremultiply_pixel_sse2(_mm_unpacklo_epi16(hi, zero)),
+                             unpremultiply_pixel_sse2(_mm_unpackhi_epi16(hi, zero)));
+        _mm_storeu_si128((__m128i *)(dst + 4 * x), _mm_packus_epi16(lo, hi));
+    }
+}
+
+/* width must be a multiple of 4 */
+static void SSE2_FUNC rgba64_to_bgra_sse2(const BYTE *src, BYTE *dst, UINT width)
+{
+    const __m128i low_bytes = _mm_set1_epi16(0xff);
+    UINT x;
+
+    for (x = 0; x < width; x += 4)
+    {
+        __m128i lo = _mm_loadu_si128((const __m128i *)(src + 8 * x));
+        __m128i hi = _mm_loadu_si128((const __m128i *)(src + 8 * x + 16));
+
+        lo = _mm_and_si128(lo, low_bytes);
+        hi = _mm_and_si128(hi, low_bytes);
+        lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3,0,1,2)), _MM_SHUFFLE(3,0,1,2));
+        hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3,0,1,2)), _MM_SHUFFLE(3,0,1,2));
+        _mm_storeu_si128((__m128i *)(dst + 4 * x), _mm_packus_epi16(lo, hi));
+    }
+}
+
+#endif /* HAVE_SSE2_INTRINSICS */
+
+static inline DWORD swap_red_blue(DWORD pixel)
+{
+    return (pixel & 0xff00ff00) | (pixel & 0xff) << 16 | (pixel >> 16 & 0xff);
+}
+
+static void gray8_to_bgra(const BYTE *src, BYTE *dst, UINT width)
+{
+    DWORD *pixel = (DWORD *)dst;
+    UINT x = width;
+
+#ifdef HAVE_SSE2_INTRINSICS
+    if (use_sse2)
+    {
+        for (; x % 16; x--) pixel[x - 1] = 0xff000000 | src[x - 1] * 0x010101;
+        gray8_to_bgra_sse2(src, dst, x);
+        return;
+    }
+#endif
+    for (; x; x--) pixel[x - 1] = 0xff000000 | src[x - 1] * 0x010101;
+}
+
+/* converts four pixels from three dword loads */
+static inline void expand_24bpp_to_32bpp(const BYTE *src, BYTE *dst, UINT width, BOOL swap)
+{
+    DWORD *pixel = (DWORD *)dst;
+    UINT x = width;
+
+    for (; x % 4; x--)
+    {
+        const BYTE *p = src + 3 * (x - 1);
+        DWORD val = 0xff000000 | p[2] << 16 | p[1] << 8 | p[0];
+        pixel[x - 1] = swap ? swap_red_blue(val) : val;
+    }
+    while (x)
+    {
+        const DWORD *p;
+        DWORD w0, w1, w2;
+
+        x -= 4;
+        p = (const DWORD *)(src + 3 * x);
+        w0 = p[0];
+        w1 = p[1];
+        w2 = p[2];
+        if (swap)
+        {
+            pixel[x + 3] = swap_red_blue(0xff000000 | w2 >> 8);
+            pixel[x + 2] = swap_red_blue(0xff000000 | w1 >> 16 | w2 << 16);
+            pixel[x + 1] = swap_red_blue(0xff000000 | w0 >> 24 | w1 << 8);
+            pixel[x] = swap_red_blue(0xff000000 | w0);
+        }
+        else
+        {
+            pixel[x + 3] = 0xff000000 | w2 >> 8;
+            pixel[x + 2] = 0xff000000 | w1 >> 16 | w2 << 16;
+            pixel[x + 1] = 0xff000000 | w0 >> 24 | w1 << 8;
+            pixel[x] = 0xff000000 | w0;
+        }
+    }
+}
+
+static void bgr24_to_bgra(const BYTE *src, BYTE *dst, UINT width)
+{
+    expand_24bpp_to_32bpp(src, dst, width, FALSE);
+}
+
+static void rgb24_to_bgra(const BYTE *src, BYTE *dst, UINT width)
+{
+    expand_24bpp_to_32bpp(src, dst, width, TRUE);
+}
+
+static void bgr32_to_bgra(const BYTE *src, BYTE *dst, UINT width)
+{
+    const DWORD *srcpixel = (const DWORD *)src;
+    DWORD *dstpixel = (DWORD *)dst;
+    UINT x;
+
+    for (x = 0; x < width; x++) dstpixel[x] = srcpixel[x] | 0xff000000;
+}
+
+static void bgra_to_pbgra(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x = 0;
+
+#ifdef HAVE_SSE2_INTRINSICS
+    if (use_sse2)
+    {
+        x = width & ~3;
+        bgra_to_pbgra_sse2(src, dst, x);
+    }
+#endif
+    for (; x < width; x++)
+    {
+        BYTE alpha = src[4 * x + 3];
+
+        dst[4 * x] = src[4 * x] * alpha / 255;
+        dst[4 * x + 1] = src[4 * x + 1] * alpha / 255;
+        dst[4 * x + 2] = src[4 * x + 2] * alpha / 255;
+        dst[4 * x + 3] = alpha;
+    }
+}
+
+static void pbgra_to_bgra(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x = 0;
+
+#ifdef HAVE_SSE2_INTRINSICS
+    if (use_sse2)
+    {
+        x = width & ~3;
+        pbgra_to_bgra_sse2(src, dst, x);
+    }
+#endif
+    for (; x < width; x++)
+    {
+        BYTE alpha = src[4 * x + 3];
+
+        if (alpha != 0 && alpha != 255)
+        {
+            dst[4 * x] = src[4 * x] * 255 / alpha;
+            dst[4 * x + 1] = src[4 * x + 1] * 255 / alpha;
+            dst[4 * x + 2] = src[4 * x + 2] * 255 / alpha;
+        }
+        else
+        {
+            dst[4 * x] = src[4 * x];
+            dst[4 * x + 1] = src[4 * x + 1];
+            dst[4 * x + 2] = src[4 * x + 2];
+        }
+        dst[4 * x + 3] = alpha;
+    }
+}
+
+/* only the first byte of each channel is used */
+static void rgb48_to_bgra(const BYTE *src, BYTE *dst, UINT width)
+{
+    DWORD *pixel = (DWORD *)dst;
+    UINT x;
+
+    for (x = 0; x < width; x++, src += 6)
+        pixel[x] = 0xff000000 | src[0] << 16 | src[2] << 8 | src[4];
+}
+
+static void rgba64_to_bgra(const BYTE *src, BYTE *dst, UINT width)
+{
+    DWORD *pixel = (DWORD *)dst;
+    UINT x = 0;
+
+#ifdef HAVE_SSE2_INTRINSICS
+    if (use_sse2)
+    {
+        x = width & ~3;
+        rgba64_to_bgra_sse2(src, dst, x);
+    }
+#endif
+    for (; x < width; x++)
+        pixel[x] = src[8 * x + 6] << 24 | src[8 * x] << 16 | src[8 * x + 2] << 8 | src[8 * x + 4];
+}
+
+static void rgba64_to_pbgra(const BYTE *src, BYTE *dst, UINT width)
+{
+    rgba64_to_bgra(src, dst, width);
+    bgra_to_pbgra(dst, dst, width);
+}
+
+/* produces four pixels with three dword stores */
+static inline void pack_32bpp_to_24bpp(const BYTE *src, BYTE *dst, UINT width, BOOL swap)
+{
+    const DWORD *pixel = (const DWORD *)src;
+    UINT x;
+
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+        DWORD p0 = pixel[x], p1 = pixel[x + 1], p2 = pixel[x + 2], p3 = pixel[x + 3];
+        DWORD *out = (DWORD *)(dst + 3 * x);
+
+        if (swap)
+        {
+            p0 = swap_red_blue(p0);
+            p1 = swap_red_blue(p1);
+            p2 = swap_red_blue(p2);
+            p3 = swap_red_blue(p3);
+        }
+        out[0] = (p0 & 0xffffff) | p1 << 24;
+        out[1] = (p1 >> 8 & 0xffff) | p2 << 16;
+        out[2] = (p2 >> 16 & 0xff) | p3 << 8;
+    }
+    for (; x < width; x++)
+    {
+        BYTE b = src[4 * x], g = src[4 * x + 1], r = src[4 * x + 2];
+
+        dst[3 * x] = swap ? r : b;
+        dst[3 * x + 1] = g;
+        dst[3 * x + 2] = swap ? b : r;
+    }
+}
+
+static void bgra_to_bgr24(const BYTE *src, BYTE *dst, UINT width)
+{
+    pack_32bpp_to_24bpp(src, dst, width, FALSE);
+}
+
+static void bgra_to_rgb24(const BYTE *src, BYTE *dst, UINT width)
+{
+    pack_32bpp_to_24bpp(src, dst, width, TRUE);
+}
+
+static void bgr24_to_gray8(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++, src += 3)
+        dst[x] = bgr_to_gray(src[0], src[1], src[2]);
+}
+
+static void rgb24_to_gray8(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++, src += 3)
+        dst[x] = bgr_to_gray(src[2], src[1], src[0]);
+}
+
+static void bgra_to_gray8(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++, src += 4)
+        dst[x] = bgr_to_gray(src[0], src[1], src[2]);
+}
+
+static const struct direct_conversion direct_conversions[] = {
+    {format_8bppGray, format_32bppBGR, 1, 4, gray8_to_bgra},
+    {format_8bppGray, format_32bppBGRA, 1, 4, gray8_to_bgra},
+    {format_8bppGray, format_32bppPBGRA, 1, 4, gray8_to_bgra},
+    {format_24bppBGR, format_32bppBGR, 3, 4, bgr24_to_bgra},
+    {format_24bppBGR, format_32bppBGRA, 3, 4, bgr24_to_bgra},
+    {format_24bppBGR, format_32bppPBGRA, 3, 4, bgr24_to_bgra},
+    {format_24bppRGB, format_32bppBGR, 3, 4, rgb24_to_bgra},
+    {format_24bppRGB, format_32bppBGRA, 3, 4, rgb24_to_bgra},
+    {format_24bppRGB, format_32bppPBGRA, 3, 4, rgb24_to_bgra},
+    {format_32bppBGR, format_32bppBGRA, 4, 4, bgr32_to_bgra},
+    {format_32bppBGR, format_32bppPBGRA, 4, 4, bgr32_to_bgra},
+    {format_32bppBGRA, format_32bppPBGRA, 4, 4, bgra_to_pbgra},
+    {format_32bppPBGRA, format_32bppBGRA, 4, 4, pbgra_to_bgra},
+    {format_48bppRGB, format_32bppBGR, 6, 4, rgb48_to_bgra},
+    {format_48bppRGB, format_32bppBGRA, 6, 4, rgb48_to_bgra},
+    {format_48bppRGB, format_32bppPBGRA, 6, 4, rgb48_to_bgra},
+    {format_64bppRGBA, format_32bppBGR, 8, 4, rgba64_to_bgra},
+    {format_64bppRGBA, format_32bppBGRA, 8, 4, rgba64_to_bgra},
+    {format_64bppRGBA, format_32bppPBGRA, 8, 4, rgba64_to_pbgra},
+    {format_32bppBGR, format_24bppBGR, 4, 3, bgra_to_bgr24},
+    {format_32bppBGRA, format_24bppBGR, 4, 3, bgra_to_bgr24},
+    {format_32bppPBGRA, format_24bppBGR, 4, 3, bgra_to_bgr24},
+    {format_32bppBGR, format_24bppRGB, 4, 3, bgra_to_rgb24},
+    {format_32bppBGRA, format_24bppRGB, 4, 3, bgra_to_rgb24},
+    {format_32bppPBGRA, format_24bppRGB, 4, 3, bgra_to_rgb24},
+    {format_24bppBGR, format_8bppGray, 3, 1, bgr24_to_gray8},
+    {format_24bppRGB, format_8bppGray, 3, 1, rgb24_to_gray8},
+    {format_32bppBGR, format_8bppGray, 4, 1, bgra_to_gray8},
+    {format_32bppBGRA, format_8bppGray, 4, 1, bgra_to_gray8},
+    {format_32bppPBGRA, format_8bppGray, 4, 1, bgra_to_gray8},
+};
+
+static const struct direct_conversion *get_direct_conversion(enum pixelformat src, enum pixelformat dst)
+{
+    UINT i;
+
+    for (i = 0; i < sizeof(direct_conversions) / sizeof(direct_conversions[0]); i++)
+        if (direct_conversions[i].src_format == src && direct_conversions[i].dst_format == dst)
+            return &direct_conversions[i];
+
+    return NULL;
+}
+
+static HRESULT copypixels_direct(struct FormatConverter *This, const WICRect *prc,
+    UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
+{
+    const struct direct_conversion *direct = This->direct;
+    UINT src_rowsize, dst_rowsize, stride, rows, y, i;
+    BYTE *srcdata = NULL;
+    HRESULT hr = S_OK;
+    BOOL in_place;
+    WICRect rc;
+
+    if (prc->Width <= 0 || prc->Height <= 0)
+        return IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
+
+    if (cbStride / direct->dst_bpp < prc->Width) return E_INVALIDARG;
+    dst_rowsize = direct->dst_bpp * prc->Width;
+    if (cbBufferSize < dst_rowsize || (cbBufferSize - dst_rowsize) / cbStride < prc->Height - 1)
+        return E_INVALIDARG;
+
+    if (prc->Width > ~0u / direct->src_bpp) return E_OUTOFMEMORY;
+    src_rowsize = direct->src_bpp * prc->Width;
+
+    /* convert in place when the source rows fit in the caller's buffer */
+    in_place = cbStride >= src_rowsize && cbBufferSize - cbStride * (prc->Height - 1) >= src_rowsize;
+    stride = in_place ? cbStride : src_rowsize;
+
+    rows = max(1, DIRECT_STRIP_SIZE / stride);
+    if (rows > prc->Height) rows = prc->Height;
+
+    if (!in_place)
+    {
+        srcdata = HeapAlloc(GetProcessHeap(), 0, src_rowsize * rows);
+        if (!srcdata) return E_OUTOFMEMORY;
+    }
+
+    rc.X = prc->X;
+    rc.Width = prc->Width;
+    for (y = 0; y < prc->Height; y += rows)
+    {
+        BYTE *dst = pbBuffer + cbStride * y;
+        BYTE *src = srcdata ? srcdata : dst;
+
+        rc.Y = prc->Y + y;
+        rc.Height = min(rows, prc->Height - y);
+        hr = IWICBitmapSource_CopyPixels(This->source, &rc, stride, stride * (rc.Height - 1) + src_rowsize, src);
+        if (FAILED(hr)) break;
+
+        for (i = 0; i < rc.Height; i++)
+            direct->convert_row(src + stride * i, dst + cbStride * i, prc->Width);
+    }
+
+    HeapFree(GetProcessHeap(), 0, srcdata);
+    return hr;
+}
+
+/* select the SIMD versions of the row converters supported by the CPU */
+void init_format_converters(void)
+{
+#ifdef HAVE_SSE2_INTRINSICS
+    use_sse2 = wine_sse2_present();
+    TRACE("SSE2 converters %s\n", use_sse2 ? "enabled" : "disabled");
+#endif
+}
+
 static const struct pixelformatinfo supported_formats[] = {
     {format_1bppIndexed, &GUID_WICPixelFormat1bppIndexed, NULL},
     {format_2bppIndexed, &GUID_WICPixelFormat2bppIndexed, NULL},
@@ -1339,6 +1819,9 @@ static HRESULT WINAPI FormatConverter_CopyPixels(IWICFormatConverter *iface,
             prc = &rc;
         }
 
+        if (This->direct)
+            return copypixels_direct(This, prc, cbStride, cbBufferSize, pbBuffer);
+
         return This->dst_format->copy_function(This, prc, cbStride, cbBufferSize,
             pbBuffer, This->src_format->format);
     }
@@ -1393,6 +1876,7 @@ static HRESULT WINAPI FormatConverter_Initialize(IWICFormatConverter *iface,
         IWICBitmapSource_AddRef(pISource);
         This->src_format = srcinfo;
         This->dst_format = dstinfo;
+        This->direct = get_direct_conversion(srcinfo->format, dstinfo->format);
         This->dither = dither;
         This->alpha_threshold = alphaThresholdPercent;
         This->palette_type = paletteTranslate;
@@ -1475,6 +1959,7 @@ HRESULT FormatConverter_CreateInstance(REFIID iid, void** ppv)
     This->IWICFormatConverter_iface.lpVtbl = &FormatConverter_Vtbl;
     This->ref = 1;
     This->source = NULL;
+    This->direct = NULL;
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": FormatConverter.lock");
 
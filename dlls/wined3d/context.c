@@ -1346,6 +1346,13 @@ void context_release(struct wined3d_context *context)
 
     if (!--context->level)
     {
+        /* Objects created or modified outside the command stream thread
+         * have to reach the driver before that thread uses them from its
+         * own context. */
+        if (context->valid && context->device->cs->thread
+                && context->device->cs->thread_id != GetCurrentThreadId())
+            context->gl_info->gl_ops.gl.p_glFlush();
+
         if (context_restore_pixel_format(context))
             context->needs_set = 1;
         if (context->restore_ctx)
@@ -3545,6 +3552,8 @@ struct wined3d_context *context_acquire(const struct wined3d_device *device, str
 
     TRACE("device %p, target %p.\n", device, target);
 
+    wined3d_cs_finish(device->cs);
+
     if (current_context && current_context->destroyed)
         current_context = NULL;
 
@@ -26,6 +26,7 @@ WINE_DEFAULT_DEBUG_CHANNEL(d3d);
 
 enum wined3d_cs_op
 {
+    WINED3D_CS_OP_NOP,
     WINED3D_CS_OP_PRESENT,
     WINED3D_CS_OP_CLEAR,
     WINED3D_CS_OP_DRAW,
@@ -59,6 +60,23 @@ enum wined3d_cs_op
     WINED3D_CS_OP_UNLOAD_RESOURCE,
     WINED3D_CS_OP_MAP,
     WINED3D_CS_OP_UNMAP,
+    WINED3D_CS_OP_SET_LIGHT,
+    WINED3D_CS_OP_SET_LIGHT_ENABLE,
+    WINED3D_CS_OP_PUSH_CONSTANTS,
+    WINED3D_CS_OP_QUERY_POLL,
+    WINED3D_CS_OP_FLUSH,
+    WINED3D_CS_OP_STOP,
+};
+
+struct wined3d_cs_packet
+{
+    size_t size;
+    BYTE data[1];
+};
+
+struct wined3d_cs_nop
+{
+    enum wined3d_cs_op opcode;
 };
 
 struct wined3d_cs_present
@@ -91,6 +109,7 @@ struct wined3d_cs_draw
     unsigned int start_instance;
     unsigned int instance_count;
     BOOL indexed;
+    GLenum primitive_type;
 };
 
 struct wined3d_cs_set_predication
@@ -310,6 +329,71 @@ struct wined3d_cs_unmap
     HRESULT *hr;
 };
 
+struct wined3d_cs_set_light
+{
+    enum wined3d_cs_op opcode;
+    struct wined3d_light_info light;
+};
+
+struct wined3d_cs_set_light_enable
+{
+    enum wined3d_cs_op opcode;
+    unsigned int idx;
+    BOOL enable;
+};
+
+struct wined3d_cs_push_constants
+{
+    enum wined3d_cs_op opcode;
+    enum wined3d_push_constants type;
+    unsigned int start_idx;
+    unsigned int count;
+    BYTE constants[1];
+};
+
+struct wined3d_cs_query_poll
+{
+    enum wined3d_cs_op opcode;
+    struct wined3d_query *query;
+    BOOL *ret;
+};
+
+struct wined3d_cs_flush
+{
+    enum wined3d_cs_op opcode;
+};
+
+struct wined3d_cs_stop
+{
+    enum wined3d_cs_op opcode;
+};
+
+static const struct
+{
+    size_t offset;
+    size_t size;
+    DWORD mask;
+}
+wined3d_cs_push_constant_info[] =
+{
+    /* WINED3D_PUSH_CONSTANTS_VS_F */
+    {FIELD_OFFSET(struct wined3d_state, vs_consts_f), sizeof(struct wined3d_vec4),  WINED3D_SHADER_CONST_VS_F},
+    /* WINED3D_PUSH_CONSTANTS_PS_F */
+    {FIELD_OFFSET(struct wined3d_state, ps_consts_f), sizeof(struct wined3d_vec4),  WINED3D_SHADER_CONST_PS_F},
+    /* WINED3D_PUSH_CONSTANTS_VS_I */
+    {FIELD_OFFSET(struct wined3d_state, vs_consts_i), sizeof(struct wined3d_ivec4), WINED3D_SHADER_CONST_VS_I},
+    /* WINED3D_PUSH_CONSTANTS_PS_I */
+    {FIELD_OFFSET(struct wined3d_state, ps_consts_i), sizeof(struct wined3d_ivec4), WINED3D_SHADER_CONST_PS_I},
+    /* WINED3D_PUSH_CONSTANTS_VS_B */
+    {FIELD_OFFSET(struct wined3d_state, vs_consts_b), sizeof(BOOL),                 WINED3D_SHADER_CONST_VS_B},
+    /* WINED3D_PUSH_CONSTANTS_PS_B */
+    {FIELD_OFFSET(struct wined3d_state, ps_consts_b), sizeof(BOOL),                 WINED3D_SHADER_CONST_PS_B},
+};
+
+static void wined3d_cs_exec_nop(struct wined3d_cs *cs, const void *data)
+{
+}
+
 static void wined3d_cs_exec_present(struct wined3d_cs *cs, const void *data)
 {
     const struct wined3d_cs_present *op = data;
@@ -360,10 +444,10 @@ static void wined3d_cs_exec_clear(struct wined3d_cs *cs, const void *data)
     RECT draw_rect;
 
     device = cs->device;
-    state = &device->state;
+    state = &cs->state;
     wined3d_get_draw_rect(state, &draw_rect);
     device_clear_render_targets(device, device->adapter->gl_info.limits.buffers,
-            &device->fb, op->rect_count, op->rects, &draw_rect, op->flags,
+            &cs->fb, op->rect_count, op->rects, &draw_rect, op->flags,
             &op->color, op->depth, op->stencil);
 
     if (op->flags & WINED3DCLEAR_TARGET)
@@ -410,13 +494,20 @@ void wined3d_cs_emit_clear(struct wined3d_cs *cs, DWORD rect_count, const RECT *
 
 static void wined3d_cs_exec_draw(struct wined3d_cs *cs, const void *data)
 {
-    struct wined3d_state *state = &cs->device->state;
+    struct wined3d_state *state = &cs->state;
     struct wined3d_shader_sampler_map_entry *entry;
     struct wined3d_shader_resource_view *view;
     const struct wined3d_cs_draw *op = data;
     struct wined3d_shader *shader;
     unsigned int i, j;
 
+    if (op->primitive_type != state->gl_primitive_type)
+    {
+        if (op->primitive_type == GL_POINTS || state->gl_primitive_type == GL_POINTS)
+            device_invalidate_state(cs->device, STATE_POINT_ENABLE);
+        state->gl_primitive_type = op->primitive_type;
+    }
+
     if (!cs->device->adapter->gl_info.supported[ARB_DRAW_ELEMENTS_BASE_VERTEX]
             && state->load_base_vertex_index != op->base_vertex_idx)
     {
@@ -487,6 +578,7 @@ void wined3d_cs_emit_draw(struct wined3d_cs *cs, int base_vertex_idx, unsigned i
     op->start_instance = start_instance;
     op->instance_count = instance_count;
     op->indexed = indexed;
+    op->primitive_type = state->gl_primitive_type;
 
     if (indexed)
         wined3d_resource_acquire(&state->index_buffer->resource);
@@ -1347,6 +1439,7 @@ HRESULT wined3d_cs_map(struct wined3d_cs *cs, struct wined3d_resource *resource,
     op->hr = &hr;
 
     cs->ops->submit(cs);
+    cs->ops->finish(cs);
 
     return hr;
 }
@@ -1371,12 +1464,149 @@ HRESULT wined3d_cs_unmap(struct wined3d_cs *cs, struct wined3d_resource *resourc
     op->hr = &hr;
 
     cs->ops->submit(cs);
+    cs->ops->finish(cs);
 
     return hr;
 }
 
+static void wined3d_cs_exec_set_light(struct wined3d_cs *cs, const void *data)
+{
+    const struct wined3d_cs_set_light *op = data;
+    struct wined3d_light_info *light_info;
+    unsigned int light_idx, hash_idx;
+
+    light_idx = op->light.OriginalIndex;
+
+    if (!(light_info = wined3d_state_get_light(&cs->state, light_idx)))
+    {
+        TRACE("Adding new light.\n");
+        if (!(light_info = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*light_info))))
+        {
+            ERR("Failed to allocate light info.\n");
+            return;
+        }
+
+        hash_idx = LIGHTMAP_HASHFUNC(light_idx);
+        list_add_head(&cs->state.light_map[hash_idx], &light_info->entry);
+        light_info->glIndex = -1;
+        light_info->OriginalIndex = light_idx;
+    }
+
+    if (light_info->glIndex != -1)
+    {
+        if (light_info->OriginalParms.type != op->light.OriginalParms.type)
+            device_invalidate_state(cs->device, STATE_LIGHT_TYPE);
+        device_invalidate_state(cs->device, STATE_ACTIVELIGHT(light_info->glIndex));
+    }
+
+    light_info->OriginalParms = op->light.OriginalParms;
+    light_info->position = op->light.position;
+    light_info->direction = op->light.direction;
+    light_info->exponent = op->light.exponent;
+    light_info->cutoff = op->light.cutoff;
+}
+
+void wined3d_cs_emit_set_light(struct wined3d_cs *cs, const struct wined3d_light_info *light)
+{
+    struct wined3d_cs_set_light *op;
+
+    op = cs->ops->require_space(cs, sizeof(*op));
+    op->opcode = WINED3D_CS_OP_SET_LIGHT;
+    op->light = *light;
+
+    cs->ops->submit(cs);
+}
+
+static void wined3d_cs_exec_set_light_enable(struct wined3d_cs *cs, const void *data)
+{
+    const struct wined3d_cs_set_light_enable *op = data;
+    struct wined3d_device *device = cs->device;
+    struct wined3d_light_info *light_info;
+    int prev_idx;
+
+    if (!(light_info = wined3d_state_get_light(&cs->state, op->idx)))
+    {
+        ERR("Light doesn't exist.\n");
+        return;
+    }
+
+    prev_idx = light_info->glIndex;
+    wined3d_state_enable_light(&cs->state, &device->adapter->gl_info, light_info, op->enable);
+    if (light_info->glIndex != prev_idx)
+    {
+        device_invalidate_state(device, STATE_LIGHT_TYPE);
+        device_invalidate_state(device, STATE_ACTIVELIGHT(op->enable ? light_info->glIndex : prev_idx));
+    }
+}
+
+void wined3d_cs_emit_set_light_enable(struct wined3d_cs *cs, unsigned int idx, BOOL enable)
+{
+    struct wined3d_cs_set_light_enable *op;
+
+    op = cs->ops->require_space(cs, sizeof(*op));
+    op->opcode = WINED3D_CS_OP_SET_LIGHT_ENABLE;
+    op->idx = idx;
+    op->enable = enable;
+
+    cs->ops->submit(cs);
+}
+
+static void wined3d_cs_st_push_constants(struct wined3d_cs *cs, enum wined3d_push_constants p,
+        unsigned int start_idx, unsigned int count, const void *constants);
+
+static void wined3d_cs_exec_push_constants(struct wined3d_cs *cs, const void *data)
+{
+    const struct wined3d_cs_push_constants *op = data;
+
+    wined3d_cs_st_push_constants(cs, op->type, op->start_idx, op->count, op->constants);
+}
+
+static void wined3d_cs_exec_query_poll(struct wined3d_cs *cs, const void *data)
+{
+    const struct wined3d_cs_query_poll *op = data;
+    struct wined3d_query *query = op->query;
+
+    *op->ret = query->query_ops->query_poll(query);
+}
+
+BOOL wined3d_cs_query_poll(struct wined3d_cs *cs, struct wined3d_query *query)
+{
+    struct wined3d_cs_query_poll *op;
+    BOOL ret;
+
+    op = cs->ops->require_space(cs, sizeof(*op));
+    op->opcode = WINED3D_CS_OP_QUERY_POLL;
+    op->query = query;
+    op->ret = &ret;
+
+    cs->ops->submit(cs);
+    cs->ops->finish(cs);
+
+    return ret;
+}
+
+static void wined3d_cs_exec_flush(struct wined3d_cs *cs, const void *data)
+{
+    struct wined3d_context *context;
+
+    context = context_acquire(cs->device, NULL);
+    context->gl_info->gl_ops.gl.p_glFlush();
+    context_release(context);
+}
+
+void wined3d_cs_emit_flush(struct wined3d_cs *cs)
+{
+    struct wined3d_cs_flush *op;
+
+    op = cs->ops->require_space(cs, sizeof(*op));
+    op->opcode = WINED3D_CS_OP_FLUSH;
+
+    cs->ops->submit(cs);
+}
+
 static void (* const wined3d_cs_op_handlers[])(struct wined3d_cs *cs, const void *data) =
 {
+    /* WINED3D_CS_OP_NOP                        */ wined3d_cs_exec_nop,
     /* WINED3D_CS_OP_PRESENT                    */ wined3d_cs_exec_present,
     /* WINED3D_CS_OP_CLEAR                      */ wined3d_cs_exec_clear,
     /* WINED3D_CS_OP_DRAW                       */ wined3d_cs_exec_draw,
@@ -1410,6 +1640,11 @@ static void (* const wined3d_cs_op_handlers[])(struct wined3d_cs *cs, const void
     /* WINED3D_CS_OP_UNLOAD_RESOURCE            */ wined3d_cs_exec_unload_resource,
     /* WINED3D_CS_OP_MAP                        */ wined3d_cs_exec_map,
     /* WINED3D_CS_OP_UNMAP                      */ wined3d_cs_exec_unmap,
+    /* WINED3D_CS_OP_SET_LIGHT                  */ wined3d_cs_exec_set_light,
+    /* WINED3D_CS_OP_SET_LIGHT_ENABLE           */ wined3d_cs_exec_set_light_enable,
+    /* WINED3D_CS_OP_PUSH_CONSTANTS             */ wined3d_cs_exec_push_constants,
+    /* WINED3D_CS_OP_QUERY_POLL                 */ wined3d_cs_exec_query_poll,
+    /* WINED3D_CS_OP_FLUSH                      */ wined3d_cs_exec_flush,
 };
 
 static void *wined3d_cs_st_require_space(struct wined3d_cs *cs, size_t size)
@@ -1444,48 +1679,254 @@ static void wined3d_cs_st_push_constants(struct wined3d_cs *cs, enum wined3d_pus
     unsigned int i;
     size_t offset;
 
-    static const struct
-    {
-        size_t offset;
-        size_t size;
-        DWORD mask;
-    }
-    push_constant_info[] =
-    {
-        /* WINED3D_PUSH_CONSTANTS_VS_F */
-        {FIELD_OFFSET(struct wined3d_state, vs_consts_f), sizeof(struct wined3d_vec4),  WINED3D_SHADER_CONST_VS_F},
-        /* WINED3D_PUSH_CONSTANTS_PS_F */
-        {FIELD_OFFSET(struct wined3d_state, ps_consts_f), sizeof(struct wined3d_vec4),  WINED3D_SHADER_CONST_PS_F},
-        /* WINED3D_PUSH_CONSTANTS_VS_I */
-        {FIELD_OFFSET(struct wined3d_state, vs_consts_i), sizeof(struct wined3d_ivec4), WINED3D_SHADER_CONST_VS_I},
-        /* WINED3D_PUSH_CONSTANTS_PS_I */
-        {FIELD_OFFSET(struct wined3d_state, ps_consts_i), sizeof(struct wined3d_ivec4), WINED3D_SHADER_CONST_PS_I},
-        /* WINED3D_PUSH_CONSTANTS_VS_B */
-        {FIELD_OFFSET(struct wined3d_state, vs_consts_b), sizeof(BOOL),                 WINED3D_SHADER_CONST_VS_B},
-        /* WINED3D_PUSH_CONSTANTS_PS_B */
-        {FIELD_OFFSET(struct wined3d_state, ps_consts_b), sizeof(BOOL),                 WINED3D_SHADER_CONST_PS_B},
-    };
-
     if (p == WINED3D_PUSH_CONSTANTS_VS_F)
         device->shader_backend->shader_update_float_vertex_constants(device, start_idx, count);
     else if (p == WINED3D_PUSH_CONSTANTS_PS_F)
         device->shader_backend->shader_update_float_pixel_constants(device, start_idx, count);
 
-    offset = push_constant_info[p].offset + start_idx * push_constant_info[p].size;
-    memcpy((BYTE *)&cs->state + offset, constants, count * push_constant_info[p].size);
+    offset = wined3d_cs_push_constant_info[p].offset + start_idx * wined3d_cs_push_constant_info[p].size;
+    memcpy((BYTE *)&cs->state + offset, constants, count * wined3d_cs_push_constant_info[p].size);
     for (i = 0, context_count = device->context_count; i < context_count; ++i)
     {
-        device->contexts[i]->constant_update_mask |= push_constant_info[p].mask;
+        device->contexts[i]->constant_update_mask |= wined3d_cs_push_constant_info[p].mask;
     }
 }
 
+static void wined3d_cs_st_finish(struct wined3d_cs *cs)
+{
+}
+
 static const struct wined3d_cs_ops wined3d_cs_st_ops =
 {
     wined3d_cs_st_require_space,
     wined3d_cs_st_submit,
+    wined3d_cs_st_finish,
     wined3d_cs_st_push_constants,
 };
 
+static BOOL wined3d_cs_queue_is_empty(const struct wined3d_cs_queue *queue)
+{
+    return *(volatile const LONG *)&queue->head == queue->tail;
+}
+
+static void *wined3d_cs_mt_require_space(struct wined3d_cs *cs, size_t size)
+{
+    struct wined3d_cs_queue *queue = cs->queue;
+    size_t queue_size = ARRAY_SIZE(queue->data);
+    size_t header_size, packet_size, remaining;
+    struct wined3d_cs_packet *packet;
+    struct wined3d_cs_nop *nop;
+    LONG head, tail, new_head;
+
+    if (cs->thread_id == GetCurrentThreadId())
+        return wined3d_cs_st_require_space(cs, size);
+
+    header_size = FIELD_OFFSET(struct wined3d_cs_packet, data[0]);
+    size = (size + header_size - 1) & ~(header_size - 1);
+    packet_size = header_size + size;
+    if (packet_size >= queue_size)
+    {
+        ERR("Packet size %lu >= queue size %u.\n",
+                (unsigned long)packet_size, WINED3D_CS_QUEUE_SIZE);
+        return NULL;
+    }
+
+    head = queue->head;
+    remaining = queue_size - head;
+    if (remaining < packet_size)
+    {
+        size_t nop_size = remaining - header_size;
+
+        TRACE("Inserting a nop for %lu + %lu bytes.\n",
+                (unsigned long)header_size, (unsigned long)nop_size);
+
+        nop = wined3d_cs_mt_require_space(cs, nop_size);
+        if (nop_size)
+            nop->opcode = WINED3D_CS_OP_NOP;
+
+        cs->ops->submit(cs);
+        head = queue->head;
+    }
+
+    new_head = (head + packet_size) & (WINED3D_CS_QUEUE_SIZE - 1);
+    for (;;)
+    {
+        tail = *(volatile const LONG *)&queue->tail;
+        if (tail <= head ? new_head != tail : head + packet_size < tail)
+            break;
+
+        wined3d_pause();
+    }
+
+    packet = (struct wined3d_cs_packet *)&queue->data[head];
+    packet->size = size;
+    return packet->data;
+}
+
+static void wined3d_cs_mt_submit(struct wined3d_cs *cs)
+{
+    struct wined3d_cs_queue *queue = cs->queue;
+    struct wined3d_cs_packet *packet;
+    size_t packet_size;
+
+    if (cs->thread_id == GetCurrentThreadId())
+    {
+        wined3d_cs_st_submit(cs);
+        return;
+    }
+
+    packet = (struct wined3d_cs_packet *)&queue->data[queue->head];
+    packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[packet->size]);
+    InterlockedExchange(&queue->head, (queue->head + packet_size) & (WINED3D_CS_QUEUE_SIZE - 1));
+
+    if (InterlockedCompareExchange(&cs->waiting_for_event, FALSE, TRUE))
+        SetEvent(cs->event);
+}
+
+static void wined3d_cs_mt_finish(struct wined3d_cs *cs)
+{
+    if (cs->thread_id == GetCurrentThreadId())
+        return;
+
+    /* The worker only signals "finish_event" if it sees "waiting_for_finish"
+     * after emptying the queue, so the queue has to be checked again after
+     * setting it. The event is manual-reset, so that it wakes every thread
+     * waiting at that point; a stale signal only causes another iteration. */
+    while (!wined3d_cs_queue_is_empty(cs->queue))
+    {
+        ResetEvent(cs->finish_event);
+        InterlockedExchange(&cs->waiting_for_finish, TRUE);
+        if (wined3d_cs_queue_is_empty(cs->queue))
+        {
+            InterlockedExchange(&cs->waiting_for_finish, FALSE);
+            break;
+        }
+        WaitForSingleObject(cs->finish_event, INFINITE);
+    }
+}
+
+static void wined3d_cs_mt_push_constants(struct wined3d_cs *cs, enum wined3d_push_constants p,
+        unsigned int start_idx, unsigned int count, const void *constants)
+{
+    struct wined3d_cs_push_constants *op;
+    size_t size;
+
+    size = count * wined3d_cs_push_constant_info[p].size;
+    op = cs->ops->require_space(cs, FIELD_OFFSET(struct wined3d_cs_push_constants, constants[size]));
+    op->opcode = WINED3D_CS_OP_PUSH_CONSTANTS;
+    op->type = p;
+    op->start_idx = start_idx;
+    op->count = count;
+    memcpy(op->constants, constants, size);
+
+    cs->ops->submit(cs);
+}
+
+static const struct wined3d_cs_ops wined3d_cs_mt_ops =
+{
+    wined3d_cs_mt_require_space,
+    wined3d_cs_mt_submit,
+    wined3d_cs_mt_finish,
+    wined3d_cs_mt_push_constants,
+};
+
+/* The worker thread sleeps on an event once the queue has been empty for a
+ * while. The event is only signalled by the submitting thread if the worker
+ * announced that it is going to wait, so the common case doesn't involve any
+ * system calls. */
+static void wined3d_cs_wait_event(struct wined3d_cs *cs)
+{
+    InterlockedExchange(&cs->waiting_for_event, TRUE);
+
+    /* The main thread might have enqueued a command and blocked on it after
+     * the CS thread decided to enter wined3d_cs_wait_event(), but before
+     * "waiting_for_event" was set.
+     *
+     * Likewise, we can race with the main thread when resetting
+     * "waiting_for_event", in which case we would need to call
+     * WaitForSingleObject() because the main thread called SetEvent(). */
+    if (!wined3d_cs_queue_is_empty(cs->queue)
+            && InterlockedCompareExchange(&cs->waiting_for_event, FALSE, TRUE))
+        return;
+
+    WaitForSingleObject(cs->event, INFINITE);
+}
+
+static void wined3d_cs_flush_context(struct wined3d_cs *cs)
+{
+    struct wined3d_context *context;
+
+    if (!(context = context_get_current()) || context->destroyed || !context->valid)
+        return;
+
+    context->gl_info->gl_ops.gl.p_glFlush();
+}
+
+static DWORD WINAPI wined3d_cs_run(void *ctx)
+{
+    struct wined3d_cs_packet *packet;
+    struct wined3d_cs_queue *queue;
+    unsigned int spin_count = 0;
+    struct wined3d_cs *cs = ctx;
+    enum wined3d_cs_op opcode;
+    LONG tail;
+
+    TRACE("Started.\n");
+
+    queue = cs->queue;
+    for (;;)
+    {
+        if (wined3d_cs_queue_is_empty(queue))
+        {
+            if (++spin_count >= WINED3D_CS_SPIN_COUNT)
+                wined3d_cs_wait_event(cs);
+            else
+                wined3d_pause();
+            continue;
+        }
+
+        spin_count = 0;
+
+        tail = queue->tail;
+        packet = (struct wined3d_cs_packet *)&queue->data[tail];
+        if (packet->size)
+        {
+            opcode = *(const enum wined3d_cs_op *)packet->data;
+
+            if (opcode >= WINED3D_CS_OP_STOP)
+            {
+                if (opcode > WINED3D_CS_OP_STOP)
+                    ERR("Invalid opcode %#x.\n", opcode);
+                break;
+            }
+
+            wined3d_cs_op_handlers[opcode](cs, packet->data);
+        }
+
+        tail += FIELD_OFFSET(struct wined3d_cs_packet, data[packet->size]);
+        tail &= (WINED3D_CS_QUEUE_SIZE - 1);
+
+        /* Make sure the GL commands submitted so far reach the driver before
+         * the queue is reported as empty; wined3d_cs_finish() callers may use
+         * the results from a different context. */
+        if (*(volatile const LONG *)&queue->head == tail)
+            wined3d_cs_flush_context(cs);
+
+        InterlockedExchange(&queue->tail, tail);
+
+        if (*(volatile const LONG *)&queue->head == tail
+                && InterlockedCompareExchange(&cs->waiting_for_finish, FALSE, TRUE))
+            SetEvent(cs->finish_event);
+    }
+
+    /* The thread's GL context must not outlive it. */
+    if (context_get_current())
+        context_set_current(NULL);
+
+    TRACE("Stopped.\n");
+    return 0;
+}
+
 struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device)
 {
     const struct wined3d_gl_info *gl_info = &device->adapter->gl_info;
@@ -1515,11 +1956,59 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device)
         return NULL;
     }
 
+    if (wined3d_settings.cs_multithreaded && !(device->wined3d->flags & WINED3D_NO3D))
+    {
+        if (!(cs->queue = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*cs->queue))))
+        {
+            ERR("Failed to allocate command stream queue.\n");
+        }
+        else if (!(cs->event = CreateEventW(NULL, FALSE, FALSE, NULL))
+                || !(cs->finish_event = CreateEventW(NULL, TRUE, FALSE, NULL)))
+        {
+            ERR("Failed to create command stream events.\n");
+        }
+        else if (!(cs->thread = CreateThread(NULL, 0, wined3d_cs_run, cs, 0, &cs->thread_id)))
+        {
+            ERR("Failed to create wined3d command stream thread.\n");
+        }
+        else
+        {
+            TRACE("Created command stream thread %04x.\n", cs->thread_id);
+            cs->ops = &wined3d_cs_mt_ops;
+        }
+
+        if (!cs->thread)
+        {
+            if (cs->finish_event)
+                CloseHandle(cs->finish_event);
+            if (cs->event)
+                CloseHandle(cs->event);
+            cs->finish_event = cs->event = NULL;
+            HeapFree(GetProcessHeap(), 0, cs->queue);
+            cs->queue = NULL;
+        }
+    }
+
     return cs;
 }
 
 void wined3d_cs_destroy(struct wined3d_cs *cs)
 {
+    struct wined3d_cs_stop *op;
+
+    if (cs->thread)
+    {
+        op = cs->ops->require_space(cs, sizeof(*op));
+        op->opcode = WINED3D_CS_OP_STOP;
+        cs->ops->submit(cs);
+
+        WaitForSingleObject(cs->thread, INFINITE);
+        CloseHandle(cs->thread);
+        CloseHandle(cs->finish_event);
+        CloseHandle(cs->event);
+        HeapFree(GetProcessHeap(), 0, cs->queue);
+    }
+
     state_cleanup(&cs->state);
     HeapFree(GetProcessHeap(), 0, cs->fb.render_targets);
     HeapFree(GetProcessHeap(), 0, cs->data);
@@ -330,7 +330,7 @@ HRESULT CDECL wined3d_query_get_data(struct wined3d_query *query,
 
     if (query->state == QUERY_CREATED)
         WARN("Query wasn't started yet.\n");
-    else if (!query->query_ops->query_poll(query))
+    else if (!wined3d_cs_query_poll(query->device->cs, query))
         return S_FALSE;
 
     if (data)
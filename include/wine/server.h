@@ -49,7 +49,21 @@ struct __server_request_info
     struct __server_iovec data[__SERVER_MAX_DATA];  /* request variable size data */
 };
 
+/* requests queued with wine_server_queue_request and sent in a single server call */
+
+#define __SERVER_BATCH_SIZE 4096
+
+struct __server_batch
+{
+    unsigned int count;       /* number of queued requests */
+    data_size_t  size;        /* size of the queued request data */
+    unsigned int status[__SERVER_BATCH_SIZE / sizeof(union generic_request)];  /* status of each request */
+    char         data[__SERVER_BATCH_SIZE];  /* queued requests, each padded to 8 bytes */
+};
+
 extern unsigned int wine_server_call( void *req_ptr );
+extern unsigned int CDECL wine_server_queue_request( struct __server_batch *batch, void *req_ptr );
+extern unsigned int CDECL wine_server_call_batch( struct __server_batch *batch );
 extern void CDECL wine_server_send_fd( int fd );
 extern int CDECL wine_server_fd_to_handle( int fd, unsigned int access, unsigned int attributes, HANDLE *handle );
 extern int CDECL wine_server_handle_to_fd( HANDLE handle, unsigned int access, int *unix_fd, unsigned int *options );
@@ -63,6 +77,13 @@ static inline unsigned int wine_server_call_err( void *req_ptr )
     return res;
 }
 
+/* start a new, empty batch of requests */
+static inline void wine_server_init_batch( struct __server_batch *batch )
+{
+    batch->count = 0;
+    batch->size  = 0;
+}
+
 /* get the size of the variable part of the returned reply */
 static inline data_size_t wine_server_reply_size( const void *reply )
 {
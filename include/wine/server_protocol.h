@@ -438,7 +438,8 @@ enum apc_type
     APC_VIRTUAL_UNLOCK,
     APC_MAP_VIEW,
     APC_UNMAP_VIEW,
-    APC_CREATE_THREAD
+    APC_CREATE_THREAD,
+    APC_CLOSE_HANDLE
 };
 
 typedef union
@@ -543,6 +544,11 @@ typedef union
         mem_size_t       reserve;
         mem_size_t       commit;
     } create_thread;
+    struct
+    {
+        enum apc_type    type;
+        obj_handle_t     handle;
+    } close_handle;
 } apc_call_t;
 
 typedef union
@@ -630,6 +636,11 @@ typedef union
         thread_id_t      tid;
         obj_handle_t     handle;
     } create_thread;
+    struct
+    {
+        enum apc_type    type;
+        unsigned int     status;
+    } close_handle;
 } apc_result_t;
 
 typedef union
@@ -701,6 +712,36 @@ typedef struct
     unsigned int   checksum;
 } pe_image_info_t;
 
+
+
+
+typedef struct
+{
+    unsigned int   seq;
+    unsigned int   wake_bits;
+    unsigned int   changed_bits;
+    unsigned int   wake_mask;
+    unsigned int   changed_mask;
+    unsigned int   input_id;
+} queue_shm_t;
+
+
+typedef struct
+{
+    unsigned int   seq;
+    unsigned int   id;
+    unsigned char  keystate[256];
+} input_shm_t;
+
+
+typedef struct
+{
+    unsigned int   seq;
+    int            cursor_x;
+    int            cursor_y;
+    unsigned int   cursor_last_change;
+} desktop_shm_t;
+
 struct rawinput_device
 {
     unsigned short usage_page;
@@ -1475,6 +1516,8 @@ struct get_handle_fd_reply
     int          cacheable;
     unsigned int access;
     unsigned int options;
+    unsigned int comp_flags;
+    char __pad_28[4];
 };
 enum server_fd_type
 {
@@ -2220,7 +2263,9 @@ struct get_mapping_info_reply
     int          protect;
     obj_handle_t mapping;
     obj_handle_t shared_file;
+    obj_handle_t aligned_file;
     /* VARARG(image,pe_image_info); */
+    char __pad_36[4];
 };
 
 
@@ -4167,6 +4212,24 @@ struct get_key_state_reply
 };
 
 
+struct get_shared_memory_request
+{
+    struct request_header __header;
+    int            type;
+};
+struct get_shared_memory_reply
+{
+    struct reply_header __header;
+    obj_handle_t   handle;
+    unsigned int   section_id;
+    unsigned int   offset;
+    unsigned int   id;
+};
+#define SHARED_MEMORY_QUEUE   0
+#define SHARED_MEMORY_INPUT   1
+#define SHARED_MEMORY_DESKTOP 2
+
+
 struct set_key_state_request
 {
     struct request_header __header;
@@ -5240,6 +5303,28 @@ struct remove_completion_reply
 };
 
 
+struct completion_info
+{
+    apc_param_t   ckey;
+    apc_param_t   cvalue;
+    apc_param_t   information;
+    unsigned int  status;
+    int           __pad;
+};
+
+
+struct remove_completions_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct remove_completions_reply
+{
+    struct reply_header __header;
+    /* VARARG(infos,completion_infos); */
+};
+
+
 
 struct query_completion_request
 {
@@ -5277,7 +5362,7 @@ struct add_fd_completion_request
     apc_param_t    cvalue;
     apc_param_t    information;
     unsigned int   status;
-    char __pad_36[4];
+    int            async;
 };
 struct add_fd_completion_reply
 {
@@ -5286,6 +5371,20 @@ struct add_fd_completion_reply
 
 
 
+struct set_fd_completion_mode_request
+{
+    struct request_header __header;
+    obj_handle_t   handle;
+    unsigned int   flags;
+    char __pad_20[4];
+};
+struct set_fd_completion_mode_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct set_fd_disp_info_request
 {
     struct request_header __header;
@@ -5547,6 +5646,22 @@ struct terminate_job_reply
 };
 
 
+
+struct batch_request
+{
+    struct request_header __header;
+    /* VARARG(requests,bytes); */
+    char __pad_12[4];
+};
+struct batch_reply
+{
+    struct reply_header __header;
+    data_size_t  count;
+    /* VARARG(status,uints); */
+    char __pad_12[4];
+};
+
+
 enum request
 {
     REQ_new_process,
@@ -5748,6 +5863,7 @@ enum request
     REQ_get_thread_input,
     REQ_get_last_input_time,
     REQ_get_key_state,
+    REQ_get_shared_memory,
     REQ_set_key_state,
     REQ_set_foreground_window,
     REQ_set_focus_window,
@@ -5812,9 +5928,11 @@ enum request
     REQ_open_completion,
     REQ_add_completion,
     REQ_remove_completion,
+    REQ_remove_completions,
     REQ_query_completion,
     REQ_set_completion_info,
     REQ_add_fd_completion,
+    REQ_set_fd_completion_mode,
     REQ_set_fd_disp_info,
     REQ_set_fd_name_info,
     REQ_get_window_layered_info,
@@ -5832,6 +5950,7 @@ enum request
     REQ_set_job_limits,
     REQ_set_job_completion_port,
     REQ_terminate_job,
+    REQ_batch,
     REQ_NB_REQUESTS
 };
 
@@ -6038,6 +6157,7 @@ union generic_request
     struct get_thread_input_request get_thread_input_request;
     struct get_last_input_time_request get_last_input_time_request;
     struct get_key_state_request get_key_state_request;
+    struct get_shared_memory_request get_shared_memory_request;
     struct set_key_state_request set_key_state_request;
     struct set_foreground_window_request set_foreground_window_request;
     struct set_focus_window_request set_focus_window_request;
@@ -6102,9 +6222,11 @@ union generic_request
     struct open_completion_request open_completion_request;
     struct add_completion_request add_completion_request;
     struct remove_completion_request remove_completion_request;
+    struct remove_completions_request remove_completions_request;
     struct query_completion_request query_completion_request;
     struct set_completion_info_request set_completion_info_request;
     struct add_fd_completion_request add_fd_completion_request;
+    struct set_fd_completion_mode_request set_fd_completion_mode_request;
     struct set_fd_disp_info_request set_fd_disp_info_request;
     struct set_fd_name_info_request set_fd_name_info_request;
     struct get_window_layered_info_request get_window_layered_info_request;
@@ -6122,6 +6244,7 @@ union generic_request
     struct set_job_limits_request set_job_limits_request;
     struct set_job_completion_port_request set_job_completion_port_request;
     struct terminate_job_request terminate_job_request;
+    struct batch_request batch_request;
 };
 union generic_reply
 {
@@ -6326,6 +6449,7 @@ union generic_reply
     struct get_thread_input_reply get_thread_input_reply;
     struct get_last_input_time_reply get_last_input_time_reply;
     struct get_key_state_reply get_key_state_reply;
+    struct get_shared_memory_reply get_shared_memory_reply;
     struct set_key_state_reply set_key_state_reply;
     struct set_foreground_window_reply set_foreground_window_reply;
     struct set_focus_window_reply set_focus_window_reply;
@@ -6390,9 +6514,11 @@ union generic_reply
     struct open_completion_reply open_completion_reply;
     struct add_completion_reply add_completion_reply;
     struct remove_completion_reply remove_completion_reply;
+    struct remove_completions_reply remove_completions_reply;
     struct query_completion_reply query_completion_reply;
     struct set_completion_info_reply set_completion_info_reply;
     struct add_fd_completion_reply add_fd_completion_reply;
+    struct set_fd_completion_mode_reply set_fd_completion_mode_reply;
     struct set_fd_disp_info_reply set_fd_disp_info_reply;
     struct set_fd_name_info_reply set_fd_name_info_reply;
     struct get_window_layered_info_reply get_window_layered_info_reply;
@@ -6410,8 +6536,9 @@ union generic_reply
     struct set_job_limits_reply set_job_limits_reply;
     struct set_job_completion_port_reply set_job_completion_port_reply;
     struct terminate_job_reply terminate_job_reply;
+    struct batch_reply batch_reply;
 };
 
-#define SERVER_PROTOCOL_VERSION 523
+#define SERVER_PROTOCOL_VERSION 531
 
 #endif /* __WINE_WINE_SERVER_PROTOCOL_H */
@@ -0,0 +1,60 @@
+/*
+ * Support for x86 SIMD code paths
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_WINE_SIMD_H
+#define __WINE_WINE_SIMD_H
+
+#ifndef __WINESRC__
+# error This is a Wine internal header
+#endif
+
+#include <windef.h>
+#include <winbase.h>
+
+/* Code that uses the intrinsics below is built for the baseline target and
+ * only enabled per function, so the callers still have to check at run time
+ * that the CPU supports the instructions. Older compilers can't mix targets
+ * within one file. */
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#include <emmintrin.h>
+#define HAVE_SSE2_INTRINSICS
+#define SSE_FUNC  __attribute__((target("sse")))
+#define SSE2_FUNC __attribute__((target("sse2")))
+#endif
+
+#ifdef HAVE_SSE2_INTRINSICS
+
+static inline BOOL wine_sse_present(void)
+{
+    return IsProcessorFeaturePresent( PF_XMMI_INSTRUCTIONS_AVAILABLE );
+}
+
+static inline BOOL wine_sse2_present(void)
+{
+    return IsProcessorFeaturePresent( PF_XMMI64_INSTRUCTIONS_AVAILABLE );
+}
+
+#else
+
+static inline BOOL wine_sse_present(void) { return FALSE; }
+static inline BOOL wine_sse2_present(void) { return FALSE; }
+
+#endif  /* HAVE_SSE2_INTRINSICS */
+
+#endif  /* __WINE_WINE_SIMD_H */
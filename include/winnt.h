@@ -824,6 +824,7 @@ NTSYSAPI VOID         WINAPI RtlInitializeSListHead(PSLIST_HEADER);
 NTSYSAPI PSLIST_ENTRY WINAPI RtlInterlockedFlushSList(PSLIST_HEADER);
 NTSYSAPI PSLIST_ENTRY WINAPI RtlInterlockedPopEntrySList(PSLIST_HEADER);
 NTSYSAPI PSLIST_ENTRY WINAPI RtlInterlockedPushEntrySList(PSLIST_HEADER, PSLIST_ENTRY);
+NTSYSAPI PSLIST_ENTRY WINAPI RtlInterlockedPushListSListEx(PSLIST_HEADER, PSLIST_ENTRY, PSLIST_ENTRY, ULONG);
 NTSYSAPI WORD         WINAPI RtlQueryDepthSList(PSLIST_HEADER);
 
 
@@ -2355,6 +2356,14 @@ extern struct _TEB * WINAPI NtCurrentTeb(void);
 #endif
 #define GetFiberData()     (*(void **)GetCurrentFiber())
 
+#if (defined(__i386__) || defined(__x86_64__)) && defined(__GNUC__)
+#define YieldProcessor() __asm__ __volatile__( "rep; nop" )
+#elif (defined(__arm__) || defined(__aarch64__)) && defined(__GNUC__)
+#define YieldProcessor() __asm__ __volatile__( "yield" )
+#else
+#define YieldProcessor() do { } while (0)
+#endif
+
 #define TLS_MINIMUM_AVAILABLE 64
 
 /*
@@ -4858,6 +4867,11 @@ typedef struct _QUOTA_LIMITS_EX {
 #define FILE_ACTION_ID_NOT_TUNNELLED          0x0000000a
 #define FILE_ACTION_TUNNELLED_ID_COLLISION    0x0000000b
 
+/* SetFileCompletionNotificationModes flags */
+#define FILE_SKIP_COMPLETION_PORT_ON_SUCCESS    0x1
+#define FILE_SKIP_SET_EVENT_ON_HANDLE           0x2
+#define FILE_SKIP_SET_USER_EVENT_ON_FAST_IO     0x4
+
 #define FILE_CASE_SENSITIVE_SEARCH      0x00000001
 #define FILE_CASE_PRESERVED_NAMES       0x00000002
 #define FILE_UNICODE_ON_DISK            0x00000004
@@ -240,6 +240,41 @@ DECL_HANDLER(remove_completion)
     release_object( completion );
 }
 
+/* get multiple completions from completion port */
+DECL_HANDLER(remove_completions)
+{
+    struct completion* completion = get_completion_obj( current->process, req->handle, IO_COMPLETION_MODIFY_STATE );
+    struct completion_info *info;
+    struct comp_msg *msg;
+    data_size_t count;
+
+    if (!completion) return;
+
+    count = min( get_reply_max_size() / sizeof(*info), completion->depth );
+    if (!completion->depth)
+        set_error( STATUS_PENDING );
+    else if (!count)
+        set_error( STATUS_BUFFER_TOO_SMALL );
+    else if ((info = set_reply_data_size( count * sizeof(*info) )))
+    {
+        while (count--)
+        {
+            msg = LIST_ENTRY( list_head( &completion->queue ), struct comp_msg, queue_entry );
+            list_remove( &msg->queue_entry );
+            completion->depth--;
+            info->ckey        = msg->ckey;
+            info->cvalue      = msg->cvalue;
+            info->information = msg->information;
+            info->status      = msg->status;
+            info->__pad       = 0;
+            free( msg );
+            info++;
+        }
+    }
+
+    release_object( completion );
+}
+
 /* get queue depth for completion port */
 DECL_HANDLER(query_completion)
 {
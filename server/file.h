@@ -137,6 +137,8 @@ extern struct mapping *get_mapping_obj( struct process *process, obj_handle_t ha
 extern obj_handle_t open_mapping_file( struct process *process, struct mapping *mapping,
                                        unsigned int access, unsigned int sharing );
 extern struct mapping *grab_mapping_unless_removable( struct mapping *mapping );
+extern struct object *create_shared_mapping( mem_size_t size, void **ptr );
+extern void release_shared_mapping( struct object *obj, void *ptr );
 extern int get_page_size(void);
 
 /* device functions */
@@ -179,6 +181,7 @@ extern int async_wake_up_by( struct async_queue *queue, struct process *process,
                              struct thread *thread, client_ptr_t iosb, unsigned int status );
 extern void async_wake_up( struct async_queue *queue, unsigned int status );
 extern struct completion *fd_get_completion( struct fd *fd, apc_param_t *p_key );
+extern unsigned int fd_get_comp_flags( struct fd *fd );
 extern void fd_copy_completion( struct fd *src, struct fd *dst );
 
 /* access rights that require Unix read permission */
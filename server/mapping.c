@@ -67,6 +67,7 @@ struct mapping
     struct ranges  *committed;       /* list of committed ranges in this mapping */
     struct file    *shared_file;     /* temp file for shared PE mapping */
     struct list     shared_entry;    /* entry in global shared PE mappings list */
+    struct file    *aligned_file;    /* temp file for page-aligned PE sections */
 };
 
 static void mapping_dump( struct object *obj, int verbose );
@@ -114,6 +115,28 @@ static const struct fd_ops mapping_fd_ops =
 
 static struct list shared_list = LIST_INIT(shared_list);
 
+/* Page-aligned copies of PE images. Image mappings only live until the loader
+ * has mapped the view, so the copies are cached by file, independently of the
+ * mappings, and evicted in least recently used order. */
+struct aligned_image
+{
+    struct list     entry;           /* entry in aligned_images, most recently used first */
+    dev_t           dev;             /* identity of the image file */
+    ino_t           ino;
+    off_t           file_size;
+    time_t          mtime;
+    size_t          copy_size;       /* number of bytes copied into the aligned file */
+    struct file    *file;            /* aligned copy, NULL until the image is loaded again */
+};
+
+static struct list aligned_images = LIST_INIT(aligned_images);
+static unsigned int aligned_images_count;
+static size_t aligned_images_size;
+
+#define MAX_ALIGNED_IMAGES      64
+#define MAX_ALIGNED_CACHE_SIZE  (256 * 1024 * 1024)  /* total size of the cached copies */
+#define MAX_ALIGNED_COPY_SIZE   (16 * 1024 * 1024)   /* max size copied for a single image */
+
 static size_t page_mask;
 
 #define ROUND_SIZE(size)  (((size) + page_mask) & ~page_mask)
@@ -209,6 +232,51 @@ static struct file *get_shared_file( struct mapping *mapping )
     return NULL;
 }
 
+/* drop the aligned copy of an image from the cache */
+static void free_aligned_image( struct aligned_image *image )
+{
+    list_remove( &image->entry );
+    if (image->file)
+    {
+        release_object( image->file );
+        aligned_images_size -= image->copy_size;
+    }
+    aligned_images_count--;
+    free( image );
+}
+
+/* find the cache entry of an image file, creating it if needed */
+static struct aligned_image *get_aligned_image( const struct stat *st, int *is_new )
+{
+    struct aligned_image *image;
+
+    LIST_FOR_EACH_ENTRY( image, &aligned_images, struct aligned_image, entry )
+    {
+        if (image->dev != st->st_dev || image->ino != st->st_ino) continue;
+        if (image->file_size != st->st_size || image->mtime != st->st_mtime) break;  /* modified */
+        list_remove( &image->entry );
+        list_add_head( &aligned_images, &image->entry );
+        *is_new = 0;
+        return image;
+    }
+    if (&image->entry != &aligned_images) free_aligned_image( image );
+
+    if (aligned_images_count >= MAX_ALIGNED_IMAGES)
+        free_aligned_image( LIST_ENTRY( list_tail( &aligned_images ), struct aligned_image, entry ));
+
+    if (!(image = mem_alloc( sizeof(*image) ))) return NULL;
+    image->dev       = st->st_dev;
+    image->ino       = st->st_ino;
+    image->file_size = st->st_size;
+    image->mtime     = st->st_mtime;
+    image->copy_size = 0;
+    image->file      = NULL;
+    list_add_head( &aligned_images, &image->entry );
+    aligned_images_count++;
+    *is_new = 1;
+    return image;
+}
+
 /* return the size of the memory mapping and file range of a given section */
 static inline void get_section_sizes( const IMAGE_SECTION_HEADER *sec, size_t *map_size,
                                       off_t *file_start, size_t *file_size )
@@ -371,6 +439,111 @@ static int build_shared_mapping( struct mapping *mapping, int fd,
     return 0;
 }
 
+/* allocate and fill the temp file for an image whose sections are not page-aligned in the file */
+/* the sections are stored at their virtual address so that the client can map them directly */
+static struct file *build_aligned_file( struct mapping *mapping, int fd,
+                                        IMAGE_SECTION_HEADER *sec, unsigned int nb_sec )
+{
+    static const size_t buffer_size = 0x10000;
+    unsigned int i;
+    size_t file_size, map_size;
+    off_t read_pos, write_pos;
+    struct file *file;
+    char *buffer;
+    int aligned_fd;
+
+    /* create a temp file for the mapping, sparse except for the section data */
+
+    if ((aligned_fd = create_temp_file( mapping->image.map_size )) == -1) return NULL;
+    if (!(file = create_file_for_fd( aligned_fd, FILE_GENERIC_READ, 0 ))) return NULL;
+
+    if (!(buffer = malloc( buffer_size ))) goto error;
+
+    for (i = 0; i < nb_sec; i++)
+    {
+        if ((sec[i].Characteristics & IMAGE_SCN_MEM_SHARED) &&
+            (sec[i].Characteristics & IMAGE_SCN_MEM_WRITE)) continue;
+        get_section_sizes( &sec[i], &map_size, &read_pos, &file_size );
+        if (!sec[i].PointerToRawData || !file_size) continue;
+        write_pos = sec[i].VirtualAddress;
+        while (file_size)
+        {
+            long res = pread( fd, buffer, min( file_size, buffer_size ), read_pos );
+            if (res < 0) goto error;
+            if (!res) break;  /* partial section at EOF, the rest stays zero */
+            if (pwrite( aligned_fd, buffer, res, write_pos ) != res) goto error;
+            file_size -= res;
+            read_pos += res;
+            write_pos += res;
+        }
+    }
+    free( buffer );
+    return file;
+
+ error:
+    release_object( file );
+    free( buffer );
+    return NULL;
+}
+
+/* find or build the page-aligned copy of an image whose sections are not page-aligned in the file */
+/* The copy is made synchronously while handling the request, which blocks all the clients, so it is
+ * only made for images that have been loaded before, and only up to MAX_ALIGNED_COPY_SIZE. Other
+ * images are copied by the client as before. */
+static void get_aligned_mapping( struct mapping *mapping, int fd, unsigned int section_align,
+                                 IMAGE_SECTION_HEADER *sec, unsigned int nb_sec )
+{
+    struct aligned_image *image;
+    struct stat st;
+    unsigned int i;
+    size_t file_size, map_size, copy_size = 0;
+    off_t read_pos;
+    int needed = 0, is_new;
+
+    if (section_align <= page_mask) return;  /* the whole file is mapped in that case */
+
+    for (i = 0; i < nb_sec; i++)
+    {
+        if ((sec[i].Characteristics & IMAGE_SCN_MEM_SHARED) &&
+            (sec[i].Characteristics & IMAGE_SCN_MEM_WRITE)) continue;
+        get_section_sizes( &sec[i], &map_size, &read_pos, &file_size );
+        if (!sec[i].PointerToRawData || !file_size) continue;
+        if (sec[i].VirtualAddress & page_mask) return;  /* the client will refuse it anyway */
+        /* the client maps every unaligned section from the copy, so all of them have to fit */
+        if (sec[i].VirtualAddress >= mapping->image.map_size ||
+            file_size > mapping->image.map_size - sec[i].VirtualAddress) return;
+        if (read_pos & page_mask) needed = 1;
+        copy_size += file_size;
+    }
+    if (!needed || copy_size > MAX_ALIGNED_COPY_SIZE) return;
+
+    if (fstat( fd, &st ) == -1) return;
+    if (!(image = get_aligned_image( &st, &is_new )))
+    {
+        clear_error();  /* not fatal, the client copies the sections by hand in that case */
+        return;
+    }
+
+    /* a single load doesn't pay for the copy, it is only made when the image is loaded again */
+    if (!image->file && !is_new)
+    {
+        /* make room for the new copy */
+        while (aligned_images_size + copy_size > MAX_ALIGNED_CACHE_SIZE)
+        {
+            struct aligned_image *old = LIST_ENTRY( list_tail( &aligned_images ), struct aligned_image, entry );
+            if (old == image) break;
+            free_aligned_image( old );
+        }
+        if ((image->file = build_aligned_file( mapping, fd, sec, nb_sec )))
+        {
+            image->copy_size = copy_size;
+            aligned_images_size += copy_size;
+        }
+        else clear_error();
+    }
+    if (image->file) mapping->aligned_file = (struct file *)grab_object( image->file );
+}
+
 /* retrieve the mapping parameters for an executable (PE) image */
 static unsigned int get_image_params( struct mapping *mapping, file_pos_t file_size, int unix_fd )
 {
@@ -388,6 +561,7 @@ static unsigned int get_image_params( struct mapping *mapping, file_pos_t file_s
     } nt;
     off_t pos;
     int size;
+    unsigned int section_align = 0;
 
     /* load the headers */
 
@@ -451,6 +625,7 @@ static unsigned int get_image_params( struct mapping *mapping, file_pos_t file_s
         mapping->image.loader_flags   = nt.opt.hdr32.LoaderFlags;
         mapping->image.header_size    = nt.opt.hdr32.SizeOfHeaders;
         mapping->image.checksum       = nt.opt.hdr32.CheckSum;
+        section_align                 = nt.opt.hdr32.SectionAlignment;
         break;
     case IMAGE_NT_OPTIONAL_HDR64_MAGIC:
         mapping->image.base           = nt.opt.hdr64.ImageBase;
@@ -465,6 +640,7 @@ static unsigned int get_image_params( struct mapping *mapping, file_pos_t file_s
         mapping->image.loader_flags   = nt.opt.hdr64.LoaderFlags;
         mapping->image.header_size    = nt.opt.hdr64.SizeOfHeaders;
         mapping->image.checksum       = nt.opt.hdr64.CheckSum;
+        section_align                 = nt.opt.hdr64.SectionAlignment;
         break;
     }
     mapping->image.image_charact = nt.FileHeader.Characteristics;
@@ -490,6 +666,8 @@ static unsigned int get_image_params( struct mapping *mapping, file_pos_t file_s
 
     if (mapping->shared_file) list_add_head( &shared_list, &mapping->shared_entry );
 
+    get_aligned_mapping( mapping, unix_fd, section_align, sec, nt.FileHeader.NumberOfSections );
+
     free( sec );
     return 0;
 
@@ -521,6 +699,7 @@ static struct object *create_mapping( struct object *root, const struct unicode_
     mapping->protect     = protect;
     mapping->fd          = NULL;
     mapping->shared_file = NULL;
+    mapping->aligned_file = NULL;
     mapping->committed   = NULL;
 
     if (protect & VPROT_READ) access |= FILE_READ_DATA;
@@ -635,13 +814,39 @@ struct mapping *grab_mapping_unless_removable( struct mapping *mapping )
     return (struct mapping *)grab_object( mapping );
 }
 
+/* create an anonymous mapping that stays mapped read-write in the server */
+/* used to publish state that clients map read-only */
+struct object *create_shared_mapping( mem_size_t size, void **ptr )
+{
+    struct object *obj;
+    struct mapping *mapping;
+    int unix_fd;
+
+    if (!(obj = create_mapping( NULL, NULL, 0, size, SEC_COMMIT, VPROT_READ | VPROT_WRITE, 0, NULL )))
+        return NULL;
+    mapping = (struct mapping *)obj;
+    if ((unix_fd = get_unix_fd( mapping->fd )) == -1) goto error;
+    *ptr = mmap( NULL, mapping->size, PROT_READ | PROT_WRITE, MAP_SHARED, unix_fd, 0 );
+    if (*ptr != MAP_FAILED) return obj;
+    file_set_error();
+ error:
+    release_object( obj );
+    return NULL;
+}
+
+void release_shared_mapping( struct object *obj, void *ptr )
+{
+    munmap( ptr, ((struct mapping *)obj)->size );
+    release_object( obj );
+}
+
 static void mapping_dump( struct object *obj, int verbose )
 {
     struct mapping *mapping = (struct mapping *)obj;
     assert( obj->ops == &mapping_ops );
-    fprintf( stderr, "Mapping size=%08x%08x flags=%08x prot=%08x fd=%p shared_file=%p\n",
+    fprintf( stderr, "Mapping size=%08x%08x flags=%08x prot=%08x fd=%p shared_file=%p aligned_file=%p\n",
              (unsigned int)(mapping->size >> 32), (unsigned int)mapping->size,
-             mapping->flags, mapping->protect, mapping->fd, mapping->shared_file );
+             mapping->flags, mapping->protect, mapping->fd, mapping->shared_file, mapping->aligned_file );
 }
 
 static struct object_type *mapping_get_type( struct object *obj )
@@ -676,6 +881,7 @@ static void mapping_destroy( struct object *obj )
         release_object( mapping->shared_file );
         list_remove( &mapping->shared_entry );
     }
+    if (mapping->aligned_file) release_object( mapping->aligned_file );
     free( mapping->committed );
 }
 
@@ -764,6 +970,12 @@ DECL_HANDLER(get_mapping_info)
             if (reply->mapping) close_handle( current->process, reply->mapping );
         }
     }
+    if (mapping->aligned_file && !get_error())
+    {
+        /* not fatal, the client copies the sections by hand without it */
+        if (!(reply->aligned_file = alloc_handle( current->process, mapping->aligned_file, GENERIC_READ, 0 )))
+            clear_error();
+    }
     release_object( mapping );
 }
 
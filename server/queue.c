@@ -114,6 +114,8 @@ struct thread_input
     int                    cursor_count;  /* cursor show count */
     struct list            msg_list;      /* list of hardware messages */
     unsigned char          keystate[256]; /* state of each key */
+    unsigned int           id;            /* unique id, reported in the queue shared memory */
+    input_shm_t           *shared;        /* state shared with the client, in the desktop shared memory */
 };
 
 struct msg_queue
@@ -140,6 +142,8 @@ struct msg_queue
     struct thread_input   *input;           /* thread input descriptor */
     struct hook_table     *hooks;           /* hook table */
     timeout_t              last_get_msg;    /* time of last get message call */
+    struct desktop        *shared_desktop;  /* desktop holding the shared memory, set on demand */
+    queue_shm_t           *shared;          /* state shared with the client */
 };
 
 struct hotkey
@@ -241,9 +245,64 @@ static void set_caret_window( struct thread_input *input, user_handle_t win )
     input->caret_state       = 0;
 }
 
+/* start an update of a shared memory block */
+static inline void shared_write_begin( unsigned int *seq )
+{
+    ++*seq;
+    __sync_synchronize();
+}
+
+/* finish an update of a shared memory block */
+static inline void shared_write_end( unsigned int *seq )
+{
+    __sync_synchronize();
+    ++*seq;
+}
+
+/* publish the queue state to the client */
+static void update_queue_shared( struct msg_queue *queue )
+{
+    queue_shm_t *shared = queue->shared;
+
+    if (!shared) return;
+    shared_write_begin( &shared->seq );
+    shared->wake_bits    = queue->wake_bits;
+    shared->changed_bits = queue->changed_bits;
+    shared->wake_mask    = queue->wake_mask;
+    shared->changed_mask = queue->changed_mask;
+    shared->input_id     = queue->input ? queue->input->id : 0;
+    shared_write_end( &shared->seq );
+}
+
+/* publish the thread input key state to the client */
+static void update_input_shared( struct thread_input *input )
+{
+    input_shm_t *shared = input->shared;
+
+    if (!shared) return;
+    shared_write_begin( &shared->seq );
+    shared->id = input->id;
+    memcpy( shared->keystate, input->keystate, sizeof(shared->keystate) );
+    shared_write_end( &shared->seq );
+}
+
+/* publish the desktop cursor state to the client */
+static void update_desktop_shared( struct desktop *desktop )
+{
+    desktop_shm_t *shared = desktop->shared;
+
+    if (!shared) return;
+    shared_write_begin( &shared->seq );
+    shared->cursor_x           = desktop->cursor.x;
+    shared->cursor_y           = desktop->cursor.y;
+    shared->cursor_last_change = desktop->cursor.last_change;
+    shared_write_end( &shared->seq );
+}
+
 /* create a thread input object */
 static struct thread_input *create_thread_input( struct thread *thread )
 {
+    static unsigned int last_input_id;
     struct thread_input *input;
 
     if ((input = alloc_object( &thread_input_ops )))
@@ -258,6 +317,8 @@ static struct thread_input *create_thread_input( struct thread *thread )
         list_init( &input->msg_list );
         set_caret_window( input, 0 );
         memset( input->keystate, 0, sizeof(input->keystate) );
+        input->id             = ++last_input_id;
+        input->shared         = NULL;
 
         if (!(input->desktop = get_thread_desktop( thread, 0 /* FIXME: access rights */ )))
         {
@@ -298,6 +359,8 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         queue->input           = (struct thread_input *)grab_object( input );
         queue->hooks           = NULL;
         queue->last_get_msg    = current_time;
+        queue->shared_desktop  = NULL;
+        queue->shared          = NULL;
         list_init( &queue->send_result );
         list_init( &queue->callback_result );
         list_init( &queue->pending_timers );
@@ -336,6 +399,7 @@ static int assign_thread_input( struct thread *thread, struct thread_input *new_
     }
     queue->input = (struct thread_input *)grab_object( new_input );
     new_input->cursor_count += queue->cursor_count;
+    update_queue_shared( queue );
     return 1;
 }
 
@@ -440,6 +504,7 @@ static inline void set_queue_bits( struct msg_queue *queue, unsigned int bits )
 {
     queue->wake_bits |= bits;
     queue->changed_bits |= bits;
+    update_queue_shared( queue );
     if (is_signaled( queue )) wake_up( &queue->obj, 0 );
 }
 
@@ -448,6 +513,7 @@ static inline void clear_queue_bits( struct msg_queue *queue, unsigned int bits
 {
     queue->wake_bits &= ~bits;
     queue->changed_bits &= ~bits;
+    update_queue_shared( queue );
 }
 
 /* check whether msg is a keyboard message */
@@ -957,6 +1023,7 @@ static void msg_queue_satisfied( struct object *obj, struct wait_queue_entry *en
     struct msg_queue *queue = (struct msg_queue *)obj;
     queue->wake_mask = 0;
     queue->changed_mask = 0;
+    update_queue_shared( queue );
 }
 
 static void msg_queue_destroy( struct object *obj )
@@ -995,6 +1062,11 @@ static void msg_queue_destroy( struct object *obj )
     release_object( queue->input );
     if (queue->hooks) release_object( queue->hooks );
     if (queue->fd) release_object( queue->fd );
+    if (queue->shared_desktop)
+    {
+        free_desktop_shared( queue->shared_desktop, queue->shared, sizeof(*queue->shared) );
+        release_object( queue->shared_desktop );
+    }
 }
 
 static void msg_queue_poll_event( struct fd *fd, int event )
@@ -1021,6 +1093,7 @@ static void thread_input_destroy( struct object *obj )
     empty_msg_list( &input->msg_list );
     if (input->desktop)
     {
+        if (input->shared) free_desktop_shared( input->desktop, input->shared, sizeof(*input->shared) );
         if (input->desktop->foreground_input == input) set_foreground_input( input->desktop, NULL );
         release_object( input->desktop );
     }
@@ -1091,7 +1164,11 @@ int attach_thread_input( struct thread *thread_from, struct thread *thread_to )
     }
 
     ret = assign_thread_input( thread_from, input );
-    if (ret) memset( input->keystate, 0, sizeof(input->keystate) );
+    if (ret)
+    {
+        memset( input->keystate, 0, sizeof(input->keystate) );
+        update_input_shared( input );
+    }
     release_object( input );
     return ret;
 }
@@ -1356,6 +1433,7 @@ static void release_hardware_message( struct msg_queue *queue, unsigned int hw_i
         if (clr_bit) clear_queue_bits( queue, clr_bit );
 
         update_input_key_state( input->desktop, input->keystate, msg );
+        update_input_shared( input );
         list_remove( &msg->entry );
         free_message( msg );
     }
@@ -1495,6 +1573,7 @@ static void queue_hardware_message( struct desktop *desktop, struct message *msg
             desktop->cursor.x = x;
             desktop->cursor.y = y;
             desktop->cursor.last_change = get_tick_count();
+            update_desktop_shared( desktop );
         }
         if (desktop->keystate[VK_LBUTTON] & 0x80)  msg->wparam |= MK_LBUTTON;
         if (desktop->keystate[VK_MBUTTON] & 0x80)  msg->wparam |= MK_MBUTTON;
@@ -1517,7 +1596,11 @@ static void queue_hardware_message( struct desktop *desktop, struct message *msg
     win = find_hardware_message_window( desktop, input, msg, &msg_code, &thread );
     if (!win || !thread)
     {
-        if (input) update_input_key_state( input->desktop, input->keystate, msg );
+        if (input)
+        {
+            update_input_key_state( input->desktop, input->keystate, msg );
+            update_input_shared( input );
+        }
         free_message( msg );
         return;
     }
@@ -1611,6 +1694,7 @@ static int queue_mouse_message( struct desktop *desktop, user_handle_t win, cons
     };
 
     desktop->cursor.last_change = get_tick_count();
+    update_desktop_shared( desktop );
     flags = input->mouse.flags;
     time  = input->mouse.time;
     if (!time) time = desktop->cursor.last_change;
@@ -1960,6 +2044,7 @@ static int get_hardware_message( struct thread *thread, unsigned int hw_id, user
         {
             /* no window at all, remove it */
             update_input_key_state( input->desktop, input->keystate, msg );
+            update_input_shared( input );
             list_remove( &msg->entry );
             free_message( msg );
             continue;
@@ -1976,6 +2061,7 @@ static int get_hardware_message( struct thread *thread, unsigned int hw_id, user
             {
                 /* for another thread input, drop it */
                 update_input_key_state( input->desktop, input->keystate, msg );
+                update_input_shared( input );
                 list_remove( &msg->entry );
                 free_message( msg );
             }
@@ -2264,6 +2350,7 @@ DECL_HANDLER(set_queue_mask)
             if (req->skip_wait) queue->wake_mask = queue->changed_mask = 0;
             else wake_up( &queue->obj, 0 );
         }
+        update_queue_shared( queue );
     }
 }
 
@@ -2277,6 +2364,7 @@ DECL_HANDLER(get_queue_status)
         reply->wake_bits    = queue->wake_bits;
         reply->changed_bits = queue->changed_bits;
         queue->changed_bits &= ~req->clear_bits;
+        update_queue_shared( queue );
     }
     else reply->wake_bits = reply->changed_bits = 0;
 }
@@ -2452,6 +2540,7 @@ DECL_HANDLER(get_message)
     }
     if (filter & QS_INPUT) queue->changed_bits &= ~QS_INPUT;
     if (filter & QS_PAINT) queue->changed_bits &= ~QS_PAINT;
+    update_queue_shared( queue );
 
     /* then check for posted messages */
     if ((filter & QS_POSTMESSAGE) &&
@@ -2506,6 +2595,7 @@ DECL_HANDLER(get_message)
     if (get_win == -1 && current->process->idle_event) set_event( current->process->idle_event );
     queue->wake_mask = req->wake_mask;
     queue->changed_mask = req->changed_mask;
+    update_queue_shared( queue );
     set_error( STATUS_PENDING );  /* FIXME */
 }
 
@@ -2928,7 +3018,11 @@ DECL_HANDLER(set_key_state)
     else
     {
         if (!(thread = get_thread_from_id( req->tid ))) return;
-        if (thread->queue) memcpy( thread->queue->input->keystate, get_req_data(), size );
+        if (thread->queue)
+        {
+            memcpy( thread->queue->input->keystate, get_req_data(), size );
+            update_input_shared( thread->queue->input );
+        }
         if (req->async && (desktop = get_thread_desktop( thread, 0 )))
         {
             memcpy( desktop->keystate, get_req_data(), size );
@@ -2939,6 +3033,64 @@ DECL_HANDLER(set_key_state)
 }
 
 
+/* retrieve a read-only mapping of the state of the current queue, thread input or desktop */
+DECL_HANDLER(get_shared_memory)
+{
+    struct msg_queue *queue;
+    struct thread_input *input;
+    struct desktop *desktop;
+
+    switch (req->type)
+    {
+    case SHARED_MEMORY_QUEUE:
+        if (!(queue = get_current_queue())) return;
+        if (!queue->shared)
+        {
+            if (!(desktop = get_thread_desktop( current, 0 ))) return;
+            if (!(queue->shared = alloc_desktop_shared( desktop, sizeof(*queue->shared) )))
+            {
+                release_object( desktop );
+                return;
+            }
+            queue->shared_desktop = desktop;
+            update_queue_shared( queue );
+        }
+        reply->handle = get_desktop_shared_handle( queue->shared_desktop, queue->shared,
+                                                   &reply->section_id, &reply->offset );
+        reply->id = get_thread_id( current );
+        break;
+    case SHARED_MEMORY_INPUT:
+        if (!(queue = get_current_queue())) return;
+        input = queue->input;
+        if (!input->shared)
+        {
+            if (!(input->shared = alloc_desktop_shared( input->desktop, sizeof(*input->shared) ))) return;
+            update_input_shared( input );
+        }
+        reply->handle = get_desktop_shared_handle( input->desktop, input->shared,
+                                                   &reply->section_id, &reply->offset );
+        reply->id = input->id;
+        break;
+    case SHARED_MEMORY_DESKTOP:
+        if (!(desktop = get_thread_desktop( current, 0 ))) return;
+        if (!get_desktop_shared( desktop ))
+        {
+            release_object( desktop );
+            return;
+        }
+        /* the shared memory may have been created for a queue block */
+        update_desktop_shared( desktop );
+        reply->handle = get_desktop_shared_handle( desktop, desktop->shared,
+                                                   &reply->section_id, &reply->offset );
+        reply->id = 0;
+        release_object( desktop );
+        break;
+    default:
+        set_error( STATUS_INVALID_PARAMETER );
+        break;
+    }
+}
+
 /* set the system foreground window */
 DECL_HANDLER(set_foreground_window)
 {
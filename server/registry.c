@@ -125,21 +125,39 @@ struct save_branch_info
 {
     struct key  *key;
     const char  *path;
+    char        *journal;      /* path of the journal file */
+    file_pos_t   base_size;    /* size of the branch file at the last full save */
+    file_pos_t   journal_size; /* current size of the journal file */
+    unsigned int generation;   /* generation of the branch file, the journal must match it */
 };
 
 #define MAX_SAVE_BRANCH_INFO 3
 static int save_branch_count;
 static struct save_branch_info save_branch_info[MAX_SAVE_BRANCH_INFO];
 
+/* a key deleted since the last save of its branch */
+struct deleted_key
+{
+    struct list  entry;   /* entry in list of deleted keys */
+    int          branch;  /* index of the branch in save_branch_info */
+    data_size_t  len;     /* length of the path */
+    WCHAR        path[1]; /* path relative to the branch key */
+};
+
+static struct list deleted_keys = LIST_INIT(deleted_keys);
+
 
 /* information about a file being loaded */
 struct file_load_info
 {
     const char *filename; /* input file name */
-    FILE       *file;     /* input file */
-    char       *buffer;   /* line buffer */
-    int         len;      /* buffer length */
+    char       *data;     /* file contents */
+    char       *pos;      /* start of the next line */
+    char       *end;      /* end of the file contents */
+    char       *buffer;   /* current line */
     int         line;     /* current input line */
+    int         journal;  /* file is a journal */
+    unsigned int *generation; /* generation of the branch file, NULL if not an initial registry file */
     WCHAR      *tmp;      /* temp buffer to use while parsing input */
     size_t      tmplen;   /* length of temp buffer */
 };
@@ -241,7 +259,12 @@ static void dump_value( const struct key_value *value, FILE *f )
     else count += fprintf( f, "hex(%x):", value->type );
     for (i = 0; i < value->len; i++)
     {
-        count += fprintf( f, "%02x", *((unsigned char *)value->data + i) );
+        static const char hex[] = "0123456789abcdef";
+        unsigned char byte = *((unsigned char *)value->data + i);
+
+        fputc( hex[byte >> 4], f );
+        fputc( hex[byte & 0x0f], f );
+        count += 2;
         if (i < value->len-1)
         {
             fputc( ',', f );
@@ -255,6 +278,25 @@ static void dump_value( const struct key_value *value, FILE *f )
     fputc( '\n', f );
 }
 
+/* save a single registry key and its values to a text file */
+static void save_key( const struct key *key, const struct key *base, FILE *f )
+{
+    int i;
+
+    fprintf( f, "\n[" );
+    if (key != base) dump_path( key, base, f );
+    fprintf( f, "] %u\n", (unsigned int)((key->modif - ticks_1601_to_1970) / TICKS_PER_SEC) );
+    fprintf( f, "#time=%x%08x\n", (unsigned int)(key->modif >> 32), (unsigned int)key->modif );
+    if (key->class)
+    {
+        fprintf( f, "#class=\"" );
+        dump_strW( key->class, key->classlen / sizeof(WCHAR), f, "\"\"" );
+        fprintf( f, "\"\n" );
+    }
+    if (key->flags & KEY_SYMLINK) fputs( "#link\n", f );
+    for (i = 0; i <= key->last_value; i++) dump_value( &key->values[i], f );
+}
+
 /* save a registry and all its subkeys to a text file */
 static void save_subkeys( const struct key *key, const struct key *base, FILE *f )
 {
@@ -264,23 +306,22 @@ static void save_subkeys( const struct key *key, const struct key *base, FILE *f
     /* save key if it has either some values or no subkeys, or needs special options */
     /* keys with no values but subkeys are saved implicitly by saving the subkeys */
     if ((key->last_value >= 0) || (key->last_subkey == -1) || key->class || (key->flags & KEY_SYMLINK))
-    {
-        fprintf( f, "\n[" );
-        if (key != base) dump_path( key, base, f );
-        fprintf( f, "] %u\n", (unsigned int)((key->modif - ticks_1601_to_1970) / TICKS_PER_SEC) );
-        fprintf( f, "#time=%x%08x\n", (unsigned int)(key->modif >> 32), (unsigned int)key->modif );
-        if (key->class)
-        {
-            fprintf( f, "#class=\"" );
-            dump_strW( key->class, key->classlen / sizeof(WCHAR), f, "\"\"" );
-            fprintf( f, "\"\n" );
-        }
-        if (key->flags & KEY_SYMLINK) fputs( "#link\n", f );
-        for (i = 0; i <= key->last_value; i++) dump_value( &key->values[i], f );
-    }
+        save_key( key, base, f );
     for (i = 0; i <= key->last_subkey; i++) save_subkeys( key->subkeys[i], base, f );
 }
 
+/* save the modified keys of a registry branch to a journal file */
+/* every modified key is saved with its full set of values, which replaces the previous one on load */
+static void journal_subkeys( const struct key *key, const struct key *base, FILE *f )
+{
+    int i;
+
+    if (key->flags & KEY_VOLATILE) return;
+    if (!(key->flags & KEY_DIRTY)) return;
+    save_key( key, base, f );
+    for (i = 0; i <= key->last_subkey; i++) journal_subkeys( key->subkeys[i], base, f );
+}
+
 static void dump_operation( const struct key *key, const struct key_value *value, const char *op )
 {
     fprintf( stderr, "%s key ", op );
@@ -982,6 +1023,55 @@ static void enum_key( const struct key *key, int index, int info_class,
     if (debug_level > 1) dump_operation( key, NULL, "Enum" );
 }
 
+/* remember a deleted key so that the deletion can be written to the journal of its branch */
+static void record_deleted_key( const struct key *key )
+{
+    struct deleted_key *deleted;
+    const struct key *parent;
+    data_size_t len = 0;
+    WCHAR *p;
+    int i = 0;
+
+    for (parent = key; parent; parent = parent->parent)
+    {
+        for (i = 0; i < save_branch_count; i++)
+            if (save_branch_info[i].key == parent) break;
+        if (i < save_branch_count) break;
+        len += parent->namelen + sizeof(WCHAR);
+    }
+    if (!parent || parent == key) return;  /* not inside a saved branch */
+
+    if (!(deleted = malloc( offsetof( struct deleted_key, path[len / sizeof(WCHAR)] ))))
+    {
+        /* force a full save of the branch instead */
+        save_branch_info[i].journal_size = ~(file_pos_t)0;
+        return;
+    }
+    deleted->branch = i;
+    deleted->len = len - sizeof(WCHAR);
+    p = deleted->path + deleted->len / sizeof(WCHAR);
+    for (; key != parent; key = key->parent)
+    {
+        p -= key->namelen / sizeof(WCHAR);
+        memcpy( p, key->name, key->namelen );
+        if (p > deleted->path) *--p = '\\';
+    }
+    list_add_tail( &deleted_keys, &deleted->entry );
+}
+
+/* forget the deleted keys of a branch once it has been saved */
+static void free_deleted_keys( int branch )
+{
+    struct deleted_key *deleted, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE( deleted, next, &deleted_keys, struct deleted_key, entry )
+    {
+        if (deleted->branch != branch) continue;
+        list_remove( &deleted->entry );
+        free( deleted );
+    }
+}
+
 /* delete a key and its values */
 static int delete_key( struct key *key, int recurse )
 {
@@ -1012,6 +1102,7 @@ static int delete_key( struct key *key, int recurse )
     }
 
     if (debug_level > 1) dump_operation( key, NULL, "Delete" );
+    if (!(key->flags & KEY_VOLATILE)) record_deleted_key( key );
     free_subkey( parent, index );
     touch_key( parent, REG_NOTIFY_CHANGE_NAME );
     return 0;
@@ -1265,37 +1356,49 @@ static inline struct key *get_parent_hkey_obj( obj_handle_t hkey )
     return get_hkey_obj( hkey, 0 );
 }
 
-/* read a line from the input file */
-static int read_next_line( struct file_load_info *info )
+/* read the whole input file into memory */
+static int read_file_data( struct file_load_info *info, FILE *f )
 {
-    char *newbuf;
-    int newlen, pos = 0;
+    struct stat st;
+    size_t size, len = 0;
+    char *data;
 
-    info->line++;
+    if (!fstat( fileno( f ), &st ) && S_ISREG( st.st_mode ) && st.st_size > 0) size = st.st_size + 1;
+    else size = 4096;
+
+    if (!(info->data = mem_alloc( size ))) return 0;
     for (;;)
     {
-        if (!fgets( info->buffer + pos, info->len - pos, info->file ))
-            return (pos != 0);  /* EOF */
-        pos = strlen(info->buffer);
-        if (info->buffer[pos-1] == '\n')
-        {
-            /* got a full line */
-            info->buffer[--pos] = 0;
-            if (pos > 0 && info->buffer[pos-1] == '\r') info->buffer[pos-1] = 0;
-            return 1;
-        }
-        if (pos < info->len - 1) return 1;  /* EOF but something was read */
-
-        /* need to enlarge the buffer */
-        newlen = info->len + info->len / 2;
-        if (!(newbuf = realloc( info->buffer, newlen )))
+        len += fread( info->data + len, 1, size - len, f );
+        if (len < size) break;
+        /* need to enlarge the buffer; always keep room for the final null */
+        size += size / 2;
+        if (!(data = realloc( info->data, size )))
         {
             set_error( STATUS_NO_MEMORY );
-            return -1;
+            return 0;
         }
-        info->buffer = newbuf;
-        info->len = newlen;
+        info->data = data;
     }
+    info->pos = info->data;
+    info->end = info->data + len;
+    return 1;
+}
+
+/* read a line from the input file */
+static int read_next_line( struct file_load_info *info )
+{
+    char *end;
+
+    if (info->pos >= info->end) return 0;  /* EOF */
+
+    info->line++;
+    info->buffer = info->pos;
+    if ((end = memchr( info->pos, '\n', info->end - info->pos ))) info->pos = end + 1;
+    else info->pos = end = info->end;
+    *end = 0;
+    if (end > info->buffer && end[-1] == '\r') end[-1] = 0;
+    return 1;
 }
 
 /* make sure the temp buffer holds enough space */
@@ -1411,7 +1514,18 @@ static int load_global_option( const char *buffer, struct file_load_info *info )
 {
     const char *p;
 
-    if (!strncmp( buffer, "#arch=", 6 ))
+    if (!strncmp( buffer, "#generation=", 12 ))
+    {
+        if (info->generation) *info->generation = strtoul( buffer + 12, NULL, 16 );
+    }
+    else if (!strncmp( buffer, "#journal=", 9 ))
+    {
+        if (!info->generation) return 1;  /* only valid for the initial registry files */
+        /* a journal left over from before the last full save, ignore it */
+        if (strtoul( buffer + 9, NULL, 16 ) != *info->generation) return 0;
+        info->journal = 1;
+    }
+    else if (!strncmp( buffer, "#arch=", 6 ))
     {
         enum prefix_type type;
         p = buffer + 6;
@@ -1469,20 +1583,34 @@ static int load_key_option( struct key *key, const char *buffer, struct file_loa
     return 1;
 }
 
+/* convert a hex digit to its value, or -1 if not a hex digit */
+static inline int get_hex_digit( char c )
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
 /* parse a comma-separated list of hex digits */
 static int parse_hex( unsigned char *dest, data_size_t *len, const char *buffer )
 {
     const char *p = buffer;
     data_size_t count = 0;
-    char *end;
+    int digit;
 
-    while (isxdigit(*p))
+    while ((digit = get_hex_digit( *p )) != -1)
     {
-        unsigned int val = strtoul( p, &end, 16 );
-        if (end == p || val > 0xff) return -1;
+        unsigned int val = 0;
+
+        do
+        {
+            val = (val << 4) | digit;
+            if (val > 0xff) return -1;
+        } while ((digit = get_hex_digit( *++p )) != -1);
+
         if (count++ >= *len) return -1;  /* dest buffer overflow */
         *dest++ = val;
-        p = end;
         while (isspace(*p)) p++;
         if (*p == ',') p++;
         while (isspace(*p)) p++;
@@ -1621,9 +1749,57 @@ static int get_prefix_len( struct key *key, const char *name, struct file_load_i
     return res;
 }
 
+/* clear the contents of a key before loading it again from a journal file */
+static void reset_key( struct key *key )
+{
+    int i;
+
+    for (i = 0; i <= key->last_value; i++)
+    {
+        free( key->values[i].name );
+        free( key->values[i].data );
+    }
+    key->last_value = -1;
+    free( key->class );
+    key->class = NULL;
+    key->classlen = 0;
+    key->flags &= ~KEY_SYMLINK;
+    key->modif = 0;
+}
+
+/* delete a key recorded as deleted in a journal file */
+static void load_deleted_key( struct key *base, const char *buffer, struct file_load_info *info )
+{
+    struct unicode_str name, token;
+    struct key *key = base;
+    data_size_t len;
+    int index;
+
+    if (*buffer++ != '"' || !get_file_tmp_space( info, strlen(buffer) * sizeof(WCHAR) )) goto error;
+    len = info->tmplen;
+    if (parse_strW( info->tmp, &len, buffer, '"' ) == -1) goto error;
+
+    name.str = info->tmp;
+    name.len = len - sizeof(WCHAR);
+    token.str = NULL;
+    if (!get_path_token( &name, &token )) goto error;
+    while (token.len)
+    {
+        if (!(key = find_subkey( key, &token, &index ))) return;  /* already gone */
+        get_path_token( &name, &token );
+    }
+    if (key != base) delete_key( key, 1 );
+    return;
+
+ error:
+    file_read_error( "Malformed key", info );
+}
+
 /* load all the keys from the input file */
 /* prefix_len is the number of key name prefixes to skip, or -1 for autodetection */
-static void load_keys( struct key *key, const char *filename, FILE *f, int prefix_len )
+/* generation is only set for the initial registry files; return TRUE if the file was a journal */
+static int load_keys( struct key *key, const char *filename, FILE *f, int prefix_len,
+                      unsigned int *generation )
 {
     struct key *subkey = NULL;
     struct file_load_info info;
@@ -1631,15 +1807,21 @@ static void load_keys( struct key *key, const char *filename, FILE *f, int prefi
     char *p;
 
     info.filename = filename;
-    info.file   = f;
-    info.len    = 4;
-    info.tmplen = 4;
-    info.line   = 0;
-    if (!(info.buffer = mem_alloc( info.len ))) return;
+    info.data    = NULL;
+    info.buffer  = NULL;
+    info.tmplen  = 4;
+    info.line    = 0;
+    info.journal = 0;
+    info.generation = generation;
+    if (!read_file_data( &info, f ))
+    {
+        free( info.data );
+        return 0;
+    }
     if (!(info.tmp = mem_alloc( info.tmplen )))
     {
-        free( info.buffer );
-        return;
+        free( info.data );
+        return 0;
     }
 
     if ((read_next_line( &info ) != 1) ||
@@ -1664,6 +1846,7 @@ static void load_keys( struct key *key, const char *filename, FILE *f, int prefi
             if (prefix_len == -1) prefix_len = get_prefix_len( key, p + 1, &info );
             if (!(subkey = load_key( key, p + 1, prefix_len, &info, &modif )))
                 file_read_error( "Error creating key", &info );
+            else if (info.journal) reset_key( subkey );
             break;
         case '@':   /* default value */
         case '\"':  /* value */
@@ -1671,7 +1854,17 @@ static void load_keys( struct key *key, const char *filename, FILE *f, int prefi
             else file_read_error( "Value without key", &info );
             break;
         case '#':   /* option */
-            if (subkey) load_key_option( subkey, p, &info );
+            if (info.journal && !strncmp( p, "#delete=", 8 ))
+            {
+                if (subkey)
+                {
+                    update_key_time( subkey, modif );
+                    release_object( subkey );
+                    subkey = NULL;
+                }
+                load_deleted_key( key, p + 8, &info );
+            }
+            else if (subkey) load_key_option( subkey, p, &info );
             else if (!load_global_option( p, &info )) goto done;
             break;
         case ';':   /* comment */
@@ -1689,8 +1882,9 @@ static void load_keys( struct key *key, const char *filename, FILE *f, int prefi
         update_key_time( subkey, modif );
         release_object( subkey );
     }
-    free( info.buffer );
+    free( info.data );
     free( info.tmp );
+    return info.journal;
 }
 
 /* load a part of the registry from a file */
@@ -1707,7 +1901,7 @@ static void load_registry( struct key *key, obj_handle_t handle )
         FILE *f = fdopen( fd, "r" );
         if (f)
         {
-            load_keys( key, NULL, f, -1 );
+            load_keys( key, NULL, f, -1, NULL );
             fclose( f );
         }
         else file_set_error();
@@ -1717,23 +1911,56 @@ static void load_registry( struct key *key, obj_handle_t handle )
 /* load one of the initial registry files */
 static int load_init_registry_from_file( const char *filename, struct key *key )
 {
-    FILE *f;
+    static const char journal_ext[] = ".journal";
+    struct save_branch_info *info;
+    struct stat st;
+    FILE *f, *journal;
+    char *journal_path;
+
+    if (!(journal_path = malloc( strlen(filename) + sizeof(journal_ext) )))
+        fatal_error( "out of memory\n" );
+    strcpy( journal_path, filename );
+    strcat( journal_path, journal_ext );
+
+    assert( save_branch_count < MAX_SAVE_BRANCH_INFO );
+
+    info = &save_branch_info[save_branch_count];
+    info->generation = 0;
 
     if ((f = fopen( filename, "r" )))
     {
-        load_keys( key, filename, f, 0 );
+        load_keys( key, filename, f, 0, &info->generation );
         fclose( f );
         if (get_error() == STATUS_NOT_REGISTRY_FILE)
         {
             fprintf( stderr, "%s is not a valid registry file\n", filename );
+            free( journal_path );
             return 1;
         }
     }
 
-    assert( save_branch_count < MAX_SAVE_BRANCH_INFO );
+    info->path = filename;
+    info->journal = journal_path;
+    info->base_size = (f && !stat( filename, &st )) ? st.st_size : 0;
+    info->journal_size = 0;
+
+    /* replay the changes made since the last full save; a journal of another
+     * generation was already merged into the branch file and gets overwritten */
+    if ((journal = fopen( journal_path, "r" )))
+    {
+        int replayed = load_keys( key, journal_path, journal, 0, &info->generation );
+
+        fclose( journal );
+        if (get_error() == STATUS_NOT_REGISTRY_FILE)
+            fprintf( stderr, "%s is not a valid registry journal\n", journal_path );
+        else if (replayed && !stat( journal_path, &st ))
+            info->journal_size = st.st_size;
+        clear_error();
+        make_clean( key );
+    }
 
-    save_branch_info[save_branch_count].path = filename;
-    save_branch_info[save_branch_count++].key = (struct key *)grab_object( key );
+    info->key = (struct key *)grab_object( key );
+    save_branch_count++;
     make_object_static( &key->obj );
     return (f != NULL);
 }
@@ -1871,7 +2098,8 @@ void init_registry(void)
 }
 
 /* save a registry branch to a file */
-static void save_all_subkeys( struct key *key, FILE *f )
+/* generation is written for the initial registry files only, 0 otherwise */
+static void save_all_subkeys( struct key *key, FILE *f, unsigned int generation )
 {
     fprintf( f, "WINE REGISTRY Version 2\n" );
     fprintf( f, ";; All keys relative to " );
@@ -1888,6 +2116,7 @@ static void save_all_subkeys( struct key *key, FILE *f )
     default:
         break;
     }
+    if (generation) fprintf( f, "#generation=%x\n", generation );
     save_subkeys( key, key, f );
 }
 
@@ -1905,7 +2134,7 @@ static void save_registry( struct key *key, obj_handle_t handle )
         FILE *f = fdopen( fd, "w" );
         if (f)
         {
-            save_all_subkeys( key, f );
+            save_all_subkeys( key, f, 0 );
             if (fclose( f )) file_set_error();
         }
         else
@@ -1917,14 +2146,18 @@ static void save_registry( struct key *key, obj_handle_t handle )
 }
 
 /* save a registry branch to a file */
-static int save_branch( struct key *key, const char *path )
+static int save_branch( struct save_branch_info *info )
 {
+    struct key *key = info->key;
+    const char *path = info->path;
     struct stat st;
     char *p, *tmp = NULL;
     int fd, count = 0, ret = 0;
+    file_pos_t size = 0;
+    unsigned int generation = info->generation + 1;
     FILE *f;
 
-    if (!(key->flags & KEY_DIRTY))
+    if (!(key->flags & KEY_DIRTY) && !info->journal_size)
     {
         if (debug_level > 1) dump_operation( key, NULL, "Not saving clean" );
         return 1;
@@ -1974,7 +2207,11 @@ static int save_branch( struct key *key, const char *path )
         dump_operation( key, NULL, "saving" );
     }
 
-    save_all_subkeys( key, f );
+    /* a new generation makes the loader ignore the current journal, even if
+     * we don't get to remove it after the branch file has been replaced */
+    if (!generation) generation = 1;
+    save_all_subkeys( key, f, generation );
+    size = ftell( f );
     ret = !fclose(f);
 
     if (tmp)
@@ -1986,7 +2223,76 @@ static int save_branch( struct key *key, const char *path )
 
 done:
     free( tmp );
-    if (ret) make_clean( key );
+    if (ret)
+    {
+        /* the journal is now part of the branch file */
+        unlink( info->journal );
+        info->generation = generation;
+        info->base_size = size;
+        info->journal_size = 0;
+        free_deleted_keys( info - save_branch_info );
+        make_clean( key );
+    }
+    return ret;
+}
+
+/* append the keys modified since the last save of a registry branch to its journal */
+static int journal_branch( struct save_branch_info *info )
+{
+    struct key *key = info->key;
+    struct deleted_key *deleted;
+    int fd, ret, branch = info - save_branch_info;
+    file_pos_t size;
+    FILE *f;
+
+    if (!(key->flags & KEY_DIRTY))
+    {
+        if (debug_level > 1) dump_operation( key, NULL, "Not saving clean" );
+        return 1;
+    }
+
+    /* rewrite the whole branch once the journal is larger than the branch file itself */
+    if (!info->base_size || info->journal_size > info->base_size) return save_branch( info );
+
+    if ((fd = open( info->journal, O_WRONLY | O_APPEND | O_CREAT | (info->journal_size ? 0 : O_TRUNC),
+                    0666 )) == -1)
+        return save_branch( info );
+    if (!(f = fdopen( fd, "a" )))
+    {
+        close( fd );
+        return save_branch( info );
+    }
+
+    if (debug_level > 1)
+    {
+        fprintf( stderr, "%s: ", info->journal );
+        dump_operation( key, NULL, "journaling" );
+    }
+
+    if (!info->journal_size)
+    {
+        fprintf( f, "WINE REGISTRY Version 2\n" );
+        fprintf( f, ";; Changes to keys relative to " );
+        dump_path( key, NULL, f );
+        fprintf( f, "\n\n#journal=%x\n", info->generation );
+    }
+    LIST_FOR_EACH_ENTRY( deleted, &deleted_keys, struct deleted_key, entry )
+    {
+        if (deleted->branch != branch) continue;
+        fprintf( f, "\n#delete=\"" );
+        dump_strW( deleted->path, deleted->len / sizeof(WCHAR), f, "\"\"" );
+        fprintf( f, "\"\n" );
+    }
+    journal_subkeys( key, key, f );
+    size = ftell( f );
+    ret = !fclose( f );
+
+    if (ret)
+    {
+        info->journal_size = size;
+        free_deleted_keys( branch );
+        make_clean( key );
+    }
     return ret;
 }
 
@@ -1998,7 +2304,7 @@ static void periodic_save( void *arg )
     if (fchdir( config_dir_fd ) == -1) return;
     save_timeout_user = NULL;
     for (i = 0; i < save_branch_count; i++)
-        save_branch( save_branch_info[i].key, save_branch_info[i].path );
+        journal_branch( &save_branch_info[i] );
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
     set_periodic_save_timer();
 }
@@ -2018,7 +2324,7 @@ void flush_registry(void)
     if (fchdir( config_dir_fd ) == -1) return;
     for (i = 0; i < save_branch_count; i++)
     {
-        if (!save_branch( save_branch_info[i].key, save_branch_info[i].path ))
+        if (!save_branch( &save_branch_info[i] ))
         {
             fprintf( stderr, "wineserver: could not save registry branch to %s",
                      save_branch_info[i].path );
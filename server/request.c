@@ -323,6 +323,74 @@ static void call_req_handler( struct thread *thread )
     current = NULL;
 }
 
+/* process a batch of requests, discarding their replies */
+DECL_HANDLER(batch)
+{
+    struct thread *thread = current;
+    union generic_request batch_req = thread->req;
+    void *batch_data = thread->req_data;
+    const char *ptr = get_req_data(), *end = ptr + get_req_data_size();
+    data_size_t max_count = get_reply_max_size() / sizeof(unsigned int);
+    unsigned int *status = NULL, count = 0, error = STATUS_SUCCESS;
+
+    if (max_count && !(status = mem_alloc( max_count * sizeof(*status) ))) return;
+
+    while (ptr < end)
+    {
+        union generic_reply sub_reply;
+        enum request sub_req;
+        data_size_t size;
+
+        if (end - ptr < sizeof(thread->req))
+        {
+            error = STATUS_INVALID_PARAMETER;
+            break;
+        }
+        memcpy( &thread->req, ptr, sizeof(thread->req) );
+        ptr += sizeof(thread->req);
+        sub_req = thread->req.request_header.req;
+        size = thread->req.request_header.request_size;
+        if (size > end - ptr)
+        {
+            error = STATUS_INVALID_PARAMETER;
+            break;
+        }
+        thread->req.request_header.reply_size = 0;
+        thread->req_data = (void *)ptr;
+        ptr += (size + 7) & ~7;
+
+        clear_error();
+        memset( &sub_reply, 0, sizeof(sub_reply) );
+        if (debug_level) trace_request();
+
+        /* requests that wait or nest can't be part of a batch */
+        if (sub_req == REQ_batch || sub_req == REQ_select)
+            set_error( STATUS_INVALID_PARAMETER );
+        else if (sub_req < REQ_NB_REQUESTS)
+            req_handlers[sub_req]( &thread->req, &sub_reply );
+        else
+            set_error( STATUS_NOT_IMPLEMENTED );
+
+        if (count < max_count) status[count] = thread->error;
+        count++;
+        free( thread->reply_data );
+        thread->reply_data = NULL;
+        thread->reply_size = 0;
+        if (!current) break;  /* the thread got killed */
+    }
+
+    thread->req = batch_req;
+    thread->req_data = batch_data;
+    if (!current)
+    {
+        free( status );
+        return;
+    }
+    set_error( error );
+    reply->count = count;
+    if (status) set_reply_data_ptr( status, min( count, max_count ) * sizeof(*status) );
+}
+
 /* read a request from a thread */
 void read_request( struct thread *thread )
 {
@@ -1563,6 +1563,9 @@ DECL_HANDLER(queue_apc)
     case APC_CREATE_THREAD:
         process = get_process_from_handle( req->handle, PROCESS_CREATE_THREAD );
         break;
+    case APC_CLOSE_HANDLE:
+        process = get_process_from_handle( req->handle, PROCESS_DUP_HANDLE );
+        break;
     default:
         set_error( STATUS_INVALID_PARAMETER );
         break;
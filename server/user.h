@@ -62,6 +62,10 @@ struct global_cursor
     user_handle_t        win;              /* window that contains the cursor */
 };
 
+/* shared memory of a desktop, holding the state published to the clients of its threads */
+#define DESKTOP_SHARED_SIZE  0x40000  /* size of the section */
+#define DESKTOP_SHARED_UNIT  64       /* allocation granularity */
+
 struct desktop
 {
     struct object        obj;              /* object header */
@@ -77,6 +81,10 @@ struct desktop
     unsigned int         users;            /* processes and threads using this desktop */
     struct global_cursor cursor;           /* global cursor information */
     unsigned char        keystate[256];    /* asynchronous key state */
+    struct object       *shared_mapping;   /* mapping for the shared memory, created on demand */
+    desktop_shm_t       *shared;           /* desktop state, at the start of the shared memory */
+    unsigned int         shared_id;        /* unique id of the shared memory */
+    unsigned int         shared_used[DESKTOP_SHARED_SIZE / DESKTOP_SHARED_UNIT / 32]; /* allocated units */
 };
 
 /* user handles functions */
@@ -187,6 +195,11 @@ extern void set_process_default_desktop( struct process *process, struct desktop
                                          obj_handle_t handle );
 extern void close_process_desktop( struct process *process );
 extern void close_thread_desktop( struct thread *thread );
+extern desktop_shm_t *get_desktop_shared( struct desktop *desktop );
+extern void *alloc_desktop_shared( struct desktop *desktop, data_size_t size );
+extern void free_desktop_shared( struct desktop *desktop, void *ptr, data_size_t size );
+extern obj_handle_t get_desktop_shared_handle( struct desktop *desktop, const void *ptr,
+                                               unsigned int *section_id, unsigned int *offset );
 
 /* mirror a rectangle respective to the window client area */
 static inline void mirror_rect( const rectangle_t *client_rect, rectangle_t *rect )
@@ -228,6 +228,9 @@ static struct desktop *create_desktop( const struct unicode_str *name, unsigned
             desktop->users = 0;
             memset( &desktop->cursor, 0, sizeof(desktop->cursor) );
             memset( desktop->keystate, 0, sizeof(desktop->keystate) );
+            desktop->shared_mapping = NULL;
+            desktop->shared = NULL;
+            desktop->shared_id = 0;
             list_add_tail( &winstation->desktops, &desktop->entry );
             list_init( &desktop->hotkeys );
         }
@@ -289,10 +292,79 @@ static void desktop_destroy( struct object *obj )
     if (desktop->msg_window) destroy_window( desktop->msg_window );
     if (desktop->global_hooks) release_object( desktop->global_hooks );
     if (desktop->close_timeout) remove_timeout_user( desktop->close_timeout );
+    if (desktop->shared_mapping) release_shared_mapping( desktop->shared_mapping, desktop->shared );
     list_remove( &desktop->entry );
     release_object( desktop->winstation );
 }
 
+/* mark a range of units of the desktop shared memory as used or free */
+static void set_desktop_shared_units( struct desktop *desktop, unsigned int start, unsigned int count, int used )
+{
+    unsigned int i;
+
+    for (i = start; i < start + count; i++)
+    {
+        if (used) desktop->shared_used[i / 32] |= 1u << (i % 32);
+        else desktop->shared_used[i / 32] &= ~(1u << (i % 32));
+    }
+}
+
+/* return the desktop state in the desktop shared memory, creating it if needed */
+desktop_shm_t *get_desktop_shared( struct desktop *desktop )
+{
+    static unsigned int last_shared_id;
+    void *ptr;
+
+    if (desktop->shared_mapping) return desktop->shared;
+    if (!(desktop->shared_mapping = create_shared_mapping( DESKTOP_SHARED_SIZE, &ptr ))) return NULL;
+    desktop->shared = ptr;
+    desktop->shared_id = ++last_shared_id;
+    memset( desktop->shared_used, 0, sizeof(desktop->shared_used) );
+    /* the desktop state always comes first */
+    set_desktop_shared_units( desktop, 0,
+                              (sizeof(*desktop->shared) + DESKTOP_SHARED_UNIT - 1) / DESKTOP_SHARED_UNIT, 1 );
+    return desktop->shared;
+}
+
+/* allocate a zeroed block of the desktop shared memory */
+void *alloc_desktop_shared( struct desktop *desktop, data_size_t size )
+{
+    unsigned int i, start, units = (size + DESKTOP_SHARED_UNIT - 1) / DESKTOP_SHARED_UNIT;
+    char *base;
+
+    if (!get_desktop_shared( desktop )) return NULL;
+
+    /* first fit */
+    for (i = start = 0; i < DESKTOP_SHARED_SIZE / DESKTOP_SHARED_UNIT && i - start < units; i++)
+        if (desktop->shared_used[i / 32] & (1u << (i % 32))) start = i + 1;
+    if (i - start < units)
+    {
+        set_error( STATUS_NO_MEMORY );
+        return NULL;
+    }
+    set_desktop_shared_units( desktop, start, units, 1 );
+    base = (char *)desktop->shared + start * DESKTOP_SHARED_UNIT;
+    memset( base, 0, units * DESKTOP_SHARED_UNIT );
+    return base;
+}
+
+/* free a block allocated with alloc_desktop_shared */
+void free_desktop_shared( struct desktop *desktop, void *ptr, data_size_t size )
+{
+    unsigned int start = ((char *)ptr - (char *)desktop->shared) / DESKTOP_SHARED_UNIT;
+
+    set_desktop_shared_units( desktop, start, (size + DESKTOP_SHARED_UNIT - 1) / DESKTOP_SHARED_UNIT, 0 );
+}
+
+/* return a read-only handle to the shared memory of a desktop for the current process */
+obj_handle_t get_desktop_shared_handle( struct desktop *desktop, const void *ptr,
+                                        unsigned int *section_id, unsigned int *offset )
+{
+    *section_id = desktop->shared_id;
+    *offset = (const char *)ptr - (const char *)desktop->shared;
+    return alloc_handle( current->process, desktop->shared_mapping, SECTION_MAP_READ | SECTION_QUERY, 0 );
+}
+
 static unsigned int desktop_map_access( struct object *obj, unsigned int access )
 {
     if (access & GENERIC_READ)    access |= STANDARD_RIGHTS_READ | DESKTOP_READOBJECTS | DESKTOP_ENUMERATE;
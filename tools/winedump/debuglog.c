@@ -0,0 +1,177 @@
+/*
+ *  Dump a binary debug log written by ntdll (WINEDEBUGLOG)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "config.h"
+#include "wine/port.h"
+#include "winedump.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+#include "windef.h"
+#include "winbase.h"
+
+/* these must match the definitions in dlls/ntdll/debugtools.c */
+
+#define DEBUG_LOG_MAGIC        0x474c4457  /* "WDLG" */
+#define DEBUG_LOG_VERSION      1
+#define DEBUG_LOG_MAX_CHANNELS 255
+#define DEBUG_LOG_NO_CHANNEL   0xff
+#define DEBUG_LOG_NO_CLASS     0xff
+#define DEBUG_LOG_SEQ_BUSY     0x80000000
+
+struct debug_log_header
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned int chunk_size;
+    unsigned int chunk_count;
+    unsigned int unix_pid;
+    int          next_seq;
+    int          channel_count;
+    unsigned int pad;
+    char         channels[DEBUG_LOG_MAX_CHANNELS + 1][16];
+};
+
+struct debug_log_chunk
+{
+    unsigned int seq;
+    unsigned int pid;
+    unsigned int tid;
+    unsigned int used;
+};
+
+struct debug_log_record
+{
+    ULONGLONG      time;
+    unsigned short size;
+    unsigned short text_len;
+    unsigned char  cls;
+    unsigned char  channel;
+    unsigned char  func_len;
+    unsigned char  pad;
+};
+
+struct log_entry
+{
+    const struct debug_log_chunk  *chunk;
+    const struct debug_log_record *rec;
+};
+
+static int compare_entries( const void *p1, const void *p2 )
+{
+    const struct log_entry *e1 = p1, *e2 = p2;
+    unsigned int seq1 = e1->chunk->seq & ~DEBUG_LOG_SEQ_BUSY, seq2 = e2->chunk->seq & ~DEBUG_LOG_SEQ_BUSY;
+
+    if (e1->rec->time != e2->rec->time) return e1->rec->time < e2->rec->time ? -1 : 1;
+    if (seq1 != seq2) return seq1 < seq2 ? -1 : 1;
+    return e1->rec < e2->rec ? -1 : e1->rec > e2->rec;
+}
+
+/* walk the valid records of a chunk, storing them in entries if not NULL */
+static unsigned int get_chunk_records( const struct debug_log_chunk *chunk, unsigned int chunk_size,
+                                       struct log_entry *entries )
+{
+    const char *ptr = (const char *)(chunk + 1);
+    unsigned int pos = 0, count = 0;
+
+    if (!chunk->seq || chunk->used > chunk_size - sizeof(*chunk)) return 0;
+
+    while (pos + sizeof(struct debug_log_record) <= chunk->used)
+    {
+        const struct debug_log_record *rec = (const struct debug_log_record *)(ptr + pos);
+
+        /* stop at anything that looks damaged, the chunk may have been recycled while in use */
+        if (rec->size < sizeof(*rec) || pos + rec->size > chunk->used ||
+            sizeof(*rec) + rec->func_len + rec->text_len > rec->size)
+            break;
+        if (entries)
+        {
+            entries[count].chunk = chunk;
+            entries[count].rec = rec;
+        }
+        count++;
+        pos += rec->size;
+    }
+    return count;
+}
+
+enum FileSig get_kind_debuglog(void)
+{
+    const struct debug_log_header *hdr;
+
+    hdr = PRD(0, sizeof(*hdr));
+    if (hdr && hdr->magic == DEBUG_LOG_MAGIC && hdr->version == DEBUG_LOG_VERSION)
+        return SIG_DEBUGLOG;
+    return SIG_UNKNOWN;
+}
+
+void debuglog_dump(void)
+{
+    static const char * const classes[] = { "fixme", "err", "warn", "trace" };
+    const struct debug_log_header *hdr = PRD(0, sizeof(*hdr));
+    const struct debug_log_chunk *chunk;
+    struct log_entry *entries;
+    unsigned int i, count, total = 0;
+    int channels;
+
+    if (hdr->chunk_size < sizeof(*hdr) || hdr->chunk_size < sizeof(*chunk) || hdr->chunk_size % 8)
+    {
+        printf("Invalid chunk size %u\n", hdr->chunk_size);
+        return;
+    }
+    channels = hdr->channel_count < DEBUG_LOG_MAX_CHANNELS ? hdr->channel_count : DEBUG_LOG_MAX_CHANNELS;
+
+    printf("Unix pid:     %u\n", hdr->unix_pid);
+    printf("Chunks:       %u used out of %u, %u bytes each\n",
+           (unsigned int)hdr->next_seq < hdr->chunk_count ? hdr->next_seq : hdr->chunk_count,
+           hdr->chunk_count, hdr->chunk_size);
+    printf("Channels:     %d\n\n", channels);
+
+    for (i = 0; i < hdr->chunk_count; i++)
+    {
+        if (!(chunk = PRD((i + 1) * (unsigned long)hdr->chunk_size, hdr->chunk_size))) break;
+        total += get_chunk_records( chunk, hdr->chunk_size, NULL );
+    }
+    if (!total) return;
+
+    if (!(entries = malloc( total * sizeof(*entries) ))) fatal( "Out of memory" );
+    for (i = count = 0; i < hdr->chunk_count; i++)
+    {
+        if (!(chunk = PRD((i + 1) * (unsigned long)hdr->chunk_size, hdr->chunk_size))) break;
+        count += get_chunk_records( chunk, hdr->chunk_size, entries + count );
+    }
+    qsort( entries, count, sizeof(*entries), compare_entries );
+
+    for (i = 0; i < count; i++)
+    {
+        const struct debug_log_record *rec = entries[i].rec;
+        const char *func = (const char *)(rec + 1);
+        const char *text = func + rec->func_len;
+
+        printf("%u.%07u:%04x:%04x:", (unsigned int)(rec->time / 10000000),
+               (unsigned int)(rec->time % 10000000), entries[i].chunk->pid, entries[i].chunk->tid);
+        if (rec->cls < sizeof(classes)/sizeof(classes[0]))
+            printf("%s:%.16s:%.*s ", classes[rec->cls],
+                   rec->channel < channels ? hdr->channels[rec->channel] : "?",
+                   rec->func_len, func);
+        printf("%.*s\n", rec->text_len, text);
+    }
+    free( entries );
+}